@@ -3,11 +3,12 @@
 
 using namespace SampleFramework11;
 
-static const char* SceneLabels[3] =
+static const char* SceneLabels[4] =
 {
     "PowerPlant",
     "Tower",
     "Columns",
+    "Stress",
 };
 
 static const char* PartitionModeLabels[3] =
@@ -23,17 +24,26 @@ static const char* CascadeSelectionModesLabels[2] =
     "Projection",
 };
 
-static const char* ShadowModeLabels[9] =
+static const char* ShadowMaskModesLabels[3] =
+{
+    "Disabled",
+    "Full Resolution",
+    "Half Resolution",
+};
+
+static const char* ShadowModeLabels[11] =
 {
     "Fixed Size PCF",
     "Grid PCF",
     "Random Disc PCF",
     "Optimized PCF",
+    "PCSS",
     "VSM",
     "EVSM 2 Component",
     "EVSM 4 Component",
     "MSM Hamburger",
     "MSM Hausdorff",
+    "ESM",
 };
 
 static const char* ShadowMapSizeLabels[3] =
@@ -50,13 +60,16 @@ static const char* DepthBufferFormatsLabels[3] =
     "32-bit FLOAT",
 };
 
-static const char* FixedFilterSizeLabels[5] =
+static const char* FixedFilterSizeLabels[8] =
 {
     "2x2",
     "3x3",
     "5x5",
     "7x7",
     "9x9",
+    "11x11",
+    "13x13",
+    "15x15",
 };
 
 static const char* ShadowMSAALabels[4] =
@@ -67,10 +80,12 @@ static const char* ShadowMSAALabels[4] =
     "8x",
 };
 
-static const char* SMFormatLabels[2] =
+static const char* SMFormatLabels[4] =
 {
     "16-bit",
     "32-bit",
+    "16-bit (Optimized Basis)",
+    "16-bit (Raw Moments)",
 };
 
 static const char* ShadowAnisotropyLabels[5] =
@@ -90,11 +105,17 @@ namespace AppSettings
     ColorSetting LightColor;
     OrientationSetting CharacterOrientation;
     BoolSetting EnableAlbedoMap;
+    IntSetting NumPropInstances;
     BoolSetting StabilizeCascades;
+    BoolSetting PerspectiveWarp;
     BoolSetting FilterAcrossCascades;
     BoolSetting AutoComputeDepthBounds;
     IntSetting ReadbackLatency;
     BoolSetting GPUSceneSubmission;
+    BoolSetting CacheStaticShadows;
+    BoolSetting QuantizedDepthPositions;
+    BoolSetting ShadowCasterLODs;
+    FloatSetting ShadowLODErrorTexels;
     FloatSetting MinCascadeDistance;
     FloatSetting MaxCascadeDistance;
     PartitionModeSetting PartitionMode;
@@ -106,11 +127,17 @@ namespace AppSettings
     CascadeSelectionModesSetting CascadeSelectionMode;
     ShadowModeSetting ShadowMode;
     ShadowMapSizeSetting ShadowMapSize;
+    BoolSetting CharacterShadowMap;
+    ShadowMapSizeSetting CharacterShadowMapSize;
+    ShadowMaskModesSetting ShadowMaskMode;
+    BoolSetting TemporalShadowAccumulation;
+    IntSetting TemporalHistoryFrames;
     DepthBufferFormatsSetting DepthBufferFormat;
     FixedFilterSizeSetting FixedFilterSize;
     FloatSetting FilterSize;
     BoolSetting RandomizeDiscOffsets;
     IntSetting NumDiscSamples;
+    FloatSetting PCSSLightSize;
     BoolSetting UsePlaneDepthBias;
     FloatSetting Bias;
     FloatSetting VSMBias;
@@ -145,7 +172,7 @@ namespace AppSettings
     {
         TwBar* tweakBar = Settings.TweakBar();
 
-        CurrentScene.Initialize(tweakBar, "CurrentScene", "SceneControls", "Current Scene", "The scene to render", Scene::PowerPlant, 3, SceneLabels);
+        CurrentScene.Initialize(tweakBar, "CurrentScene", "SceneControls", "Current Scene", "The scene to render", Scene::PowerPlant, 4, SceneLabels);
         Settings.AddSetting(&CurrentScene);
 
         AnimateLight.Initialize(tweakBar, "AnimateLight", "SceneControls", "Animate Light", "Automatically rotates the light about the Y axis", false);
@@ -163,9 +190,15 @@ namespace AppSettings
         EnableAlbedoMap.Initialize(tweakBar, "EnableAlbedoMap", "SceneControls", "Enable Albedo Map", "Enables using albedo maps when rendering the scene", true);
         Settings.AddSetting(&EnableAlbedoMap);
 
+        NumPropInstances.Initialize(tweakBar, "NumPropInstances", "SceneControls", "Num Prop Instances", "Number of copies of a prop that get scattered around the scene and drawn with instancing, with the instances culled per part on the CPU", 0, 0, 20000);
+        Settings.AddSetting(&NumPropInstances);
+
         StabilizeCascades.Initialize(tweakBar, "StabilizeCascades", "CascadeControls", "Stabilize Cascades", "Keeps consistent sizes for each cascade, and snaps each cascade so that they move in texel-sized increments. Reduces temporal aliasing artifacts, but reduces the effective resolution of the cascades", false);
         Settings.AddSetting(&StabilizeCascades);
 
+        PerspectiveWarp.Initialize(tweakBar, "PerspectiveWarp", "CascadeControls", "Perspective Warp", "Warps each cascade with a light space perspective projection (LiSPSM) so that more of its resolution goes to the part of the cascade that's closest to the camera. Can't be combined with cascade stabilization", false);
+        Settings.AddSetting(&PerspectiveWarp);
+
         FilterAcrossCascades.Initialize(tweakBar, "FilterAcrossCascades", "CascadeControls", "Filter Across Cascades", "Enables blending across cascade boundaries to reduce the appearance of seams", false);
         Settings.AddSetting(&FilterAcrossCascades);
 
@@ -178,6 +211,18 @@ namespace AppSettings
         GPUSceneSubmission.Initialize(tweakBar, "GPUSceneSubmission", "CascadeControls", "GPU Scene Submission", "Uses compute shaders to handle shadow setup and mesh batching to minimize draw calls and avoid depth readback latency", false);
         Settings.AddSetting(&GPUSceneSubmission);
 
+        CacheStaticShadows.Initialize(tweakBar, "CacheStaticShadows", "CascadeControls", "Cache Static Shadows", "Renders the static scene into a per-cascade depth cache that only gets updated when the cascade matrix changes, so that only the character gets drawn into the shadow map every frame", false);
+        Settings.AddSetting(&CacheStaticShadows);
+
+        QuantizedDepthPositions.Initialize(tweakBar, "QuantizedDepthPositions", "CascadeControls", "Quantized Depth Positions", "Renders depth and shadows from a position-only stream stored as 16-bit UNORM relative to the bounds of the mesh, instead of 32-bit floats", false);
+        Settings.AddSetting(&QuantizedDepthPositions);
+
+        ShadowCasterLODs.Initialize(tweakBar, "ShadowCasterLODs", "CascadeControls", "Shadow Caster LODs", "Renders simplified versions of the meshes into the cascades, picking the level of detail for each part from the size of a shadow map texel", false);
+        Settings.AddSetting(&ShadowCasterLODs);
+
+        ShadowLODErrorTexels.Initialize(tweakBar, "ShadowLODErrorTexels", "CascadeControls", "Shadow LOD Error (Texels)", "The largest error that a shadow caster level of detail can have, in shadow map texels", 1.0000f, 0.1000f, 8.0000f, 0.1000f);
+        Settings.AddSetting(&ShadowLODErrorTexels);
+
         MinCascadeDistance.Initialize(tweakBar, "MinCascadeDistance", "CascadeControls", "Min Cascade Distance", "The closest depth that is covered by the shadow cascades", 0.0000f, 0.0000f, 0.1000f, 0.0010f);
         Settings.AddSetting(&MinCascadeDistance);
 
@@ -205,16 +250,31 @@ namespace AppSettings
         CascadeSelectionMode.Initialize(tweakBar, "CascadeSelectionMode", "CascadeControls", "Cascade Selection Mode", "Controls how cascades are selected per-pixel in the shader", CascadeSelectionModes::SplitDepth, 2, CascadeSelectionModesLabels);
         Settings.AddSetting(&CascadeSelectionMode);
 
-        ShadowMode.Initialize(tweakBar, "ShadowMode", "Shadows", "Shadow Mode", "The shadow mapping technique to use", ShadowMode::FixedSizePCF, 9, ShadowModeLabels);
+        ShadowMode.Initialize(tweakBar, "ShadowMode", "Shadows", "Shadow Mode", "The shadow mapping technique to use", ShadowMode::FixedSizePCF, 11, ShadowModeLabels);
         Settings.AddSetting(&ShadowMode);
 
         ShadowMapSize.Initialize(tweakBar, "ShadowMapSize", "Shadows", "Shadow Map Size", "The size of the shadow map", ShadowMapSize::SMSize2048, 3, ShadowMapSizeLabels);
         Settings.AddSetting(&ShadowMapSize);
 
+        CharacterShadowMap.Initialize(tweakBar, "CharacterShadowMap", "Shadows", "Character Shadow Map", "Renders the character into its own shadow map with a projection fitted to its bounds, instead of into the cascades", false);
+        Settings.AddSetting(&CharacterShadowMap);
+
+        CharacterShadowMapSize.Initialize(tweakBar, "CharacterShadowMapSize", "Shadows", "Character Shadow Map Size", "The size of the character's shadow map", ShadowMapSize::SMSize512, 3, ShadowMapSizeLabels);
+        Settings.AddSetting(&CharacterShadowMapSize);
+
+        ShadowMaskMode.Initialize(tweakBar, "ShadowMaskMode", "Shadows", "Shadow Mask", "Evaluates the shadows in a separate full-screen pass from the depth buffer, instead of for every pixel shaded in the forward pass. At half resolution the mask gets upsampled with a depth-aware bilateral filter.", ShadowMaskModes::Disabled, 3, ShadowMaskModesLabels);
+        Settings.AddSetting(&ShadowMaskMode);
+
+        TemporalShadowAccumulation.Initialize(tweakBar, "TemporalShadowAccumulation", "Shadows", "Temporal Accumulation", "Blends the shadow mask with the previous frames, reprojected with the last frame's camera. The random rotation of the sample pattern changes every frame, so that noisy filters like randomized disc PCF converge to a smooth result over time.", false);
+        Settings.AddSetting(&TemporalShadowAccumulation);
+
+        TemporalHistoryFrames.Initialize(tweakBar, "TemporalHistoryFrames", "Shadows", "Temporal History Frames", "Roughly how many frames get averaged together by temporal accumulation", 8, 1, 64);
+        Settings.AddSetting(&TemporalHistoryFrames);
+
         DepthBufferFormat.Initialize(tweakBar, "DepthBufferFormat", "Shadows", "Depth Buffer Format", "The surface format used for the shadow depth buffer", DepthBufferFormats::DB32Float, 3, DepthBufferFormatsLabels);
         Settings.AddSetting(&DepthBufferFormat);
 
-        FixedFilterSize.Initialize(tweakBar, "FixedFilterSize", "Shadows", "Fixed Filter Size", "Size of the PCF kernel used for Fixed Sized PCF shadow mode", FixedFilterSize::Filter2x2, 5, FixedFilterSizeLabels);
+        FixedFilterSize.Initialize(tweakBar, "FixedFilterSize", "Shadows", "Fixed Filter Size", "Size of the PCF kernel used for Fixed Sized PCF shadow mode", FixedFilterSize::Filter2x2, 8, FixedFilterSizeLabels);
         Settings.AddSetting(&FixedFilterSize);
 
         FilterSize.Initialize(tweakBar, "FilterSize", "Shadows", "Filter Size", "Width of the filter kernel used for PCF or VSM filtering", 0.0000f, 0.0000f, 100.0000f, 0.1000f);
@@ -223,9 +283,12 @@ namespace AppSettings
         RandomizeDiscOffsets.Initialize(tweakBar, "RandomizeDiscOffsets", "Shadows", "Randomize Disc Offsets", "Applies a per-pixel random rotation to the sample locations when using disc PCF", false);
         Settings.AddSetting(&RandomizeDiscOffsets);
 
-        NumDiscSamples.Initialize(tweakBar, "NumDiscSamples", "Shadows", "Num Disc Samples", "Number of samples to take when using randomized disc PCF", 16, 1, 64);
+        NumDiscSamples.Initialize(tweakBar, "NumDiscSamples", "Shadows", "Num Disc Samples", "Number of samples to take when using randomized disc PCF", 8, 1, 64);
         Settings.AddSetting(&NumDiscSamples);
 
+        PCSSLightSize.Initialize(tweakBar, "PCSSLightSize", "Shadows", "PCSS Light Size", "Width of the PCSS penumbra per world unit of distance between the blocker and the receiver", 0.0500f, 0.0000f, 0.5000f, 0.0010f);
+        Settings.AddSetting(&PCSSLightSize);
+
         UsePlaneDepthBias.Initialize(tweakBar, "UsePlaneDepthBias", "Shadows", "Use Receiver Plane Depth Bias", "Automatically computes a bias value based on the slope of the receiver", true);
         Settings.AddSetting(&UsePlaneDepthBias);
 
@@ -241,7 +304,7 @@ namespace AppSettings
         ShadowMSAA.Initialize(tweakBar, "ShadowMSAA", "Shadows", "Shadow MSAA", "MSAA mode to use for VSM or MSM shadow maps", ShadowMSAA::MSAANone, 4, ShadowMSAALabels);
         Settings.AddSetting(&ShadowMSAA);
 
-        SMFormat.Initialize(tweakBar, "SMFormat", "Shadows", "VSM/MSM Format", "Texture format to use for VSM or <SM shadow maps", SMFormat::SM32Bit, 2, SMFormatLabels);
+        SMFormat.Initialize(tweakBar, "SMFormat", "Shadows", "VSM/MSM Format", "Texture format to use for VSM or <SM shadow maps", SMFormat::SM32Bit, 4, SMFormatLabels);
         Settings.AddSetting(&SMFormat);
 
         ShadowAnisotropy.Initialize(tweakBar, "ShadowAnisotropy", "Shadows", "Shadow Anisotropy", "Level of anisotropic filtering to use when sampling VSM shadow maps", ShadowAnisotropy::Anisotropy1x, 5, ShadowAnisotropyLabels);
@@ -250,7 +313,7 @@ namespace AppSettings
         EnableShadowMips.Initialize(tweakBar, "EnableShadowMips", "Shadows", "Enable Shadow Mip Maps", "Generates mip maps when using VSM or MSM", false);
         Settings.AddSetting(&EnableShadowMips);
 
-        PositiveExponent.Initialize(tweakBar, "PositiveExponent", "Shadows", "EVSM Positive Exponent", "Exponent used for the positive EVSM warp", 40.0000f, 0.0000f, 100.0000f, 0.1000f);
+        PositiveExponent.Initialize(tweakBar, "PositiveExponent", "Shadows", "EVSM Positive Exponent", "Exponent used for the positive EVSM warp, and for the ESM warp", 40.0000f, 0.0000f, 100.0000f, 0.1000f);
         Settings.AddSetting(&PositiveExponent);
 
         NegativeExponent.Initialize(tweakBar, "NegativeExponent", "Shadows", "EVSM Negative Exponent", "Exponent used for the negative EVSM warp", 5.0000f, 0.0000f, 100.0000f, 0.1000f);
@@ -316,6 +379,7 @@ namespace AppSettings
         CBuffer.Data.LightColor = LightColor;
         CBuffer.Data.EnableAlbedoMap = EnableAlbedoMap;
         CBuffer.Data.StabilizeCascades = StabilizeCascades;
+        CBuffer.Data.PerspectiveWarp = PerspectiveWarp;
         CBuffer.Data.AutoComputeDepthBounds = AutoComputeDepthBounds;
         CBuffer.Data.MinCascadeDistance = MinCascadeDistance;
         CBuffer.Data.MaxCascadeDistance = MaxCascadeDistance;
@@ -329,6 +393,7 @@ namespace AppSettings
         CBuffer.Data.DepthBufferFormat = DepthBufferFormat;
         CBuffer.Data.FilterSize = FilterSize;
         CBuffer.Data.NumDiscSamples = NumDiscSamples;
+        CBuffer.Data.PCSSLightSize = PCSSLightSize;
         CBuffer.Data.Bias = Bias;
         CBuffer.Data.VSMBias = VSMBias;
         CBuffer.Data.OffsetScale = OffsetScale;
@@ -365,22 +430,32 @@ namespace AppSettings
         bool enableVSM = UseVSM();
         bool enableEVSM = UseEVSM();
         bool enableMSM = UseMSM();
+        bool enableESM = UseESM();
         bool enableFilterableShadows = UseFilterableShadows();
         bool enableMinMaxDepth = AutoComputeDepthBounds == false;
+        bool enablePCSS = ShadowMode == ShadowMode::PCSS;
+        bool enableDiscSamples = ShadowMode == ShadowMode::RandomDiscPCF || enablePCSS;
 
         SplitDistance0.SetEditable(enableSplits);
         SplitDistance1.SetEditable(enableSplits);
         SplitDistance2.SetEditable(enableSplits);
         SplitDistance3.SetEditable(enableSplits);
         PSSMLambda.SetEditable(enableLambda);
-        PositiveExponent.SetEditable(enableEVSM);
+        PositiveExponent.SetEditable(enableEVSM || enableESM);
         NegativeExponent.SetEditable(enableEVSM);
         LightBleedingReduction.SetEditable(enableFilterableShadows);
-        FilterSize.SetEditable(ShadowMode != ShadowMode::FixedSizePCF && ShadowMode != ShadowMode::OptimizedPCF);
+        FilterSize.SetEditable(ShadowMode != ShadowMode::FixedSizePCF && ShadowMode != ShadowMode::OptimizedPCF
+                               && enablePCSS == false);
         ReadbackLatency.SetEditable(enableMinMaxDepth == false && GPUSceneSubmission == false);
+        CacheStaticShadows.SetEditable(GPUSceneSubmission == false);
+        CharacterShadowMapSize.SetEditable(CharacterShadowMap);
+        StabilizeCascades.SetEditable(PerspectiveWarp == false);
+        TemporalShadowAccumulation.SetEditable(ShadowMaskMode != ShadowMaskModes::Disabled);
+        TemporalHistoryFrames.SetEditable(UseTemporalShadows());
         Bias.SetEditable(UsePlaneDepthBias == false);
-        NumDiscSamples.SetEditable(ShadowMode == ShadowMode::RandomDiscPCF);
-        RandomizeDiscOffsets.SetEditable(ShadowMode == ShadowMode::RandomDiscPCF);
+        NumDiscSamples.SetEditable(enableDiscSamples);
+        RandomizeDiscOffsets.SetEditable(enableDiscSamples);
+        PCSSLightSize.SetEditable(enablePCSS);
         MinCascadeDistance.SetEditable(enableMinMaxDepth);
         MaxCascadeDistance.SetEditable(enableMinMaxDepth);
         FixedFilterSize.SetEditable(ShadowMode == ShadowMode::FixedSizePCF || ShadowMode == ShadowMode::OptimizedPCF);
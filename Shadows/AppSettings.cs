@@ -12,6 +12,9 @@ enum ShadowMode
     [EnumLabel("Optimized PCF")]
     OptimizedPCF,
 
+    [EnumLabel("PCSS")]
+    PCSS,
+
     [EnumLabel("VSM")]
     VSM,
 
@@ -26,6 +29,9 @@ enum ShadowMode
 
     [EnumLabel("MSM Hausdorff")]
     MSMHausdorff,
+
+    [EnumLabel("ESM")]
+    ESM,
 }
 
 enum Scene
@@ -33,6 +39,7 @@ enum Scene
     PowerPlant = 0,
     Tower = 1,
     Columns = 2,
+    Stress = 3,
 }
 
 enum PartitionMode
@@ -58,6 +65,15 @@ enum FixedFilterSize
 
     [EnumLabel("9x9")]
     Filter9x9,
+
+    [EnumLabel("11x11")]
+    Filter11x11,
+
+    [EnumLabel("13x13")]
+    Filter13x13,
+
+    [EnumLabel("15x15")]
+    Filter15x15,
 }
 
 enum ShadowMapSize
@@ -94,6 +110,12 @@ enum SMFormat
 
     [EnumLabel("32-bit")]
     SM32Bit,
+
+    [EnumLabel("16-bit (Optimized Basis)")]
+    SM16BitOptimized,
+
+    [EnumLabel("16-bit (Raw Moments)")]
+    SM16BitRaw,
 };
 
 enum ShadowAnisotropy
@@ -123,6 +145,18 @@ enum CascadeSelectionModes
     Projection,
 };
 
+enum ShadowMaskModes
+{
+    [EnumLabel("Disabled")]
+    Disabled = 0,
+
+    [EnumLabel("Full Resolution")]
+    FullResolution,
+
+    [EnumLabel("Half Resolution")]
+    HalfResolution,
+};
+
 enum DepthBufferFormats
 {
     [EnumLabel("16-bit UNORM")]
@@ -169,6 +203,14 @@ public class Settings
         [DisplayName("Enable Albedo Map")]
         [HelpText("Enables using albedo maps when rendering the scene")]
         bool EnableAlbedoMap = true;
+
+        [DisplayName("Num Prop Instances")]
+        [HelpText("Number of copies of a prop that get scattered around the scene and drawn with " +
+                  "instancing, with the instances culled per part on the CPU")]
+        [MinValue(0)]
+        [MaxValue(20000)]
+        [UseAsShaderConstant(false)]
+        int NumPropInstances = 0;
     }
 
     public class CascadeControls
@@ -179,6 +221,12 @@ public class Settings
                   "reduces the effective resolution of the cascades")]
         bool StabilizeCascades = false;
 
+        [DisplayName("Perspective Warp")]
+        [HelpText("Warps each cascade with a light space perspective projection (LiSPSM) so that more of " +
+                  "its resolution goes to the part of the cascade that's closest to the camera. " +
+                  "Can't be combined with cascade stabilization")]
+        bool PerspectiveWarp = false;
+
         [DisplayName("Filter Across Cascades")]
         [HelpText("Enables blending across cascade boundaries to reduce the appearance of seams")]
         [UseAsShaderConstant(false)]
@@ -202,6 +250,32 @@ public class Settings
         [UseAsShaderConstant(false)]
         bool GPUSceneSubmission = false;
 
+        [DisplayName("Cache Static Shadows")]
+        [HelpText("Renders the static scene into a per-cascade depth cache that only gets updated when the " +
+                  "cascade matrix changes, so that only the character gets drawn into the shadow map every frame")]
+        [UseAsShaderConstant(false)]
+        bool CacheStaticShadows = false;
+
+        [DisplayName("Quantized Depth Positions")]
+        [HelpText("Renders depth and shadows from a position-only stream stored as 16-bit UNORM relative to the " +
+                  "bounds of the mesh, instead of 32-bit floats")]
+        [UseAsShaderConstant(false)]
+        bool QuantizedDepthPositions = false;
+
+        [DisplayName("Shadow Caster LODs")]
+        [HelpText("Renders simplified versions of the meshes into the cascades, picking the level of detail " +
+                  "for each part from the size of a shadow map texel")]
+        [UseAsShaderConstant(false)]
+        bool ShadowCasterLODs = false;
+
+        [DisplayName("Shadow LOD Error (Texels)")]
+        [HelpText("The largest error that a shadow caster level of detail can have, in shadow map texels")]
+        [MinValue(0.1f)]
+        [MaxValue(8.0f)]
+        [StepSize(0.1f)]
+        [UseAsShaderConstant(false)]
+        float ShadowLODErrorTexels = 1.0f;
+
         [DisplayName("Min Cascade Distance")]
         [HelpText("The closest depth that is covered by the shadow cascades")]
         [MinValue(0.0f)]
@@ -273,6 +347,33 @@ public class Settings
         [HelpText("The size of the shadow map")]
         ShadowMapSize ShadowMapSize = ShadowMapSize.SMSize2048;
 
+        [DisplayName("Character Shadow Map")]
+        [HelpText("Renders the character into its own shadow map with a projection fitted to its bounds, instead of into the cascades")]
+        [UseAsShaderConstant(false)]
+        bool CharacterShadowMap = false;
+
+        [DisplayName("Character Shadow Map Size")]
+        [HelpText("The size of the character's shadow map")]
+        [UseAsShaderConstant(false)]
+        ShadowMapSize CharacterShadowMapSize = ShadowMapSize.SMSize512;
+
+        [DisplayName("Shadow Mask")]
+        [HelpText("Evaluates the shadows in a separate full-screen pass from the depth buffer, instead of for every pixel shaded in the forward pass. At half resolution the mask gets upsampled with a depth-aware bilateral filter.")]
+        [UseAsShaderConstant(false)]
+        ShadowMaskModes ShadowMaskMode = ShadowMaskModes.Disabled;
+
+        [DisplayName("Temporal Accumulation")]
+        [HelpText("Blends the shadow mask with the previous frames, reprojected with the last frame's camera. The random rotation of the sample pattern changes every frame, so that noisy filters like randomized disc PCF converge to a smooth result over time.")]
+        [UseAsShaderConstant(false)]
+        bool TemporalShadowAccumulation = false;
+
+        [DisplayName("Temporal History Frames")]
+        [MinValue(1)]
+        [MaxValue(64)]
+        [HelpText("Roughly how many frames get averaged together by temporal accumulation")]
+        [UseAsShaderConstant(false)]
+        int TemporalHistoryFrames = 8;
+
         [DisplayName("Depth Buffer Format")]
         [HelpText("The surface format used for the shadow depth buffer")]
         DepthBufferFormats DepthBufferFormat = DepthBufferFormats.DB32Float;
@@ -298,7 +399,14 @@ public class Settings
         [MinValue(1)]
         [MaxValue(64)]
         [HelpText("Number of samples to take when using randomized disc PCF")]
-        int NumDiscSamples = 16;
+        int NumDiscSamples = 8;
+
+        [DisplayName("PCSS Light Size")]
+        [MinValue(0.0f)]
+        [MaxValue(0.5f)]
+        [StepSize(0.001f)]
+        [HelpText("Width of the PCSS penumbra per world unit of distance between the blocker and the receiver")]
+        float PCSSLightSize = 0.05f;
 
         [DisplayName("Use Receiver Plane Depth Bias")]
         [HelpText("Automatically computes a bias value based on the slope of the receiver")]
@@ -349,7 +457,7 @@ public class Settings
         [MinValue(0.0f)]
         [MaxValue(100.0f)]
         [StepSize(0.1f)]
-        [HelpText("Exponent used for the positive EVSM warp")]
+        [HelpText("Exponent used for the positive EVSM warp, and for the ESM warp")]
         float PositiveExponent = 40.0f;
 
         [DisplayName("EVSM Negative Exponent")]
@@ -11,6 +11,7 @@ enum class Scene
     PowerPlant = 0,
     Tower = 1,
     Columns = 2,
+    Stress = 3,
 
     NumValues
 };
@@ -38,17 +39,30 @@ enum class CascadeSelectionModes
 
 typedef EnumSettingT<CascadeSelectionModes> CascadeSelectionModesSetting;
 
+enum class ShadowMaskModes
+{
+    Disabled = 0,
+    FullResolution = 1,
+    HalfResolution = 2,
+
+    NumValues
+};
+
+typedef EnumSettingT<ShadowMaskModes> ShadowMaskModesSetting;
+
 enum class ShadowMode
 {
     FixedSizePCF = 0,
     GridPCF = 1,
     RandomDiscPCF = 2,
     OptimizedPCF = 3,
-    VSM = 4,
-    EVSM2 = 5,
-    EVSM4 = 6,
-    MSMHamburger = 7,
-    MSMHausdorff = 8,
+    PCSS = 4,
+    VSM = 5,
+    EVSM2 = 6,
+    EVSM4 = 7,
+    MSMHamburger = 8,
+    MSMHausdorff = 9,
+    ESM = 10,
 
     NumValues
 };
@@ -84,6 +98,9 @@ enum class FixedFilterSize
     Filter5x5 = 2,
     Filter7x7 = 3,
     Filter9x9 = 4,
+    Filter11x11 = 5,
+    Filter13x13 = 6,
+    Filter15x15 = 7,
 
     NumValues
 };
@@ -106,6 +123,8 @@ enum class SMFormat
 {
     SM16Bit = 0,
     SM32Bit = 1,
+    SM16BitOptimized = 2,
+    SM16BitRaw = 3,
 
     NumValues
 };
@@ -133,11 +152,17 @@ namespace AppSettings
     extern ColorSetting LightColor;
     extern OrientationSetting CharacterOrientation;
     extern BoolSetting EnableAlbedoMap;
+    extern IntSetting NumPropInstances;
     extern BoolSetting StabilizeCascades;
+    extern BoolSetting PerspectiveWarp;
     extern BoolSetting FilterAcrossCascades;
     extern BoolSetting AutoComputeDepthBounds;
     extern IntSetting ReadbackLatency;
     extern BoolSetting GPUSceneSubmission;
+    extern BoolSetting CacheStaticShadows;
+    extern BoolSetting QuantizedDepthPositions;
+    extern BoolSetting ShadowCasterLODs;
+    extern FloatSetting ShadowLODErrorTexels;
     extern FloatSetting MinCascadeDistance;
     extern FloatSetting MaxCascadeDistance;
     extern PartitionModeSetting PartitionMode;
@@ -149,11 +174,17 @@ namespace AppSettings
     extern CascadeSelectionModesSetting CascadeSelectionMode;
     extern ShadowModeSetting ShadowMode;
     extern ShadowMapSizeSetting ShadowMapSize;
+    extern BoolSetting CharacterShadowMap;
+    extern ShadowMapSizeSetting CharacterShadowMapSize;
+    extern ShadowMaskModesSetting ShadowMaskMode;
+    extern BoolSetting TemporalShadowAccumulation;
+    extern IntSetting TemporalHistoryFrames;
     extern DepthBufferFormatsSetting DepthBufferFormat;
     extern FixedFilterSizeSetting FixedFilterSize;
     extern FloatSetting FilterSize;
     extern BoolSetting RandomizeDiscOffsets;
     extern IntSetting NumDiscSamples;
+    extern FloatSetting PCSSLightSize;
     extern BoolSetting UsePlaneDepthBias;
     extern FloatSetting Bias;
     extern FloatSetting VSMBias;
@@ -188,6 +219,7 @@ namespace AppSettings
         Float4Align Float3 LightColor;
         bool32 EnableAlbedoMap;
         bool32 StabilizeCascades;
+        bool32 PerspectiveWarp;
         bool32 AutoComputeDepthBounds;
         float MinCascadeDistance;
         float MaxCascadeDistance;
@@ -201,6 +233,7 @@ namespace AppSettings
         int32 DepthBufferFormat;
         float FilterSize;
         int32 NumDiscSamples;
+        float PCSSLightSize;
         float Bias;
         float VSMBias;
         float OffsetScale;
@@ -231,7 +264,7 @@ namespace AppSettings
 
     inline uint32 FixedFilterKernelSize(uint32 value)
     {
-        static const uint32 KernelSizes[] = { 2, 3, 5, 7, 9 };
+        static const uint32 KernelSizes[] = { 2, 3, 5, 7, 9, 11, 13, 15 };
         StaticAssert_(_countof(KernelSizes) >= uint64(FixedFilterSize::NumValues));
         return KernelSizes[value];
     }
@@ -286,9 +319,19 @@ namespace AppSettings
         return UseMSM(ShadowMode);
     }
 
+    inline bool UseESM(uint32 value)
+    {
+        return value == uint32(ShadowMode::ESM);
+    }
+
+    inline bool UseESM()
+    {
+        return UseESM(ShadowMode);
+    }
+
     inline bool UseFilterableShadows(uint32 value)
     {
-        return UseVSM(value) || UseMSM(value);
+        return UseVSM(value) || UseMSM(value) || UseESM(value);
     }
 
     inline bool UseFilterableShadows()
@@ -320,5 +363,21 @@ namespace AppSettings
         return NumAnisotropicSamples(ShadowAnisotropy);
     }
 
+    inline bool UseShadowMask()
+    {
+        return ShadowMaskMode != ShadowMaskModes::Disabled;
+    }
+
+    // Number of screen pixels per shadow mask texel along each axis
+    inline uint32 ShadowMaskScale()
+    {
+        return ShadowMaskMode == ShadowMaskModes::HalfResolution ? 2 : 1;
+    }
+
+    inline bool UseTemporalShadows()
+    {
+        return UseShadowMask() && TemporalShadowAccumulation;
+    }
+
     void Update();
 }
\ No newline at end of file
@@ -4,6 +4,7 @@ cbuffer AppSettings : register(b7)
     float3 LightColor;
     bool EnableAlbedoMap;
     bool StabilizeCascades;
+    bool PerspectiveWarp;
     bool AutoComputeDepthBounds;
     float MinCascadeDistance;
     float MaxCascadeDistance;
@@ -17,6 +18,7 @@ cbuffer AppSettings : register(b7)
     int DepthBufferFormat;
     float FilterSize;
     int NumDiscSamples;
+    float PCSSLightSize;
     float Bias;
     float VSMBias;
     float OffsetScale;
@@ -44,15 +46,21 @@ static const int PartitionMode_PSSM = 2;
 static const int CascadeSelectionModes_SplitDepth = 0;
 static const int CascadeSelectionModes_Projection = 1;
 
+static const int ShadowMaskModes_Disabled = 0;
+static const int ShadowMaskModes_FullResolution = 1;
+static const int ShadowMaskModes_HalfResolution = 2;
+
 static const int ShadowMode_FixedSizePCF = 0;
 static const int ShadowMode_GridPCF = 1;
 static const int ShadowMode_RandomDiscPCF = 2;
 static const int ShadowMode_OptimizedPCF = 3;
-static const int ShadowMode_VSM = 4;
-static const int ShadowMode_EVSM2 = 5;
-static const int ShadowMode_EVSM4 = 6;
-static const int ShadowMode_MSMHamburger = 7;
-static const int ShadowMode_MSMHausdorff = 8;
+static const int ShadowMode_PCSS = 4;
+static const int ShadowMode_VSM = 5;
+static const int ShadowMode_EVSM2 = 6;
+static const int ShadowMode_EVSM4 = 7;
+static const int ShadowMode_MSMHamburger = 8;
+static const int ShadowMode_MSMHausdorff = 9;
+static const int ShadowMode_ESM = 10;
 
 static const int ShadowMapSize_SMSize512 = 0;
 static const int ShadowMapSize_SMSize1024 = 1;
@@ -67,6 +75,9 @@ static const int FixedFilterSize_Filter3x3 = 1;
 static const int FixedFilterSize_Filter5x5 = 2;
 static const int FixedFilterSize_Filter7x7 = 3;
 static const int FixedFilterSize_Filter9x9 = 4;
+static const int FixedFilterSize_Filter11x11 = 5;
+static const int FixedFilterSize_Filter13x13 = 6;
+static const int FixedFilterSize_Filter15x15 = 7;
 
 static const int ShadowMSAA_MSAANone = 0;
 static const int ShadowMSAA_MSAA2x = 1;
@@ -75,6 +86,8 @@ static const int ShadowMSAA_MSAA8x = 3;
 
 static const int SMFormat_SM16Bit = 0;
 static const int SMFormat_SM32Bit = 1;
+static const int SMFormat_SM16BitOptimized = 2;
+static const int SMFormat_SM16BitRaw = 3;
 
 static const int ShadowAnisotropy_Anisotropy1x = 0;
 static const int ShadowAnisotropy_Anisotropy2x = 1;
@@ -0,0 +1,561 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include <emmintrin.h>
+#include <future>
+#include <thread>
+
+#include "BVH.h"
+#include "VertexCompression.h"
+
+#include "SampleFramework11/Timer.h"
+
+// Build parameters
+static const uint32 NumBins = 16;
+static const uint32 MaxLeafTriangles = 8;
+static const uint32 MaxBuildDepth = 60;
+static const uint32 MaxLeafCount = UINT16_MAX;
+static const uint32 ParallelBuildThreshold = 4096;
+static const float TraversalCost = 1.0f;
+static const float IntersectionCost = 1.0f;
+
+// Nodes past MaxBuildDepth with more than MaxLeafCount triangles get split in half, which takes
+// at most this many more levels for a 32-bit triangle count
+static const uint32 MaxMedianSplitDepth = 17;
+
+// Traversal stack, which needs to be deeper than the deepest leaf
+static const uint32 MaxStackSize = MaxBuildDepth + MaxMedianSplitDepth + 4;
+
+struct AABB
+{
+    Float3 Min;
+    Float3 Max;
+
+    AABB() : Min(FLT_MAX, FLT_MAX, FLT_MAX), Max(-FLT_MAX, -FLT_MAX, -FLT_MAX)
+    {
+    }
+
+    void Grow(const Float3& p)
+    {
+        Min = Float3(std::min(Min.x, p.x), std::min(Min.y, p.y), std::min(Min.z, p.z));
+        Max = Float3(std::max(Max.x, p.x), std::max(Max.y, p.y), std::max(Max.z, p.z));
+    }
+
+    void Grow(const AABB& other)
+    {
+        Grow(other.Min);
+        Grow(other.Max);
+    }
+
+    float SurfaceArea() const
+    {
+        if(Min.x > Max.x)
+            return 0.0f;
+        Float3 d = Max - Min;
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+};
+
+struct BuildPrimitive
+{
+    AABB Bounds;
+    Float3 Centroid;
+    uint32 TriangleIdx;
+};
+
+struct BuildNode
+{
+    AABB Bounds;
+    uint32 Start;
+    uint32 Count;
+    uint32 SplitAxis;
+    std::unique_ptr<BuildNode> Children[2];
+
+    BuildNode() : Start(0), Count(0), SplitAxis(0)
+    {
+    }
+};
+
+static float Component(const Float3& v, uint32 axis)
+{
+    return (&v.x)[axis];
+}
+
+// Recursively builds a node using a binned SAH, splitting off the left subtree to another
+// thread near the top of the tree
+static std::unique_ptr<BuildNode> BuildRecursive(std::vector<BuildPrimitive>& prims, uint32 start, uint32 end,
+                                                 uint32 depth, uint32 parallelDepth)
+{
+    std::unique_ptr<BuildNode> node(new BuildNode());
+    node->Start = start;
+    node->Count = end - start;
+
+    AABB centroidBounds;
+    for(uint32 i = start; i < end; ++i)
+    {
+        node->Bounds.Grow(prims[i].Bounds);
+        centroidBounds.Grow(prims[i].Centroid);
+    }
+
+    // Past the maximum depth the SAH isn't evaluated anymore, and nodes only get split when they
+    // have more triangles than a leaf can store
+    const uint32 count = node->Count;
+    const bool pastMaxDepth = depth >= MaxBuildDepth;
+    if(count <= 1 || (pastMaxDepth && count <= MaxLeafCount))
+        return node;
+
+    // Evaluate the SAH for the bin boundaries along all 3 axes
+    float bestCost = FLT_MAX;
+    uint32 bestAxis = uint32(-1);
+    uint32 bestSplit = 0;
+    for(uint32 axis = 0; axis < 3 && pastMaxDepth == false; ++axis)
+    {
+        const float cMin = Component(centroidBounds.Min, axis);
+        const float extent = Component(centroidBounds.Max, axis) - cMin;
+        if(extent <= 1e-12f)
+            continue;
+
+        AABB binBounds[NumBins];
+        uint32 binCounts[NumBins] = { 0 };
+        const float binScale = NumBins / extent;
+        for(uint32 i = start; i < end; ++i)
+        {
+            uint32 binIdx = std::min(uint32((Component(prims[i].Centroid, axis) - cMin) * binScale), NumBins - 1);
+            binBounds[binIdx].Grow(prims[i].Bounds);
+            ++binCounts[binIdx];
+        }
+
+        // Sweep from the right to get the area and count on the right side of each split
+        float rightAreas[NumBins];
+        uint32 rightCounts[NumBins];
+        AABB rightBounds;
+        uint32 rightCount = 0;
+        for(uint32 binIdx = NumBins - 1; binIdx > 0; --binIdx)
+        {
+            rightBounds.Grow(binBounds[binIdx]);
+            rightCount += binCounts[binIdx];
+            rightAreas[binIdx] = rightBounds.SurfaceArea();
+            rightCounts[binIdx] = rightCount;
+        }
+
+        // Then sweep from the left, evaluating the cost of splitting after each bin
+        AABB leftBounds;
+        uint32 leftCount = 0;
+        for(uint32 binIdx = 0; binIdx < NumBins - 1; ++binIdx)
+        {
+            leftBounds.Grow(binBounds[binIdx]);
+            leftCount += binCounts[binIdx];
+            if(leftCount == 0 || rightCounts[binIdx + 1] == 0)
+                continue;
+
+            float cost = leftBounds.SurfaceArea() * leftCount + rightAreas[binIdx + 1] * rightCounts[binIdx + 1];
+            if(cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = binIdx;
+            }
+        }
+    }
+
+    uint32 mid = start + count / 2;
+    if(bestAxis != uint32(-1))
+    {
+        const float parentArea = node->Bounds.SurfaceArea();
+        const float leafCost = count * IntersectionCost;
+        const float splitCost = TraversalCost + IntersectionCost * bestCost / std::max(parentArea, 1e-20f);
+        if(count <= MaxLeafTriangles && splitCost >= leafCost)
+            return node;
+
+        const float cMin = Component(centroidBounds.Min, bestAxis);
+        const float binScale = NumBins / (Component(centroidBounds.Max, bestAxis) - cMin);
+        auto isLeft = [=](const BuildPrimitive& prim)
+        {
+            uint32 binIdx = std::min(uint32((Component(prim.Centroid, bestAxis) - cMin) * binScale), NumBins - 1);
+            return binIdx <= bestSplit;
+        };
+
+        mid = uint32(std::partition(prims.begin() + start, prims.begin() + end, isLeft) - prims.begin());
+        node->SplitAxis = bestAxis;
+    }
+    else if(pastMaxDepth)
+    {
+        // Split at the median centroid along the longest axis
+        const Float3 extent = centroidBounds.Max - centroidBounds.Min;
+        const uint32 axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+        auto centroidLess = [=](const BuildPrimitive& a, const BuildPrimitive& b)
+        {
+            return Component(a.Centroid, axis) < Component(b.Centroid, axis);
+        };
+
+        std::nth_element(prims.begin() + start, prims.begin() + mid, prims.begin() + end, centroidLess);
+        node->SplitAxis = axis;
+    }
+    else if(count <= MaxLeafTriangles)
+    {
+        return node;
+    }
+
+    // All centroids are in the same spot if no split was found, in which case we just
+    // split the list in half
+    Assert_(mid > start && mid < end);
+
+    if(depth < parallelDepth && count >= ParallelBuildThreshold)
+    {
+        std::future<std::unique_ptr<BuildNode>> leftTask = std::async(std::launch::async, BuildRecursive, std::ref(prims),
+                                                                      start, mid, depth + 1, parallelDepth);
+        node->Children[1] = BuildRecursive(prims, mid, end, depth + 1, parallelDepth);
+        node->Children[0] = leftTask.get();
+    }
+    else
+    {
+        node->Children[0] = BuildRecursive(prims, start, mid, depth + 1, parallelDepth);
+        node->Children[1] = BuildRecursive(prims, mid, end, depth + 1, parallelDepth);
+    }
+
+    return node;
+}
+
+// Converts the build tree into the depth-first node layout used for traversal
+static void FlattenRecursive(const BuildNode& buildNode, std::vector<BVHNode>& nodes, uint32 depth, uint32& maxDepth)
+{
+    maxDepth = std::max(maxDepth, depth);
+
+    const uint32 nodeIdx = uint32(nodes.size());
+    nodes.push_back(BVHNode());
+    nodes[nodeIdx].BoundsMin = buildNode.Bounds.Min;
+    nodes[nodeIdx].BoundsMax = buildNode.Bounds.Max;
+    nodes[nodeIdx].SplitAxis = uint16(buildNode.SplitAxis);
+
+    if(buildNode.Children[0] == nullptr)
+    {
+        Assert_(buildNode.Count <= UINT16_MAX);
+        nodes[nodeIdx].Offset = buildNode.Start;
+        nodes[nodeIdx].NumTriangles = uint16(buildNode.Count);
+        return;
+    }
+
+    nodes[nodeIdx].NumTriangles = 0;
+    FlattenRecursive(*buildNode.Children[0], nodes, depth + 1, maxDepth);
+    nodes[nodeIdx].Offset = uint32(nodes.size());
+    FlattenRecursive(*buildNode.Children[1], nodes, depth + 1, maxDepth);
+}
+
+RayPacket::RayPacket() : Direction(0.0f, 0.0f, 1.0f), ActiveMask(0)
+{
+    for(uint32 i = 0; i < 4; ++i)
+    {
+        OriginX[i] = OriginY[i] = OriginZ[i] = 0.0f;
+        TMin[i] = 0.0f;
+        TMax[i] = FLT_MAX;
+    }
+}
+
+BVH::BVH() : boundsMin(0.0f, 0.0f, 0.0f), boundsMax(0.0f, 0.0f, 0.0f), maxDepth(0), buildTime(0.0f)
+{
+}
+
+void BVH::AddModel(const Model& model, const Float4x4& world)
+{
+    for(const Mesh& mesh : model.Meshes())
+    {
+        std::vector<Float3> vertices;
+        DecodePositions(mesh, vertices);
+        const bool index32 = mesh.IndexBufferType() == Mesh::Index32Bit;
+
+        for(const MeshPart& part : mesh.MeshParts())
+        {
+            for(uint32 i = part.IndexStart; i + 2 < part.IndexStart + part.IndexCount; i += 3)
+            {
+                Float3 positions[3];
+                for(uint32 v = 0; v < 3; ++v)
+                {
+                    uint32 vtxIdx = index32 ? reinterpret_cast<const uint32*>(mesh.Indices())[i + v]
+                                            : reinterpret_cast<const uint16*>(mesh.Indices())[i + v];
+                    positions[v] = Float3::Transform(vertices[vtxIdx], world);
+                }
+
+                AddTriangle(positions[0], positions[1], positions[2]);
+            }
+        }
+    }
+}
+
+void BVH::AddTriangle(const Float3& v0, const Float3& v1, const Float3& v2)
+{
+    BVHTriangle tri;
+    tri.V0 = v0;
+    tri.E1 = v1 - v0;
+    tri.E2 = v2 - v0;
+    triangles.push_back(tri);
+
+    // Adding triangles invalidates the hierarchy
+    nodes.clear();
+}
+
+void BVH::Clear()
+{
+    nodes.clear();
+    triangles.clear();
+    boundsMin = boundsMax = Float3(0.0f, 0.0f, 0.0f);
+    maxDepth = 0;
+}
+
+void BVH::Build(uint32 numThreads)
+{
+    Timer timer;
+
+    nodes.clear();
+    maxDepth = 0;
+    if(triangles.size() == 0)
+        return;
+
+    if(numThreads == 0)
+        numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    // Spawning a task for each node in the top log2(numThreads) + 1 levels gives a bit of
+    // oversubscription, which helps with unbalanced splits
+    uint32 parallelDepth = 0;
+    while((1u << parallelDepth) < numThreads)
+        ++parallelDepth;
+    if(numThreads > 1)
+        ++parallelDepth;
+
+    const uint32 numTriangles = uint32(triangles.size());
+    std::vector<BuildPrimitive> prims(numTriangles);
+    AABB sceneBounds;
+    for(uint32 i = 0; i < numTriangles; ++i)
+    {
+        const BVHTriangle& tri = triangles[i];
+        BuildPrimitive& prim = prims[i];
+        prim.Bounds.Grow(tri.V0);
+        prim.Bounds.Grow(tri.V0 + tri.E1);
+        prim.Bounds.Grow(tri.V0 + tri.E2);
+        prim.Centroid = (prim.Bounds.Min + prim.Bounds.Max) * 0.5f;
+        prim.TriangleIdx = i;
+        sceneBounds.Grow(prim.Bounds);
+    }
+
+    boundsMin = sceneBounds.Min;
+    boundsMax = sceneBounds.Max;
+
+    std::unique_ptr<BuildNode> root = BuildRecursive(prims, 0, numTriangles, 0, parallelDepth);
+
+    nodes.reserve(numTriangles * 2);
+    FlattenRecursive(*root, nodes, 0, maxDepth);
+    Assert_(maxDepth < MaxStackSize);
+
+    // Re-order the triangles to match the leaves
+    std::vector<BVHTriangle> sortedTriangles(numTriangles);
+    for(uint32 i = 0; i < numTriangles; ++i)
+        sortedTriangles[i] = triangles[prims[i].TriangleIdx];
+    triangles.swap(sortedTriangles);
+
+    timer.Update();
+    buildTime = timer.ElapsedSecondsF();
+}
+
+template<bool AnyHit> uint32 BVH::TraversePacket(const RayPacket& packet, float hitT[4]) const
+{
+    if(nodes.size() == 0 || packet.ActiveMask == 0)
+        return 0;
+
+    // Keep the reciprocal direction finite so that the slab test never produces NaN's
+    const Float3 dir = packet.Direction;
+    float invDir[3];
+    for(uint32 i = 0; i < 3; ++i)
+    {
+        float d = Component(dir, i);
+        if(std::abs(d) < 1e-20f)
+            d = d < 0.0f ? -1e-20f : 1e-20f;
+        invDir[i] = 1.0f / d;
+    }
+
+    const uint32 dirNegative[3] = { invDir[0] < 0.0f, invDir[1] < 0.0f, invDir[2] < 0.0f };
+
+    const __m128 originX = _mm_loadu_ps(packet.OriginX);
+    const __m128 originY = _mm_loadu_ps(packet.OriginY);
+    const __m128 originZ = _mm_loadu_ps(packet.OriginZ);
+    const __m128 invDirX = _mm_set1_ps(invDir[0]);
+    const __m128 invDirY = _mm_set1_ps(invDir[1]);
+    const __m128 invDirZ = _mm_set1_ps(invDir[2]);
+    const __m128 scaledOriginX = _mm_mul_ps(originX, invDirX);
+    const __m128 scaledOriginY = _mm_mul_ps(originY, invDirY);
+    const __m128 scaledOriginZ = _mm_mul_ps(originZ, invDirZ);
+    const __m128 tMin = _mm_loadu_ps(packet.TMin);
+    __m128 tMax = _mm_loadu_ps(packet.TMax);
+
+    const __m128i laneBits = _mm_setr_epi32(1, 2, 4, 8);
+    __m128 active = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(packet.ActiveMask), laneBits), laneBits));
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    uint32 hitMask = 0;
+    uint32 stack[MaxStackSize];
+    uint32 stackSize = 0;
+    uint32 nodeIdx = 0;
+    while(true)
+    {
+        const BVHNode& node = nodes[nodeIdx];
+
+        // Slab test against the node bounds for all rays in the packet
+        const Float3& nearPlanes = node.BoundsMin;
+        const Float3& farPlanes = node.BoundsMax;
+        const float nearX = dirNegative[0] ? farPlanes.x : nearPlanes.x;
+        const float nearY = dirNegative[1] ? farPlanes.y : nearPlanes.y;
+        const float nearZ = dirNegative[2] ? farPlanes.z : nearPlanes.z;
+        const float farX = dirNegative[0] ? nearPlanes.x : farPlanes.x;
+        const float farY = dirNegative[1] ? nearPlanes.y : farPlanes.y;
+        const float farZ = dirNegative[2] ? nearPlanes.z : farPlanes.z;
+
+        __m128 tNear = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(nearX), invDirX), scaledOriginX);
+        tNear = _mm_max_ps(tNear, _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(nearY), invDirY), scaledOriginY));
+        tNear = _mm_max_ps(tNear, _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(nearZ), invDirZ), scaledOriginZ));
+        tNear = _mm_max_ps(tNear, tMin);
+
+        __m128 tFar = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(farX), invDirX), scaledOriginX);
+        tFar = _mm_min_ps(tFar, _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(farY), invDirY), scaledOriginY));
+        tFar = _mm_min_ps(tFar, _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(farZ), invDirZ), scaledOriginZ));
+        tFar = _mm_min_ps(tFar, tMax);
+
+        const __m128 nodeHit = _mm_and_ps(_mm_cmple_ps(tNear, tFar), active);
+        if(_mm_movemask_ps(nodeHit) != 0)
+        {
+            if(node.NumTriangles == 0)
+            {
+                // Visit the child on the near side of the split first
+                uint32 firstChild = nodeIdx + 1;
+                uint32 secondChild = node.Offset;
+                if(dirNegative[node.SplitAxis])
+                    std::swap(firstChild, secondChild);
+
+                stack[stackSize++] = secondChild;
+                nodeIdx = firstChild;
+                continue;
+            }
+
+            for(uint32 triIdx = node.Offset; triIdx < node.Offset + node.NumTriangles; ++triIdx)
+            {
+                // Moller-Trumbore, where everything that only depends on the direction is
+                // shared by the whole packet
+                const BVHTriangle& tri = triangles[triIdx];
+                const Float3 pvec = Float3::Cross(dir, tri.E2);
+                const float det = Float3::Dot(tri.E1, pvec);
+                if(std::abs(det) < 1e-12f)
+                    continue;
+                const __m128 invDet = _mm_set1_ps(1.0f / det);
+
+                const __m128 tvecX = _mm_sub_ps(originX, _mm_set1_ps(tri.V0.x));
+                const __m128 tvecY = _mm_sub_ps(originY, _mm_set1_ps(tri.V0.y));
+                const __m128 tvecZ = _mm_sub_ps(originZ, _mm_set1_ps(tri.V0.z));
+
+                __m128 u = _mm_mul_ps(tvecX, _mm_set1_ps(pvec.x));
+                u = _mm_add_ps(u, _mm_mul_ps(tvecY, _mm_set1_ps(pvec.y)));
+                u = _mm_add_ps(u, _mm_mul_ps(tvecZ, _mm_set1_ps(pvec.z)));
+                u = _mm_mul_ps(u, invDet);
+
+                const __m128 e1X = _mm_set1_ps(tri.E1.x);
+                const __m128 e1Y = _mm_set1_ps(tri.E1.y);
+                const __m128 e1Z = _mm_set1_ps(tri.E1.z);
+                const __m128 qvecX = _mm_sub_ps(_mm_mul_ps(tvecY, e1Z), _mm_mul_ps(tvecZ, e1Y));
+                const __m128 qvecY = _mm_sub_ps(_mm_mul_ps(tvecZ, e1X), _mm_mul_ps(tvecX, e1Z));
+                const __m128 qvecZ = _mm_sub_ps(_mm_mul_ps(tvecX, e1Y), _mm_mul_ps(tvecY, e1X));
+
+                __m128 v = _mm_mul_ps(qvecX, _mm_set1_ps(dir.x));
+                v = _mm_add_ps(v, _mm_mul_ps(qvecY, _mm_set1_ps(dir.y)));
+                v = _mm_add_ps(v, _mm_mul_ps(qvecZ, _mm_set1_ps(dir.z)));
+                v = _mm_mul_ps(v, invDet);
+
+                __m128 t = _mm_mul_ps(qvecX, _mm_set1_ps(tri.E2.x));
+                t = _mm_add_ps(t, _mm_mul_ps(qvecY, _mm_set1_ps(tri.E2.y)));
+                t = _mm_add_ps(t, _mm_mul_ps(qvecZ, _mm_set1_ps(tri.E2.z)));
+                t = _mm_mul_ps(t, invDet);
+
+                __m128 triHit = _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmpge_ps(v, zero));
+                triHit = _mm_and_ps(triHit, _mm_cmple_ps(_mm_add_ps(u, v), one));
+                triHit = _mm_and_ps(triHit, _mm_cmpgt_ps(t, tMin));
+                triHit = _mm_and_ps(triHit, _mm_cmplt_ps(t, tMax));
+                triHit = _mm_and_ps(triHit, active);
+
+                const uint32 triHitMask = _mm_movemask_ps(triHit);
+                if(triHitMask == 0)
+                    continue;
+
+                hitMask |= triHitMask;
+                if(AnyHit)
+                    active = _mm_andnot_ps(triHit, active);
+                else
+                    tMax = _mm_or_ps(_mm_and_ps(triHit, t), _mm_andnot_ps(triHit, tMax));
+            }
+
+            // Shadow rays are done once they've all hit something
+            if(AnyHit && _mm_movemask_ps(active) == 0)
+                break;
+        }
+
+        if(stackSize == 0)
+            break;
+        nodeIdx = stack[--stackSize];
+    }
+
+    if(AnyHit == false)
+    {
+        _mm_storeu_ps(hitT, tMax);
+        for(uint32 i = 0; i < 4; ++i)
+            if((hitMask & (1 << i)) == 0)
+                hitT[i] = FLT_MAX;
+    }
+
+    return hitMask;
+}
+
+uint32 BVH::OccludedPacket(const RayPacket& packet) const
+{
+    return TraversePacket<true>(packet, nullptr);
+}
+
+void BVH::IntersectPacket(const RayPacket& packet, float hitT[4]) const
+{
+    for(uint32 i = 0; i < 4; ++i)
+        hitT[i] = FLT_MAX;
+    TraversePacket<false>(packet, hitT);
+}
+
+bool BVH::Occluded(const Float3& origin, const Float3& direction, float tMin, float tMax) const
+{
+    RayPacket packet;
+    packet.OriginX[0] = origin.x;
+    packet.OriginY[0] = origin.y;
+    packet.OriginZ[0] = origin.z;
+    packet.TMin[0] = tMin;
+    packet.TMax[0] = tMax;
+    packet.Direction = direction;
+    packet.ActiveMask = 1;
+    return OccludedPacket(packet) != 0;
+}
+
+float BVH::Intersect(const Float3& origin, const Float3& direction, float tMin, float tMax) const
+{
+    RayPacket packet;
+    packet.OriginX[0] = origin.x;
+    packet.OriginY[0] = origin.y;
+    packet.OriginZ[0] = origin.z;
+    packet.TMin[0] = tMin;
+    packet.TMax[0] = tMax;
+    packet.Direction = direction;
+    packet.ActiveMask = 1;
+
+    float hitT[4];
+    IntersectPacket(packet, hitT);
+    return hitT[0];
+}
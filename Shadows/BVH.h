@@ -0,0 +1,101 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+#include "SampleFramework11/Math.h"
+#include "SampleFramework11/Model.h"
+
+using namespace SampleFramework11;
+
+// Pre-computed triangle data used for ray intersection
+struct BVHTriangle
+{
+    Float3 V0;
+    Float3 E1;
+    Float3 E2;
+};
+
+// Node of the flattened BVH. The first child of an interior node always directly
+// follows its parent, so only the offset of the second child needs to be stored.
+struct BVHNode
+{
+    Float3 BoundsMin;
+    uint32 Offset;          // First triangle for leaf nodes, second child for interior nodes
+    Float3 BoundsMax;
+    uint16 NumTriangles;    // 0 for interior nodes
+    uint16 SplitAxis;
+};
+
+// A packet of 4 rays that share the same direction, which is all that's needed for
+// evaluating visibility from a directional light. Rays with a bit cleared in ActiveMask
+// are ignored.
+struct RayPacket
+{
+    float OriginX[4];
+    float OriginY[4];
+    float OriginZ[4];
+    float TMin[4];
+    float TMax[4];
+    Float3 Direction;
+    uint32 ActiveMask;
+
+    RayPacket();
+};
+
+// Bounding volume hierarchy over the triangles of one or more models, built on the CPU with
+// a binned SAH builder and traversed with SSE ray packets
+class BVH
+{
+
+public:
+
+    BVH();
+
+    // Adds all triangles of a model, transformed by the world matrix
+    void AddModel(const Model& model, const Float4x4& world);
+    void AddTriangle(const Float3& v0, const Float3& v1, const Float3& v2);
+    void Clear();
+
+    // Builds the hierarchy, numThreads = 0 uses all hardware threads
+    void Build(uint32 numThreads = 0);
+
+    // Single ray queries
+    bool Occluded(const Float3& origin, const Float3& direction, float tMin, float tMax) const;
+    float Intersect(const Float3& origin, const Float3& direction, float tMin, float tMax) const;
+
+    // Packet queries. OccludedPacket returns a bit mask of rays that hit something, and
+    // IntersectPacket returns the closest hit distance for each ray (FLT_MAX for a miss).
+    uint32 OccludedPacket(const RayPacket& packet) const;
+    void IntersectPacket(const RayPacket& packet, float hitT[4]) const;
+
+    // Accessors
+    const std::vector<BVHNode>& Nodes() const { return nodes; }
+    const std::vector<BVHTriangle>& Triangles() const { return triangles; }
+    uint32 NumTriangles() const { return uint32(triangles.size()); }
+    uint32 NumNodes() const { return uint32(nodes.size()); }
+    uint32 MaxDepth() const { return maxDepth; }
+    float BuildTime() const { return buildTime; }
+    bool Built() const { return nodes.size() > 0; }
+    Float3 BoundsMin() const { return boundsMin; }
+    Float3 BoundsMax() const { return boundsMax; }
+
+protected:
+
+    template<bool AnyHit> uint32 TraversePacket(const RayPacket& packet, float hitT[4]) const;
+
+    std::vector<BVHNode> nodes;
+    std::vector<BVHTriangle> triangles;
+    Float3 boundsMin;
+    Float3 boundsMax;
+    uint32 maxDepth;
+    float buildTime;
+};
@@ -20,8 +20,25 @@ cbuffer VSConstants : register(b0)
 // ================================================================================================
 // Vertex Shader
 // ================================================================================================
-float4 VS(in float3 PositionOS : POSITION) : SV_Position
+struct VSInput
 {
-    float3 positionWS = mul(float4(PositionOS, 1.0f), World).xyz;
+    float3 PositionOS           : POSITION;
+#if Instanced_
+    float4 InstanceWorld0       : INSTANCEWORLD0;
+    float4 InstanceWorld1       : INSTANCEWORLD1;
+    float4 InstanceWorld2       : INSTANCEWORLD2;
+#endif
+};
+
+float4 VS(in VSInput input) : SV_Position
+{
+    float3 positionWS = mul(float4(input.PositionOS, 1.0f), World).xyz;
+
+    #if Instanced_
+        // World only dequantizes the positions here, and the instance's transform goes after it
+        float3x4 instanceWorld = float3x4(input.InstanceWorld0, input.InstanceWorld1, input.InstanceWorld2);
+        positionWS = mul(instanceWorld, float4(positionWS, 1.0f));
+    #endif
+
     return mul(float4(positionWS, 1.0f), ViewProjection);
 }
\ No newline at end of file
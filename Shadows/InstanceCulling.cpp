@@ -0,0 +1,143 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include <immintrin.h>
+
+#include "InstanceCulling.h"
+
+#include "SampleFramework11/Assert.h"
+
+// The most planes that CullInstances can test against, which is enough for a frustum
+static const uint32 MaxCullPlanes = 6;
+
+InstanceTransform MakeInstanceTransform(const Float4x4& world)
+{
+    InstanceTransform transform;
+    transform.Columns[0] = Float4(world._11, world._21, world._31, world._41);
+    transform.Columns[1] = Float4(world._12, world._22, world._32, world._42);
+    transform.Columns[2] = Float4(world._13, world._23, world._33, world._43);
+    return transform;
+}
+
+void BuildInstanceSpheres(const Sphere* partSpheres, uint32 numParts, const Float4x4* worlds,
+                          uint32 numInstances, InstanceSpheres& spheres)
+{
+    spheres.NumParts = numParts;
+    spheres.NumInstances = numInstances;
+    spheres.PartStride = (numInstances + 3) & ~3u;
+
+    const uint64 numSpheres = uint64(numParts) * spheres.PartStride;
+    spheres.CenterX.assign(numSpheres, 0.0f);
+    spheres.CenterY.assign(numSpheres, 0.0f);
+    spheres.CenterZ.assign(numSpheres, 0.0f);
+    spheres.Radius.assign(numSpheres, 0.0f);
+
+    spheres.MinScale = numInstances > 0 ? FLT_MAX : 1.0f;
+    spheres.MaxScale = numInstances > 0 ? 0.0f : 1.0f;
+
+    for(uint32 instanceIdx = 0; instanceIdx < numInstances; ++instanceIdx)
+    {
+        const Float4x4& world = worlds[instanceIdx];
+        const float scale = std::max(Float3::Length(world.Right()),
+                                     std::max(Float3::Length(world.Up()), Float3::Length(world.Forward())));
+        spheres.MinScale = std::min(spheres.MinScale, scale);
+        spheres.MaxScale = std::max(spheres.MaxScale, scale);
+
+        for(uint32 partIdx = 0; partIdx < numParts; ++partIdx)
+        {
+            const Float3 center = Float3::Transform(Float3(partSpheres[partIdx].Center), world);
+            const uint64 idx = uint64(partIdx) * spheres.PartStride + instanceIdx;
+            spheres.CenterX[idx] = center.x;
+            spheres.CenterY[idx] = center.y;
+            spheres.CenterZ[idx] = center.z;
+            spheres.Radius[idx] = partSpheres[partIdx].Radius * scale;
+        }
+    }
+}
+
+void CullInstances(const Float4* planes, uint32 numPlanes, const InstanceSpheres& spheres,
+                   InstanceDrawList& drawList)
+{
+    Assert_(numPlanes <= MaxCullPlanes);
+
+    __m128 planeX[MaxCullPlanes];
+    __m128 planeY[MaxCullPlanes];
+    __m128 planeZ[MaxCullPlanes];
+    __m128 planeW[MaxCullPlanes];
+    for(uint32 i = 0; i < numPlanes; ++i)
+    {
+        planeX[i] = _mm_set1_ps(planes[i].x);
+        planeY[i] = _mm_set1_ps(planes[i].y);
+        planeZ[i] = _mm_set1_ps(planes[i].z);
+        planeW[i] = _mm_set1_ps(planes[i].w);
+    }
+
+    drawList.PartStarts.resize(spheres.NumParts);
+    drawList.PartCounts.resize(spheres.NumParts);
+
+    // All four lanes of a group get written whether or not they're visible, so there needs to be
+    // room for a full group past the last visible instance
+    drawList.Instances.resize(uint64(spheres.NumParts) * spheres.PartStride + 4);
+
+    const __m128i laneIndices = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    uint32 numVisible = 0;
+    for(uint32 partIdx = 0; partIdx < spheres.NumParts; ++partIdx)
+    {
+        drawList.PartStarts[partIdx] = numVisible;
+
+        const uint64 partStart = uint64(partIdx) * spheres.PartStride;
+        for(uint32 instanceIdx = 0; instanceIdx < spheres.NumInstances; instanceIdx += 4)
+        {
+            const uint64 idx = partStart + instanceIdx;
+            const __m128 x = _mm_loadu_ps(&spheres.CenterX[idx]);
+            const __m128 y = _mm_loadu_ps(&spheres.CenterY[idx]);
+            const __m128 z = _mm_loadu_ps(&spheres.CenterZ[idx]);
+            const __m128 negRadius = _mm_xor_ps(_mm_loadu_ps(&spheres.Radius[idx]), signMask);
+
+            // The padding at the end of the part never counts as visible
+            const __m128i remaining = _mm_set1_epi32(int32(spheres.NumInstances - instanceIdx));
+            __m128 visible = _mm_castsi128_ps(_mm_cmplt_epi32(laneIndices, remaining));
+
+            for(uint32 i = 0; i < numPlanes; ++i)
+            {
+                __m128 distance = _mm_add_ps(_mm_mul_ps(planeX[i], x), planeW[i]);
+                distance = _mm_add_ps(distance, _mm_mul_ps(planeY[i], y));
+                distance = _mm_add_ps(distance, _mm_mul_ps(planeZ[i], z));
+                visible = _mm_and_ps(visible, _mm_cmpge_ps(distance, negRadius));
+            }
+
+            // Write every lane, and only advance past the ones that are visible
+            const uint32 mask = uint32(_mm_movemask_ps(visible));
+            uint32* output = &drawList.Instances[numVisible];
+            uint32 numWritten = 0;
+            for(uint32 lane = 0; lane < 4; ++lane)
+            {
+                output[numWritten] = instanceIdx + lane;
+                numWritten += (mask >> lane) & 1;
+            }
+            numVisible += numWritten;
+        }
+
+        drawList.PartCounts[partIdx] = numVisible - drawList.PartStarts[partIdx];
+    }
+
+    drawList.Instances.resize(numVisible);
+    drawList.NumVisible = numVisible;
+}
+
+void CompactInstanceTransforms(const InstanceDrawList& drawList, const Float4x4* worlds,
+                               InstanceTransform* transforms)
+{
+    for(uint32 i = 0; i < drawList.NumVisible; ++i)
+        transforms[i] = MakeInstanceTransform(worlds[drawList.Instances[i]]);
+}
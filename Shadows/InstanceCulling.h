@@ -0,0 +1,83 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+#include "SampleFramework11/Math.h"
+
+using namespace SampleFramework11;
+
+// CPU culling for models that get drawn many times with instancing. Nothing in here touches the
+// device, so it can be run and checked without creating one.
+
+// Represents a bounding sphere for a MeshPart
+struct Sphere
+{
+    XMFLOAT3 Center;
+    float Radius;
+};
+
+// Transform of an instance as it's stored in the instance vertex buffer: the first three columns
+// of the world matrix, which is all an affine transform needs
+struct InstanceTransform
+{
+    Float4 Columns[3];
+};
+
+InstanceTransform MakeInstanceTransform(const Float4x4& world);
+
+// World space bounding spheres of every part of every instance, stored part by part as structures
+// of arrays so that four instances can be tested at once. The arrays for each part are padded
+// to a multiple of 4.
+struct InstanceSpheres
+{
+    uint32 NumParts;
+    uint32 NumInstances;
+    uint32 PartStride;
+    std::vector<float> CenterX;
+    std::vector<float> CenterY;
+    std::vector<float> CenterZ;
+    std::vector<float> Radius;
+
+    // Smallest and largest scale of any of the instances
+    float MinScale;
+    float MaxScale;
+
+    InstanceSpheres() : NumParts(0), NumInstances(0), PartStride(0), MinScale(1.0f), MaxScale(1.0f) {}
+};
+
+// Transforms the object space spheres of the parts by every world matrix. The radii get scaled by
+// the largest axis of each matrix.
+void BuildInstanceSpheres(const Sphere* partSpheres, uint32 numParts, const Float4x4* worlds,
+                          uint32 numInstances, InstanceSpheres& spheres);
+
+// Visible instances of each part, packed part by part so that each part can be drawn with a
+// single DrawIndexedInstanced using PartStarts as the start instance location
+struct InstanceDrawList
+{
+    std::vector<uint32> PartStarts;
+    std::vector<uint32> PartCounts;
+    std::vector<uint32> Instances;
+    uint32 NumVisible;
+
+    InstanceDrawList() : NumVisible(0) {}
+};
+
+// Tests every sphere against the planes, which point inward, and compacts the instances that
+// aren't completely outside of any of them into the draw list. With no planes every instance is
+// visible.
+void CullInstances(const Float4* planes, uint32 numPlanes, const InstanceSpheres& spheres,
+                   InstanceDrawList& drawList);
+
+// Writes the transforms of the visible instances in draw list order, which needs room for
+// drawList.NumVisible transforms
+void CompactInstanceTransforms(const InstanceDrawList& drawList, const Float4x4* worlds,
+                               InstanceTransform* transforms);
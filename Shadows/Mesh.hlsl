@@ -17,6 +17,11 @@
 #include "MSM.hlsl"
 #include "AppSettings.hlsl"
 
+// Vertex layouts, matching VertexFormat in VertexCompression.h
+#define VertexFormatFloat_ 0
+#define VertexFormatOctahedral_ 1
+#define VertexFormatQTangent_ 2
+
 //=================================================================================================
 // Constant buffers
 //=================================================================================================
@@ -24,6 +29,8 @@ cbuffer VSConstants : register(b0)
 {
     float4x4 World;
     float4x4 ViewProjection;
+    float3 PositionScale;
+    float3 PositionBias;
 }
 
 cbuffer PSConstants : register(b0)
@@ -33,6 +40,17 @@ cbuffer PSConstants : register(b0)
 	float4 CascadeSplits;
     float4 CascadeOffsets[NumCascades];
     float4 CascadeScales[NumCascades];
+    float4x4 CharacterShadowMatrix;
+    float4x4 CascadeMatrices[NumCascades];
+    float SampleRotationOffset;
+}
+
+cbuffer ShadowMaskConstants : register(b1)
+{
+    float4x4 InvViewProjection;
+    float4x4 PrevViewProjection;
+    float2 ProjectionParams;
+    float HistoryBlend;
 }
 
 //=================================================================================================
@@ -41,11 +59,17 @@ cbuffer PSConstants : register(b0)
 Texture2D DiffuseMap : register(t0);
 Texture2DArray ShadowMap : register(t1);
 Texture2D<float> RandomRotations : register(t2);
+Texture2DArray<float2> ShadowMinMaxMap : register(t3);
+Texture2D<float> CharacterShadowMap : register(t4);
+Texture2DMS<float> SceneDepthMap : register(t5);
+Texture2D<float4> ShadowMaskHistory : register(t6);
+Texture2D<float4> ShadowMask : register(t7);
 
 SamplerState AnisoSampler : register(s0);
 SamplerComparisonState ShadowSampler : register(s1);
 SamplerComparisonState ShadowSamplerPCF : register(s2);
 SamplerState VSMSampler : register(s3);
+SamplerState LinearClampSampler : register(s4);
 
 //=================================================================================================
 // Input/Output structs
@@ -53,8 +77,19 @@ SamplerState VSMSampler : register(s3);
 struct VSInput
 {
     float3 PositionOS 		    : POSITION;
+#if VertexFormat_ == VertexFormatQTangent_
+    float4 QTangent 		    : QTANGENT;
+#elif VertexFormat_ == VertexFormatOctahedral_
+    float2 NormalOct 		    : NORMAL;
+#else
     float3 NormalOS 		    : NORMAL;
+#endif
     float2 TexCoord 		    : TEXCOORD0;
+#if Instanced_
+    float4 InstanceWorld0       : INSTANCEWORLD0;
+    float4 InstanceWorld1       : INSTANCEWORLD1;
+    float4 InstanceWorld2       : INSTANCEWORLD2;
+#endif
 };
 
 struct VSOutput
@@ -75,6 +110,29 @@ struct PSInput
 	float DepthVS			    : DEPTHVS;
 };
 
+//=================================================================================================
+// Vertex decoding
+//=================================================================================================
+float3 DecodeOctahedral(in float2 encoded)
+{
+    float3 n = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+    float t = saturate(-n.z);
+    n.xy += n.xy >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
+// Rotates the basis vectors by the quaternion. The handedness of the tangent frame is stored in
+// the sign of w.
+void DecodeQTangent(in float4 q, out float3 normal, out float3 tangent, out float3 bitangent)
+{
+    q = normalize(q);
+    normal = float3(2.0f * (q.x * q.z + q.y * q.w), 2.0f * (q.y * q.z - q.x * q.w),
+                    1.0f - 2.0f * (q.x * q.x + q.y * q.y));
+    tangent = float3(1.0f - 2.0f * (q.y * q.y + q.z * q.z), 2.0f * (q.x * q.y + q.z * q.w),
+                     2.0f * (q.x * q.z - q.y * q.w));
+    bitangent = cross(normal, tangent) * (q.w < 0.0f ? -1.0f : 1.0f);
+}
+
 //=================================================================================================
 // Vertex Shader
 //=================================================================================================
@@ -82,8 +140,28 @@ VSOutput VS(in VSInput input)
 {
     VSOutput output;
 
+    // Quantized positions are relative to the bounds of the mesh
+    float3 positionOS = input.PositionOS * PositionScale + PositionBias;
+
+    #if VertexFormat_ == VertexFormatQTangent_
+        float3 normalOS, tangentOS, bitangentOS;
+        DecodeQTangent(input.QTangent, normalOS, tangentOS, bitangentOS);
+    #elif VertexFormat_ == VertexFormatOctahedral_
+        float3 normalOS = DecodeOctahedral(input.NormalOct);
+    #else
+        float3 normalOS = input.NormalOS;
+    #endif
+
+    #if Instanced_
+        // Each instance has the first three columns of its world matrix, which get applied
+        // before World
+        float3x4 instanceWorld = float3x4(input.InstanceWorld0, input.InstanceWorld1, input.InstanceWorld2);
+        positionOS = mul(instanceWorld, float4(positionOS, 1.0f));
+        normalOS = mul((float3x3)instanceWorld, normalOS);
+    #endif
+
     // Calc the world-space position
-    output.PositionWS = mul(float4(input.PositionOS, 1.0f), World).xyz;
+    output.PositionWS = mul(float4(positionOS, 1.0f), World).xyz;
 
     // Calc the clip-space position
     output.PositionCS = mul(float4(output.PositionWS, 1.0f), ViewProjection);
@@ -91,7 +169,7 @@ VSOutput VS(in VSInput input)
     output.DepthVS = output.PositionCS.w;
 
 	// Rotate the normal into world space
-    output.NormalWS = normalize(mul(input.NormalOS, (float3x3)World));
+    output.NormalWS = normalize(mul(normalOS, (float3x3)World));
 
     // Pass along the texture coordinate
     output.TexCoord = input.TexCoord;
@@ -312,7 +390,7 @@ float SampleShadowMapRandomDiscPCF(in float3 shadowPos, in float3 shadowPosDX,
             uint2 randomRotationsSize;
             RandomRotations.GetDimensions(randomRotationsSize.x, randomRotationsSize.y);
             uint2 randomSamplePos = screenPos % randomRotationsSize;
-            float theta = RandomRotations[randomSamplePos] * Pi2;
+            float theta = (RandomRotations[randomSamplePos] + SampleRotationOffset) * Pi2;
             float2x2 randomRotationMatrix = float2x2(float2(cos(theta), -sin(theta)),
                                                      float2(sin(theta), cos(theta)));
         #endif
@@ -441,6 +519,166 @@ float SampleShadowMapGridPCF(in float3 shadowPos, in float3 shadowPosDX,
     return result;
 }
 
+//-------------------------------------------------------------------------------------------------
+// Returns the min and max depth of every shadow map texel within radius texels of texelPos. Each
+// texel of pyramid level n covers 2^(n + 1) shadow map texels, so this picks the first level
+// where 2x2 texels are big enough to cover the whole region.
+//-------------------------------------------------------------------------------------------------
+float2 ShadowRegionMinMax(in float2 texelPos, in float radius, in uint cascadeIdx)
+{
+    uint2 baseSize;
+    uint numSlices, numLevels;
+    ShadowMinMaxMap.GetDimensions(0, baseSize.x, baseSize.y, numSlices, numLevels);
+
+    float level = clamp(ceil(log2(radius * 2.0f)) - 1.0f, 0.0f, numLevels - 1.0f);
+    float cellSize = exp2(level + 1.0f);
+    int2 maxCoord = max(int2(baseSize >> uint(level)), 1) - 1;
+    int2 cell = int2(floor((texelPos - radius) / cellSize));
+
+    float2 minMax = float2(1.0f, 0.0f);
+
+    [unroll]
+    for(int y = 0; y < 2; ++y)
+    {
+        [unroll]
+        for(int x = 0; x < 2; ++x)
+        {
+            int2 coord = clamp(cell + int2(x, y), 0, maxCoord);
+            float2 texelMinMax = ShadowMinMaxMap.Load(int4(coord, cascadeIdx, int(level)));
+            minMax.x = min(minMax.x, texelMinMax.x);
+            minMax.y = max(minMax.y, texelMinMax.y);
+        }
+    }
+
+    return minMax;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Samples the shadow map using percentage-closer soft shadows. The min/max depth pyramid is
+// checked before the blocker search, so that receivers that are in front of every texel in the
+// search region (fully lit) or behind all of them (fully shadowed) can skip the search and the
+// filtering. EvaluatePCSS in PCSS.h is the CPU version of this function.
+//-------------------------------------------------------------------------------------------------
+float SampleShadowMapPCSS(in float3 shadowPos, in float3 shadowPosDX, in float3 shadowPosDY,
+                          in uint cascadeIdx, in uint2 screenPos)
+{
+    // Get the size of the shadow map
+    float2 shadowMapSize;
+    float numSlices;
+    ShadowMap.GetDimensions(shadowMapSize.x, shadowMapSize.y, numSlices);
+
+    #if UsePlaneDepthBias_
+        float2 texelSize = 1.0f / shadowMapSize;
+
+        float2 receiverPlaneDepthBias = ComputeReceiverPlaneDepthBias(shadowPosDX, shadowPosDY);
+
+        // Static depth biasing to make up for incorrect fractional sampling on the shadow map grid
+        float fractionalSamplingError = dot(float2(1.0f, 1.0f) * texelSize, abs(receiverPlaneDepthBias));
+        float shadowDepth = shadowPos.z - min(fractionalSamplingError, 0.01f);
+    #else
+        float shadowDepth = shadowPos.z - Bias;
+    #endif
+
+    // The global shadow matrix maps one world unit to one unit of UV and depth, so the cascade
+    // scales give us the size of a world unit in this cascade. This converts from the light size
+    // to the penumbra width in texels per unit of depth between the blocker and the receiver.
+    float2 penumbraScale = PCSSLightSize * abs(CascadeScales[cascadeIdx].xy / CascadeScales[cascadeIdx].z) * shadowMapSize;
+
+    // With a directional light the blockers can be anywhere between the receiver and the near plane
+    float2 searchSize = clamp(penumbraScale * shadowDepth, 1.0f, MaxPCSSKernelSize);
+    float2 texelPos = shadowPos.xy * shadowMapSize;
+
+    // The bilinear filter taps can touch one texel past the search region
+    float regionRadius = max(searchSize.x, searchSize.y) * 0.5f + 1.0f;
+    float2 regionMinMax = ShadowRegionMinMax(texelPos, regionRadius, cascadeIdx);
+
+    #if UsePlaneDepthBias_
+        // Account for the receiver depth changing across the region
+        float regionDepthRange = dot(regionRadius * texelSize, abs(receiverPlaneDepthBias));
+    #else
+        float regionDepthRange = 0.0f;
+    #endif
+
+    [branch]
+    if(shadowDepth + regionDepthRange <= regionMinMax.x)
+        return 1.0f;
+
+    [branch]
+    if(shadowDepth - regionDepthRange > regionMinMax.y)
+        return 0.0f;
+
+    // Find the average depth of the blockers in the search region
+    float blockerSum = 0.0f;
+    float numBlockers = 0.0f;
+
+    [unroll]
+    for(uint blockerIdx = 0; blockerIdx < NumPCSSBlockerSamples; ++blockerIdx)
+    {
+        float2 sampleOffset = PoissonSamples[blockerIdx] * searchSize * 0.5f;
+        int2 sampleTexel = clamp(int2(floor(texelPos + sampleOffset)), 0, int2(shadowMapSize) - 1);
+        float blockerDepth = ShadowMap.Load(int4(sampleTexel, cascadeIdx, 0)).x;
+
+        #if UsePlaneDepthBias_
+            float sampleDepth = shadowDepth + dot(sampleOffset * texelSize, receiverPlaneDepthBias);
+        #else
+            float sampleDepth = shadowDepth;
+        #endif
+
+        if(blockerDepth < sampleDepth)
+        {
+            blockerSum += blockerDepth;
+            numBlockers += 1.0f;
+        }
+    }
+
+    [branch]
+    if(numBlockers == 0.0f)
+        return 1.0f;
+
+    // The penumbra gets wider as the distance between the blocker and receiver increases
+    float blockerDistance = shadowDepth - blockerSum / numBlockers;
+    float2 filterSize = clamp(penumbraScale * blockerDistance, 1.0f, searchSize);
+
+    [branch]
+    if(filterSize.x <= 1.0f && filterSize.y <= 1.0f)
+        return ShadowMap.SampleCmpLevelZero(ShadowSamplerPCF, float3(shadowPos.xy, cascadeIdx), shadowDepth);
+
+    #if RandomizeOffsets_
+        // Get a value to randomly rotate the kernel by
+        uint2 randomRotationsSize;
+        RandomRotations.GetDimensions(randomRotationsSize.x, randomRotationsSize.y);
+        uint2 randomSamplePos = screenPos % randomRotationsSize;
+        float theta = (RandomRotations[randomSamplePos] + SampleRotationOffset) * Pi2;
+        float2x2 randomRotationMatrix = float2x2(float2(cos(theta), -sin(theta)),
+                                                 float2(sin(theta), cos(theta)));
+    #endif
+
+    float2 sampleScale = (0.5f * filterSize) / shadowMapSize;
+
+    float sum = 0.0f;
+    for(uint i = 0; i < uint(NumDiscSamples); ++i)
+    {
+        #if RandomizeOffsets_
+            float2 sampleOffset = mul(PoissonSamples[i], randomRotationMatrix) * sampleScale;
+        #else
+            float2 sampleOffset = PoissonSamples[i] * sampleScale;
+        #endif
+
+        float2 samplePos = shadowPos.xy + sampleOffset;
+
+        #if UsePlaneDepthBias_
+            // Compute offset and apply planar depth bias
+            float sampleDepth = shadowDepth + dot(sampleOffset, receiverPlaneDepthBias);
+        #else
+            float sampleDepth = shadowDepth;
+        #endif
+
+        sum += ShadowMap.SampleCmpLevelZero(ShadowSamplerPCF, float3(samplePos, cascadeIdx), sampleDepth);
+    }
+
+    return sum / NumDiscSamples;
+}
+
 //-------------------------------------------------------------------------------------------------
 // Samples the VSM shadow map
 //-------------------------------------------------------------------------------------------------
@@ -451,6 +689,8 @@ float SampleShadowMapVSM(in float3 shadowPos, in float3 shadowPosDX,
 
     float2 occluder = ShadowMap.SampleGrad(VSMSampler, float3(shadowPos.xy, cascadeIdx),
                                            shadowPosDX.xy, shadowPosDY.xy).xy;
+    if(SMFormat == SMFormat_SM16BitOptimized)
+        occluder = ConvertOptimizedVSMMoments(occluder);
 
     return ChebyshevUpperBound(occluder, depth, VSMBias * 0.01, LightBleedingReduction);
 }
@@ -481,6 +721,24 @@ float SampleShadowMapEVSM(in float3 shadowPos, in float3 shadowPosDX,
     #endif
 }
 
+//-------------------------------------------------------------------------------------------------
+// Samples the ESM shadow map
+//-------------------------------------------------------------------------------------------------
+float SampleShadowMapESM(in float3 shadowPos, in float3 shadowPosDX,
+                         in float3 shadowPosDY, uint cascadeIdx)
+{
+    float2 exponents = float2(GetESMExponent(PositiveExponent, SMFormat), 0.0f);
+    float warpedDepth = WarpDepth(shadowPos.z, exponents).x;
+
+    float occluder = ShadowMap.SampleGrad(VSMSampler, float3(shadowPos.xy, cascadeIdx),
+                                          shadowPosDX.xy, shadowPosDY.xy).x;
+
+    // exp(c * occluder) / exp(c * receiver)
+    float result = saturate(occluder / warpedDepth);
+
+    return ReduceLightBleeding(result, LightBleedingReduction);
+}
+
 //-------------------------------------------------------------------------------------------------
 // Samples the MSM shadow map
 //-------------------------------------------------------------------------------------------------
@@ -490,7 +748,7 @@ float SampleShadowMapMSM(in float3 shadowPos, in float3 shadowPosDX,
     float depth = shadowPos.z;
     float4 moments = ShadowMap.SampleGrad(VSMSampler, float3(shadowPos.xy, cascadeIdx),
                                           shadowPosDX.xy, shadowPosDY.xy);
-    if(SMFormat == SMFormat_SM16Bit)
+    if(SMFormat == SMFormat_SM16Bit || SMFormat == SMFormat_SM16BitOptimized)
         moments = ConvertOptimizedMoments(moments);
 
     #if ShadowMode_ == ShadowModeMSMHausdorff_
@@ -564,118 +822,55 @@ float SampleShadowMapOptimizedPCF(in float3 shadowPos, in float3 shadowPosDX,
 
     #if FilterSize_ == 2
         return ShadowMap.SampleCmpLevelZero(ShadowSamplerPCF, float3(shadowPos.xy, cascadeIdx), lightDepth);
-    #elif FilterSize_ == 3
-
-        float uw0 = (3 - 2 * s);
-        float uw1 = (1 + 2 * s);
-
-        float u0 = (2 - s) / uw0 - 1;
-        float u1 = s / uw1 + 1;
-
-        float vw0 = (3 - 2 * t);
-        float vw1 = (1 + 2 * t);
-
-        float v0 = (2 - t) / vw0 - 1;
-        float v1 = t / vw1 + 1;
-
-        sum += uw0 * vw0 * SampleShadowMap(base_uv, u0, v0, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-        sum += uw1 * vw0 * SampleShadowMap(base_uv, u1, v0, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-        sum += uw0 * vw1 * SampleShadowMap(base_uv, u0, v1, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-        sum += uw1 * vw1 * SampleShadowMap(base_uv, u1, v1, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-
-        return sum * 1.0f / 16;
-
-    #elif FilterSize_ == 5
-
-        float uw0 = (4 - 3 * s);
-        float uw1 = 7;
-        float uw2 = (1 + 3 * s);
-
-        float u0 = (3 - 2 * s) / uw0 - 2;
-        float u1 = (3 + s) / uw1;
-        float u2 = s / uw2 + 2;
-
-        float vw0 = (4 - 3 * t);
-        float vw1 = 7;
-        float vw2 = (1 + 3 * t);
-
-        float v0 = (3 - 2 * t) / vw0 - 2;
-        float v1 = (3 + t) / vw1;
-        float v2 = t / vw2 + 2;
-
-        sum += uw0 * vw0 * SampleShadowMap(base_uv, u0, v0, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-        sum += uw1 * vw0 * SampleShadowMap(base_uv, u1, v0, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-        sum += uw2 * vw0 * SampleShadowMap(base_uv, u2, v0, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-
-        sum += uw0 * vw1 * SampleShadowMap(base_uv, u0, v1, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-        sum += uw1 * vw1 * SampleShadowMap(base_uv, u1, v1, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-        sum += uw2 * vw1 * SampleShadowMap(base_uv, u2, v1, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-
-        sum += uw0 * vw2 * SampleShadowMap(base_uv, u0, v2, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-        sum += uw1 * vw2 * SampleShadowMap(base_uv, u1, v2, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-        sum += uw2 * vw2 * SampleShadowMap(base_uv, u2, v2, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-
-        return sum * 1.0f / 144;
-
-    #else // FilterSize_ == 7
-
-        float uw0 = (5 * s - 6);
-        float uw1 = (11 * s - 28);
-        float uw2 = -(11 * s + 17);
-        float uw3 = -(5 * s + 1);
-
-        float u0 = (4 * s - 5) / uw0 - 3;
-        float u1 = (4 * s - 16) / uw1 - 1;
-        float u2 = -(7 * s + 5) / uw2 + 1;
-        float u3 = -s / uw3 + 3;
-
-        float vw0 = (5 * t - 6);
-        float vw1 = (11 * t - 28);
-        float vw2 = -(11 * t + 17);
-        float vw3 = -(5 * t + 1);
-
-        float v0 = (4 * t - 5) / vw0 - 3;
-        float v1 = (4 * t - 16) / vw1 - 1;
-        float v2 = -(7 * t + 5) / vw2 + 1;
-        float v3 = -t / vw3 + 3;
+    #else
+        // The fetch weights and offsets come from PCFKernels.hlsl, which is generated by PCFKernels.cpp
+        const int FS_2 = FilterSize_ / 2;
 
-        sum += uw0 * vw0 * SampleShadowMap(base_uv, u0, v0, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-        sum += uw1 * vw0 * SampleShadowMap(base_uv, u1, v0, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-        sum += uw2 * vw0 * SampleShadowMap(base_uv, u2, v0, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-        sum += uw3 * vw0 * SampleShadowMap(base_uv, u3, v0, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
+        float uw[NumOptimizedPCFFetches];
+        float vw[NumOptimizedPCFFetches];
+        float u[NumOptimizedPCFFetches];
+        float v[NumOptimizedPCFFetches];
 
-        sum += uw0 * vw1 * SampleShadowMap(base_uv, u0, v1, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-        sum += uw1 * vw1 * SampleShadowMap(base_uv, u1, v1, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-        sum += uw2 * vw1 * SampleShadowMap(base_uv, u2, v1, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-        sum += uw3 * vw1 * SampleShadowMap(base_uv, u3, v1, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
+        [unroll]
+        for(uint i = 0; i < NumOptimizedPCFFetches; ++i)
+        {
+            float4 fetch = OptimizedPCFFetches[i];
+            float texelOffset = int(i * 2) - FS_2;
 
-        sum += uw0 * vw2 * SampleShadowMap(base_uv, u0, v2, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-        sum += uw1 * vw2 * SampleShadowMap(base_uv, u1, v2, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-        sum += uw2 * vw2 * SampleShadowMap(base_uv, u2, v2, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-        sum += uw3 * vw2 * SampleShadowMap(base_uv, u3, v2, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
+            uw[i] = fetch.x + fetch.y * s;
+            u[i] = (fetch.z + fetch.w * s) / uw[i] + texelOffset;
 
-        sum += uw0 * vw3 * SampleShadowMap(base_uv, u0, v3, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-        sum += uw1 * vw3 * SampleShadowMap(base_uv, u1, v3, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-        sum += uw2 * vw3 * SampleShadowMap(base_uv, u2, v3, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
-        sum += uw3 * vw3 * SampleShadowMap(base_uv, u3, v3, shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
+            vw[i] = fetch.x + fetch.y * t;
+            v[i] = (fetch.z + fetch.w * t) / vw[i] + texelOffset;
+        }
 
-        return sum * 1.0f / 2704;
+        [unroll]
+        for(uint row = 0; row < NumOptimizedPCFFetches; ++row)
+        {
+            [unroll]
+            for(uint col = 0; col < NumOptimizedPCFFetches; ++col)
+                sum += uw[col] * vw[row] * SampleShadowMap(base_uv, u[col], v[row], shadowMapSizeInv, cascadeIdx, lightDepth, receiverPlaneDepthBias);
+        }
 
+        return sum * OptimizedPCFNormalization;
     #endif
 }
 
 //-------------------------------------------------------------------------------------------------
-// Samples the appropriate shadow map cascade
+// Samples the appropriate shadow map cascade. The position and derivatives are in the global
+// shadow space, except with the perspective warp where they're already in the cascade's UV space.
 //-------------------------------------------------------------------------------------------------
 float3 SampleShadowCascade(in float3 shadowPosition, in float3 shadowPosDX,
                            in float3 shadowPosDY, in uint cascadeIdx,
                            in uint2 screenPos)
 {
-    shadowPosition += CascadeOffsets[cascadeIdx].xyz;
-    shadowPosition *= CascadeScales[cascadeIdx].xyz;
+    #if UsePerspectiveWarp_ == 0
+        shadowPosition += CascadeOffsets[cascadeIdx].xyz;
+        shadowPosition *= CascadeScales[cascadeIdx].xyz;
 
-    shadowPosDX *= CascadeScales[cascadeIdx].xyz;
-    shadowPosDY *= CascadeScales[cascadeIdx].xyz;
+        shadowPosDX *= CascadeScales[cascadeIdx].xyz;
+        shadowPosDY *= CascadeScales[cascadeIdx].xyz;
+    #endif
 
     float3 cascadeColor = 1.0f;
 
@@ -693,6 +888,8 @@ float3 SampleShadowCascade(in float3 shadowPosition, in float3 shadowPosDX,
 
     #if UseEVSM_
         float shadow = SampleShadowMapEVSM(shadowPosition, shadowPosDX, shadowPosDY, cascadeIdx);
+    #elif UseESM_
+        float shadow = SampleShadowMapESM(shadowPosition, shadowPosDX, shadowPosDY, cascadeIdx);
     #elif UseMSM_
         float shadow = SampleShadowMapMSM(shadowPosition, shadowPosDX, shadowPosDY, cascadeIdx);
     #elif ShadowMode_ == ShadowModeVSM_
@@ -703,6 +900,8 @@ float3 SampleShadowCascade(in float3 shadowPosition, in float3 shadowPosDX,
         float shadow = SampleShadowMapGridPCF(shadowPosition, shadowPosDX, shadowPosDY, cascadeIdx);
     #elif ShadowMode_ == ShadowModeRandomDiscPCF_
         float shadow = SampleShadowMapRandomDiscPCF(shadowPosition, shadowPosDX, shadowPosDY, cascadeIdx, screenPos);
+    #elif ShadowMode_ == ShadowModePCSS_
+        float shadow = SampleShadowMapPCSS(shadowPosition, shadowPosDX, shadowPosDY, cascadeIdx, screenPos);
     #else //if ShadowMode_ == SampleShadowMapOptimizedPCF_
         float shadow = SampleShadowMapOptimizedPCF(shadowPosition, shadowPosDX, shadowPosDY, cascadeIdx);
     #endif
@@ -723,11 +922,86 @@ float3 GetShadowPosOffset(in float nDotL, in float3 normal)
     return texelSize * OffsetScale * nmlOffsetScale * normal;
 }
 
+#if UseCharacterShadow_
+
+//-------------------------------------------------------------------------------------------------
+// Samples the character's own shadow map with a 3x3 PCF kernel. Only the character gets
+// rendered into it, so anything outside of its projection is lit.
+//-------------------------------------------------------------------------------------------------
+float SampleCharacterShadow(in float3 positionWS, in float3 positionDX, in float3 positionDY,
+                            in float nDotL, in float3 normal)
+{
+    float2 shadowMapSize;
+    CharacterShadowMap.GetDimensions(shadowMapSize.x, shadowMapSize.y);
+    float2 texelSize = 1.0f / shadowMapSize;
+
+    // The normal offset is scaled by the world-space size of a texel in this projection
+    float worldTexelSize = texelSize.x / length(CharacterShadowMatrix._11_21_31);
+    float3 offset = worldTexelSize * OffsetScale * saturate(1.0f - nDotL) * normal;
+
+    float3 shadowPos = mul(float4(positionWS + offset, 1.0f), CharacterShadowMatrix).xyz;
+    float3 shadowPosDX = mul(positionDX, (float3x3)CharacterShadowMatrix);
+    float3 shadowPosDY = mul(positionDY, (float3x3)CharacterShadowMatrix);
+
+    if(any(shadowPos.xy < 0.0f) || any(shadowPos.xy > 1.0f))
+        return 1.0f;
+
+    float lightDepth = shadowPos.z;
+
+    #if UsePlaneDepthBias_
+        float2 receiverPlaneDepthBias = ComputeReceiverPlaneDepthBias(shadowPosDX, shadowPosDY);
+
+        // Static depth biasing to make up for incorrect fractional sampling on the shadow map grid
+        float fractionalSamplingError = dot(float2(1.0f, 1.0f) * texelSize, abs(receiverPlaneDepthBias));
+        lightDepth -= min(fractionalSamplingError, 0.01f);
+    #else
+        float2 receiverPlaneDepthBias = 0.0f;
+        lightDepth -= Bias;
+    #endif
+
+    float sum = 0.0f;
+
+    [unroll]
+    for(int y = -1; y <= 1; ++y)
+    {
+        [unroll]
+        for(int x = -1; x <= 1; ++x)
+        {
+            float2 sampleOffset = float2(x, y) * texelSize;
+            float sampleDepth = lightDepth + dot(sampleOffset, receiverPlaneDepthBias);
+            sum += CharacterShadowMap.SampleCmpLevelZero(ShadowSamplerPCF, shadowPos.xy + sampleOffset,
+                                                         sampleDepth);
+        }
+    }
+
+    return sum / 9.0f;
+}
+
+#endif
+
+//-------------------------------------------------------------------------------------------------
+// Returns the position in the UV space of a cascade. With the perspective warp every cascade has
+// its own projection that needs a divide by w, otherwise the position in the global shadow space
+// just gets offset and scaled.
+//-------------------------------------------------------------------------------------------------
+float3 CascadePosition(in float3 positionWS, in float3 projectionPos, in uint cascadeIdx)
+{
+    #if UsePerspectiveWarp_
+        float4 cascadePos = mul(float4(positionWS, 1.0f), CascadeMatrices[cascadeIdx]);
+        cascadePos.xyz /= cascadePos.w;
+        return float3(cascadePos.xy * float2(0.5f, -0.5f) + 0.5f, cascadePos.z);
+    #else
+        return (projectionPos + CascadeOffsets[cascadeIdx].xyz) * CascadeScales[cascadeIdx].xyz;
+    #endif
+}
+
 //-------------------------------------------------------------------------------------------------
-// Computes the visibility term by performing the shadow test
+// Computes the visibility term by performing the shadow test. positionDX and positionDY are the
+// world-space distances to the neighboring pixels, which are used to get the derivatives of the
+// shadow map coordinates.
 //-------------------------------------------------------------------------------------------------
-float3 ShadowVisibility(in float3 positionWS, in float depthVS, in float nDotL, in float3 normal,
-                        in uint2 screenPos)
+float3 ShadowVisibility(in float3 positionWS, in float3 positionDX, in float3 positionDY,
+                        in float depthVS, in float nDotL, in float3 normal, in uint2 screenPos)
 {
 	float3 shadowVisibility = 1.0f;
 	uint cascadeIdx = NumCascades - 1;
@@ -740,8 +1014,7 @@ float3 ShadowVisibility(in float3 positionWS, in float depthVS, in float nDotL,
         #if SelectFromProjection_
             // Select based on whether or not the pixel is inside the projection
             // used for rendering to the cascade
-            float3 cascadePos = projectionPos + CascadeOffsets[i].xyz;
-            cascadePos *= CascadeScales[i].xyz;
+            float3 cascadePos = CascadePosition(positionWS, projectionPos, i);
             cascadePos = abs(cascadePos - 0.5f);
             if(all(cascadePos <= 0.5f))
                 cascadeIdx = i;
@@ -758,9 +1031,17 @@ float3 ShadowVisibility(in float3 positionWS, in float depthVS, in float nDotL,
 
     // Project into shadow space
     float3 samplePos = positionWS + offset;
-	float3 shadowPosition = mul(float4(samplePos, 1.0f), ShadowMatrix).xyz;
-    float3 shadowPosDX = ddx_fine(shadowPosition);
-    float3 shadowPosDY = ddy_fine(shadowPosition);
+    #if UsePerspectiveWarp_
+        // The projection isn't linear, so the derivatives come from projecting the positions
+        // of the neighboring pixels with the same cascade matrix
+        float3 shadowPosition = CascadePosition(samplePos, 0.0f, cascadeIdx);
+        float3 shadowPosDX = CascadePosition(samplePos + positionDX, 0.0f, cascadeIdx) - shadowPosition;
+        float3 shadowPosDY = CascadePosition(samplePos + positionDY, 0.0f, cascadeIdx) - shadowPosition;
+    #else
+        float3 shadowPosition = mul(float4(samplePos, 1.0f), ShadowMatrix).xyz;
+        float3 shadowPosDX = mul(positionDX, (float3x3)ShadowMatrix);
+        float3 shadowPosDY = mul(positionDY, (float3x3)ShadowMatrix);
+    #endif
 
 	shadowVisibility = SampleShadowCascade(shadowPosition, shadowPosDX, shadowPosDY,
                                            cascadeIdx, screenPos);
@@ -775,8 +1056,7 @@ float3 ShadowVisibility(in float3 positionWS, in float depthVS, in float nDotL,
         float fadeFactor = (nextSplit - depthVS) / splitSize;
 
         #if SelectFromProjection_
-            float3 cascadePos = projectionPos + CascadeOffsets[cascadeIdx].xyz;
-            cascadePos *= CascadeScales[cascadeIdx].xyz;
+            float3 cascadePos = CascadePosition(positionWS, projectionPos, cascadeIdx);
             cascadePos = abs(cascadePos * 2.0f - 1.0f);
             float distToEdge = 1.0f - max(max(cascadePos.x, cascadePos.y), cascadePos.z);
             fadeFactor = max(distToEdge, fadeFactor);
@@ -789,19 +1069,182 @@ float3 ShadowVisibility(in float3 positionWS, in float depthVS, in float nDotL,
             float3 nextCascadeOffset = GetShadowPosOffset(nDotL, normal) / abs(CascadeScales[cascadeIdx + 1].z);
 
             // Project into shadow space
-            float3 nextCascadeShadowPosition = mul(float4(positionWS + nextCascadeOffset, 1.0f), ShadowMatrix).xyz;
+            float3 nextSamplePos = positionWS + nextCascadeOffset;
+            #if UsePerspectiveWarp_
+                float3 nextCascadeShadowPosition = CascadePosition(nextSamplePos, 0.0f, cascadeIdx + 1);
+                float3 nextShadowPosDX = CascadePosition(nextSamplePos + positionDX, 0.0f, cascadeIdx + 1) -
+                                         nextCascadeShadowPosition;
+                float3 nextShadowPosDY = CascadePosition(nextSamplePos + positionDY, 0.0f, cascadeIdx + 1) -
+                                         nextCascadeShadowPosition;
+            #else
+                float3 nextCascadeShadowPosition = mul(float4(nextSamplePos, 1.0f), ShadowMatrix).xyz;
+                float3 nextShadowPosDX = shadowPosDX;
+                float3 nextShadowPosDY = shadowPosDY;
+            #endif
 
-            float3 nextSplitVisibility = SampleShadowCascade(nextCascadeShadowPosition, shadowPosDX,
-                                                             shadowPosDY, cascadeIdx + 1,
+            float3 nextSplitVisibility = SampleShadowCascade(nextCascadeShadowPosition, nextShadowPosDX,
+                                                             nextShadowPosDY, cascadeIdx + 1,
                                                              screenPos);
             float lerpAmt = smoothstep(0.0f, BlendThreshold, fadeFactor);
             shadowVisibility = lerp(nextSplitVisibility, shadowVisibility, lerpAmt);
         }
     #endif
 
+    #if UseCharacterShadow_
+        // The character isn't in the cascades, so its shadow gets combined with the scene's
+        shadowVisibility *= SampleCharacterShadow(positionWS, positionDX, positionDY, nDotL, normal);
+    #endif
+
 	return shadowVisibility;
 }
 
+//-------------------------------------------------------------------------------------------------
+// Reconstructs the world-space position and view-space depth of a pixel from sample 0 of the
+// scene depth buffer
+//-------------------------------------------------------------------------------------------------
+float3 SceneDepthPosition(in int2 pixelPos, out float depthVS)
+{
+    uint2 depthMapSize;
+    uint numSamples;
+    SceneDepthMap.GetDimensions(depthMapSize.x, depthMapSize.y, numSamples);
+    pixelPos = clamp(pixelPos, 0, int2(depthMapSize) - 1);
+
+    float depth = SceneDepthMap.Load(pixelPos, 0);
+    float2 samplePos = pixelPos + 0.5f + SceneDepthMap.GetSamplePosition(0);
+    float2 positionCS = (samplePos / depthMapSize) * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f);
+
+    float4 positionWS = mul(float4(positionCS, depth, 1.0f), InvViewProjection);
+    depthVS = ProjectionParams.y / (depth - ProjectionParams.x);
+    return positionWS.xyz / positionWS.w;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Picks the difference to whichever neighbor is closest in depth, so that the derivatives don't
+// get polluted by a different surface at depth discontinuities
+//-------------------------------------------------------------------------------------------------
+float3 ClosestNeighborDelta(in float3 position, in float depthVS, in float3 prevPosition,
+                            in float prevDepthVS, in float3 nextPosition, in float nextDepthVS)
+{
+    return abs(nextDepthVS - depthVS) < abs(depthVS - prevDepthVS) ? nextPosition - position
+                                                                   : position - prevPosition;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Reprojects a position into the shadow mask from the previous frame, and blends it with the
+// current visibility if the history is from the same surface. Matches AccumulateShadowHistory
+// in ShadowMask.cpp.
+//-------------------------------------------------------------------------------------------------
+float3 AccumulateShadowHistory(in float3 positionWS, in float3 visibility)
+{
+    float4 prevPositionCS = mul(float4(positionWS, 1.0f), PrevViewProjection);
+    if(prevPositionCS.w <= 0.0f)
+        return visibility;
+
+    float2 prevUV = (prevPositionCS.xy / prevPositionCS.w) * float2(0.5f, -0.5f) + 0.5f;
+    if(any(prevUV < 0.0f) || any(prevUV > 1.0f))
+        return visibility;
+
+    uint2 screenSize;
+    uint numSamples;
+    SceneDepthMap.GetDimensions(screenSize.x, screenSize.y, numSamples);
+
+    float2 historySize;
+    ShadowMaskHistory.GetDimensions(historySize.x, historySize.y);
+
+    // Mask texel i sits on screen pixel i * scale, so the center of pixel i * scale maps to the
+    // center of the texel
+    float2 historyTexelPos = (prevUV * screenSize - 0.5f) / ShadowMaskScale_ + 0.5f;
+    float4 history = ShadowMaskHistory.SampleLevel(LinearClampSampler, historyTexelPos / historySize, 0.0f);
+
+    if(abs(history.w - prevPositionCS.w) > ShadowHistoryDepthThreshold * prevPositionCS.w)
+        return visibility;
+
+    return lerp(history.xyz, visibility, HistoryBlend);
+}
+
+//-------------------------------------------------------------------------------------------------
+// Evaluates the shadows for one pixel of the shadow mask from the depth buffer. With a half
+// resolution mask each texel evaluates the top-left pixel of its 2x2 block. The visibility goes
+// in rgb (so that the cascade visualization still works), and the view-space depth of the pixel
+// goes in alpha for the bilateral upsample.
+//-------------------------------------------------------------------------------------------------
+float4 ShadowMaskPS(in float4 PositionSS : SV_Position,
+                    in float2 TexCoord : TEXCOORD0) : SV_Target0
+{
+    int2 pixelPos = int2(PositionSS.xy) * ShadowMaskScale_;
+
+    float depthVS;
+    float3 positionWS = SceneDepthPosition(pixelPos, depthVS);
+    if(SceneDepthMap.Load(pixelPos, 0) >= 1.0f)
+        return float4(1.0f, 1.0f, 1.0f, depthVS);
+
+    // The derivatives are always taken over a single full resolution pixel to match the forward pass
+    float4 neighborDepths;
+    float3 left = SceneDepthPosition(pixelPos + int2(-1, 0), neighborDepths.x);
+    float3 right = SceneDepthPosition(pixelPos + int2(1, 0), neighborDepths.y);
+    float3 up = SceneDepthPosition(pixelPos + int2(0, -1), neighborDepths.z);
+    float3 down = SceneDepthPosition(pixelPos + int2(0, 1), neighborDepths.w);
+    float3 positionDX = ClosestNeighborDelta(positionWS, depthVS, left, neighborDepths.x, right, neighborDepths.y);
+    float3 positionDY = ClosestNeighborDelta(positionWS, depthVS, up, neighborDepths.z, down, neighborDepths.w);
+
+    // There's no vertex normal here, so use the normal of the reconstructed surface
+    float3 normalWS = normalize(cross(positionDY, positionDX));
+    if(dot(normalWS, CameraPosWS - positionWS) < 0.0f)
+        normalWS = -normalWS;
+
+    float nDotL = saturate(dot(normalWS, LightDirection));
+    float3 shadowVisibility = ShadowVisibility(positionWS, positionDX, positionDY, depthVS, nDotL,
+                                               normalWS, uint2(pixelPos));
+
+    #if UseShadowHistory_
+        shadowVisibility = AccumulateShadowHistory(positionWS, shadowVisibility);
+    #endif
+
+    return float4(shadowVisibility, depthVS);
+}
+
+//-------------------------------------------------------------------------------------------------
+// Reads the shadow mask for a pixel of the forward pass. Each mask texel sits on the top-left
+// pixel of its block, so the 2x2 neighborhood gets bilinear weights that are scaled down by how
+// far the stored depth is from the pixel's depth. If none of them are on the same surface, the
+// one that's closest in depth gets used instead. Matches UpsampleShadowMask in ShadowMask.cpp.
+//-------------------------------------------------------------------------------------------------
+float3 SampleShadowMask(in uint2 screenPos, in float depthVS)
+{
+    uint2 maskSize;
+    ShadowMask.GetDimensions(maskSize.x, maskSize.y);
+
+    float2 maskPos = float2(screenPos) / ShadowMaskScale_;
+    int2 basePos = int2(floor(maskPos));
+    float2 lerpAmt = maskPos - basePos;
+
+    float3 sum = 0.0f;
+    float weightSum = 0.0f;
+    float3 closest = 1.0f;
+    float closestDiff = 3.402823466e+38f;
+
+    [unroll]
+    for(uint i = 0; i < 4; ++i)
+    {
+        int2 offset = int2(i & 1, i >> 1);
+        float4 mask = ShadowMask[min(uint2(basePos + offset), maskSize - 1)];
+
+        float2 bilinear = offset == 1 ? lerpAmt : 1.0f - lerpAmt;
+        float depthDiff = abs(mask.w - depthVS) / depthVS;
+        float weight = bilinear.x * bilinear.y * saturate(1.0f - depthDiff / ShadowMaskDepthThreshold);
+        sum += mask.xyz * weight;
+        weightSum += weight;
+
+        if(depthDiff < closestDiff)
+        {
+            closest = mask.xyz;
+            closestDiff = depthDiff;
+        }
+    }
+
+    return weightSum >= ShadowMaskMinWeight ? sum / weightSum : closest;
+}
+
 //=================================================================================================
 // Pixel Shader
 //=================================================================================================
@@ -816,8 +1259,13 @@ float4 PS(in PSInput input) : SV_Target0
 
     float nDotL = saturate(dot(normalWS, LightDirection));
     uint2 screenPos = uint2(input.PositionSS.xy);
-	float3 shadowVisibility = ShadowVisibility(input.PositionWS, input.DepthVS, nDotL,
-                                               normalWS, screenPos);
+    #if UseShadowMask_
+        float3 shadowVisibility = SampleShadowMask(screenPos, input.DepthVS);
+    #else
+        float3 shadowVisibility = ShadowVisibility(input.PositionWS, ddx_fine(input.PositionWS),
+                                                   ddy_fine(input.PositionWS), input.DepthVS, nDotL,
+                                                   normalWS, screenPos);
+    #endif
 
 	float3 lighting = 0.0f;
 
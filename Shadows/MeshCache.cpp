@@ -0,0 +1,606 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "MeshCache.h"
+#include "MeshRenderer.h"
+#include "VertexCompression.h"
+
+#include "SampleFramework11/Assert.h"
+#include "SampleFramework11/Utility.h"
+
+// Finds the approximate smallest enclosing bounding sphere for a set of points. Based on
+// "An Efficient Bounding Sphere", by Jack Ritter.
+static Sphere ComputeBoundingSphereFromPoints(const XMFLOAT3* points, uint32 numPoints, uint32 stride)
+{
+    Sphere sphere;
+
+    Assert_(numPoints > 0);
+    Assert_(points);
+
+    // Find the points with minimum and maximum x, y, and z
+    XMVECTOR MinX, MaxX, MinY, MaxY, MinZ, MaxZ;
+
+    MinX = MaxX = MinY = MaxY = MinZ = MaxZ = XMLoadFloat3(points);
+
+    for(uint32 i = 1; i < numPoints; i++)
+    {
+        XMVECTOR Point = XMLoadFloat3((XMFLOAT3*)((BYTE*)points + i * stride));
+
+        float px = XMVectorGetX(Point);
+        float py = XMVectorGetY(Point);
+        float pz = XMVectorGetZ(Point);
+
+        if(px < XMVectorGetX(MinX))
+            MinX = Point;
+
+        if(px > XMVectorGetX(MaxX))
+            MaxX = Point;
+
+        if(py < XMVectorGetY(MinY))
+            MinY = Point;
+
+        if(py > XMVectorGetY(MaxY))
+            MaxY = Point;
+
+        if(pz < XMVectorGetZ(MinZ))
+            MinZ = Point;
+
+        if(pz > XMVectorGetZ(MaxZ))
+            MaxZ = Point;
+    }
+
+    // Use the min/max pair that are farthest apart to form the initial sphere.
+    XMVECTOR DeltaX = MaxX - MinX;
+    XMVECTOR DistX = XMVector3Length(DeltaX);
+
+    XMVECTOR DeltaY = MaxY - MinY;
+    XMVECTOR DistY = XMVector3Length(DeltaY);
+
+    XMVECTOR DeltaZ = MaxZ - MinZ;
+    XMVECTOR DistZ = XMVector3Length(DeltaZ);
+
+    XMVECTOR Center;
+    XMVECTOR Radius;
+
+    if(XMVector3Greater(DistX, DistY))
+    {
+        if(XMVector3Greater(DistX, DistZ))
+        {
+            // Use min/max x.
+            Center = (MaxX + MinX) * 0.5f;
+            Radius = DistX * 0.5f;
+        }
+        else
+        {
+            // Use min/max z.
+            Center = (MaxZ + MinZ) * 0.5f;
+            Radius = DistZ * 0.5f;
+        }
+    }
+    else // Y >= X
+    {
+        if(XMVector3Greater(DistY, DistZ))
+        {
+            // Use min/max y.
+            Center = (MaxY + MinY) * 0.5f;
+            Radius = DistY * 0.5f;
+        }
+        else
+        {
+            // Use min/max z.
+            Center = (MaxZ + MinZ) * 0.5f;
+            Radius = DistZ * 0.5f;
+        }
+    }
+
+    // Add any points not inside the sphere.
+    for(uint32 i = 0; i < numPoints; i++)
+    {
+        XMVECTOR Point = XMLoadFloat3((XMFLOAT3*)((BYTE*)points + i * stride));
+
+        XMVECTOR Delta = Point - Center;
+
+        XMVECTOR Dist = XMVector3Length(Delta);
+
+        if(XMVector3Greater(Dist, Radius))
+        {
+            // Adjust sphere to include the new point.
+            Radius = (Radius + Dist) * 0.5f;
+            Center += (XMVectorReplicate(1.0f) - Radius * XMVectorReciprocal(Dist)) * Delta;
+        }
+    }
+
+    XMStoreFloat3(&sphere.Center, Center);
+    XMStoreFloat(&sphere.Radius, Radius);
+
+    return sphere;
+}
+
+// Rounds an offset up to the start of the next section
+static uint64 AlignCacheOffset(uint64 offset)
+{
+    return (offset + MeshCacheAlignment - 1) & ~(MeshCacheAlignment - 1);
+}
+
+// Appends a null-terminated string to the string table, and returns its offset
+static uint32 AddCacheString(std::vector<char>& strings, const std::string& str)
+{
+    const uint32 offset = uint32(strings.size());
+    strings.insert(strings.end(), str.begin(), str.end());
+    strings.push_back('\0');
+    return offset;
+}
+
+// Returns true if count elements of the given size starting at offset are inside the file
+static bool CacheSectionFits(uint64 fileSize, uint64 offset, uint64 count, uint64 elemSize)
+{
+    return offset <= fileSize && count <= (fileSize - offset) / std::max<uint64>(elemSize, 1);
+}
+
+// Returns true if every index is below numVertices
+template<typename T> static bool IndicesInRange(const T* indices, uint64 numIndices, uint32 numVertices)
+{
+    for(uint64 i = 0; i < numIndices; ++i)
+        if(indices[i] >= numVertices)
+            return false;
+    return true;
+}
+
+MeshStreamsView::MeshStreamsView() : Positions(nullptr), NumPositions(0), Indices(nullptr), NumIndices(0),
+                                     DrawCalls(nullptr), NumDrawCalls(0), PartLODs(nullptr)
+{
+}
+
+MeshStreamsView::MeshStreamsView(const MeshStreams& streams) : Positions(streams.Positions.data()),
+                                                              NumPositions(uint32(streams.Positions.size())),
+                                                              Indices(streams.Indices.data()),
+                                                              NumIndices(uint32(streams.Indices.size())),
+                                                              DrawCalls(streams.DrawCalls.data()),
+                                                              NumDrawCalls(uint32(streams.DrawCalls.size())),
+                                                              PartLODs(streams.PartLODs.data())
+{
+}
+
+// Simplifies every MeshPart down to each of the PartLODRatios, and appends the results to the
+// merged indices. Each level starts from the original triangles so that the errors don't pile
+// up, and levels that don't get much smaller than the one before them just re-use its indices.
+static void BuildPartLODs(MeshStreams& streams)
+{
+    const uint32 numDrawCalls = uint32(streams.DrawCalls.size());
+    streams.PartLODs.resize(uint64(numDrawCalls) * NumPartLODs);
+
+    std::vector<uint32> partIndices;
+    std::vector<uint32> lodIndices;
+    for(uint32 drawIdx = 0; drawIdx < numDrawCalls; ++drawIdx)
+    {
+        const DrawCall& drawCall = streams.DrawCalls[drawIdx];
+        MeshPartLOD* lods = &streams.PartLODs[uint64(drawIdx) * NumPartLODs];
+        lods[0].StartIndex = drawCall.StartIndex;
+        lods[0].NumIndices = drawCall.NumIndices;
+        lods[0].Error = 0.0f;
+        lods[0].Padding = 0;
+
+        partIndices.assign(streams.Indices.begin() + drawCall.StartIndex,
+                           streams.Indices.begin() + drawCall.StartIndex + drawCall.NumIndices);
+
+        for(uint32 lodIdx = 1; lodIdx < NumPartLODs; ++lodIdx)
+        {
+            lods[lodIdx] = lods[lodIdx - 1];
+
+            const uint32 targetIndices = uint32(drawCall.NumIndices * PartLODRatios[lodIdx]) / 3 * 3;
+            const float error = SimplifyMesh(streams.Positions.data(), partIndices.data(), drawCall.NumIndices,
+                                             targetIndices, drawCall.SphereRadius * MaxPartLODError, lodIndices);
+            if(lodIndices.empty() || lodIndices.size() * 10 >= uint64(lods[lodIdx - 1].NumIndices) * 9)
+                continue;
+
+            lods[lodIdx].StartIndex = uint32(streams.Indices.size());
+            lods[lodIdx].NumIndices = uint32(lodIndices.size());
+            lods[lodIdx].Error = std::max(error, lods[lodIdx - 1].Error);
+            streams.Indices.insert(streams.Indices.end(), lodIndices.begin(), lodIndices.end());
+        }
+    }
+}
+
+void BuildMeshStreams(const Model& model, MeshStreams& streams)
+{
+    streams.Positions.clear();
+    streams.Indices.clear();
+    streams.DrawCalls.clear();
+    streams.PartLODs.clear();
+
+    std::vector<Float3> points;
+    for(uint64 meshIdx = 0; meshIdx < model.Meshes().size(); ++meshIdx)
+    {
+        const Mesh& mesh = model.Meshes()[meshIdx];
+
+        const uint32 vtxOffset = uint32(streams.Positions.size());
+        DecodePositions(mesh, points);
+        streams.Positions.insert(streams.Positions.end(), points.begin(), points.end());
+
+        const uint32 idxOffset = uint32(streams.Indices.size());
+        for(uint32 i = 0; i < mesh.NumIndices(); ++i)
+        {
+            uint32 idx = GetIndex(mesh.Indices(), i, mesh.IndexSize());
+            idx += vtxOffset;
+            streams.Indices.push_back(idx);
+        }
+
+        for(uint64 partIdx = 0; partIdx < mesh.MeshParts().size(); ++partIdx)
+        {
+            const MeshPart& part = mesh.MeshParts()[partIdx];
+
+            points.clear();
+            for(uint32 i = 0; i < part.IndexCount; ++i)
+                points.push_back(streams.Positions[streams.Indices[idxOffset + part.IndexStart + i]]);
+
+            const Sphere sphere = ComputeBoundingSphereFromPoints(points.data(), uint32(points.size()), sizeof(Float3));
+
+            DrawCall drawCall;
+            drawCall.StartIndex = part.IndexStart + idxOffset;
+            drawCall.NumIndices = part.IndexCount;
+            drawCall.SphereCenter = sphere.Center;
+            drawCall.SphereRadius = sphere.Radius;
+            streams.DrawCalls.push_back(drawCall);
+        }
+    }
+
+    BuildPartLODs(streams);
+}
+
+void WriteMeshCache(const wchar* filePath, const Model& model, const MeshStreams& streams,
+                    uint64 sourceTimestamp)
+{
+    const std::vector<Mesh>& meshes = model.Meshes();
+    const std::vector<MeshMaterial>& materials = model.Materials();
+
+    // Offset 0 is always the empty string
+    std::vector<char> strings;
+    strings.push_back('\0');
+
+    std::vector<MeshCacheMesh> cacheMeshes(meshes.size());
+    std::vector<MeshCacheInputElement> cacheElements;
+    std::vector<MeshPart> cacheParts;
+    for(uint64 meshIdx = 0; meshIdx < meshes.size(); ++meshIdx)
+    {
+        const Mesh& mesh = meshes[meshIdx];
+        MeshCacheMesh& cacheMesh = cacheMeshes[meshIdx];
+        cacheMesh.VertexOffset = 0;
+        cacheMesh.IndexOffset = 0;
+        cacheMesh.NumVertices = mesh.NumVertices();
+        cacheMesh.VertexStride = mesh.VertexStride();
+        cacheMesh.NumIndices = mesh.NumIndices();
+        cacheMesh.IndexType = uint32(mesh.IndexBufferType());
+        cacheMesh.FirstInputElement = uint32(cacheElements.size());
+        cacheMesh.NumInputElements = mesh.NumInputElements();
+        cacheMesh.FirstPart = uint32(cacheParts.size());
+        cacheMesh.NumParts = uint32(mesh.MeshParts().size());
+        cacheMesh.NameOffset = AddCacheString(strings, mesh.Name());
+        cacheMesh.Padding = 0;
+        cacheMesh.PositionScale = mesh.PositionScale();
+        cacheMesh.PositionBias = mesh.PositionBias();
+
+        for(uint32 i = 0; i < mesh.NumInputElements(); ++i)
+        {
+            const D3D11_INPUT_ELEMENT_DESC& element = mesh.InputElements()[i];
+            MeshCacheInputElement cacheElement;
+            cacheElement.SemanticNameOffset = AddCacheString(strings, element.SemanticName);
+            cacheElement.SemanticIndex = element.SemanticIndex;
+            cacheElement.Format = uint32(element.Format);
+            cacheElement.InputSlot = element.InputSlot;
+            cacheElement.AlignedByteOffset = element.AlignedByteOffset;
+            cacheElement.InputSlotClass = uint32(element.InputSlotClass);
+            cacheElement.InstanceDataStepRate = element.InstanceDataStepRate;
+            cacheElements.push_back(cacheElement);
+        }
+
+        cacheParts.insert(cacheParts.end(), mesh.MeshParts().begin(), mesh.MeshParts().end());
+    }
+
+    Assert_(streams.DrawCalls.size() == cacheParts.size());
+    Assert_(streams.PartLODs.size() == cacheParts.size() * NumPartLODs);
+
+    std::vector<MeshCacheMaterial> cacheMaterials(materials.size());
+    for(uint64 i = 0; i < materials.size(); ++i)
+    {
+        const MeshMaterial& material = materials[i];
+        MeshCacheMaterial& cacheMaterial = cacheMaterials[i];
+        cacheMaterial.AmbientAlbedo = material.AmbientAlbedo;
+        cacheMaterial.DiffuseAlbedo = material.DiffuseAlbedo;
+        cacheMaterial.SpecularAlbedo = material.SpecularAlbedo;
+        cacheMaterial.Emissive = material.Emissive;
+        cacheMaterial.SpecularPower = material.SpecularPower;
+        cacheMaterial.Alpha = material.Alpha;
+        cacheMaterial.NameOffset = AddCacheString(strings, material.Name);
+        cacheMaterial.DiffuseMapNameOffset = AddCacheString(strings, WStringToAnsi(material.DiffuseMapName.c_str()));
+        cacheMaterial.NormalMapNameOffset = AddCacheString(strings, WStringToAnsi(material.NormalMapName.c_str()));
+    }
+
+    // Lay out the sections
+    MeshCacheHeader header;
+    header.Magic = MeshCacheMagic;
+    header.Version = MeshCacheVersion;
+    header.SourceTimestamp = sourceTimestamp;
+    header.NumMeshes = uint32(cacheMeshes.size());
+    header.NumInputElements = uint32(cacheElements.size());
+    header.NumParts = uint32(cacheParts.size());
+    header.NumMaterials = uint32(cacheMaterials.size());
+    header.NumPositions = uint32(streams.Positions.size());
+    header.NumIndices = uint32(streams.Indices.size());
+
+    uint64 offset = AlignCacheOffset(sizeof(MeshCacheHeader));
+    header.MeshesOffset = offset;
+    offset = AlignCacheOffset(offset + cacheMeshes.size() * sizeof(MeshCacheMesh));
+    header.InputElementsOffset = offset;
+    offset = AlignCacheOffset(offset + cacheElements.size() * sizeof(MeshCacheInputElement));
+    header.PartsOffset = offset;
+    offset = AlignCacheOffset(offset + cacheParts.size() * sizeof(MeshPart));
+    header.MaterialsOffset = offset;
+    offset = AlignCacheOffset(offset + cacheMaterials.size() * sizeof(MeshCacheMaterial));
+    header.DrawCallsOffset = offset;
+    offset = AlignCacheOffset(offset + streams.DrawCalls.size() * sizeof(DrawCall));
+    header.PositionsOffset = offset;
+    offset = AlignCacheOffset(offset + streams.Positions.size() * sizeof(Float3));
+    header.IndicesOffset = offset;
+    offset = AlignCacheOffset(offset + streams.Indices.size() * sizeof(uint32));
+    header.PartLODsOffset = offset;
+    offset = AlignCacheOffset(offset + streams.PartLODs.size() * sizeof(MeshPartLOD));
+
+    for(uint64 meshIdx = 0; meshIdx < meshes.size(); ++meshIdx)
+    {
+        cacheMeshes[meshIdx].VertexOffset = offset;
+        offset = AlignCacheOffset(offset + uint64(meshes[meshIdx].NumVertices()) * meshes[meshIdx].VertexStride());
+    }
+
+    for(uint64 meshIdx = 0; meshIdx < meshes.size(); ++meshIdx)
+    {
+        cacheMeshes[meshIdx].IndexOffset = offset;
+        offset = AlignCacheOffset(offset + uint64(meshes[meshIdx].NumIndices()) * meshes[meshIdx].IndexSize());
+    }
+
+    header.StringsOffset = offset;
+    header.StringsSize = strings.size();
+    header.FileSize = offset + strings.size();
+
+    // Build the whole file in memory so that it only takes one write
+    std::vector<uint8> fileData(header.FileSize, 0);
+    uint8* dst = fileData.data();
+    memcpy(dst, &header, sizeof(MeshCacheHeader));
+    memcpy(dst + header.MeshesOffset, cacheMeshes.data(), cacheMeshes.size() * sizeof(MeshCacheMesh));
+    memcpy(dst + header.InputElementsOffset, cacheElements.data(), cacheElements.size() * sizeof(MeshCacheInputElement));
+    memcpy(dst + header.PartsOffset, cacheParts.data(), cacheParts.size() * sizeof(MeshPart));
+    memcpy(dst + header.MaterialsOffset, cacheMaterials.data(), cacheMaterials.size() * sizeof(MeshCacheMaterial));
+    memcpy(dst + header.DrawCallsOffset, streams.DrawCalls.data(), streams.DrawCalls.size() * sizeof(DrawCall));
+    memcpy(dst + header.PositionsOffset, streams.Positions.data(), streams.Positions.size() * sizeof(Float3));
+    memcpy(dst + header.IndicesOffset, streams.Indices.data(), streams.Indices.size() * sizeof(uint32));
+    memcpy(dst + header.PartLODsOffset, streams.PartLODs.data(), streams.PartLODs.size() * sizeof(MeshPartLOD));
+
+    for(uint64 meshIdx = 0; meshIdx < meshes.size(); ++meshIdx)
+    {
+        const Mesh& mesh = meshes[meshIdx];
+        memcpy(dst + cacheMeshes[meshIdx].VertexOffset, mesh.Vertices(), uint64(mesh.NumVertices()) * mesh.VertexStride());
+        memcpy(dst + cacheMeshes[meshIdx].IndexOffset, mesh.Indices(), uint64(mesh.NumIndices()) * mesh.IndexSize());
+    }
+
+    memcpy(dst + header.StringsOffset, strings.data(), strings.size());
+
+    File file(filePath, File::OpenWrite);
+    file.Write(fileData.size(), fileData.data());
+}
+
+MeshCache::MeshCache() : header(nullptr)
+{
+}
+
+bool MeshCache::Open(const wchar* filePath, uint64 sourceTimestamp)
+{
+    Close();
+
+    if(FileExists(filePath) == false)
+        return false;
+
+    file.Open(filePath);
+    if(file.Size() < sizeof(MeshCacheHeader))
+    {
+        file.Close();
+        return false;
+    }
+
+    header = Section<MeshCacheHeader>(0);
+    if(header->SourceTimestamp != sourceTimestamp || Validate() == false)
+    {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void MeshCache::Close()
+{
+    file.Close();
+    header = nullptr;
+}
+
+const char* MeshCache::String(uint32 offset) const
+{
+    Assert_(offset < header->StringsSize);
+    return Section<char>(header->StringsOffset + offset);
+}
+
+// Checks that everything the header and mesh descriptions point to is inside the file, and that
+// every index refers to an existing vertex, so that a truncated or corrupted cache gets rebuilt
+// instead of being read out of bounds
+bool MeshCache::Validate() const
+{
+    const uint64 fileSize = file.Size();
+    const MeshCacheHeader& h = *header;
+    if(h.Magic != MeshCacheMagic || h.Version != MeshCacheVersion || h.FileSize != fileSize)
+        return false;
+
+    const uint64 offsets[] = { h.MeshesOffset, h.InputElementsOffset, h.PartsOffset, h.MaterialsOffset,
+                               h.DrawCallsOffset, h.PositionsOffset, h.IndicesOffset, h.PartLODsOffset,
+                               h.StringsOffset };
+    for(uint64 i = 0; i < ArraySize_(offsets); ++i)
+        if(offsets[i] % MeshCacheAlignment != 0)
+            return false;
+
+    if(CacheSectionFits(fileSize, h.MeshesOffset, h.NumMeshes, sizeof(MeshCacheMesh)) == false ||
+       CacheSectionFits(fileSize, h.InputElementsOffset, h.NumInputElements, sizeof(MeshCacheInputElement)) == false ||
+       CacheSectionFits(fileSize, h.PartsOffset, h.NumParts, sizeof(MeshPart)) == false ||
+       CacheSectionFits(fileSize, h.MaterialsOffset, h.NumMaterials, sizeof(MeshCacheMaterial)) == false ||
+       CacheSectionFits(fileSize, h.DrawCallsOffset, h.NumParts, sizeof(DrawCall)) == false ||
+       CacheSectionFits(fileSize, h.PositionsOffset, h.NumPositions, sizeof(Float3)) == false ||
+       CacheSectionFits(fileSize, h.IndicesOffset, h.NumIndices, sizeof(uint32)) == false ||
+       CacheSectionFits(fileSize, h.PartLODsOffset, uint64(h.NumParts) * NumPartLODs, sizeof(MeshPartLOD)) == false ||
+       CacheSectionFits(fileSize, h.StringsOffset, h.StringsSize, 1) == false)
+        return false;
+
+    // The string table needs to end with a terminator, so that every offset in it is a valid string
+    if(h.StringsSize == 0 || *Section<char>(h.StringsOffset + h.StringsSize - 1) != '\0')
+        return false;
+
+    const MeshCacheInputElement* elements = Section<MeshCacheInputElement>(h.InputElementsOffset);
+    for(uint32 i = 0; i < h.NumInputElements; ++i)
+        if(elements[i].SemanticNameOffset >= h.StringsSize)
+            return false;
+
+    const MeshCacheMaterial* materials = Section<MeshCacheMaterial>(h.MaterialsOffset);
+    for(uint32 i = 0; i < h.NumMaterials; ++i)
+        if(materials[i].NameOffset >= h.StringsSize || materials[i].DiffuseMapNameOffset >= h.StringsSize ||
+           materials[i].NormalMapNameOffset >= h.StringsSize)
+            return false;
+
+    // The merged indices are offset into the merged positions
+    if(IndicesInRange(Section<uint32>(h.IndicesOffset), h.NumIndices, h.NumPositions) == false)
+        return false;
+
+    const MeshCacheMesh* meshes = Section<MeshCacheMesh>(h.MeshesOffset);
+    const MeshPart* parts = Section<MeshPart>(h.PartsOffset);
+    const DrawCall* drawCalls = Section<DrawCall>(h.DrawCallsOffset);
+    const MeshPartLOD* partLODs = Section<MeshPartLOD>(h.PartLODsOffset);
+    for(uint32 meshIdx = 0; meshIdx < h.NumMeshes; ++meshIdx)
+    {
+        const MeshCacheMesh& mesh = meshes[meshIdx];
+        const uint32 indexSize = mesh.IndexType == Mesh::Index32Bit ? 4 : 2;
+        if(mesh.IndexType > Mesh::Index32Bit || mesh.NameOffset >= h.StringsSize || mesh.NumInputElements == 0 ||
+           mesh.FirstInputElement > h.NumInputElements || mesh.NumInputElements > h.NumInputElements - mesh.FirstInputElement ||
+           mesh.FirstPart > h.NumParts || mesh.NumParts > h.NumParts - mesh.FirstPart ||
+           CacheSectionFits(fileSize, mesh.VertexOffset, mesh.NumVertices, mesh.VertexStride) == false ||
+           CacheSectionFits(fileSize, mesh.IndexOffset, mesh.NumIndices, indexSize) == false)
+            return false;
+
+        const bool indicesInRange = indexSize == 4
+                                  ? IndicesInRange(Section<uint32>(mesh.IndexOffset), mesh.NumIndices, mesh.NumVertices)
+                                  : IndicesInRange(Section<uint16>(mesh.IndexOffset), mesh.NumIndices, mesh.NumVertices);
+        if(indicesInRange == false)
+            return false;
+
+        for(uint32 partIdx = mesh.FirstPart; partIdx < mesh.FirstPart + mesh.NumParts; ++partIdx)
+        {
+            const MeshPart& part = parts[partIdx];
+            if(part.IndexStart > mesh.NumIndices || part.IndexCount > mesh.NumIndices - part.IndexStart ||
+               part.MaterialIdx >= h.NumMaterials)
+                return false;
+
+            const DrawCall& drawCall = drawCalls[partIdx];
+            if(drawCall.StartIndex > h.NumIndices || drawCall.NumIndices > h.NumIndices - drawCall.StartIndex)
+                return false;
+
+            for(uint32 lodIdx = 0; lodIdx < NumPartLODs; ++lodIdx)
+            {
+                const MeshPartLOD& lod = partLODs[partIdx * NumPartLODs + lodIdx];
+                if(lod.StartIndex > h.NumIndices || lod.NumIndices > h.NumIndices - lod.StartIndex)
+                    return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void MeshCache::CreateModel(ID3D11Device* device, Model& model, const std::wstring& textureDirectory) const
+{
+    Assert_(IsOpen());
+
+    const MeshCacheMesh* cacheMeshes = Section<MeshCacheMesh>(header->MeshesOffset);
+    const MeshCacheInputElement* cacheElements = Section<MeshCacheInputElement>(header->InputElementsOffset);
+    const MeshPart* parts = Section<MeshPart>(header->PartsOffset);
+
+    std::vector<Mesh>& meshes = model.Meshes();
+    meshes.clear();
+    meshes.resize(header->NumMeshes);
+
+    std::vector<D3D11_INPUT_ELEMENT_DESC> elements;
+    for(uint32 meshIdx = 0; meshIdx < header->NumMeshes; ++meshIdx)
+    {
+        const MeshCacheMesh& cacheMesh = cacheMeshes[meshIdx];
+
+        // The semantic names point straight into the mapped string table
+        elements.resize(cacheMesh.NumInputElements);
+        for(uint32 i = 0; i < cacheMesh.NumInputElements; ++i)
+        {
+            const MeshCacheInputElement& cacheElement = cacheElements[cacheMesh.FirstInputElement + i];
+            elements[i].SemanticName = String(cacheElement.SemanticNameOffset);
+            elements[i].SemanticIndex = cacheElement.SemanticIndex;
+            elements[i].Format = DXGI_FORMAT(cacheElement.Format);
+            elements[i].InputSlot = cacheElement.InputSlot;
+            elements[i].AlignedByteOffset = cacheElement.AlignedByteOffset;
+            elements[i].InputSlotClass = D3D11_INPUT_CLASSIFICATION(cacheElement.InputSlotClass);
+            elements[i].InstanceDataStepRate = cacheElement.InstanceDataStepRate;
+        }
+
+        meshes[meshIdx].InitFromMemory(device, Section<uint8>(cacheMesh.VertexOffset), cacheMesh.NumVertices,
+                                       cacheMesh.VertexStride, Section<uint8>(cacheMesh.IndexOffset),
+                                       cacheMesh.NumIndices, Mesh::IndexType(cacheMesh.IndexType),
+                                       elements.data(), cacheMesh.NumInputElements,
+                                       parts + cacheMesh.FirstPart, cacheMesh.NumParts,
+                                       String(cacheMesh.NameOffset));
+        meshes[meshIdx].SetPositionDequantization(cacheMesh.PositionScale, cacheMesh.PositionBias);
+    }
+
+    const MeshCacheMaterial* cacheMaterials = Section<MeshCacheMaterial>(header->MaterialsOffset);
+    std::vector<MeshMaterial>& materials = model.Materials();
+    materials.clear();
+    materials.resize(header->NumMaterials);
+    for(uint32 i = 0; i < header->NumMaterials; ++i)
+    {
+        const MeshCacheMaterial& cacheMaterial = cacheMaterials[i];
+        MeshMaterial& material = materials[i];
+        material.AmbientAlbedo = cacheMaterial.AmbientAlbedo;
+        material.DiffuseAlbedo = cacheMaterial.DiffuseAlbedo;
+        material.SpecularAlbedo = cacheMaterial.SpecularAlbedo;
+        material.Emissive = cacheMaterial.Emissive;
+        material.SpecularPower = cacheMaterial.SpecularPower;
+        material.Alpha = cacheMaterial.Alpha;
+        material.Name = String(cacheMaterial.NameOffset);
+        material.DiffuseMapName = AnsiToWString(String(cacheMaterial.DiffuseMapNameOffset));
+        material.NormalMapName = AnsiToWString(String(cacheMaterial.NormalMapNameOffset));
+    }
+
+    if(device != nullptr)
+        model.LoadMaterialTextures(device, textureDirectory);
+}
+
+MeshStreamsView MeshCache::Streams() const
+{
+    Assert_(IsOpen());
+
+    MeshStreamsView view;
+    view.Positions = Section<Float3>(header->PositionsOffset);
+    view.NumPositions = header->NumPositions;
+    view.Indices = Section<uint32>(header->IndicesOffset);
+    view.NumIndices = header->NumIndices;
+    view.DrawCalls = Section<DrawCall>(header->DrawCallsOffset);
+    view.NumDrawCalls = header->NumParts;
+    view.PartLODs = Section<MeshPartLOD>(header->PartLODsOffset);
+    return view;
+}
@@ -0,0 +1,184 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+#include "SampleFramework11/Math.h"
+#include "SampleFramework11/Model.h"
+#include "SampleFramework11/FileIO.h"
+
+using namespace SampleFramework11;
+
+#include "SharedConstants.h"
+#include "MeshSimplifier.h"
+
+// Binary cache for a Model and the streams that MeshRenderer builds from it, laid out so that it
+// can be memory-mapped and handed straight to D3D without copying any of the vertex or index
+// data. The file is a header followed by a list of sections, each of which starts on a
+// MeshCacheAlignment boundary:
+//
+//  MeshCacheHeader
+//  MeshCacheMesh[NumMeshes]
+//  MeshCacheInputElement[NumInputElements]
+//  MeshPart[NumParts]
+//  MeshCacheMaterial[NumMaterials]
+//  DrawCall[NumParts]              (object space bounding spheres)
+//  Float3[NumPositions]            (positions of every mesh, back to back)
+//  uint32[NumIndices]              (indices of every mesh, offset into the merged positions,
+//                                   followed by the simplified indices of every MeshPart)
+//  MeshPartLOD[NumParts * NumPartLODs]
+//  vertex data for each mesh
+//  index data for each mesh
+//  string table                    (null-terminated ANSI strings)
+
+static const uint32 MeshCacheMagic = 0x4853454D;     // "MESH"
+static const uint32 MeshCacheVersion = 6;
+static const uint64 MeshCacheAlignment = 64;
+
+struct MeshCacheHeader
+{
+    uint32 Magic;
+    uint32 Version;
+    uint64 FileSize;
+    uint64 SourceTimestamp;
+
+    uint32 NumMeshes;
+    uint32 NumInputElements;
+    uint32 NumParts;
+    uint32 NumMaterials;
+    uint32 NumPositions;
+    uint32 NumIndices;
+
+    uint64 MeshesOffset;
+    uint64 InputElementsOffset;
+    uint64 PartsOffset;
+    uint64 MaterialsOffset;
+    uint64 DrawCallsOffset;
+    uint64 PositionsOffset;
+    uint64 IndicesOffset;
+    uint64 PartLODsOffset;
+    uint64 StringsOffset;
+    uint64 StringsSize;
+};
+
+struct MeshCacheMesh
+{
+    uint64 VertexOffset;
+    uint64 IndexOffset;
+    uint32 NumVertices;
+    uint32 VertexStride;
+    uint32 NumIndices;
+    uint32 IndexType;
+    uint32 FirstInputElement;
+    uint32 NumInputElements;
+    uint32 FirstPart;
+    uint32 NumParts;
+    uint32 NameOffset;
+    uint32 Padding;
+    Float3 PositionScale;
+    Float3 PositionBias;
+};
+
+// D3D11_INPUT_ELEMENT_DESC with the semantic name stored as an offset into the string table
+struct MeshCacheInputElement
+{
+    uint32 SemanticNameOffset;
+    uint32 SemanticIndex;
+    uint32 Format;
+    uint32 InputSlot;
+    uint32 AlignedByteOffset;
+    uint32 InputSlotClass;
+    uint32 InstanceDataStepRate;
+};
+
+struct MeshCacheMaterial
+{
+    Float3 AmbientAlbedo;
+    Float3 DiffuseAlbedo;
+    Float3 SpecularAlbedo;
+    Float3 Emissive;
+    float SpecularPower;
+    float Alpha;
+    uint32 NameOffset;
+    uint32 DiffuseMapNameOffset;
+    uint32 NormalMapNameOffset;
+};
+
+// Merged position and index streams for all meshes in a model, along with a DrawCall (with an
+// object space bounding sphere) and NumPartLODs levels of detail for each MeshPart
+struct MeshStreams
+{
+    std::vector<Float3> Positions;
+    std::vector<uint32> Indices;
+    std::vector<DrawCall> DrawCalls;
+    std::vector<MeshPartLOD> PartLODs;
+};
+
+// Same as MeshStreams, but pointing at memory that's owned by someone else
+struct MeshStreamsView
+{
+    const Float3* Positions;
+    uint32 NumPositions;
+    const uint32* Indices;
+    uint32 NumIndices;
+    const DrawCall* DrawCalls;
+    uint32 NumDrawCalls;
+    const MeshPartLOD* PartLODs;
+
+    MeshStreamsView();
+    MeshStreamsView(const MeshStreams& streams);
+};
+
+// Builds the merged streams, bounding spheres, and levels of detail from the CPU copy of the
+// model's data
+void BuildMeshStreams(const Model& model, MeshStreams& streams);
+
+// Writes out the model and its streams with a single write. The timestamp of the source file
+// gets stored so that the cache can be rebuilt when the source changes.
+void WriteMeshCache(const wchar* filePath, const Model& model, const MeshStreams& streams,
+                    uint64 sourceTimestamp);
+
+class MeshCache
+{
+
+public:
+
+    MeshCache();
+
+    // Maps the cache file and validates it. Returns false if the file doesn't exist, was made
+    // from an older version of the source file or with a different version of the format, or
+    // is malformed.
+    bool Open(const wchar* filePath, uint64 sourceTimestamp);
+    void Close();
+
+    bool IsOpen() const { return header != nullptr; }
+
+    // Creates the meshes straight from the mapped data, and loads the material textures. The
+    // cache needs to stay open for as long as the model is alive. With a null device only the
+    // CPU side of the model gets set up, as with Model::CreateFromSDKMeshFile.
+    void CreateModel(ID3D11Device* device, Model& model, const std::wstring& textureDirectory) const;
+
+    MeshStreamsView Streams() const;
+
+protected:
+
+    template<typename T> const T* Section(uint64 offset) const
+    {
+        return reinterpret_cast<const T*>(file.Data() + offset);
+    }
+
+    const char* String(uint32 offset) const;
+
+    bool Validate() const;
+
+    MappedFile file;
+    const MeshCacheHeader* header;
+};
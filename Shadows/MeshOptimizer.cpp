@@ -0,0 +1,598 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "MeshOptimizer.h"
+#include "VertexCompression.h"
+
+#include "SampleFramework11/Assert.h"
+#include "SampleFramework11/Utility.h"
+
+// Scoring constants from Forsyth's article
+static const float ForsythCacheDecayPower = 1.5f;
+static const float ForsythLastTriScore = 0.75f;
+static const float ForsythValenceBoostScale = 2.0f;
+static const float ForsythValenceBoostPower = 0.5f;
+static const uint32 ForsythMaxValence = 32;
+
+static const uint32 InvalidIndex = 0xFFFFFFFF;
+
+// Score of a vertex given its position in the cache (-1 if it's not in the cache) and the number
+// of triangles using it that haven't been added yet
+static float ForsythVertexScore(int32 cachePosition, uint32 numActiveTris)
+{
+    if(numActiveTris == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if(cachePosition >= 0)
+    {
+        // The last triangle's vertices get a fixed score, so that it doesn't matter which order
+        // they were added in
+        if(cachePosition < 3)
+            score = ForsythLastTriScore;
+        else
+        {
+            const float scale = 1.0f / (VertexCacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scale, ForsythCacheDecayPower);
+        }
+    }
+
+    // Boost vertices with only a few triangles left, so that they get finished off
+    const float valence = float(std::min(numActiveTris, ForsythMaxValence));
+    score += ForsythValenceBoostScale * std::pow(valence, -ForsythValenceBoostPower);
+    return score;
+}
+
+VertexCacheStats AnalyzeVertexCache(const uint32* indices, uint32 numIndices, uint32 numVertices,
+                                    uint32 cacheSize)
+{
+    VertexCacheStats stats;
+    const uint32 numTris = numIndices / 3;
+    if(numTris == 0)
+        return stats;
+
+    // A vertex is in the FIFO if fewer than cacheSize misses happened since it was added
+    std::vector<uint32> timestamps(numVertices, 0);
+    std::vector<bool> referenced(numVertices, false);
+    uint32 time = cacheSize + 1;
+    uint32 numMisses = 0;
+    uint32 numReferenced = 0;
+    for(uint32 i = 0; i < numTris * 3; ++i)
+    {
+        const uint32 idx = indices[i];
+        Assert_(idx < numVertices);
+        if(time - timestamps[idx] > cacheSize)
+        {
+            timestamps[idx] = time++;
+            ++numMisses;
+        }
+
+        if(referenced[idx] == false)
+        {
+            referenced[idx] = true;
+            ++numReferenced;
+        }
+    }
+
+    stats.ACMR = float(numMisses) / numTris;
+    stats.ATVR = float(numMisses) / numReferenced;
+    return stats;
+}
+
+void OptimizeVertexCache(uint32* indices, uint32 numIndices, uint32 numVertices)
+{
+    const uint32 numTris = numIndices / 3;
+    if(numTris < 2)
+        return;
+
+    // Build the list of triangles that use each vertex
+    std::vector<uint32> triOffsets(numVertices + 1, 0);
+    for(uint32 i = 0; i < numTris * 3; ++i)
+        ++triOffsets[indices[i] + 1];
+    for(uint32 v = 0; v < numVertices; ++v)
+        triOffsets[v + 1] += triOffsets[v];
+
+    std::vector<uint32> numActiveTris(numVertices, 0);
+    std::vector<uint32> vertexTris(numTris * 3);
+    for(uint32 i = 0; i < numTris * 3; ++i)
+    {
+        const uint32 v = indices[i];
+        vertexTris[triOffsets[v] + numActiveTris[v]] = i / 3;
+        ++numActiveTris[v];
+    }
+
+    std::vector<float> vertexScores(numVertices);
+    std::vector<int32> cachePositions(numVertices, -1);
+    for(uint32 v = 0; v < numVertices; ++v)
+        vertexScores[v] = ForsythVertexScore(-1, numActiveTris[v]);
+
+    std::vector<float> triScores(numTris);
+    std::vector<bool> triAdded(numTris, false);
+
+    std::vector<uint32> cache;
+    std::vector<uint32> newCache;
+    cache.reserve(VertexCacheSize + 3);
+    newCache.reserve(VertexCacheSize + 3);
+
+    std::vector<uint32> output(numTris * 3);
+    uint32 bestTri = InvalidIndex;
+    uint32 scanPos = 0;
+    for(uint32 outTri = 0; outTri < numTris; ++outTri)
+    {
+        // If none of the triangles touching the cache are left, fall back to the next one in the
+        // original order. The cursor only moves forward, so all of the restarts together only
+        // walk the list once.
+        if(bestTri == InvalidIndex)
+        {
+            while(triAdded[scanPos])
+                ++scanPos;
+            bestTri = scanPos;
+        }
+
+        Assert_(bestTri != InvalidIndex);
+        triAdded[bestTri] = true;
+
+        newCache.clear();
+        for(uint32 i = 0; i < 3; ++i)
+        {
+            const uint32 v = indices[bestTri * 3 + i];
+            output[outTri * 3 + i] = v;
+            newCache.push_back(v);
+
+            // Remove the triangle from the vertex's list of active triangles
+            uint32* tris = &vertexTris[triOffsets[v]];
+            const uint32 numActive = numActiveTris[v];
+            for(uint32 j = 0; j < numActive; ++j)
+            {
+                if(tris[j] == bestTri)
+                {
+                    std::swap(tris[j], tris[numActive - 1]);
+                    break;
+                }
+            }
+            --numActiveTris[v];
+        }
+
+        for(uint32 v : cache)
+            if(v != newCache[0] && v != newCache[1] && v != newCache[2])
+                newCache.push_back(v);
+
+        // Update the scores of everything that was in the cache, including the vertices that just
+        // got pushed out, and look for the best triangle that uses them
+        float bestScore = -1.0f;
+        bestTri = InvalidIndex;
+        for(uint32 i = 0; i < newCache.size(); ++i)
+        {
+            const uint32 v = newCache[i];
+            cachePositions[v] = i < VertexCacheSize ? int32(i) : -1;
+            vertexScores[v] = ForsythVertexScore(cachePositions[v], numActiveTris[v]);
+        }
+
+        for(uint32 i = 0; i < newCache.size(); ++i)
+        {
+            const uint32 v = newCache[i];
+            for(uint32 j = 0; j < numActiveTris[v]; ++j)
+            {
+                const uint32 t = vertexTris[triOffsets[v] + j];
+                triScores[t] = vertexScores[indices[t * 3 + 0]] + vertexScores[indices[t * 3 + 1]] +
+                               vertexScores[indices[t * 3 + 2]];
+                if(triScores[t] > bestScore)
+                {
+                    bestScore = triScores[t];
+                    bestTri = t;
+                }
+            }
+        }
+
+        if(newCache.size() > VertexCacheSize)
+            newCache.resize(VertexCacheSize);
+        cache.swap(newCache);
+    }
+
+    memcpy(indices, output.data(), numTris * 3 * sizeof(uint32));
+}
+
+void OptimizeOverdraw(uint32* indices, uint32 numIndices, const uint8* positions, uint32 positionStride,
+                      float threshold)
+{
+    const uint32 numTris = numIndices / 3;
+    if(numTris < 2)
+        return;
+
+    uint32 numVertices = 0;
+    for(uint32 i = 0; i < numTris * 3; ++i)
+        numVertices = std::max(numVertices, indices[i] + 1);
+
+    // Find the number of misses for each triangle with the same FIFO as AnalyzeVertexCache
+    std::vector<uint32> timestamps(numVertices, 0);
+    std::vector<uint32> triMisses(numTris, 0);
+    uint32 time = VertexCacheSize + 1;
+    for(uint32 i = 0; i < numTris * 3; ++i)
+    {
+        const uint32 idx = indices[i];
+        if(time - timestamps[idx] > VertexCacheSize)
+        {
+            timestamps[idx] = time++;
+            ++triMisses[i / 3];
+        }
+    }
+
+    const float acmr = float(time - VertexCacheSize - 1) / numTris;
+
+    // Clusters can only start at triangles that miss on all 3 vertices, since nothing from the
+    // previous cluster was being reused there anyway
+    std::vector<uint32> clusterStarts;
+    clusterStarts.push_back(0);
+    uint32 clusterMisses = 0;
+    for(uint32 t = 0; t < numTris; ++t)
+    {
+        const uint32 clusterSize = t - clusterStarts.back();
+        if(clusterSize > 0 && triMisses[t] == 3 && clusterMisses <= threshold * acmr * clusterSize)
+        {
+            clusterStarts.push_back(t);
+            clusterMisses = 0;
+        }
+
+        clusterMisses += triMisses[t];
+    }
+
+    const uint32 numClusters = uint32(clusterStarts.size());
+    if(numClusters < 2)
+        return;
+
+    clusterStarts.push_back(numTris);
+
+    // Area-weighted centroid and normal of each cluster
+    std::vector<Float3> clusterCentroids(numClusters);
+    std::vector<Float3> clusterNormals(numClusters);
+    Float3 meshCentroid = 0.0f;
+    float meshArea = 0.0f;
+    for(uint32 c = 0; c < numClusters; ++c)
+    {
+        Float3 centroid = 0.0f;
+        Float3 normal = 0.0f;
+        float area = 0.0f;
+        for(uint32 t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t)
+        {
+            const Float3& p0 = *reinterpret_cast<const Float3*>(positions + uint64(indices[t * 3 + 0]) * positionStride);
+            const Float3& p1 = *reinterpret_cast<const Float3*>(positions + uint64(indices[t * 3 + 1]) * positionStride);
+            const Float3& p2 = *reinterpret_cast<const Float3*>(positions + uint64(indices[t * 3 + 2]) * positionStride);
+            const Float3 triNormal = Float3::Cross(p1 - p0, p2 - p0);
+            const float triArea = Float3::Length(triNormal);
+            centroid += (p0 + p1 + p2) * (triArea / 3.0f);
+            normal += triNormal;
+            area += triArea;
+        }
+
+        meshCentroid += centroid;
+        meshArea += area;
+        clusterCentroids[c] = area > 0.0f ? centroid / area : Float3(0.0f);
+        clusterNormals[c] = normal;
+    }
+
+    if(meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    // Clusters that face away from the center are more likely to occlude the rest of the part,
+    // so they get drawn first
+    std::vector<float> sortKeys(numClusters, 0.0f);
+    for(uint32 c = 0; c < numClusters; ++c)
+    {
+        const float normalLength = Float3::Length(clusterNormals[c]);
+        if(normalLength > 0.0f)
+            sortKeys[c] = Float3::Dot(clusterCentroids[c] - meshCentroid, clusterNormals[c] / normalLength);
+    }
+
+    std::vector<uint32> clusterOrder(numClusters);
+    for(uint32 c = 0; c < numClusters; ++c)
+        clusterOrder[c] = c;
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(),
+                     [&](uint32 a, uint32 b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<uint32> output;
+    output.reserve(numTris * 3);
+    for(uint32 c : clusterOrder)
+        output.insert(output.end(), indices + clusterStarts[c] * 3, indices + clusterStarts[c + 1] * 3);
+
+    memcpy(indices, output.data(), numTris * 3 * sizeof(uint32));
+}
+
+void OptimizeVertexFetch(uint8* vertices, uint32 numVertices, uint32 stride, uint32* indices, uint32 numIndices)
+{
+    std::vector<uint32> remap(numVertices, InvalidIndex);
+    uint32 nextVertex = 0;
+    for(uint32 i = 0; i < numIndices; ++i)
+    {
+        Assert_(indices[i] < numVertices);
+        if(remap[indices[i]] == InvalidIndex)
+            remap[indices[i]] = nextVertex++;
+        indices[i] = remap[indices[i]];
+    }
+
+    for(uint32 v = 0; v < numVertices; ++v)
+        if(remap[v] == InvalidIndex)
+            remap[v] = nextVertex++;
+
+    std::vector<uint8> reordered(uint64(numVertices) * stride);
+    for(uint32 v = 0; v < numVertices; ++v)
+        memcpy(&reordered[uint64(remap[v]) * stride], vertices + uint64(v) * stride, stride);
+
+    memcpy(vertices, reordered.data(), reordered.size());
+}
+
+std::string OptimizeModelMeshes(ID3D11Device* device, Model& model)
+{
+    std::string report = "Vertex cache optimization (FIFO size " + ToAnsiString(VertexCacheSize) + ")\n";
+    report += MakeString("%-24s %5s %9s %10s %10s %10s %10s\n", "Mesh", "Part", "Tris", "ACMR Before",
+                         "ACMR After", "ATVR Before", "ATVR After");
+
+    uint64 totalTris = 0;
+    double totalMissesBefore = 0.0;
+    double totalMissesAfter = 0.0;
+    uint32 totalParts = 0;
+    uint32 numRevertedParts = 0;
+
+    for(uint64 meshIdx = 0; meshIdx < model.Meshes().size(); ++meshIdx)
+    {
+        Mesh& mesh = model.Meshes()[meshIdx];
+        const uint32 numVertices = mesh.NumVertices();
+        const uint32 numIndices = mesh.NumIndices();
+        const uint32 stride = mesh.VertexStride();
+        const uint32 indexSize = mesh.IndexSize();
+
+        std::vector<uint8> vertices(mesh.Vertices(), mesh.Vertices() + uint64(numVertices) * stride);
+        std::vector<uint32> indices(numIndices);
+        for(uint32 i = 0; i < numIndices; ++i)
+            indices[i] = GetIndex(mesh.Indices(), i, indexSize);
+
+        std::vector<Float3> positions;
+        DecodePositions(mesh, positions);
+        std::vector<MeshPart>& parts = mesh.MeshParts();
+        std::vector<VertexCacheStats> statsBefore(parts.size());
+        for(uint64 partIdx = 0; partIdx < parts.size(); ++partIdx)
+        {
+            uint32* partIndices = indices.data() + parts[partIdx].IndexStart;
+            const uint32 partNumIndices = parts[partIdx].IndexCount;
+            statsBefore[partIdx] = AnalyzeVertexCache(partIndices, partNumIndices, numVertices);
+            OptimizeVertexCache(partIndices, partNumIndices, numVertices);
+
+            // The clusters only bound the ACMR one at a time, so the overdraw order gets checked
+            // for the whole part and thrown away if it costs too much vertex cache efficiency
+            const VertexCacheStats cacheStats = AnalyzeVertexCache(partIndices, partNumIndices, numVertices);
+            std::vector<uint32> cacheOrder(partIndices, partIndices + partNumIndices);
+            OptimizeOverdraw(partIndices, partNumIndices, reinterpret_cast<const uint8*>(positions.data()),
+                             sizeof(Float3));
+
+            const VertexCacheStats overdrawStats = AnalyzeVertexCache(partIndices, partNumIndices, numVertices);
+            if(overdrawStats.ACMR > cacheStats.ACMR * OverdrawClusterThreshold)
+            {
+                std::copy(cacheOrder.begin(), cacheOrder.end(), partIndices);
+                ++numRevertedParts;
+            }
+            ++totalParts;
+        }
+
+        // The parts share the vertex buffer, so this happens once for the whole mesh
+        OptimizeVertexFetch(vertices.data(), numVertices, stride, indices.data(), numIndices);
+
+        for(uint64 partIdx = 0; partIdx < parts.size(); ++partIdx)
+        {
+            MeshPart& part = parts[partIdx];
+            const uint32* partIndices = indices.data() + part.IndexStart;
+            const VertexCacheStats statsAfter = AnalyzeVertexCache(partIndices, part.IndexCount, numVertices);
+
+            // The range of vertices used by each part has changed
+            uint32 minVertex = numVertices;
+            uint32 maxVertex = 0;
+            for(uint32 i = 0; i < part.IndexCount; ++i)
+            {
+                minVertex = std::min(minVertex, partIndices[i]);
+                maxVertex = std::max(maxVertex, partIndices[i]);
+            }
+            part.VertexStart = part.IndexCount > 0 ? minVertex : 0;
+            part.VertexCount = part.IndexCount > 0 ? maxVertex - minVertex + 1 : 0;
+
+            const uint32 numTris = part.IndexCount / 3;
+            totalTris += numTris;
+            totalMissesBefore += statsBefore[partIdx].ACMR * numTris;
+            totalMissesAfter += statsAfter.ACMR * numTris;
+
+            report += MakeString("%-24s %5u %9u %10.3f %10.3f %10.3f %10.3f\n", mesh.Name().c_str(),
+                                 uint32(partIdx), numTris, statsBefore[partIdx].ACMR, statsAfter.ACMR,
+                                 statsBefore[partIdx].ATVR, statsAfter.ATVR);
+        }
+
+        std::vector<uint8> indexData(uint64(numIndices) * indexSize);
+        for(uint32 i = 0; i < numIndices; ++i)
+        {
+            if(indexSize == 2)
+                reinterpret_cast<uint16*>(indexData.data())[i] = uint16(indices[i]);
+            else
+                reinterpret_cast<uint32*>(indexData.data())[i] = indices[i];
+        }
+
+        mesh.UpdateGeometry(device, vertices.data(), indexData.data());
+    }
+
+    if(totalTris > 0)
+        report += MakeString("Total: %llu triangles, ACMR %.3f -> %.3f\n", totalTris,
+                             totalMissesBefore / totalTris, totalMissesAfter / totalTris);
+
+    report += MakeString("%u of %u parts kept the vertex cache order, since sorting for overdraw made their "
+                         "ACMR more than %.0f%% worse\n", numRevertedParts, totalParts,
+                         (OverdrawClusterThreshold - 1.0f) * 100.0f);
+
+    return report;
+}
+
+// Computes the vertex range of the part that was last added to a chunk, and adds it if it has any
+// triangles
+static void FinishChunkPart(IndexChunk& chunk, MeshPart& part)
+{
+    if(part.IndexCount == 0)
+        return;
+
+    uint32 minVertex = 0xFFFF;
+    uint32 maxVertex = 0;
+    for(uint32 i = 0; i < part.IndexCount; ++i)
+    {
+        minVertex = std::min<uint32>(minVertex, chunk.Indices[part.IndexStart + i]);
+        maxVertex = std::max<uint32>(maxVertex, chunk.Indices[part.IndexStart + i]);
+    }
+    part.VertexStart = minVertex;
+    part.VertexCount = maxVertex - minVertex + 1;
+
+    chunk.Parts.push_back(part);
+}
+
+void SplitIndexChunks(const uint32* indices, const MeshPart* parts, uint32 numParts, uint32 numVertices,
+                      uint32 maxVertices, std::vector<IndexChunk>& chunks)
+{
+    Assert_(maxVertices >= 3 && maxVertices <= Max16BitIndexVertices);
+
+    // Where each source vertex is in the current chunk
+    std::vector<uint32> chunkVertices(numVertices, InvalidIndex);
+
+    chunks.clear();
+    chunks.push_back(IndexChunk());
+    IndexChunk* chunk = &chunks.back();
+
+    for(uint32 partIdx = 0; partIdx < numParts; ++partIdx)
+    {
+        const MeshPart& srcPart = parts[partIdx];
+        MeshPart part;
+        part.MaterialIdx = srcPart.MaterialIdx;
+        part.IndexStart = uint32(chunk->Indices.size());
+
+        const uint32* partIndices = indices + srcPart.IndexStart;
+        for(uint32 triStart = 0; triStart + 2 < srcPart.IndexCount; triStart += 3)
+        {
+            uint32 numNewVertices = 0;
+            for(uint32 i = 0; i < 3; ++i)
+                numNewVertices += chunkVertices[partIndices[triStart + i]] == InvalidIndex ? 1 : 0;
+
+            // Start a new chunk if the triangle doesn't fit, and carry on with the rest of the part
+            if(chunk->Vertices.size() + numNewVertices > maxVertices)
+            {
+                FinishChunkPart(*chunk, part);
+                for(uint64 i = 0; i < chunk->Vertices.size(); ++i)
+                    chunkVertices[chunk->Vertices[i]] = InvalidIndex;
+
+                chunks.push_back(IndexChunk());
+                chunk = &chunks.back();
+                part.IndexStart = 0;
+                part.IndexCount = 0;
+            }
+
+            for(uint32 i = 0; i < 3; ++i)
+            {
+                const uint32 vertex = partIndices[triStart + i];
+                if(chunkVertices[vertex] == InvalidIndex)
+                {
+                    chunkVertices[vertex] = uint32(chunk->Vertices.size());
+                    chunk->Vertices.push_back(vertex);
+                }
+                chunk->Indices.push_back(uint16(chunkVertices[vertex]));
+            }
+
+            part.IndexCount += 3;
+        }
+
+        FinishChunkPart(*chunk, part);
+    }
+
+    if(chunk->Indices.empty())
+        chunks.pop_back();
+}
+
+std::string SplitModelMeshes(ID3D11Device* device, Model& model)
+{
+    std::string report = "16-bit index splitting\n";
+    report += MakeString("%-24s %9s %6s %6s %7s %12s %12s\n", "Mesh", "Vertices", "Parts", "Chunks",
+                         "Parts", "IB Before", "IB After");
+
+    std::vector<Mesh>& meshes = model.Meshes();
+    std::vector<std::vector<IndexChunk>> meshChunks(meshes.size());
+    uint64 numNewMeshes = 0;
+    for(uint64 meshIdx = 0; meshIdx < meshes.size(); ++meshIdx)
+    {
+        const Mesh& mesh = meshes[meshIdx];
+        if(mesh.IndexBufferType() == Mesh::Index32Bit && mesh.NumIndices() > 0)
+        {
+            std::vector<uint32> indices(mesh.NumIndices());
+            for(uint32 i = 0; i < mesh.NumIndices(); ++i)
+                indices[i] = GetIndex(mesh.Indices(), i, mesh.IndexSize());
+
+            SplitIndexChunks(indices.data(), mesh.MeshParts().data(), uint32(mesh.MeshParts().size()),
+                             mesh.NumVertices(), Max16BitIndexVertices, meshChunks[meshIdx]);
+        }
+
+        numNewMeshes += meshChunks[meshIdx].empty() ? 1 : meshChunks[meshIdx].size();
+    }
+
+    // The new meshes get built in place, since they can't be moved once they're initialized
+    std::vector<Mesh> newMeshes(numNewMeshes);
+    uint64 newMeshIdx = 0;
+    uint64 totalBytesBefore = 0;
+    uint64 totalBytesAfter = 0;
+    for(uint64 meshIdx = 0; meshIdx < meshes.size(); ++meshIdx)
+    {
+        const Mesh& mesh = meshes[meshIdx];
+        const std::vector<IndexChunk>& chunks = meshChunks[meshIdx];
+        const uint64 bytesBefore = uint64(mesh.NumIndices()) * mesh.IndexSize();
+        totalBytesBefore += bytesBefore;
+
+        if(chunks.empty())
+        {
+            newMeshes[newMeshIdx++].InitFromMesh(device, mesh, mesh.Vertices(), mesh.NumVertices(), mesh.Indices(),
+                                                 mesh.NumIndices(), mesh.IndexBufferType(), mesh.MeshParts().data(),
+                                                 uint32(mesh.MeshParts().size()), mesh.Name());
+            totalBytesAfter += bytesBefore;
+            continue;
+        }
+
+        const uint32 stride = mesh.VertexStride();
+        uint64 bytesAfter = 0;
+        uint64 numParts = 0;
+        std::vector<uint8> vertices;
+        for(uint64 chunkIdx = 0; chunkIdx < chunks.size(); ++chunkIdx)
+        {
+            const IndexChunk& chunk = chunks[chunkIdx];
+            vertices.resize(chunk.Vertices.size() * stride);
+            for(uint64 i = 0; i < chunk.Vertices.size(); ++i)
+                memcpy(&vertices[i * stride], mesh.Vertices() + uint64(chunk.Vertices[i]) * stride, stride);
+
+            std::string name = mesh.Name();
+            if(chunks.size() > 1)
+                name += "_" + ToAnsiString(chunkIdx);
+
+            newMeshes[newMeshIdx++].InitFromMesh(device, mesh, vertices.data(), uint32(chunk.Vertices.size()),
+                                                 reinterpret_cast<const uint8*>(chunk.Indices.data()),
+                                                 uint32(chunk.Indices.size()), Mesh::Index16Bit,
+                                                 chunk.Parts.data(), uint32(chunk.Parts.size()), name);
+            bytesAfter += chunk.Indices.size() * sizeof(uint16);
+            numParts += chunk.Parts.size();
+        }
+
+        totalBytesAfter += bytesAfter;
+        report += MakeString("%-24s %9u %6u %6u %7u %12llu %12llu\n", mesh.Name().c_str(), mesh.NumVertices(),
+                             uint32(mesh.MeshParts().size()), uint32(chunks.size()), uint32(numParts),
+                             bytesBefore, bytesAfter);
+    }
+
+    Assert_(newMeshIdx == numNewMeshes);
+    meshes.swap(newMeshes);
+
+    report += MakeString("Total index data: %.2f KB -> %.2f KB\n", totalBytesBefore / 1024.0,
+                         totalBytesAfter / 1024.0);
+    return report;
+}
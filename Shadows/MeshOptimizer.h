@@ -0,0 +1,83 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+#include "SampleFramework11/Math.h"
+#include "SampleFramework11/Model.h"
+
+using namespace SampleFramework11;
+
+// Import-time reordering of the index and vertex data, so that the post-transform vertex cache
+// gets reused as much as possible (which is what limits the shadow passes for the dense meshes),
+// overdraw gets reduced in the main pass, and vertex fetches are close together in memory.
+
+// Size of the FIFO cache that's used for optimizing and for the reports. Real hardware doesn't
+// have a simple FIFO, but this is close enough to compare orderings.
+static const uint32 VertexCacheSize = 32;
+
+// Clusters are only split when their ACMR is within this factor of the ACMR of the whole part.
+// OptimizeModelMeshes also checks the whole part afterwards, and keeps the vertex cache order if
+// the overdraw order ends up worse than this factor.
+static const float OverdrawClusterThreshold = 1.05f;
+
+struct VertexCacheStats
+{
+    float ACMR;     // Average cache misses per triangle, between 0.5 and 3
+    float ATVR;     // Average transforms per referenced vertex, where 1 is ideal
+
+    VertexCacheStats() : ACMR(0.0f), ATVR(0.0f) {}
+};
+
+// Simulates a FIFO cache for a triangle list
+VertexCacheStats AnalyzeVertexCache(const uint32* indices, uint32 numIndices, uint32 numVertices,
+                                    uint32 cacheSize = VertexCacheSize);
+
+// Reorders the triangles with Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+void OptimizeVertexCache(uint32* indices, uint32 numIndices, uint32 numVertices);
+
+// Splits a cache-optimized triangle list into clusters and sorts them so that the ones facing
+// outward from the center of the part get drawn first, as in "Fast Triangle Reordering for
+// Vertex Locality and Reduced Overdraw" by Sander et al. positions needs a stride of
+// positionStride bytes.
+void OptimizeOverdraw(uint32* indices, uint32 numIndices, const uint8* positions, uint32 positionStride,
+                      float threshold = OverdrawClusterThreshold);
+
+// Sorts the vertices by the order in which they're first referenced, and remaps the indices.
+// Vertices that aren't referenced end up at the end of the buffer.
+void OptimizeVertexFetch(uint8* vertices, uint32 numVertices, uint32 stride, uint32* indices, uint32 numIndices);
+
+// Runs all three passes on every part of every mesh, re-creates the buffers, and returns a report
+// with the ACMR and ATVR of every part before and after
+std::string OptimizeModelMeshes(ID3D11Device* device, Model& model);
+
+// Largest number of vertices that can be addressed with 16-bit indices
+static const uint32 Max16BitIndexVertices = 65536;
+
+// A piece of a mesh whose vertices can be addressed with 16-bit indices
+struct IndexChunk
+{
+    std::vector<uint32> Vertices;       // Index of each of the chunk's vertices in the source mesh
+    std::vector<uint16> Indices;
+    std::vector<MeshPart> Parts;
+};
+
+// Packs the parts of a triangle list into chunks that have at most maxVertices vertices each,
+// keeping the order of the parts and triangles. A part that doesn't fit into what's left of a
+// chunk gets split between two triangles, so the chunks can end up with more parts in total.
+// The vertices of a chunk are in the order that they're first referenced.
+void SplitIndexChunks(const uint32* indices, const MeshPart* parts, uint32 numParts, uint32 numVertices,
+                      uint32 maxVertices, std::vector<IndexChunk>& chunks);
+
+// Replaces every mesh with 32-bit indices by one or more meshes with 16-bit indices, and returns a
+// report with the index buffer sizes before and after. This needs to happen before the other
+// import steps, since it changes the vertex order and the number of parts.
+std::string SplitModelMeshes(ID3D11Device* device, Model& model);
@@ -13,6 +13,12 @@
 #include "MeshRenderer.h"
 #include "AppSettings.h"
 #include "SharedConstants.h"
+#include "MomentQuantization.h"
+#include "PositionQuantization.h"
+#include "MeshOptimizer.h"
+#include "SampleSets.h"
+#include "PCFKernels.h"
+#include "ShadowMask.h"
 
 #include "SampleFramework11/Exceptions.h"
 #include "SampleFramework11/Utility.h"
@@ -20,119 +26,12 @@
 #include "SampleFramework11/App.h"
 #include "SampleFramework11/Profiler.h"
 #include "SampleFramework11/Settings.h"
+#include "SampleFramework11/TextureCache.h"
 
 // Constants
 static const float ShadowNearClip = 1.0f;
 static const bool UseComputeReduction = true;
 
-// Finds the approximate smallest enclosing bounding sphere for a set of points. Based on
-// "An Efficient Bounding Sphere", by Jack Ritter.
-static Sphere ComputeBoundingSphereFromPoints(const XMFLOAT3* points, uint32 numPoints, uint32 stride)
-{
-    Sphere sphere;
-
-    Assert_(numPoints > 0);
-    Assert_(points);
-
-    // Find the points with minimum and maximum x, y, and z
-    XMVECTOR MinX, MaxX, MinY, MaxY, MinZ, MaxZ;
-
-    MinX = MaxX = MinY = MaxY = MinZ = MaxZ = XMLoadFloat3(points);
-
-    for(uint32 i = 1; i < numPoints; i++)
-    {
-        XMVECTOR Point = XMLoadFloat3((XMFLOAT3*)((BYTE*)points + i * stride));
-
-        float px = XMVectorGetX(Point);
-        float py = XMVectorGetY(Point);
-        float pz = XMVectorGetZ(Point);
-
-        if(px < XMVectorGetX(MinX))
-            MinX = Point;
-
-        if(px > XMVectorGetX(MaxX))
-            MaxX = Point;
-
-        if(py < XMVectorGetY(MinY))
-            MinY = Point;
-
-        if(py > XMVectorGetY(MaxY))
-            MaxY = Point;
-
-        if(pz < XMVectorGetZ(MinZ))
-            MinZ = Point;
-
-        if(pz > XMVectorGetZ(MaxZ))
-            MaxZ = Point;
-    }
-
-    // Use the min/max pair that are farthest apart to form the initial sphere.
-    XMVECTOR DeltaX = MaxX - MinX;
-    XMVECTOR DistX = XMVector3Length(DeltaX);
-
-    XMVECTOR DeltaY = MaxY - MinY;
-    XMVECTOR DistY = XMVector3Length(DeltaY);
-
-    XMVECTOR DeltaZ = MaxZ - MinZ;
-    XMVECTOR DistZ = XMVector3Length(DeltaZ);
-
-    XMVECTOR Center;
-    XMVECTOR Radius;
-
-    if(XMVector3Greater(DistX, DistY))
-    {
-        if(XMVector3Greater(DistX, DistZ))
-        {
-            // Use min/max x.
-            Center = (MaxX + MinX) * 0.5f;
-            Radius = DistX * 0.5f;
-        }
-        else
-        {
-            // Use min/max z.
-            Center = (MaxZ + MinZ) * 0.5f;
-            Radius = DistZ * 0.5f;
-        }
-    }
-    else // Y >= X
-    {
-        if(XMVector3Greater(DistY, DistZ))
-        {
-            // Use min/max y.
-            Center = (MaxY + MinY) * 0.5f;
-            Radius = DistY * 0.5f;
-        }
-        else
-        {
-            // Use min/max z.
-            Center = (MaxZ + MinZ) * 0.5f;
-            Radius = DistZ * 0.5f;
-        }
-    }
-
-    // Add any points not inside the sphere.
-    for(uint32 i = 0; i < numPoints; i++)
-    {
-        XMVECTOR Point = XMLoadFloat3((XMFLOAT3*)((BYTE*)points + i * stride));
-
-        XMVECTOR Delta = Point - Center;
-
-        XMVECTOR Dist = XMVector3Length(Delta);
-
-        if(XMVector3Greater(Dist, Radius))
-        {
-            // Adjust sphere to include the new point.
-            Radius = (Radius + Dist) * 0.5f;
-            Center += (XMVectorReplicate(1.0f) - Radius * XMVectorReciprocal(Dist)) * Delta;
-        }
-    }
-
-    XMStoreFloat3(&sphere.Center, Center);
-    XMStoreFloat(&sphere.Radius, Radius);
-
-    return sphere;
-}
-
 // Calculates the inverse a camera's view * projection matrices
 static Float4x4 CalculateInverseViewProj(const Camera& camera)
 {
@@ -191,67 +90,55 @@ static uint32 TestFrustumSphere(const Frustum& frustum, const Sphere& sphere, bo
     return result;
 }
 
-// Calculates the bounding sphere for each MeshPart
-static void ComputeBoundingSpheres(ID3D11Device* device, ID3D11DeviceContext* context,
-                                   const Float4x4& world, Model* model,
-                                   std::vector<Sphere>& boundingSpheres)
+// Sine of the angle between the view direction and the light direction below which the cascades
+// don't get warped, since the optimal n for LiSPSM goes to infinity as the angle goes to 0
+static const float MinLiSPSMSinGamma = 0.01f;
+
+// Makes a projection that warps a cascade with Light Space Perspective Shadow Maps (LiSPSM). The
+// light view needs to have its y axis pointed along the view direction, and the projection
+// center gets placed n units behind the near side of the slice, using the optimal n from the
+// paper for the depth range of the slice. The result is fitted to the warped slice corners,
+// with the x and y extents scaled by filterScale to leave room for the filter kernel.
+static Float4x4 MakeLiSPSMProjection(const Float4x4& lightView, const Float3* sliceCornersWS,
+                                     float sliceNear, float sliceFar, float sinGamma, float filterScale)
 {
-    boundingSpheres.clear();
-
-    for(uint32 meshIdx = 0; meshIdx < model->Meshes().size(); ++meshIdx)
+    Float3 mins = FLT_MAX;
+    Float3 maxes = -FLT_MAX;
+    for(uint32 i = 0; i < 8; ++i)
     {
-        Mesh& mesh = model->Meshes()[meshIdx];
-
-        // Create staging buffers for copying the vertex/index data to
-        ID3D11BufferPtr stagingVB;
-        ID3D11BufferPtr stagingIB;
-
-        D3D11_BUFFER_DESC bufferDesc;
-        bufferDesc.BindFlags = 0;
-        bufferDesc.ByteWidth = mesh.NumVertices() * mesh.VertexStride();
-        bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
-        bufferDesc.MiscFlags = 0;
-        bufferDesc.StructureByteStride = 0;
-        bufferDesc.Usage = D3D11_USAGE_STAGING;
-        DXCall(device->CreateBuffer(&bufferDesc, nullptr, &stagingVB));
-
-        uint32 indexSize = mesh.IndexBufferType() == Mesh::Index16Bit ? 2 : 4;
-        bufferDesc.ByteWidth = mesh.NumIndices() * indexSize;
-        DXCall(device->CreateBuffer(&bufferDesc, nullptr, &stagingIB));
-
-        context->CopyResource(stagingVB, mesh.VertexBuffer());
-        context->CopyResource(stagingIB, mesh.IndexBuffer());
-
-        D3D11_MAPPED_SUBRESOURCE mapped;
-        context->Map(stagingVB, 0, D3D11_MAP_READ, 0, &mapped);
-        const BYTE* verts = reinterpret_cast<const BYTE*>(mapped.pData);
-        uint32 stride = mesh.VertexStride();
-
-        context->Map(stagingIB, 0, D3D11_MAP_READ, 0, &mapped);
-        const BYTE* indices = reinterpret_cast<const BYTE*>(mapped.pData);
-        const uint32* indices32 = reinterpret_cast<const uint32*>(mapped.pData);
-        const WORD* indices16 = reinterpret_cast<const WORD*>(mapped.pData);
-
-        for(uint32 partIdx = 0; partIdx < mesh.MeshParts().size(); ++partIdx)
-        {
-            const MeshPart& part = mesh.MeshParts()[partIdx];
-
-            std::vector<Float3> points;
-            for(uint32 i = 0; i < part.IndexCount; ++i)
-            {
-                uint32 index = indexSize == 2 ? indices16[part.IndexStart + i] : indices32[part.IndexStart + i];
-                Float3 point = *reinterpret_cast<const Float3*>(verts + (index * stride));
-                point = Float3::Transform(point, world);
-                points.push_back(point);
-            }
-
-            Sphere sphere = ComputeBoundingSphereFromPoints(&points[0], static_cast<uint32>(points.size()), sizeof(XMFLOAT3));
-            boundingSpheres.push_back(sphere);
-        }
+        Float3 corner = Float3::Transform(sliceCornersWS[i], lightView);
+        mins = XMVectorMin(mins.ToSIMD(), corner.ToSIMD());
+        maxes = XMVectorMax(maxes.ToSIMD(), corner.ToSIMD());
+    }
 
-        context->Unmap(stagingVB, 0);
-        context->Unmap(stagingIB, 0);
+    const float n = (sliceNear + std::sqrt(sliceNear * sliceFar)) / sinGamma;
+    const float f = n + maxes.y - mins.y;
+
+    // A perspective projection along the y axis, which divides everything along a light ray
+    // by the same w so that the depth ordering along the ray is preserved
+    XMMATRIX warp = XMMatrixTranslation(-(mins.x + maxes.x) * 0.5f, n - mins.y, 0.0f);
+    warp = XMMatrixMultiply(warp, XMMatrixSet(1.0f, 0.0f,                         0.0f, 0.0f,
+                                              0.0f, (f + n) / (f - n),            0.0f, 1.0f,
+                                              0.0f, 0.0f,                         1.0f, 0.0f,
+                                              0.0f, -2.0f * f * n / (f - n),      0.0f, 0.0f));
+
+    // Fit the warped slice to the [-1, 1] x [-1, 1] x [0, 1] clip space box
+    const Float4x4 viewWarp = XMMatrixMultiply(lightView.ToSIMD(), warp);
+    Float3 warpedMins = FLT_MAX;
+    Float3 warpedMaxes = -FLT_MAX;
+    for(uint32 i = 0; i < 8; ++i)
+    {
+        Float3 corner = Float3::Transform(sliceCornersWS[i], viewWarp);
+        warpedMins = XMVectorMin(warpedMins.ToSIMD(), corner.ToSIMD());
+        warpedMaxes = XMVectorMax(warpedMaxes.ToSIMD(), corner.ToSIMD());
     }
+
+    const Float3 center = (warpedMins + warpedMaxes) * 0.5f;
+    const Float3 halfSize = (warpedMaxes - warpedMins) * (0.5f * filterScale);
+    XMMATRIX fit = XMMatrixOrthographicOffCenterLH(center.x - halfSize.x, center.x + halfSize.x,
+                                                   center.y - halfSize.y, center.y + halfSize.y,
+                                                   warpedMins.z, warpedMaxes.z);
+    return XMMatrixMultiply(warp, fit);
 }
 
 // Makes the "global" shadow matrix used as the reference point for the cascades
@@ -301,11 +188,19 @@ static Float4x4 MakeGlobalShadowMatrix(const Camera& camera)
     return shadowCamera.ViewProjectionMatrix() * texScaleBias;
 }
 
-MeshRenderer::MeshRenderer() : currFrame(0)
+MeshRenderer::MeshRenderer() : characterBoundingRadius(0.0f),
+                               shadowMaskHistoryValid(false), shadowMaskFrame(0),
+                               screenWidth(0), screenHeight(0), currFrame(0)
 {
+    InvalidateShadowCache();
 }
 
-static PixelShaderPtr CompileMeshPS(ID3D11Device* device)
+MeshRenderer::~MeshRenderer()
+{
+    TextureCache::GlobalCache.Release(defaultTexture);
+}
+
+static PixelShaderPtr CompileMeshPS(ID3D11Device* device, const char* entryPoint = "PS")
 {
     CompileOptions opts;
     opts.Add("VisualizeCascades_", AppSettings::VisualizeCascades);
@@ -315,16 +210,39 @@ static PixelShaderPtr CompileMeshPS(ID3D11Device* device)
     opts.Add("ShadowMode_", uint32(AppSettings::ShadowMode));
     opts.Add("RandomizeOffsets_", AppSettings::RandomizeDiscOffsets);
     opts.Add("SelectFromProjection_", AppSettings::CascadeSelectionMode == CascadeSelectionModes::Projection ? 1 : 0);
-    return CompilePSFromFile(device, L"Mesh.hlsl", "PS", "ps_5_0", opts);
+    opts.Add("UseCharacterShadow_", AppSettings::CharacterShadowMap);
+    opts.Add("UsePerspectiveWarp_", AppSettings::PerspectiveWarp);
+    opts.Add("UseShadowMask_", AppSettings::UseShadowMask());
+    opts.Add("ShadowMaskScale_", AppSettings::ShadowMaskScale());
+    opts.Add("UseShadowHistory_", AppSettings::UseTemporalShadows());
+    return CompilePSFromFile(device, L"Mesh.hlsl", entryPoint, "ps_5_0", opts);
 }
 
 // Loads all shaders
 void MeshRenderer::LoadShaders()
 {
     // Load the mesh shaders
-    meshDepthVS = CompileVSFromFile(device, L"DepthOnly.hlsl", "VS", "vs_5_0");
-    meshVS = CompileVSFromFile(device, L"Mesh.hlsl", "VS", "vs_5_0");
+    for(uint32 instancing = 0; instancing < 2; ++instancing)
+    {
+        CompileOptions opts;
+        opts.Add("Instanced_", instancing);
+        VertexShaderPtr& vs = instancing ? meshDepthInstancedVS : meshDepthVS;
+        vs = CompileVSFromFile(device, L"DepthOnly.hlsl", "VS", "vs_5_0", opts);
+    }
+
+    for(uint32 vtxFormat = 0; vtxFormat < uint32(VertexFormat::NumValues); ++vtxFormat)
+    {
+        for(uint32 instancing = 0; instancing < 2; ++instancing)
+        {
+            CompileOptions opts;
+            opts.Add("VertexFormat_", vtxFormat);
+            opts.Add("Instanced_", instancing);
+            VertexShaderPtr& vs = instancing ? meshInstancedVS[vtxFormat] : meshVS[vtxFormat];
+            vs = CompileVSFromFile(device, L"Mesh.hlsl", "VS", "vs_5_0", opts);
+        }
+    }
     meshPS = CompileMeshPS(device);
+    shadowMaskPS = CompileMeshPS(device, "ShadowMaskPS");
 
     fullScreenVS = CompileVSFromFile(device, L"VSMConvert.hlsl", "FullScreenVS");
     for(uint32 shadowMode = uint32(ShadowMode::VSM); shadowMode < uint32(ShadowMode::NumValues); ++shadowMode)
@@ -373,6 +291,8 @@ void MeshRenderer::LoadShaders()
     opts.Add("GPUSceneSubmission_", 1);
     vsmBlurGPUV = CompilePSFromFile(device, L"VSMConvert.hlsl", "BlurVSM", "ps_5_0", opts);
 
+    minMaxInitialPS = CompilePSFromFile(device, L"ShadowMinMax.hlsl", "MinMaxInitialPS");
+    minMaxPS = CompilePSFromFile(device, L"ShadowMinMax.hlsl", "MinMaxPS");
 
     depthReductionInitialPS = CompilePSFromFile(device, L"DepthReduction.hlsl", "DepthReductionInitialPS");
     depthReductionPS = CompilePSFromFile(device, L"DepthReduction.hlsl", "DepthReductionPS");
@@ -413,35 +333,7 @@ void MeshRenderer::CreateShadowMaps()
         uint32 msaaSamples = AppSettings::MSAASamples();
         shadowMap.Initialize(device, ShadowMapSize, ShadowMapSize, depthFormat, true, msaaSamples, 0, 1);
 
-        DXGI_FORMAT smFmt;
-        if(AppSettings::ShadowMode == ShadowMode::EVSM4)
-        {
-            if(AppSettings::SMFormat == SMFormat::SM16Bit)
-                smFmt = DXGI_FORMAT_R16G16B16A16_FLOAT;
-            else
-                smFmt = DXGI_FORMAT_R32G32B32A32_FLOAT;
-        }
-        else if(AppSettings::ShadowMode == ShadowMode::EVSM2)
-        {
-            if(AppSettings::SMFormat == SMFormat::SM16Bit)
-                smFmt = DXGI_FORMAT_R16G16_FLOAT;
-            else
-                smFmt = DXGI_FORMAT_R32G32_FLOAT;
-        }
-        else if(AppSettings::ShadowMode == ShadowMode::MSMHamburger || AppSettings::ShadowMode == ShadowMode::MSMHausdorff)
-        {
-            if(AppSettings::SMFormat == SMFormat::SM16Bit)
-                smFmt = DXGI_FORMAT_R16G16B16A16_UNORM;
-            else
-                smFmt = DXGI_FORMAT_R32G32B32A32_FLOAT;
-        }
-        else
-        {
-            if(AppSettings::SMFormat == SMFormat::SM16Bit)
-                smFmt = DXGI_FORMAT_R16G16_UNORM;
-            else
-                smFmt = DXGI_FORMAT_R32G32_FLOAT;
-        }
+        DXGI_FORMAT smFmt = MomentMapFormat(AppSettings::ShadowMode, AppSettings::SMFormat);
 
         uint32 numMips = AppSettings::EnableShadowMips ? 0 : 1;
         varianceShadowMap.Initialize(device, ShadowMapSize, ShadowMapSize, smFmt, numMips, 1, 0,
@@ -463,97 +355,328 @@ void MeshRenderer::CreateShadowMaps()
         srvDesc.Texture2DArray.FirstArraySlice = cascadeIdx;
         device->CreateShaderResourceView(shadowMap.Texture, &srvDesc, &cascadeSlices[cascadeIdx]);
     }
-}
-
-// Creates bounding spheres for a mesh, and creates resources used for GPU batching
-static void SetupMesh(ID3D11Device* device, ID3D11DeviceContext* context, Model* model,
-                      MeshData& meshData, const Float4x4& world, VertexShaderPtr meshVS,
-                      VertexShaderPtr meshDepthVS)
-{
-    meshData.Model = model;
-
-    ComputeBoundingSpheres(device, context, world, model, meshData.BoundingSpheres);
 
-    std::vector<Float3> positions;
-    std::vector<uint32> indices;
-    std::vector<DrawCall> drawCalls;
-    uint64 drawIdx = 0;
-    for(uint64 meshIdx = 0; meshIdx < model->Meshes().size(); ++meshIdx)
+    // PCSS needs a min/max depth pyramid for each cascade, starting at half resolution
+    minMaxLevelRTVs.clear();
+    minMaxLevelSRVs.clear();
+    if(AppSettings::ShadowMode == ShadowMode::PCSS)
     {
-        const Mesh& mesh = model->Meshes()[meshIdx];
-        const uint8* verts = mesh.Vertices();
+        const uint32 baseSize = ShadowMapSize / 2;
+        uint32 numLevels = 0;
+        for(uint32 levelSize = baseSize; levelSize >= 1; levelSize /= 2)
+            ++numLevels;
 
-        const uint32 vtxOffset = uint32(positions.size());
-        for(uint64 i = 0; i < mesh.NumVertices(); ++i)
+        shadowMinMaxMap.Initialize(device, baseSize, baseSize, DXGI_FORMAT_R32G32_FLOAT, numLevels, 1, 0,
+                                   false, false, NumCascades, false);
+
+        for(uint32 level = 0; level < numLevels; ++level)
         {
-            positions.push_back(*reinterpret_cast<const Float3*>(verts));
-            verts += mesh.VertexStride();
+            for(uint32 cascadeIdx = 0; cascadeIdx < NumCascades; ++cascadeIdx)
+            {
+                D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = { };
+                rtvDesc.Format = DXGI_FORMAT_R32G32_FLOAT;
+                rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2DARRAY;
+                rtvDesc.Texture2DArray.MipSlice = level;
+                rtvDesc.Texture2DArray.FirstArraySlice = cascadeIdx;
+                rtvDesc.Texture2DArray.ArraySize = 1;
+
+                ID3D11RenderTargetViewPtr rtv;
+                DXCall(device->CreateRenderTargetView(shadowMinMaxMap.Texture, &rtvDesc, &rtv));
+                minMaxLevelRTVs.push_back(rtv);
+
+                D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = { };
+                srvDesc.Format = DXGI_FORMAT_R32G32_FLOAT;
+                srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+                srvDesc.Texture2DArray.MostDetailedMip = level;
+                srvDesc.Texture2DArray.MipLevels = 1;
+                srvDesc.Texture2DArray.FirstArraySlice = cascadeIdx;
+                srvDesc.Texture2DArray.ArraySize = 1;
+
+                ID3D11ShaderResourceViewPtr srv;
+                DXCall(device->CreateShaderResourceView(shadowMinMaxMap.Texture, &srvDesc, &srv));
+                minMaxLevelSRVs.push_back(srv);
+            }
         }
+    }
+    else
+    {
+        shadowMinMaxMap = RenderTarget2D();
+    }
+
+    // The static shadow cache has a slice for every cascade, with the same format and MSAA mode
+    // as the shadow map. Partial moment conversion also needs a target for the unblurred moments.
+    rawVSMArraySRV = nullptr;
+    if(AppSettings::CacheStaticShadows)
+    {
+        const uint32 msaaSamples = AppSettings::UseFilterableShadows() ? AppSettings::MSAASamples() : 1;
+        staticShadowCache.Initialize(device, ShadowMapSize, ShadowMapSize, depthFormat, true, msaaSamples, 0,
+                                     NumCascades);
 
-        const uint32 idxOffset = uint32(indices.size());
-        for(uint32 i = 0; i < mesh.NumIndices(); ++i)
+        if(AppSettings::UseFilterableShadows())
         {
-            uint32 idx = GetIndex(mesh.Indices(), i, mesh.IndexSize());
-            idx += vtxOffset;
-            indices.push_back(idx);
+            DXGI_FORMAT smFmt = MomentMapFormat(AppSettings::ShadowMode, AppSettings::SMFormat);
+            rawVSM.Initialize(device, ShadowMapSize, ShadowMapSize, smFmt, 1, 1, 0, false, false, 1, false);
+
+            // The horizontal blur pass reads from an array
+            D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = { };
+            srvDesc.Format = smFmt;
+            srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+            srvDesc.Texture2DArray.MostDetailedMip = 0;
+            srvDesc.Texture2DArray.MipLevels = 1;
+            srvDesc.Texture2DArray.FirstArraySlice = 0;
+            srvDesc.Texture2DArray.ArraySize = 1;
+            DXCall(device->CreateShaderResourceView(rawVSM.Texture, &srvDesc, &rawVSMArraySRV));
         }
-
-        for(uint64 partIdx = 0; partIdx < mesh.MeshParts().size(); ++partIdx)
+        else
         {
-            const MeshPart& part = mesh.MeshParts()[partIdx];
-            DrawCall drawCall;
-            drawCall.StartIndex = part.IndexStart + idxOffset;
-            drawCall.NumIndices = part.IndexCount;
-            drawCall.SphereCenter = meshData.BoundingSpheres[drawIdx].Center;
-            drawCall.SphereRadius= meshData.BoundingSpheres[drawIdx].Radius;
-            drawCalls.push_back(drawCall);
-
-            ++drawIdx;
+            rawVSM = RenderTarget2D();
         }
     }
+    else
+    {
+        staticShadowCache = DepthStencilBuffer();
+        rawVSM = RenderTarget2D();
+    }
+
+    // The character's shadow map is always sampled with PCF, so it doesn't need MSAA or moments
+    if(AppSettings::CharacterShadowMap)
+    {
+        const uint32 characterSize = AppSettings::ShadowMapResolution(AppSettings::CharacterShadowMapSize);
+        characterShadowMap.Initialize(device, characterSize, characterSize, depthFormat, true, 1, 0, 1);
+    }
+    else
+    {
+        characterShadowMap = DepthStencilBuffer();
+    }
+
+    InvalidateShadowCache();
+}
+
+// Forces the static shadow cache to get re-rendered, and the moment maps to get fully converted
+void MeshRenderer::InvalidateShadowCache()
+{
+    for(uint32 cascadeIdx = 0; cascadeIdx < NumCascades; ++cascadeIdx)
+    {
+        cascadeCacheValid[cascadeIdx] = false;
+        prevCharacterRects[cascadeIdx] = D3D11_RECT();
+    }
+}
+
+// Adds the elements for the transform of each instance, which come from the second vertex buffer
+static void AddInstanceElements(std::vector<D3D11_INPUT_ELEMENT_DESC>& elements)
+{
+    for(uint32 i = 0; i < ArraySize_(((InstanceTransform*)nullptr)->Columns); ++i)
+    {
+        D3D11_INPUT_ELEMENT_DESC element = { };
+        element.SemanticName = "INSTANCEWORLD";
+        element.SemanticIndex = i;
+        element.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+        element.InputSlot = 1;
+        element.AlignedByteOffset = i * sizeof(Float4);
+        element.InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+        element.InstanceDataStepRate = 1;
+        elements.push_back(element);
+    }
+}
+
+// Creates world space bounding spheres for a mesh, and creates resources used for GPU batching
+// and depth rendering. If the streams didn't come from a mesh cache, they get built from the
+// model's CPU data.
+static void SetupMesh(ID3D11Device* device, Model* model, const MeshStreamsView* streamsView,
+                      MeshData& meshData, const Float4x4& world, const VertexShaderPtr* meshVS,
+                      const char* name)
+{
+    meshData.Model = model;
+
+    MeshStreams builtStreams;
+    MeshStreamsView streams;
+    if(streamsView != nullptr)
+    {
+        streams = *streamsView;
+    }
+    else
+    {
+        BuildMeshStreams(*model, builtStreams);
+        streams = MeshStreamsView(builtStreams);
+    }
+
+    // The cached spheres are in object space, so they need to be transformed and scaled by the
+    // largest axis of the world matrix
+    const float worldScale = std::max(Float3::Length(world.Right()),
+                                      std::max(Float3::Length(world.Up()), Float3::Length(world.Forward())));
+
+    std::vector<DrawCall> drawCalls(streams.DrawCalls, streams.DrawCalls + streams.NumDrawCalls);
+    meshData.BoundingSpheres.resize(drawCalls.size());
+    for(uint64 drawIdx = 0; drawIdx < drawCalls.size(); ++drawIdx)
+    {
+        DrawCall& drawCall = drawCalls[drawIdx];
+        drawCall.SphereCenter = Float3::Transform(drawCall.SphereCenter, world);
+        drawCall.SphereRadius *= worldScale;
+
+        meshData.BoundingSpheres[drawIdx].Center = drawCall.SphereCenter;
+        meshData.BoundingSpheres[drawIdx].Radius = drawCall.SphereRadius;
+    }
+
+    // The GPU batches only use the full-detail indices, which come before the simplified ones
+    uint32 numBaseIndices = 0;
+    for(uint64 drawIdx = 0; drawIdx < drawCalls.size(); ++drawIdx)
+        numBaseIndices += drawCalls[drawIdx].NumIndices;
 
-    meshData.Indices.Initialize(device, sizeof(uint32), uint32(indices.size()), false, false, false, indices.data());
-    meshData.CulledIndices.Initialize(device, DXGI_FORMAT_R32_UINT, 4, uint32(indices.size()), false, false, true);
+    // The merged indices are offset into the merged positions, so the batched and depth index
+    // buffers can only use 16-bit indices when all of the meshes fit in that range together
+    const bool indices16Bit = streams.NumPositions <= Max16BitIndexVertices;
+    meshData.DepthIndexFormat = indices16Bit ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    const uint32 depthIndexSize = indices16Bit ? sizeof(uint16) : sizeof(uint32);
+
+    meshData.Indices.Initialize(device, sizeof(uint32), streams.NumIndices, false, false, false, streams.Indices);
+    meshData.CulledIndices.Initialize(device, meshData.DepthIndexFormat, depthIndexSize, numBaseIndices, false, false, true);
     meshData.DrawCalls.Initialize(device, sizeof(DrawCall), uint32(drawCalls.size()), false, false, false, drawCalls.data());
     meshData.CulledDraws.Initialize(device, sizeof(CulledDraw), uint32(drawCalls.size()), true, true, false, nullptr);
 
     D3D11_BUFFER_DESC vbDesc;
     vbDesc.Usage = D3D11_USAGE_IMMUTABLE;
     vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-    vbDesc.ByteWidth = uint32(positions.size() * sizeof(Float3));
+    vbDesc.ByteWidth = streams.NumPositions * sizeof(Float3);
     vbDesc.CPUAccessFlags = 0;
     vbDesc.MiscFlags = 0;
     vbDesc.StructureByteStride = 0;
-    D3D11_SUBRESOURCE_DATA vbInitData = { positions.data(), 0, 0 };
+    D3D11_SUBRESOURCE_DATA vbInitData = { streams.Positions, 0, 0 };
     DXCall(device->CreateBuffer(&vbDesc, &vbInitData, &meshData.PositionsVB));
 
+    std::vector<uint16> quantizedPositions(uint64(streams.NumPositions) * 4);
+    const PositionQuantization quantization = QuantizePositions(streams.Positions, streams.NumPositions,
+                                                                quantizedPositions.data());
+    meshData.Dequantization = DequantizationMatrix(quantization);
+
+    vbDesc.ByteWidth = streams.NumPositions * QuantizedPositionStride;
+    vbInitData.pSysMem = quantizedPositions.data();
+    DXCall(device->CreateBuffer(&vbDesc, &vbInitData, &meshData.QuantizedPositionsVB));
+
+    std::vector<uint16> depthIndices16;
+    if(indices16Bit)
+        depthIndices16.assign(streams.Indices, streams.Indices + streams.NumIndices);
+
+    D3D11_BUFFER_DESC ibDesc = vbDesc;
+    ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+    ibDesc.ByteWidth = streams.NumIndices * depthIndexSize;
+    D3D11_SUBRESOURCE_DATA ibInitData = { indices16Bit ? static_cast<const void*>(depthIndices16.data()) : streams.Indices, 0, 0 };
+    DXCall(device->CreateBuffer(&ibDesc, &ibInitData, &meshData.DepthIB));
+
+    meshData.PartLODs.assign(streams.PartLODs, streams.PartLODs + uint64(streams.NumDrawCalls) * NumPartLODs);
+    meshData.WorldScale = worldScale;
+
     meshData.InputLayouts.clear();
-    meshData.DepthInputLayouts.clear();
 
+    uint64 vertexBytes = 0;
     for(uint32 i = 0; i < model->Meshes().size(); ++i)
     {
         Mesh& mesh = model->Meshes()[i];
+        const VertexShaderPtr& vs = meshVS[uint64(GetVertexFormat(mesh))];
         ID3D11InputLayoutPtr inputLayout;
         DXCall(device->CreateInputLayout(mesh.InputElements(), mesh.NumInputElements(),
-                                         meshVS->ByteCode->GetBufferPointer(),
-                                         meshVS->ByteCode->GetBufferSize(), &inputLayout));
+                                         vs->ByteCode->GetBufferPointer(),
+                                         vs->ByteCode->GetBufferSize(), &inputLayout));
         meshData.InputLayouts.push_back(inputLayout);
 
-        DXCall(device->CreateInputLayout(mesh.InputElements(), mesh.NumInputElements(),
-                                         meshDepthVS->ByteCode->GetBufferPointer(),
-                                         meshDepthVS->ByteCode->GetBufferSize(), &inputLayout));
-        meshData.DepthInputLayouts.push_back(inputLayout);
+        vertexBytes += uint64(mesh.NumVertices()) * mesh.VertexStride();
     }
+
+    const uint32 fullVertexBytes = streams.NumPositions > 0 ? uint32(vertexBytes / streams.NumPositions) : 0;
+    std::string report = PositionQuantizationReport(name, quantization, streams.NumPositions,
+                                                    fullVertexBytes, worldScale);
+    report += PartLODReport(name, streams.PartLODs, streams.NumDrawCalls, worldScale);
+    PrintReport(report);
 }
 
-void MeshRenderer::SetSceneMesh(ID3D11DeviceContext* context, Model* model, const Float4x4& world)
+void MeshRenderer::SetSceneMesh(ID3D11DeviceContext* context, Model* model, const Float4x4& world,
+                                const MeshStreamsView* streams)
 {
-    SetupMesh(device, context, model, scene, world, meshVS, meshDepthVS);
+    SetupMesh(device, model, streams, scene, world, meshVS, "scene");
+    InvalidateShadowCache();
 }
 
-void MeshRenderer::SetCharacterMesh(ID3D11DeviceContext* context, Model* model, const Float4x4& world)
+void MeshRenderer::SetCharacterMesh(ID3D11DeviceContext* context, Model* model, const Float4x4& world,
+                                    const MeshStreamsView* streams)
 {
-    SetupMesh(device, context, model, character, world, meshVS, meshDepthVS);
+    SetupMesh(device, model, streams, character, world, meshVS, "character");
+
+    // Radius of a sphere around the character's origin that contains all of its parts, which
+    // stays conservative as the character moves and rotates
+    const Float3 origin = world.Translation();
+    characterBoundingRadius = 0.0f;
+    for(uint64 i = 0; i < character.BoundingSpheres.size(); ++i)
+    {
+        const Sphere& sphere = character.BoundingSpheres[i];
+        const float dist = Float3::Length(Float3(sphere.Center) - origin) + sphere.Radius;
+        characterBoundingRadius = std::max(characterBoundingRadius, dist);
+    }
+
+    // Keep the spheres in object space so that the character's shadow projection can be fitted
+    // to them wherever it ends up
+    const Float4x4 invWorld = Float4x4::Invert(world);
+    const float invScale = 1.0f / Float3::Length(world.Right());
+    characterLocalSpheres.resize(character.BoundingSpheres.size());
+    for(uint64 i = 0; i < character.BoundingSpheres.size(); ++i)
+    {
+        const Sphere& sphere = character.BoundingSpheres[i];
+        characterLocalSpheres[i].Center = Float3::Transform(Float3(sphere.Center), invWorld);
+        characterLocalSpheres[i].Radius = sphere.Radius * invScale;
+    }
+}
+
+void MeshRenderer::SetInstancedMesh(ID3D11DeviceContext* context, Model* model, const Float4x4* worlds,
+                                    uint32 numInstances, const MeshStreamsView* streams)
+{
+    InvalidateShadowCache();
+
+    instanced.InstanceWorlds.clear();
+    if(model == nullptr || numInstances == 0)
+    {
+        instanced.Model = nullptr;
+        return;
+    }
+
+    // The bounding spheres stay in object space, and get transformed by each of the instances
+    SetupMesh(device, model, streams, instanced, Float4x4(), meshVS, "instanced");
+
+    instanced.InstanceWorlds.assign(worlds, worlds + numInstances);
+    const uint32 numParts = uint32(instanced.BoundingSpheres.size());
+    BuildInstanceSpheres(instanced.BoundingSpheres.data(), numParts, worlds, numInstances, instanced.Instances);
+
+    // The levels of detail get picked once per part for all of its instances, so they use the
+    // largest scale to stay conservative for every instance
+    for(uint64 i = 0; i < instanced.BoundingSpheres.size(); ++i)
+        instanced.BoundingSpheres[i].Radius *= instanced.Instances.MaxScale;
+    instanced.WorldScale = instanced.Instances.MaxScale;
+
+    instanced.InstancedInputLayouts.clear();
+    for(uint64 i = 0; i < model->Meshes().size(); ++i)
+    {
+        const Mesh& mesh = model->Meshes()[i];
+        std::vector<D3D11_INPUT_ELEMENT_DESC> elements(mesh.InputElements(),
+                                                       mesh.InputElements() + mesh.NumInputElements());
+        AddInstanceElements(elements);
+
+        const VertexShaderPtr& vs = meshInstancedVS[uint64(GetVertexFormat(mesh))];
+        ID3D11InputLayoutPtr inputLayout;
+        DXCall(device->CreateInputLayout(elements.data(), uint32(elements.size()), vs->ByteCode->GetBufferPointer(),
+                                         vs->ByteCode->GetBufferSize(), &inputLayout));
+        instanced.InstancedInputLayouts.push_back(inputLayout);
+    }
+
+    // Big enough for every instance of every part to be visible at once
+    const uint64 instanceBytes = uint64(numParts) * numInstances * sizeof(InstanceTransform);
+    Assert_(instanceBytes <= D3D11_REQ_RESOURCE_SIZE_IN_MEGABYTES_EXPRESSION_A_TERM * 1024 * 1024);
+
+    D3D11_BUFFER_DESC vbDesc;
+    vbDesc.Usage = D3D11_USAGE_DYNAMIC;
+    vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    vbDesc.ByteWidth = uint32(std::max<uint64>(instanceBytes, sizeof(InstanceTransform)));
+    vbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    vbDesc.MiscFlags = 0;
+    vbDesc.StructureByteStride = 0;
+    instanced.InstanceVB = nullptr;
+    DXCall(device->CreateBuffer(&vbDesc, nullptr, &instanced.InstanceVB));
 }
 
 // Loads resources
@@ -569,6 +692,7 @@ void MeshRenderer::Initialize(ID3D11Device* device, ID3D11DeviceContext* context
     depthOnlyConstants.Initialize(device, true);
     meshVSConstants.Initialize(device);
     meshPSConstants.Initialize(device, true);
+    shadowMaskConstants.Initialize(device);
     vsmConstants.Initialize(device, true);
     reductionConstants.Initialize(device);
     gpuBatchConstants.Initialize(device, true);
@@ -581,6 +705,8 @@ void MeshRenderer::Initialize(ID3D11Device* device, ID3D11DeviceContext* context
 
     defaultTexture = LoadTexture(device, L"..\\Content\\Textures\\Default.dds");
 
+    UpdateSampleSetsHeader(L"SampleSets.hlsl");
+    UpdatePCFKernelsHeader(L"PCFKernels.hlsl");
     LoadShaders();
 
     D3D11_RASTERIZER_DESC rsDesc = RasterizerStates::NoCullDesc();
@@ -594,13 +720,11 @@ void MeshRenderer::Initialize(ID3D11Device* device, ID3D11DeviceContext* context
         DXCall(device->CreateSamplerState(&sampDesc, &evsmSamplers[anisotropy]));
     }
 
-    // Initialize a 64x64 texture containing random rotation values
-    static const uint32 RandomTextureSize = 64;
+    // Initialize a tileable blue noise texture containing random rotation values, which
+    // gives less clumping in the noise pattern than white noise
+    static const uint32 RandomTextureSize = BlueNoiseTextureSize;
     BYTE randomValues[RandomTextureSize * RandomTextureSize];
-    srand(0);
-
-    for(uint32 i = 0; i < RandomTextureSize * RandomTextureSize; ++i)
-        randomValues[i] = static_cast<BYTE>(RandFloat() * 255.0f);
+    GenerateBlueNoiseTexture(RandomTextureSize, 0, randomValues);
 
     D3D11_TEXTURE2D_DESC texDesc = { };
     texDesc.Width = RandomTextureSize;
@@ -635,6 +759,8 @@ void MeshRenderer::Initialize(ID3D11Device* device, ID3D11DeviceContext* context
     uint32 dispatchArgsInit[4] = { 1, 1, 1, 0 };
     batchDispatchArgs.Initialize(device, DXGI_FORMAT_R32_TYPELESS, 4, 4, true, false, false, true, dispatchArgsInit);
 
+    // Input layouts for the position-only streams used by depth rendering. The UNORM positions
+    // get expanded to [0, 1] by the input assembler, so the same vertex shader works for both.
     D3D11_INPUT_ELEMENT_DESC inputElements[1] = { };
     inputElements[0].AlignedByteOffset = 0;
     inputElements[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;
@@ -644,7 +770,25 @@ void MeshRenderer::Initialize(ID3D11Device* device, ID3D11DeviceContext* context
     inputElements[0].SemanticName = "POSITION";
     inputElements[0].SemanticIndex = 0;
     DXCall(device->CreateInputLayout(inputElements, 1, meshDepthVS->ByteCode->GetBufferPointer(),
-                                     meshDepthVS->ByteCode->GetBufferSize(), &depthGPUInputLayout));
+                                     meshDepthVS->ByteCode->GetBufferSize(), &depthInputLayout));
+
+    inputElements[0].Format = DXGI_FORMAT_R16G16B16A16_UNORM;
+    DXCall(device->CreateInputLayout(inputElements, 1, meshDepthVS->ByteCode->GetBufferPointer(),
+                                     meshDepthVS->ByteCode->GetBufferSize(), &depthQuantizedInputLayout));
+
+    // The same again with the instance transforms in the second slot
+    std::vector<D3D11_INPUT_ELEMENT_DESC> instancedElements(inputElements, inputElements + 1);
+    AddInstanceElements(instancedElements);
+    instancedElements[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+    DXCall(device->CreateInputLayout(instancedElements.data(), uint32(instancedElements.size()),
+                                     meshDepthInstancedVS->ByteCode->GetBufferPointer(),
+                                     meshDepthInstancedVS->ByteCode->GetBufferSize(), &depthInstancedInputLayout));
+
+    instancedElements[0].Format = DXGI_FORMAT_R16G16B16A16_UNORM;
+    DXCall(device->CreateInputLayout(instancedElements.data(), uint32(instancedElements.size()),
+                                     meshDepthInstancedVS->ByteCode->GetBufferPointer(),
+                                     meshDepthInstancedVS->ByteCode->GetBufferSize(),
+                                     &depthQuantizedInstancedInputLayout));
 
     // Create resources for GPU cascade setup
     cascadeMatrixBuffer.Initialize(device, sizeof(Float4), NumCascades * 4, true);
@@ -694,6 +838,8 @@ void MeshRenderer::Initialize(ID3D11Device* device, ID3D11DeviceContext* context
 // Performs frustum/sphere intersection tests for all MeshPart's
 static void DoFrustumTests(const Camera& camera, bool ignoreNearZ, MeshData& mesh)
 {
+    CPUProfileBlock cpuBlock(L"CPU Culling");
+
     mesh.FrustumTests.clear();
     mesh.NumSuccessfulTests = 0;
 
@@ -709,18 +855,66 @@ static void DoFrustumTests(const Camera& camera, bool ignoreNearZ, MeshData& mes
     }
 }
 
+// Culls the instances of every part against the camera's frustum, and compacts the visible ones
+static void DoInstanceCulling(const Camera& camera, bool ignoreNearZ, MeshData& mesh)
+{
+    CPUProfileBlock cpuBlock(L"CPU Instance Culling");
+
+    Frustum frustum;
+    ComputeFrustum(camera, frustum);
+
+    Float4 planes[6];
+    for(uint32 i = 0; i < 6; ++i)
+        planes[i] = frustum.Planes[i];
+
+    CullInstances(planes, ignoreNearZ ? 5 : 6, mesh.Instances, mesh.VisibleInstances);
+}
+
+// Writes the transforms of the visible instances to the instance buffer, and binds it to the
+// second vertex buffer slot
+static void SetInstanceStream(ID3D11DeviceContext* context, const MeshData& meshData)
+{
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    DXCall(context->Map(meshData.InstanceVB, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
+    CompactInstanceTransforms(meshData.VisibleInstances, meshData.InstanceWorlds.data(),
+                              reinterpret_cast<InstanceTransform*>(mapped.pData));
+    context->Unmap(meshData.InstanceVB, 0);
+
+    ID3D11Buffer* vertexBuffers[1] = { meshData.InstanceVB };
+    uint32 vertexStrides[1] = { sizeof(InstanceTransform) };
+    uint32 offsets[1] = { 0 };
+    context->IASetVertexBuffers(1, 1, vertexBuffers, vertexStrides, offsets);
+}
+
 void MeshRenderer::Update()
 {
     if(AppSettings::ShadowMapSize.Changed() || AppSettings::ShadowMode.Changed()
         || AppSettings::ShadowMSAA.Changed() || AppSettings::SMFormat.Changed()
-        || AppSettings::EnableShadowMips.Changed() || AppSettings::DepthBufferFormat.Changed())
+        || AppSettings::EnableShadowMips.Changed() || AppSettings::DepthBufferFormat.Changed()
+        || AppSettings::CacheStaticShadows.Changed() || AppSettings::CharacterShadowMap.Changed()
+        || AppSettings::CharacterShadowMapSize.Changed())
         CreateShadowMaps();
 
+    // The cached moments outside of the character's footprint depend on these
+    if(AppSettings::FilterSize.Changed() || AppSettings::PositiveExponent.Changed()
+       || AppSettings::NegativeExponent.Changed() || AppSettings::GPUSceneSubmission.Changed()
+       || AppSettings::QuantizedDepthPositions.Changed() || AppSettings::ShadowCasterLODs.Changed()
+       || AppSettings::ShadowLODErrorTexels.Changed())
+        InvalidateShadowCache();
+
     if(AppSettings::VisualizeCascades.Changed() || AppSettings::UsePlaneDepthBias.Changed()
        || AppSettings::FilterAcrossCascades.Changed() || AppSettings::FixedFilterSize.Changed()
        || AppSettings::ShadowMode.Changed() || AppSettings::RandomizeDiscOffsets.Changed()
-       || AppSettings::CascadeSelectionMode.Changed())
+       || AppSettings::CascadeSelectionMode.Changed() || AppSettings::CharacterShadowMap.Changed()
+       || AppSettings::PerspectiveWarp.Changed() || AppSettings::ShadowMaskMode.Changed()
+       || AppSettings::TemporalShadowAccumulation.Changed())
+    {
         meshPS = CompileMeshPS(device);
+        shadowMaskPS = CompileMeshPS(device, "ShadowMaskPS");
+    }
+
+    if(AppSettings::ShadowMaskMode.Changed() || AppSettings::TemporalShadowAccumulation.Changed())
+        CreateShadowMask(screenWidth, screenHeight);
 
     if(AppSettings::AutoComputeDepthBounds && AppSettings::GPUSceneSubmission == false)
     {
@@ -772,12 +966,124 @@ void MeshRenderer::CreateReductionTargets(uint32 width, uint32 height)
     }
 }
 
+// Creates the shadow mask at either full or half of the screen resolution
+void MeshRenderer::CreateShadowMask(uint32 width, uint32 height)
+{
+    screenWidth = width;
+    screenHeight = height;
+
+    shadowMaskHistoryValid = false;
+    shadowMaskHistory = RenderTarget2D();
+
+    if(AppSettings::UseShadowMask() == false || width == 0 || height == 0)
+    {
+        shadowMask = RenderTarget2D();
+        return;
+    }
+
+    const uint32 scale = AppSettings::ShadowMaskScale();
+    const uint32 maskWidth = (width + scale - 1) / scale;
+    const uint32 maskHeight = (height + scale - 1) / scale;
+    shadowMask.Initialize(device, maskWidth, maskHeight, DXGI_FORMAT_R16G16B16A16_FLOAT);
+
+    if(AppSettings::UseTemporalShadows())
+        shadowMaskHistory.Initialize(device, maskWidth, maskHeight, DXGI_FORMAT_R16G16B16A16_FLOAT);
+}
+
+// Evaluates the shadows for every pixel of the shadow mask, using the depth buffer from the
+// depth prepass. Needs to happen after the shadow maps are rendered.
+void MeshRenderer::RenderShadowMask(ID3D11DeviceContext* context, ID3D11ShaderResourceView* depthTarget,
+                                    const Camera& camera)
+{
+    PIXEvent event(L"Shadow Mask");
+    ProfileBlock block(L"Shadow Mask");
+
+    Assert_(shadowMask.RTView != nullptr);
+
+    // Last frame's mask becomes the history
+    const bool useHistory = AppSettings::UseTemporalShadows();
+    if(useHistory)
+        std::swap(shadowMask, shadowMaskHistory);
+
+    const Float4x4& projection = camera.ProjectionMatrix();
+    shadowMaskConstants.Data.InvViewProjection = Float4x4::Transpose(Float4x4::Invert(camera.ViewProjectionMatrix()));
+    shadowMaskConstants.Data.PrevViewProjection = Float4x4::Transpose(prevViewProjection);
+    shadowMaskConstants.Data.ProjectionParams = Float2(projection._33, projection._43);
+    shadowMaskConstants.Data.HistoryBlend = shadowMaskHistoryValid ? 1.0f / AppSettings::TemporalHistoryFrames : 1.0f;
+    shadowMaskConstants.ApplyChanges(context);
+    shadowMaskConstants.SetPS(context, 1);
+
+    SetMeshPSConstants(context, camera);
+
+    float blendFactor[4] = {1, 1, 1, 1};
+    context->OMSetBlendState(blendStates.BlendDisabled(), blendFactor, 0xFFFFFFFF);
+    context->RSSetState(rasterizerStates.NoCull());
+    context->OMSetDepthStencilState(depthStencilStates.DepthDisabled(), 0);
+    ID3D11Buffer* vbs[1] = { nullptr };
+    uint32 strides[1] = { 0 };
+    uint32 offsets[1] = { 0 };
+    context->IASetVertexBuffers(0, 1, vbs, strides, offsets);
+    context->IASetIndexBuffer(nullptr, DXGI_FORMAT_R32_UINT, 0);
+    context->IASetInputLayout(nullptr);
+    context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+    ID3D11SamplerState* sampStates[5] = {
+        samplerStates.Anisotropic(),
+        samplerStates.ShadowMap(),
+        samplerStates.ShadowMapPCF(),
+        evsmSamplers[AppSettings::ShadowAnisotropy],
+        samplerStates.LinearClamp(),
+    };
+
+    context->PSSetSamplers(0, 5, sampStates);
+
+    context->VSSetShader(fullScreenVS, nullptr, 0);
+    context->PSSetShader(shadowMaskPS, nullptr, 0);
+
+    ID3D11RenderTargetView* rtvs[1] = { shadowMask.RTView };
+    context->OMSetRenderTargets(1, rtvs, nullptr);
+
+    D3D11_VIEWPORT vp;
+    vp.TopLeftX = 0.0f;
+    vp.TopLeftY = 0.0f;
+    vp.MinDepth = 0.0f;
+    vp.MaxDepth = 1.0f;
+    vp.Width = static_cast<float>(shadowMask.Width);
+    vp.Height = static_cast<float>(shadowMask.Height);
+    context->RSSetViewports(1, &vp);
+
+    ID3D11ShaderResourceView* srvs[7] =
+    {
+        nullptr,
+        AppSettings::UseFilterableShadows() ? varianceShadowMap.SRView : shadowMap.SRView,
+        randomRotations,
+        shadowMinMaxMap.SRView,
+        characterShadowMap.SRView,
+        depthTarget,
+        useHistory ? shadowMaskHistory.SRView : nullptr,
+    };
+    context->PSSetShaderResources(0, 7, srvs);
+
+    context->Draw(3, 0);
+
+    ID3D11ShaderResourceView* nullSRVs[7] = { nullptr };
+    context->PSSetShaderResources(0, 7, nullSRVs);
+
+    rtvs[0] = nullptr;
+    context->OMSetRenderTargets(1, rtvs, nullptr);
+
+    prevViewProjection = camera.ViewProjectionMatrix();
+    shadowMaskHistoryValid = useHistory;
+    ++shadowMaskFrame;
+}
+
 // Computes the min and max depth from the depth buffer using a parallel reduction
 void MeshRenderer::ReduceDepth(ID3D11DeviceContext* context, ID3D11ShaderResourceView* depthTarget,
                                const Camera& camera)
 {
     PIXEvent event(L"Depth Reduction");
     ProfileBlock block(L"Depth Reduction");
+    CPUProfileBlock cpuBlock(L"CPU Depth Reduction");
 
     reductionConstants.Data.Projection = Float4x4::Transpose(camera.ProjectionMatrix());
     reductionConstants.Data.NearClip = camera.NearClip();
@@ -926,15 +1232,20 @@ void MeshRenderer::ReduceDepth(ID3D11DeviceContext* context, ID3D11ShaderResourc
     }
 }
 
-// Convert to a VSM map
+// Convert to a VSM map. If a dirty rect is passed in, only the texels that can be affected by it
+// get updated and everything else is left as it was.
 void MeshRenderer::ConvertToVSM(ID3D11DeviceContext* context, uint32 cascadeIdx,
-                                Float3 cascadeScale, Float3 cascade0Scale)
+                                Float3 cascadeScale, Float3 cascade0Scale,
+                                const D3D11_RECT* dirtyRect)
 {
     PIXEvent event(L"VSM Conversion");
 
+    const bool partialUpdate = dirtyRect != nullptr;
+    Assert_(partialUpdate == false || AppSettings::GPUSceneSubmission == false);
+
     float blendFactor[4] = {1, 1, 1, 1};
     context->OMSetBlendState(blendStates.BlendDisabled(), blendFactor, 0xFFFFFFFF);
-    context->RSSetState(rasterizerStates.NoCull());
+    context->RSSetState(partialUpdate ? rasterizerStates.NoCullScissor() : rasterizerStates.NoCull());
     context->OMSetDepthStencilState(depthStencilStates.DepthDisabled(), 0);
     ID3D11Buffer* vbs[1] = { nullptr };
     uint32 strides[1] = { 0 };
@@ -968,12 +1279,55 @@ void MeshRenderer::ConvertToVSM(ID3D11DeviceContext* context, uint32 cascadeIdx,
                          sizeof(Float4) * 0, sizeof(vsmConstants.Data.CascadeScale));
     }
 
-    context->VSSetShader(fullScreenVS, nullptr, 0);
+    float maxFilterSizeU = MaxKernelSize / std::abs(cascade0Scale.x);
+    float maxFilterSizeV = MaxKernelSize / std::abs(cascade0Scale.y);
+    const float FilterSizeU = Clamp(std::min<float>(AppSettings::FilterSize, maxFilterSizeU) * std::abs(cascadeScale.x), 1.0f, MaxKernelSize);
+    const float FilterSizeV = Clamp(std::min<float>(AppSettings::FilterSize, maxFilterSizeV) * std::abs(cascadeScale.y), 1.0f, MaxKernelSize);
+    uint32 sampleRadiusU = static_cast<uint32>((FilterSizeU / 2) + 0.499f);
+    uint32 sampleRadiusV = static_cast<uint32>((FilterSizeV / 2) + 0.499f);
 
-    ID3D11PixelShader* ps = vsmConvertPS[AppSettings::ShadowMode - uint32(ShadowMode::VSM)][AppSettings::ShadowMSAA];
-    context->PSSetShader(ps, nullptr, 0);
+    // For GPU-driven submission, we always run the blur passes and use a dynamic loop
+    // in the shader. For CPU submission, we figure out the minimum sample radius and
+    // switch shader permutations. This could also be done with GPU submission,
+    // by using DrawIndirect or something similar.
+    const bool blur = (FilterSizeU > 1.0f || FilterSizeV > 1.0f) || AppSettings::GPUSceneSubmission;
+
+    // The blurred result changes up to one sample radius away from the dirty texels, so the
+    // horizontal pass needs to cover that much more vertically and the conversion needs to
+    // cover it in both directions. The conversion goes to a separate target in that case, since
+    // the texels around the final rect still need to hold the blurred result from last time.
+    D3D11_RECT convertRect = { };
+    D3D11_RECT blurHRect = { };
+    D3D11_RECT blurVRect = { };
+    if(partialUpdate)
+    {
+        const D3D11_RECT fullRect = { 0, 0, LONG(varianceShadowMap.Width), LONG(varianceShadowMap.Height) };
+        const LONG radiusU = LONG(sampleRadiusU);
+        const LONG radiusV = LONG(sampleRadiusV);
+
+        blurVRect = *dirtyRect;
+        InflateRect(&blurVRect, radiusU, radiusV);
+        IntersectRect(&blurVRect, &blurVRect, &fullRect);
+
+        blurHRect = *dirtyRect;
+        InflateRect(&blurHRect, radiusU, radiusV * 2);
+        IntersectRect(&blurHRect, &blurHRect, &fullRect);
+
+        convertRect = *dirtyRect;
+        InflateRect(&convertRect, radiusU * 2, radiusV * 2);
+        IntersectRect(&convertRect, &convertRect, &fullRect);
+
+        context->RSSetScissorRects(1, &convertRect);
+    }
+
+    context->VSSetShader(fullScreenVS, nullptr, 0);
+
+    ID3D11PixelShader* ps = vsmConvertPS[AppSettings::ShadowMode - uint32(ShadowMode::VSM)][AppSettings::ShadowMSAA];
+    context->PSSetShader(ps, nullptr, 0);
 
     ID3D11RenderTargetView* rtvs[1] = { varianceShadowMap.RTVArraySlices[cascadeIdx] };
+    if(partialUpdate && blur)
+        rtvs[0] = rawVSM.RTView;
     context->OMSetRenderTargets(1, rtvs, nullptr);
 
     ID3D11ShaderResourceView* srvs[1] = { shadowMap.SRView };
@@ -984,24 +1338,13 @@ void MeshRenderer::ConvertToVSM(ID3D11DeviceContext* context, uint32 cascadeIdx,
     srvs[0] = nullptr;
     context->PSSetShaderResources(0, 1, srvs);
 
-    float maxFilterSizeU = MaxKernelSize / std::abs(cascade0Scale.x);
-    float maxFilterSizeV = MaxKernelSize / std::abs(cascade0Scale.y);
-    const float FilterSizeU = Clamp(std::min<float>(AppSettings::FilterSize, maxFilterSizeU) * std::abs(cascadeScale.x), 1.0f, MaxKernelSize);
-    const float FilterSizeV = Clamp(std::min<float>(AppSettings::FilterSize, maxFilterSizeV) * std::abs(cascadeScale.y), 1.0f, MaxKernelSize);
-
-    // For GPU-driven submission, we always run the blur passes and use a dynamic loop
-    // in the shader. For CPU submission, we figure out the minimum sample radius and
-    // switch shader permutations. This could also be done with GPU submission,
-    // by using DrawIndirect or something similar.
-    if((FilterSizeU > 1.0f || FilterSizeV > 1.0f) || AppSettings::GPUSceneSubmission)
+    if(blur)
     {
         // Horizontal pass
-        uint32 sampleRadiusU = static_cast<uint32>((FilterSizeU / 2) + 0.499f);
-
         rtvs[0] = tempVSM.RTView;
         context->OMSetRenderTargets(1, rtvs, nullptr);
 
-        srvs[0] = varianceShadowMap.SRVArraySlices[cascadeIdx];
+        srvs[0] = partialUpdate ? rawVSMArraySRV : varianceShadowMap.SRVArraySlices[cascadeIdx];
         context->PSSetShaderResources(0, 1, srvs);
 
         if(AppSettings::GPUSceneSubmission)
@@ -1009,14 +1352,15 @@ void MeshRenderer::ConvertToVSM(ID3D11DeviceContext* context, uint32 cascadeIdx,
         else
             context->PSSetShader(vsmBlurH[sampleRadiusU], nullptr, 0);
 
+        if(partialUpdate)
+            context->RSSetScissorRects(1, &blurHRect);
+
         context->Draw(3, 0);
 
         srvs[0] = nullptr;
         context->PSSetShaderResources(0, 1, srvs);
 
         // Vertical pass
-        uint32 sampleRadiusV = static_cast<uint32>((FilterSizeV / 2) + 0.499f);
-
         rtvs[0] = varianceShadowMap.RTVArraySlices[cascadeIdx];
         context->OMSetRenderTargets(1, rtvs, nullptr);
 
@@ -1028,6 +1372,9 @@ void MeshRenderer::ConvertToVSM(ID3D11DeviceContext* context, uint32 cascadeIdx,
         else
             context->PSSetShader(vsmBlurV[sampleRadiusV], nullptr, 0);
 
+        if(partialUpdate)
+            context->RSSetScissorRects(1, &blurVRect);
+
         context->Draw(3, 0);
 
         srvs[0] = nullptr;
@@ -1038,6 +1385,54 @@ void MeshRenderer::ConvertToVSM(ID3D11DeviceContext* context, uint32 cascadeIdx,
         context->GenerateMips(varianceShadowMap.SRView);
 }
 
+// Builds the min/max depth pyramid for a cascade, which is used to accelerate the PCSS blocker search
+void MeshRenderer::BuildMinMaxPyramid(ID3D11DeviceContext* context, uint32 cascadeIdx)
+{
+    PIXEvent event(L"Min/Max Depth Pyramid");
+
+    float blendFactor[4] = {1, 1, 1, 1};
+    context->OMSetBlendState(blendStates.BlendDisabled(), blendFactor, 0xFFFFFFFF);
+    context->RSSetState(rasterizerStates.NoCull());
+    context->OMSetDepthStencilState(depthStencilStates.DepthDisabled(), 0);
+    ID3D11Buffer* vbs[1] = { nullptr };
+    uint32 strides[1] = { 0 };
+    uint32 offsets[1] = { 0 };
+    context->IASetVertexBuffers(0, 1, vbs, strides, offsets);
+    context->IASetIndexBuffer(nullptr, DXGI_FORMAT_R32_UINT, 0);
+    context->IASetInputLayout(nullptr);
+
+    context->VSSetShader(fullScreenVS, nullptr, 0);
+
+    for(uint32 level = 0; level < shadowMinMaxMap.NumMipLevels; ++level)
+    {
+        const uint32 levelSize = std::max(shadowMinMaxMap.Width >> level, 1u);
+
+        D3D11_VIEWPORT vp;
+        vp.TopLeftX = 0.0f;
+        vp.TopLeftY = 0.0f;
+        vp.MinDepth = 0.0f;
+        vp.MaxDepth = 1.0f;
+        vp.Width = static_cast<float>(levelSize);
+        vp.Height = static_cast<float>(levelSize);
+        context->RSSetViewports(1, &vp);
+
+        ID3D11RenderTargetView* rtvs[1] = { minMaxLevelRTVs[level * NumCascades + cascadeIdx] };
+        context->OMSetRenderTargets(1, rtvs, nullptr);
+
+        // The first level reads from the shadow map, and the rest read from the level before them
+        ID3D11ShaderResourceView* srvs[1] = { cascadeSlices[cascadeIdx] };
+        if(level > 0)
+            srvs[0] = minMaxLevelSRVs[(level - 1) * NumCascades + cascadeIdx];
+        context->PSSetShaderResources(0, 1, srvs);
+
+        context->PSSetShader(level == 0 ? minMaxInitialPS : minMaxPS, nullptr, 0);
+        context->Draw(3, 0);
+
+        srvs[0] = nullptr;
+        context->PSSetShaderResources(0, 1, srvs);
+    }
+}
+
 // Renders the main pass for all meshes in both scenes (assumes shadow maps are already rendered)
 void MeshRenderer::Render(ID3D11DeviceContext* context, const Camera& camera, const Float4x4& world,
                           const Float4x4& characterWorld)
@@ -1047,6 +1442,8 @@ void MeshRenderer::Render(ID3D11DeviceContext* context, const Camera& camera, co
 
     DoFrustumTests(camera, false, scene);
     DoFrustumTests(camera, false, character);
+    if(instanced.InstanceWorlds.size() > 0)
+        DoInstanceCulling(camera, false, instanced);
 
     // Set states
     float blendFactor[4] = {1, 1, 1, 1};
@@ -1067,7 +1464,6 @@ void MeshRenderer::Render(ID3D11DeviceContext* context, const Camera& camera, co
     context->DSSetShader(nullptr, nullptr, 0);
     context->HSSetShader(nullptr, nullptr, 0);
     context->GSSetShader(nullptr, nullptr, 0);
-    context->VSSetShader(meshVS , nullptr, 0);
 
     /*uint32 filterSize = (AppSettings::ShadowMode == ShadowMode::FixedSizePCF || AppSettings::ShadowMode == ShadowMode::OptimizedPCF) ? AppSettings::FixedFilterSize : 0;
     uint32 randomizeOffsets = AppSettings::ShadowMode == ShadowMode::RandomDiscPCF ? AppSettings::RandomizeDiscOffsets : 0;
@@ -1088,48 +1484,36 @@ void MeshRenderer::Render(ID3D11DeviceContext* context, const Camera& camera, co
         RenderModel(context, camera, characterWorld, character);
     }
 
-    ID3D11ShaderResourceView* nullSRVs[3] = { nullptr };
-    context->PSSetShaderResources(0, 3, nullSRVs);
+    if(instanced.InstanceWorlds.size() > 0)
+    {
+        PIXEvent event_(L"Instanced Mesh Rendering");
+
+        RenderModel(context, camera, Float4x4(), instanced);
+    }
+
+    ID3D11ShaderResourceView* nullSRVs[8] = { nullptr };
+    context->PSSetShaderResources(0, 8, nullSRVs);
 }
 
-// Renders one of the models, either the scene or the character
+// Renders one of the models, either the scene or the character, or the instanced model with
+// the instances from the last culling test. The depth prepass uses this with depthOnly set, which
+// leaves the pixel shader inputs alone.
 void MeshRenderer::RenderModel(ID3D11DeviceContext* context, const Camera& camera, const Float4x4& world,
-                              MeshData& meshData)
+                              MeshData& meshData, bool depthOnly)
 {
+    CPUProfileBlock cpuBlock(L"CPU Submission");
+
+    const bool instancing = meshData.InstanceWorlds.size() > 0;
+    if(instancing)
+        SetInstanceStream(context, meshData);
+
     // Set constant buffers
     meshVSConstants.Data.World = Float4x4::Transpose(world);
     meshVSConstants.Data.ViewProjection = Float4x4::Transpose(camera.ViewProjectionMatrix());
-    meshVSConstants.ApplyChanges(context);
     meshVSConstants.SetVS(context, 0);
 
-    meshPSConstants.Data.CameraPosWS = camera.Position();
-    meshPSConstants.ApplyChanges(context);
-    meshPSConstants.SetPS(context, 0);
-
-    if(AppSettings::GPUSceneSubmission)
-    {
-        // Copy the computed cascade info to the constant buffer
-        D3D11_BOX srcBox;
-        srcBox.left = 0;
-        srcBox.right = sizeof(float) * NumCascades;
-        srcBox.top = 0;
-        srcBox.bottom = 1;
-        srcBox.front = 0;
-        srcBox.back = 1;
-        uint32 dstOffset = offsetof(MeshPSConstants, CascadeSplits);
-        context->CopySubresourceRegion(meshPSConstants.Buffer, 0, dstOffset, 0, 0,
-                                       cascadeSplitBuffer.Buffer, 0, &srcBox);
-
-        srcBox.right = sizeof(Float4) * NumCascades;
-        dstOffset = offsetof(MeshPSConstants, CascadeOffsets);
-        context->CopySubresourceRegion(meshPSConstants.Buffer, 0, dstOffset, 0, 0,
-                                       cascadeOffsetBuffer.Buffer, 0, &srcBox);
-
-        srcBox.right = sizeof(Float4) * NumCascades;
-        dstOffset = offsetof(MeshPSConstants, CascadeScales);
-        context->CopySubresourceRegion(meshPSConstants.Buffer, 0, dstOffset, 0, 0,
-                                       cascadeScaleBuffer.Buffer, 0, &srcBox);
-    }
+    if(depthOnly == false)
+        SetMeshPSConstants(context, camera);
 
     // Draw all meshes
     Model* model = meshData.Model;
@@ -1138,6 +1522,13 @@ void MeshRenderer::RenderModel(ID3D11DeviceContext* context, const Camera& camer
     {
         Mesh& mesh = model->Meshes()[meshIdx];
 
+        // Each mesh can have a different vertex format, and its own position dequantization
+        const uint64 vtxFormat = uint64(GetVertexFormat(mesh));
+        context->VSSetShader(instancing ? meshInstancedVS[vtxFormat] : meshVS[vtxFormat], nullptr, 0);
+        meshVSConstants.Data.PositionScale = mesh.PositionScale();
+        meshVSConstants.Data.PositionBias = mesh.PositionBias();
+        meshVSConstants.ApplyChanges(context);
+
         // Set the vertices and indices
         ID3D11Buffer* vertexBuffers[1] = { mesh.VertexBuffer() };
         uint32 vertexStrides[1] = { mesh.VertexStride() };
@@ -1147,64 +1538,144 @@ void MeshRenderer::RenderModel(ID3D11DeviceContext* context, const Camera& camer
         context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
         // Set the input layout
-        context->IASetInputLayout(meshData.InputLayouts[meshIdx]);
+        context->IASetInputLayout(instancing ? meshData.InstancedInputLayouts[meshIdx] : meshData.InputLayouts[meshIdx]);
 
         // Draw all parts
         for(uint64 partIdx = 0; partIdx < mesh.MeshParts().size(); ++partIdx)
         {
-            if(meshData.FrustumTests[partCount++])
+            const uint32 drawIdx = partCount++;
+            const uint32 numInstances = instancing ? meshData.VisibleInstances.PartCounts[drawIdx]
+                                                   : meshData.FrustumTests[drawIdx];
+            if(numInstances > 0)
             {
                 const MeshPart& part = mesh.MeshParts()[partIdx];
                 const MeshMaterial& material = model->Materials()[part.MaterialIdx];
 
                 // Set the textures
-                ID3D11ShaderResourceView* psTextures[3] =
+                if(depthOnly == false)
                 {
-                    material.DiffuseMap,
-                    shadowMap.SRView,
-                    randomRotations,
-                };
+                    ID3D11ShaderResourceView* psTextures[8] =
+                    {
+                        material.DiffuseMap,
+                        shadowMap.SRView,
+                        randomRotations,
+                        shadowMinMaxMap.SRView,
+                        characterShadowMap.SRView,
+                        nullptr,
+                        nullptr,
+                        shadowMask.SRView,
+                    };
+
+                    if(psTextures[0] == nullptr)
+                        psTextures[0] = defaultTexture;
+
+                    if(AppSettings::UseFilterableShadows())
+                        psTextures[1] = varianceShadowMap.SRView;
+
+                    context->PSSetShaderResources(0, 8, psTextures);
+                }
+                if(instancing)
+                    context->DrawIndexedInstanced(part.IndexCount, numInstances, part.IndexStart, 0,
+                                                  meshData.VisibleInstances.PartStarts[drawIdx]);
+                else
+                    context->DrawIndexed(part.IndexCount, part.IndexStart, 0);
+            }
+        }
+    }
+}
+
+// Sets the constant buffer used for evaluating the shadows in the pixel shader
+void MeshRenderer::SetMeshPSConstants(ID3D11DeviceContext* context, const Camera& camera)
+{
+    meshPSConstants.Data.CameraPosWS = camera.Position();
+    meshPSConstants.Data.SampleRotationOffset = AppSettings::UseTemporalShadows() ? ShadowSampleRotation(shadowMaskFrame) : 0.0f;
+    meshPSConstants.ApplyChanges(context);
+    meshPSConstants.SetPS(context, 0);
+
+    if(AppSettings::GPUSceneSubmission)
+    {
+        // Copy the computed cascade info to the constant buffer
+        D3D11_BOX srcBox;
+        srcBox.left = 0;
+        srcBox.right = sizeof(float) * NumCascades;
+        srcBox.top = 0;
+        srcBox.bottom = 1;
+        srcBox.front = 0;
+        srcBox.back = 1;
+        uint32 dstOffset = offsetof(MeshPSConstants, CascadeSplits);
+        context->CopySubresourceRegion(meshPSConstants.Buffer, 0, dstOffset, 0, 0,
+                                       cascadeSplitBuffer.Buffer, 0, &srcBox);
 
-                if(psTextures[0] == nullptr)
-                    psTextures[0] = defaultTexture;
+        srcBox.right = sizeof(Float4) * NumCascades;
+        dstOffset = offsetof(MeshPSConstants, CascadeOffsets);
+        context->CopySubresourceRegion(meshPSConstants.Buffer, 0, dstOffset, 0, 0,
+                                       cascadeOffsetBuffer.Buffer, 0, &srcBox);
 
-                if(AppSettings::UseFilterableShadows())
-                    psTextures[1] = varianceShadowMap.SRView;
+        srcBox.right = sizeof(Float4) * NumCascades;
+        dstOffset = offsetof(MeshPSConstants, CascadeScales);
+        context->CopySubresourceRegion(meshPSConstants.Buffer, 0, dstOffset, 0, 0,
+                                       cascadeScaleBuffer.Buffer, 0, &srcBox);
 
-                context->PSSetShaderResources(0, 3, psTextures);
-                context->DrawIndexed(part.IndexCount, part.IndexStart, 0);
-            }
-        }
+        srcBox.right = sizeof(Float4x4) * NumCascades;
+        dstOffset = offsetof(MeshPSConstants, CascadeMatrices);
+        context->CopySubresourceRegion(meshPSConstants.Buffer, 0, dstOffset, 0, 0,
+                                       cascadeMatrixBuffer.Buffer, 0, &srcBox);
     }
 }
 
 // Renders all meshes using depth-only rendering, using CPU-driven submission
 void MeshRenderer::RenderDepthCPU(ID3D11DeviceContext* context, const Camera& camera,
                                   const Float4x4& world, const Float4x4& characterWorld,
-                                  bool shadowRendering)
+                                  bool shadowRendering, float lodTexelSize)
 {
     PIXEvent event(L"Mesh Depth Rendering");
 
-    DoFrustumTests(camera, shadowRendering, scene);
-    DoFrustumTests(camera, shadowRendering, character);
+    RenderSceneDepthCPU(context, camera, world, shadowRendering, lodTexelSize);
+    RenderCharacterDepthCPU(context, camera, characterWorld, shadowRendering, lodTexelSize);
+}
+
+// Renders the static scene using depth-only rendering, using CPU-driven submission
+void MeshRenderer::RenderSceneDepthCPU(ID3D11DeviceContext* context, const Camera& camera, const Float4x4& world,
+                                       bool shadowRendering, float lodTexelSize)
+{
+    PIXEvent event(L"Static Mesh Rendering");
 
+    DoFrustumTests(camera, shadowRendering, scene);
     SetupRenderDepthState(context, shadowRendering);
+    RenderModelDepthCPU(context, camera, world, scene, shadowRendering, lodTexelSize);
 
+    // The instanced model is static as well, so it goes wherever the scene goes
+    if(instanced.InstanceWorlds.size() > 0)
     {
-        PIXEvent event_(L"Static Mesh Rendering");
-        RenderModelDepthCPU(context, camera, world, scene);
+        DoInstanceCulling(camera, shadowRendering, instanced);
+        RenderModelDepthCPU(context, camera, Float4x4(), instanced, shadowRendering, lodTexelSize);
     }
+}
 
-    {
-        PIXEvent event_(L"Character Mesh Rendering");
-        RenderModelDepthCPU(context, camera, characterWorld, character);
-    }
+// Renders the character using depth-only rendering, using CPU-driven submission
+void MeshRenderer::RenderCharacterDepthCPU(ID3D11DeviceContext* context, const Camera& camera,
+                                           const Float4x4& characterWorld, bool shadowRendering,
+                                           float lodTexelSize)
+{
+    PIXEvent event(L"Character Mesh Rendering");
+
+    DoFrustumTests(camera, shadowRendering, character);
+    SetupRenderDepthState(context, shadowRendering);
+    RenderModelDepthCPU(context, camera, characterWorld, character, shadowRendering, lodTexelSize);
 }
 
 // Renders all meshes using depth-only rendering, using GPU-driven submission
 void MeshRenderer::RenderDepthGPU(ID3D11DeviceContext* context, const Camera& camera, const Float4x4& world,
                                   const Float4x4& characterWorld, bool shadowRendering)
 {
+    // The depth prepass has to match the main pass exactly, which only the CPU path does. The main
+    // pass is always submitted from the CPU, so this doesn't lose any culling that it would get.
+    if(shadowRendering == false)
+    {
+        RenderDepthCPU(context, camera, world, characterWorld, false);
+        return;
+    }
+
     tempViewProjBuffer.Data = Float4x4::Transpose(camera.ViewProjectionMatrix());
     tempViewProjBuffer.ApplyChanges(context);
 
@@ -1234,6 +1705,25 @@ void MeshRenderer::RenderDepthGPU(ID3D11DeviceContext* context, const Float4x4&
                            frustumPlanes, planesOffset);
     }
 
+    // The frustum is only on the GPU here, so every instance gets drawn
+    if(instanced.InstanceWorlds.size() > 0)
+    {
+        PIXEvent event_(L"Instanced Mesh Rendering");
+        CullInstances(nullptr, 0, instanced.Instances, instanced.VisibleInstances);
+
+        const Float4x4 dequantization = SetDepthPositionStream(context, instanced, shadowRendering);
+        context->IASetIndexBuffer(instanced.DepthIB, instanced.DepthIndexFormat, 0);
+
+        depthOnlyConstants.Data.World = Float4x4::Transpose(dequantization);
+        depthOnlyConstants.ApplyChanges(context);
+        depthOnlyConstants.SetVS(context, 0);
+        CopyBufferRegion(context, depthOnlyConstants.Buffer, viewProj, sizeof(Float4x4), viewProjOffset, sizeof(Float4x4));
+
+        RenderInstancesDepth(context, instanced, shadowRendering, 0.0f);
+    }
+
+    // The character gets its own shadow map when CharacterShadowMap is enabled
+    if(shadowRendering == false || AppSettings::CharacterShadowMap == false)
     {
         PIXEvent event_(L"Character Mesh Rendering");
         RenderModelDepthGPU(context, character, shadowRendering, characterWorld, viewProj, viewProjOffset,
@@ -1262,44 +1752,109 @@ void MeshRenderer::SetupRenderDepthState(ID3D11DeviceContext* context, bool shad
     context->HSSetShader(nullptr, nullptr, 0);
 }
 
-// Renders depth-only for a model using CPU-driven submission
+// Binds the position-only stream for depth rendering, along with its input layout. Returns the
+// matrix that maps the stream's positions to object space. The quantized stream is only used for
+// shadow maps, since its positions don't exactly match the ones the main pass draws with.
+Float4x4 MeshRenderer::SetDepthPositionStream(ID3D11DeviceContext* context, const MeshData& meshData,
+                                              bool shadowRendering)
+{
+    const bool quantized = shadowRendering && AppSettings::QuantizedDepthPositions;
+    ID3D11Buffer* vertexBuffers[1] = { quantized ? meshData.QuantizedPositionsVB : meshData.PositionsVB };
+    uint32 vertexStrides[1] = { quantized ? QuantizedPositionStride : sizeof(Float3) };
+    uint32 offsets[1] = { 0 };
+    context->IASetVertexBuffers(0, 1, vertexBuffers, vertexStrides, offsets);
+    context->IASetInputLayout(quantized ? depthQuantizedInputLayout : depthInputLayout);
+    context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+    return quantized ? meshData.Dequantization : Float4x4();
+}
+
+// Picks the coarsest level of detail for a part whose error is below the size of a shadow map
+// texel in world space. Parts that are smaller than a texel always get the coarsest level.
+static const MeshPartLOD& SelectPartLOD(const MeshData& meshData, uint64 partIdx, float lodTexelSize)
+{
+    const MeshPartLOD* lods = &meshData.PartLODs[partIdx * NumPartLODs];
+    if(lodTexelSize <= 0.0f || AppSettings::ShadowCasterLODs == false)
+        return lods[0];
+
+    if(meshData.BoundingSpheres[partIdx].Radius * 2.0f < lodTexelSize)
+        return lods[NumPartLODs - 1];
+
+    const float maxError = AppSettings::ShadowLODErrorTexels * lodTexelSize / meshData.WorldScale;
+    uint32 lodIdx = NumPartLODs - 1;
+    while(lodIdx > 0 && lods[lodIdx].Error > maxError)
+        --lodIdx;
+    return lods[lodIdx];
+}
+
+// Renders depth-only for a model using CPU-driven submission. When lodTexelSize is non-zero it's
+// the world space size of a shadow map texel, which is used for picking the level of detail.
 void MeshRenderer::RenderModelDepthCPU(ID3D11DeviceContext* context, const Camera& camera, const Float4x4& world,
-                                      MeshData& meshData)
+                                      MeshData& meshData, bool shadowRendering, float lodTexelSize)
 {
+    // The main pass tests against the prepass depth with LESS_EQUAL, so the prepass needs to
+    // produce bit-identical depth. The position stream is decoded differently from the mesh
+    // vertex buffers, so this draws with the same buffers and vertex shaders as the main pass.
+    if(shadowRendering == false)
+    {
+        RenderModel(context, camera, world, meshData, true);
+        context->VSSetShader(meshDepthVS, nullptr, 0);
+        return;
+    }
+
+    CPUProfileBlock cpuBlock(L"CPU Submission");
+
+    // Set the position stream, which has the vertices of all meshes
+    const Float4x4 dequantization = SetDepthPositionStream(context, meshData, shadowRendering);
+
     // Set constant buffers
-    depthOnlyConstants.Data.World = Float4x4::Transpose(world);
+    depthOnlyConstants.Data.World = Float4x4::Transpose(dequantization * world);
     depthOnlyConstants.Data.ViewProjection = Float4x4::Transpose(camera.ViewProjectionMatrix());
     depthOnlyConstants.ApplyChanges(context);
     depthOnlyConstants.SetVS(context, 0);
 
-    Model* model = meshData.Model;
+    // Set the indices, which are already offset into the position stream
+    context->IASetIndexBuffer(meshData.DepthIB, meshData.DepthIndexFormat, 0);
 
-    uint32 partCount = 0;
-    for (uint64 meshIdx = 0; meshIdx < model->Meshes().size(); ++meshIdx)
+    if(meshData.InstanceWorlds.size() > 0)
     {
-        Mesh& mesh = model->Meshes()[meshIdx];
+        RenderInstancesDepth(context, meshData, shadowRendering, lodTexelSize);
+        return;
+    }
 
-        // Set the vertices and indices
-        ID3D11Buffer* vertexBuffers[1] = { mesh.VertexBuffer() };
-        uint32 vertexStrides[1] = { mesh.VertexStride() };
-        uint32 offsets[1] = { 0 };
-        context->IASetVertexBuffers(0, 1, vertexBuffers, vertexStrides, offsets);
-        context->IASetIndexBuffer(mesh.IndexBuffer(), mesh.IndexBufferFormat(), 0);
-        context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    // Draw all parts
+    for(uint64 partIdx = 0; partIdx < meshData.FrustumTests.size(); ++partIdx)
+    {
+        if(meshData.FrustumTests[partIdx])
+        {
+            const MeshPartLOD& lod = SelectPartLOD(meshData, partIdx, lodTexelSize);
+            context->DrawIndexed(lod.NumIndices, lod.StartIndex, 0);
+        }
+    }
+}
 
-        // Set the input layout
-        context->IASetInputLayout(meshData.DepthInputLayouts[meshIdx]);
+// Draws the instances from the last culling test with depth only, with one draw for each part.
+// The position stream, the indices, and the constants need to be set already.
+void MeshRenderer::RenderInstancesDepth(ID3D11DeviceContext* context, const MeshData& meshData,
+                                        bool shadowRendering, float lodTexelSize)
+{
+    SetInstanceStream(context, meshData);
+    const bool quantized = shadowRendering && AppSettings::QuantizedDepthPositions;
+    context->IASetInputLayout(quantized ? depthQuantizedInstancedInputLayout : depthInstancedInputLayout);
+    context->VSSetShader(meshDepthInstancedVS, nullptr, 0);
 
-        // Draw all parts
-        for (uint64 partIdx = 0; partIdx < mesh.MeshParts().size(); ++partIdx)
+    const InstanceDrawList& visible = meshData.VisibleInstances;
+    for(uint64 partIdx = 0; partIdx < visible.PartCounts.size(); ++partIdx)
+    {
+        if(visible.PartCounts[partIdx] > 0)
         {
-            if(meshData.FrustumTests[partCount++])
-            {
-                const MeshPart& part = mesh.MeshParts()[partIdx];
-                context->DrawIndexed(part.IndexCount, part.IndexStart, 0);
-            }
+            const MeshPartLOD& lod = SelectPartLOD(meshData, partIdx, lodTexelSize);
+            context->DrawIndexedInstanced(lod.NumIndices, visible.PartCounts[partIdx], lod.StartIndex, 0,
+                                          visible.PartStarts[partIdx]);
         }
     }
+
+    context->VSSetShader(meshDepthVS, nullptr, 0);
 }
 
 // Renders depth-only for a model using GPU-driven submission
@@ -1343,24 +1898,17 @@ void MeshRenderer::RenderModelDepthGPU(ID3D11DeviceContext* context, MeshData& m
     ClearCSOutputs(context);
     ClearCSInputs(context);
 
+    // Set the vertices and indices
+    const Float4x4 dequantization = SetDepthPositionStream(context, meshData, shadowRendering);
+    context->IASetIndexBuffer(meshData.CulledIndices.Buffer, meshData.CulledIndices.Format, 0);
+
     // Setup the constant buffer for mesh rendering
-    depthOnlyConstants.Data.World = Float4x4::Transpose(world);
+    depthOnlyConstants.Data.World = Float4x4::Transpose(dequantization * world);
     depthOnlyConstants.ApplyChanges(context);
     depthOnlyConstants.SetVS(context, 0);
 
     CopyBufferRegion(context, depthOnlyConstants.Buffer, viewProj, sizeof(Float4x4), viewProjOffset, sizeof(Float4x4));
 
-    // Set the vertices and indices
-    ID3D11Buffer* vertexBuffers[1] = { meshData.PositionsVB };
-    uint32 vertexStrides[1] = { sizeof(Float3) };
-    uint32 offsets[1] = { 0 };
-    context->IASetVertexBuffers(0, 1, vertexBuffers, vertexStrides, offsets);
-    context->IASetIndexBuffer(meshData.CulledIndices.Buffer, DXGI_FORMAT_R32_UINT, 0);
-    context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-    // Set the input layout
-    context->IASetInputLayout(depthGPUInputLayout);
-
     // Draw the batch
     context->DrawIndexedInstancedIndirect(drawArgsBuffer.Buffer, 0);
 }
@@ -1381,6 +1929,10 @@ void MeshRenderer::RenderShadowMap(ID3D11DeviceContext* context, const Camera& c
     const float MaxDistance = AppSettings::AutoComputeDepthBounds ? reductionDepth.y
                                                                   : AppSettings::MaxCascadeDistance;
 
+    // The cascade setup is interleaved with rendering, so the CPU profile is stopped and
+    // restarted around the draw calls
+    Profiler::GlobalProfiler.StartCPUProfile(L"CPU Cascade Setup");
+
     // Compute the split distances based on the partitioning mode
     float CascadeSplits[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
 
@@ -1442,7 +1994,10 @@ void MeshRenderer::RenderShadowMap(ID3D11DeviceContext* context, const Camera& c
             dsv = shadowMap.ArraySlices[cascadeIdx];
         ID3D11RenderTargetView* nullRenderTargets[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT] = { nullptr };
         context->OMSetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, nullRenderTargets, dsv);
-        context->ClearDepthStencilView(dsv, D3D11_CLEAR_DEPTH|D3D11_CLEAR_STENCIL, 1.0f, 0);
+
+        // The cached path overwrites the whole slice with the static depth
+        if(AppSettings::CacheStaticShadows == false)
+            context->ClearDepthStencilView(dsv, D3D11_CLEAR_DEPTH|D3D11_CLEAR_STENCIL, 1.0f, 0);
 
         // Get the 8 points of the view frustum in world space
         Float3 frustumCornersWS[8] =
@@ -1483,9 +2038,13 @@ void MeshRenderer::RenderShadowMap(ID3D11DeviceContext* context, const Camera& c
 
         Float3 upDir = Float3(0.0f, 1.0f, 0.0f);
 
+        // The perspective warp changes the cascade every time the camera moves, so there's no
+        // point in stabilizing it
+        const bool stabilize = AppSettings::StabilizeCascades && AppSettings::PerspectiveWarp == false;
+
         Float3 minExtents;
         Float3 maxExtents;
-        if(AppSettings::StabilizeCascades)
+        if(stabilize)
         {
             // Calculate the radius of a bounding sphere surrounding the frustum corners
             float sphereRadius = 0.0f;
@@ -1538,7 +2097,7 @@ void MeshRenderer::RenderShadowMap(ID3D11DeviceContext* context, const Camera& c
                                         maxExtents.y, 0.0f, cascadeExtents.z);
         shadowCamera.SetLookAt(shadowCameraPos, frustumCenter, upDir);
 
-        if(AppSettings::StabilizeCascades)
+        if(stabilize)
         {
             // Create the rounding matrix, by projecting the world-space origin and determining
             // the fractional offset in texel space
@@ -1558,8 +2117,36 @@ void MeshRenderer::RenderShadowMap(ID3D11DeviceContext* context, const Camera& c
             shadowCamera.SetProjection(shadowProj);
         }
 
+        // With the perspective warp the cascade gets rendered with a light view that's aligned
+        // with the view direction, while the cascade offsets and scales keep using the unwarped
+        // projection as an approximation of the texel density
+        OrthographicCamera cascadeCamera = shadowCamera;
+        const float sinGamma = Float3::Length(Float3::Cross(camera.Forward(), AppSettings::LightDirection));
+        if(AppSettings::PerspectiveWarp && sinGamma >= MinLiSPSMSinGamma)
+        {
+            const float sliceNear = camera.NearClip() + prevSplitDist * (camera.FarClip() - camera.NearClip());
+            const float sliceFar = camera.NearClip() + splitDist * (camera.FarClip() - camera.NearClip());
+            const float filterScale = (ShadowMapSize + AppSettings::FixedFilterKernelSize()) / sMapSize;
+
+            cascadeCamera.SetLookAt(frustumCenter, frustumCenter - AppSettings::LightDirection, camera.Forward());
+            cascadeCamera.SetProjection(MakeLiSPSMProjection(cascadeCamera.ViewMatrix(), frustumCornersWS,
+                                                             sliceNear, sliceFar, sinGamma, filterScale));
+        }
+
         // Draw the mesh with depth only, using the new shadow camera
-        RenderDepthCPU(context, shadowCamera, world, characterWorld, true);
+        Profiler::GlobalProfiler.EndCPUProfile(L"CPU Cascade Setup");
+        // The levels of detail are picked using the size of a texel in the unwarped projection
+        const float texelSize = (maxExtents.x - minExtents.x) / sMapSize;
+        D3D11_RECT dirtyRect = { };
+        bool cacheHit = false;
+        if(AppSettings::CacheStaticShadows)
+            cacheHit = RenderCachedShadowCascade(context, cascadeCamera, world, characterWorld, cascadeIdx,
+                                                 texelSize, dirtyRect);
+        else if(AppSettings::CharacterShadowMap)
+            RenderSceneDepthCPU(context, cascadeCamera, world, true, texelSize);
+        else
+            RenderDepthCPU(context, cascadeCamera, world, characterWorld, true, texelSize);
+        Profiler::GlobalProfiler.StartCPUProfile(L"CPU Cascade Setup");
 
         // Apply the scale/offset matrix, which transforms from [-1,1]
         // post-projection space to [0,1] UV space
@@ -1569,7 +2156,8 @@ void MeshRenderer::RenderShadowMap(ID3D11DeviceContext* context, const Camera& c
         texScaleBias.r[2] = XMVectorSet(0.0f,  0.0f, 1.0f, 0.0f);
         texScaleBias.r[3] = XMVectorSet(0.5f,  0.5f, 0.0f, 1.0f);
         XMMATRIX shadowMatrix = shadowCamera.ViewProjectionMatrix().ToSIMD();
-        invCascadeMats[cascadeIdx] = XMMatrixInverse(nullptr, shadowMatrix);
+        invCascadeMats[cascadeIdx] = Float4x4::Invert(cascadeCamera.ViewProjectionMatrix());
+        meshPSConstants.Data.CascadeMatrices[cascadeIdx] = Float4x4::Transpose(cascadeCamera.ViewProjectionMatrix());
         shadowMatrix = XMMatrixMultiply(shadowMatrix, texScaleBias);
 
         // Store the split distance in terms of view space depth
@@ -1591,10 +2179,142 @@ void MeshRenderer::RenderShadowMap(ID3D11DeviceContext* context, const Camera& c
         meshPSConstants.Data.CascadeOffsets[cascadeIdx] = Float4(-cascadeCorner, 0.0f);
         meshPSConstants.Data.CascadeScales[cascadeIdx] = Float4(cascadeScale, 1.0f);
 
+        Profiler::GlobalProfiler.EndCPUProfile(L"CPU Cascade Setup");
+
         if(AppSettings::UseFilterableShadows())
             ConvertToVSM(context, cascadeIdx, meshPSConstants.Data.CascadeScales[cascadeIdx].To3D(),
-                         meshPSConstants.Data.CascadeScales[0].To3D());
+                         meshPSConstants.Data.CascadeScales[0].To3D(), cacheHit ? &dirtyRect : nullptr);
+        else if(AppSettings::ShadowMode == ShadowMode::PCSS)
+            BuildMinMaxPyramid(context, cascadeIdx);
+
+        Profiler::GlobalProfiler.StartCPUProfile(L"CPU Cascade Setup");
+    }
+
+    Profiler::GlobalProfiler.EndCPUProfile(L"CPU Cascade Setup");
+
+    if(AppSettings::CharacterShadowMap)
+        RenderCharacterShadowMap(context, characterWorld);
+}
+
+// Renders a cascade using the static shadow cache. The scene only gets rendered into the cache
+// when the cascade matrix changes, otherwise the cached depth gets copied into the shadow map and
+// only the character is drawn on top of it. Returns true if the cache was re-used, in which case
+// dirtyRect covers the texels that the character could have touched this frame or the last one.
+bool MeshRenderer::RenderCachedShadowCascade(ID3D11DeviceContext* context, const OrthographicCamera& shadowCamera,
+                                             const Float4x4& world, const Float4x4& characterWorld,
+                                             uint32 cascadeIdx, float texelSize, D3D11_RECT& dirtyRect)
+{
+    PIXEvent event(L"Cached Shadow Map Rendering");
+
+    const Float4x4 cascadeMat = shadowCamera.ViewProjectionMatrix();
+    const bool cacheHit = cascadeCacheValid[cascadeIdx] &&
+                          memcmp(&cascadeMat, &cachedCascadeMats[cascadeIdx], sizeof(Float4x4)) == 0;
+
+    ID3D11RenderTargetView* nullRenderTargets[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT] = { nullptr };
+    if(cacheHit == false)
+    {
+        ID3D11DepthStencilView* cacheDSV = staticShadowCache.ArraySlices[cascadeIdx];
+        context->OMSetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, nullRenderTargets, cacheDSV);
+        context->ClearDepthStencilView(cacheDSV, D3D11_CLEAR_DEPTH|D3D11_CLEAR_STENCIL, 1.0f, 0);
+
+        RenderSceneDepthCPU(context, shadowCamera, world, true, texelSize);
+
+        cachedCascadeMats[cascadeIdx] = cascadeMat;
+        cascadeCacheValid[cascadeIdx] = true;
+    }
+
+    // The filterable modes render every cascade into the same depth slice
+    ID3D11DepthStencilView* dsv = shadowMap.ArraySlices[cascadeIdx];
+    uint32 dstSubresource = cascadeIdx;
+    if(AppSettings::UseFilterableShadows())
+    {
+        dsv = shadowMap.DSView;
+        dstSubresource = 0;
+    }
+
+    context->OMSetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, nullRenderTargets, nullptr);
+    context->CopySubresourceRegion(shadowMap.Texture, dstSubresource, 0, 0, 0, staticShadowCache.Texture,
+                                   cascadeIdx, nullptr);
+
+    // With a dedicated shadow map the character doesn't touch the cascades at all, and the
+    // empty rect makes sure that it gets removed from them the frame after it's enabled
+    D3D11_RECT characterRect = { };
+    if(AppSettings::CharacterShadowMap)
+    {
+        UnionRect(&dirtyRect, &characterRect, &prevCharacterRects[cascadeIdx]);
+        prevCharacterRects[cascadeIdx] = characterRect;
+        return cacheHit;
+    }
+
+    context->OMSetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, nullRenderTargets, dsv);
+    RenderCharacterDepthCPU(context, shadowCamera, characterWorld, true, texelSize);
+
+    // Project the character's bounding sphere to find the texels that it covers, with an extra
+    // texel on each side for rasterization and bilinear filtering
+    const float size = float(shadowMap.Width);
+    float minX = 0.0f;
+    float minY = 0.0f;
+    float maxX = size;
+    float maxY = size;
+    if(AppSettings::PerspectiveWarp)
+    {
+        // The warped projection isn't affine, so the corners of a box around the sphere get
+        // projected instead. If any of them are behind the projection center, the whole cascade
+        // is treated as dirty.
+        const Float3 center = characterWorld.Translation();
+        const float r = characterBoundingRadius;
+        float cornerMinX = FLT_MAX;
+        float cornerMinY = FLT_MAX;
+        float cornerMaxX = -FLT_MAX;
+        float cornerMaxY = -FLT_MAX;
+        bool behindCenter = false;
+        for(uint32 i = 0; i < 8; ++i)
+        {
+            const Float3 corner = center + Float3(i & 1 ? r : -r, i & 2 ? r : -r, i & 4 ? r : -r);
+            const XMVECTOR projected = XMVector4Transform(XMVectorSet(corner.x, corner.y, corner.z, 1.0f),
+                                                          cascadeMat.ToSIMD());
+            const float w = XMVectorGetW(projected);
+            behindCenter = behindCenter || w <= 0.0f;
+            const float x = (XMVectorGetX(projected) / w * 0.5f + 0.5f) * size;
+            const float y = (XMVectorGetY(projected) / w * -0.5f + 0.5f) * size;
+            cornerMinX = std::min(cornerMinX, x);
+            cornerMinY = std::min(cornerMinY, y);
+            cornerMaxX = std::max(cornerMaxX, x);
+            cornerMaxY = std::max(cornerMaxY, y);
+        }
+
+        if(behindCenter == false)
+        {
+            minX = cornerMinX - 1.0f;
+            minY = cornerMinY - 1.0f;
+            maxX = cornerMaxX + 1.0f;
+            maxY = cornerMaxY + 1.0f;
+        }
+    }
+    else
+    {
+        const Float4x4 projection = shadowCamera.ProjectionMatrix();
+        const Float3 center = Float3::Transform(characterWorld.Translation(), cascadeMat);
+        const float centerX = (center.x * 0.5f + 0.5f) * size;
+        const float centerY = (center.y * -0.5f + 0.5f) * size;
+        const float radiusX = characterBoundingRadius * std::abs(projection._11) * 0.5f * size + 1.0f;
+        const float radiusY = characterBoundingRadius * std::abs(projection._22) * 0.5f * size + 1.0f;
+        minX = centerX - radiusX;
+        minY = centerY - radiusY;
+        maxX = centerX + radiusX;
+        maxY = centerY + radiusY;
     }
+
+    characterRect.left = LONG(Clamp(std::floor(minX), 0.0f, size));
+    characterRect.top = LONG(Clamp(std::floor(minY), 0.0f, size));
+    characterRect.right = LONG(Clamp(std::ceil(maxX), 0.0f, size));
+    characterRect.bottom = LONG(Clamp(std::ceil(maxY), 0.0f, size));
+
+    // Wherever the character was last frame needs to go back to the static depth
+    UnionRect(&dirtyRect, &characterRect, &prevCharacterRects[cascadeIdx]);
+    prevCharacterRects[cascadeIdx] = characterRect;
+
+    return cacheHit;
 }
 
 // Renders the shadow map for all cascades using GPU batching, and performs VSM conversion if necessary
@@ -1614,6 +2334,7 @@ void MeshRenderer::RenderShadowMapGPU(ID3D11DeviceContext* context, const Camera
     shadowSetupConstants.Data.CameraRight = camera.WorldMatrix().Right();
     shadowSetupConstants.Data.CameraNearClip = camera.NearClip();
     shadowSetupConstants.Data.CameraFarClip = camera.FarClip();
+    shadowSetupConstants.Data.CameraForward = camera.Forward();
     shadowSetupConstants.ApplyChanges(context);
     shadowSetupConstants.SetCS(context, 0);
 
@@ -1653,8 +2374,87 @@ void MeshRenderer::RenderShadowMapGPU(ID3D11DeviceContext* context, const Camera
                        cascadePlanesBuffer.Buffer, sizeof(Float4) * 6 * cascadeIdx);
 
         if(AppSettings::UseFilterableShadows())
+        {
             ConvertToVSM(context, cascadeIdx, Float3(1.0f, 1.0f, 1.0f), Float3(1.0f, 1.0f, 1.0f));
+        }
+        else if(AppSettings::ShadowMode == ShadowMode::PCSS)
+        {
+            BuildMinMaxPyramid(context, cascadeIdx);
+            context->RSSetViewports(1, &viewport);
+        }
+    }
+
+    if(AppSettings::CharacterShadowMap)
+        RenderCharacterShadowMap(context, characterWorld);
+}
+
+// Renders the character into its own shadow map, using an orthographic projection that's fitted
+// to its bounding spheres
+void MeshRenderer::RenderCharacterShadowMap(ID3D11DeviceContext* context, const Float4x4& characterWorld)
+{
+    PIXEvent event(L"Character Shadow Map Rendering");
+
+    // Create a view matrix for the light centered on the character, and find the AABB of the
+    // bounding spheres in that space
+    const Float3 origin = characterWorld.Translation();
+    const Float3 upDir = Float3(0.0f, 1.0f, 0.0f);
+    const Float3 lookAt = origin - AppSettings::LightDirection;
+    const Float4x4 lightView = XMMatrixLookAtLH(origin.ToSIMD(), lookAt.ToSIMD(), upDir.ToSIMD());
+    const float worldScale = Float3::Length(characterWorld.Right());
+
+    Float3 mins = FLT_MAX;
+    Float3 maxes = -FLT_MAX;
+    for(uint64 i = 0; i < characterLocalSpheres.size(); ++i)
+    {
+        const Sphere& sphere = characterLocalSpheres[i];
+        Float3 center = Float3::Transform(Float3(sphere.Center), characterWorld);
+        center = Float3::Transform(center, lightView);
+        const Float3 radius = sphere.Radius * worldScale;
+        mins = XMVectorMin(mins.ToSIMD(), (center - radius).ToSIMD());
+        maxes = XMVectorMax(maxes.ToSIMD(), (center + radius).ToSIMD());
     }
+
+    // Leave a texel on each side for the PCF kernel
+    const float sMapSize = static_cast<float>(characterShadowMap.Width);
+    const float borderX = (maxes.x - mins.x) / (sMapSize - 2.0f);
+    const float borderY = (maxes.y - mins.y) / (sMapSize - 2.0f);
+    mins.x -= borderX;
+    mins.y -= borderY;
+    maxes.x += borderX;
+    maxes.y += borderY;
+
+    const Float3 shadowCameraPos = origin + AppSettings::LightDirection.Value() * -mins.z;
+    OrthographicCamera shadowCamera(mins.x, mins.y, maxes.x, maxes.y, 0.0f, maxes.z - mins.z);
+    shadowCamera.SetLookAt(shadowCameraPos, origin, upDir);
+
+    D3D11_VIEWPORT viewport;
+    viewport.TopLeftX = 0.0f;
+    viewport.TopLeftY = 0.0f;
+    viewport.Width = sMapSize;
+    viewport.Height = sMapSize;
+    viewport.MinDepth = 0.0f;
+    viewport.MaxDepth = 1.0f;
+    context->RSSetViewports(1, &viewport);
+
+    ID3D11RenderTargetView* nullRenderTargets[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT] = { nullptr };
+    context->OMSetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, nullRenderTargets,
+                                characterShadowMap.DSView);
+    context->ClearDepthStencilView(characterShadowMap.DSView, D3D11_CLEAR_DEPTH|D3D11_CLEAR_STENCIL, 1.0f, 0);
+
+    RenderCharacterDepthCPU(context, shadowCamera, characterWorld, true);
+
+    context->OMSetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, nullRenderTargets, nullptr);
+
+    // Apply the scale/offset matrix, which transforms from [-1,1]
+    // post-projection space to [0,1] UV space
+    XMMATRIX texScaleBias;
+    texScaleBias.r[0] = XMVectorSet(0.5f,  0.0f, 0.0f, 0.0f);
+    texScaleBias.r[1] = XMVectorSet(0.0f, -0.5f, 0.0f, 0.0f);
+    texScaleBias.r[2] = XMVectorSet(0.0f,  0.0f, 1.0f, 0.0f);
+    texScaleBias.r[3] = XMVectorSet(0.5f,  0.5f, 0.0f, 1.0f);
+    XMMATRIX shadowMatrix = shadowCamera.ViewProjectionMatrix().ToSIMD();
+    shadowMatrix = XMMatrixMultiply(shadowMatrix, texScaleBias);
+    meshPSConstants.Data.CharacterShadowMatrix = Float4x4::Transpose(shadowMatrix);
 }
 
 void MeshRenderer::RenderCascadeDebug(ID3D11DeviceContext* context, const Camera& camera, const Camera& cameraForShadows)
@@ -21,16 +21,12 @@
 
 #include "AppSettings.h"
 #include "SharedConstants.h"
+#include "MeshCache.h"
+#include "VertexCompression.h"
+#include "InstanceCulling.h"
 
 using namespace SampleFramework11;
 
-// Represents a bouncing sphere for a MeshPart
-struct Sphere
-{
-    XMFLOAT3 Center;
-    float Radius;
-};
-
 // Represents the 6 planes of a frustum
 Float4Align struct Frustum
 {
@@ -40,7 +36,19 @@ Float4Align struct Frustum
 struct MeshData
 {
     Model* Model;
+
+    // Position-only streams for depth rendering, with the vertices of every mesh back to back and
+    // the merged indices (including the simplified ones) of every part
     ID3D11BufferPtr PositionsVB;
+    ID3D11BufferPtr QuantizedPositionsVB;
+    ID3D11BufferPtr DepthIB;
+    DXGI_FORMAT DepthIndexFormat;
+    Float4x4 Dequantization;
+
+    // NumPartLODs levels of detail for each part, with the errors in object space
+    std::vector<MeshPartLOD> PartLODs;
+    float WorldScale;
+
     StructuredBuffer Indices;
     StructuredBuffer DrawCalls;
     StructuredBuffer CulledDraws;
@@ -51,9 +59,17 @@ struct MeshData
     uint32 NumSuccessfulTests;
 
     std::vector<ID3D11InputLayoutPtr> InputLayouts;
-    std::vector<ID3D11InputLayoutPtr> DepthInputLayouts;
 
-    MeshData() : Model(NULL), NumSuccessfulTests(0) {}
+    // For models that get drawn with instancing: the world matrix of every instance, the bounding
+    // spheres of every part of every instance, the instances that passed the last culling test,
+    // and the vertex buffer that their transforms get written to
+    std::vector<Float4x4> InstanceWorlds;
+    InstanceSpheres Instances;
+    InstanceDrawList VisibleInstances;
+    ID3D11BufferPtr InstanceVB;
+    std::vector<ID3D11InputLayoutPtr> InstancedInputLayouts;
+
+    MeshData() : Model(NULL), DepthIndexFormat(DXGI_FORMAT_R32_UINT), WorldScale(1.0f), NumSuccessfulTests(0) {}
 };
 
 class MeshRenderer
@@ -68,13 +84,21 @@ protected:
 public:
 
     MeshRenderer();
+    ~MeshRenderer();
 
     void Initialize(ID3D11Device* device, ID3D11DeviceContext* context);
-    void SetSceneMesh(ID3D11DeviceContext* context, Model* model, const Float4x4& world);
-    void SetCharacterMesh(ID3D11DeviceContext* context, Model* model, const Float4x4& world);
+    void SetSceneMesh(ID3D11DeviceContext* context, Model* model, const Float4x4& world,
+                      const MeshStreamsView* streams = nullptr);
+    void SetCharacterMesh(ID3D11DeviceContext* context, Model* model, const Float4x4& world,
+                          const MeshStreamsView* streams = nullptr);
+
+    // Sets a static model that gets drawn once for each of the world matrices, with the
+    // instances culled per part. Passing no instances removes it.
+    void SetInstancedMesh(ID3D11DeviceContext* context, Model* model, const Float4x4* worlds,
+                          uint32 numInstances, const MeshStreamsView* streams = nullptr);
 
     void RenderDepthCPU(ID3D11DeviceContext* context, const Camera& camera, const Float4x4& world,
-                        const Float4x4& characterWorld, bool shadowRendering);
+                        const Float4x4& characterWorld, bool shadowRendering, float lodTexelSize = 0.0f);
     void RenderDepthGPU(ID3D11DeviceContext* context, const Camera& camera, const Float4x4& world,
                         const Float4x4& characterWorld, bool shadowRendering);
 
@@ -95,6 +119,11 @@ public:
     void ReduceDepth(ID3D11DeviceContext* context, ID3D11ShaderResourceView* depthTarget,
                      const Camera& camera);
 
+    void CreateShadowMask(uint32 width, uint32 height);
+
+    void RenderShadowMask(ID3D11DeviceContext* context, ID3D11ShaderResourceView* depthTarget,
+                          const Camera& camera);
+
     DepthStencilBuffer& ShadowMap() { return shadowMap; }
     ID3D11ShaderResourceView* ShadowMapCascadeSlice(uint32 cascadeIdx)
     {
@@ -107,10 +136,25 @@ protected:
     void LoadShaders();
     void CreateShadowMaps();
     void ConvertToVSM(ID3D11DeviceContext* context, uint32 cascadeIdx,
-                      Float3 cascadeScale, Float3 cascade0Scale);
+                      Float3 cascadeScale, Float3 cascade0Scale,
+                      const D3D11_RECT* dirtyRect = nullptr);
+    void BuildMinMaxPyramid(ID3D11DeviceContext* context, uint32 cascadeIdx);
 
     void SetupRenderDepthState(ID3D11DeviceContext* context, bool shadowRendering);
 
+    void RenderSceneDepthCPU(ID3D11DeviceContext* context, const Camera& camera, const Float4x4& world,
+                             bool shadowRendering, float lodTexelSize = 0.0f);
+    void RenderCharacterDepthCPU(ID3D11DeviceContext* context, const Camera& camera,
+                                 const Float4x4& characterWorld, bool shadowRendering,
+                                 float lodTexelSize = 0.0f);
+
+    void InvalidateShadowCache();
+    bool RenderCachedShadowCascade(ID3D11DeviceContext* context, const OrthographicCamera& shadowCamera,
+                                   const Float4x4& world, const Float4x4& characterWorld,
+                                   uint32 cascadeIdx, float texelSize, D3D11_RECT& dirtyRect);
+
+    void RenderCharacterShadowMap(ID3D11DeviceContext* context, const Float4x4& characterWorld);
+
     void RenderDepthGPU(ID3D11DeviceContext* context, const Float4x4& world,
                         const Float4x4& characterWorld, bool shadowRendering,
                         ID3D11Buffer* viewProj, uint32 viewProjOffset,
@@ -120,10 +164,16 @@ protected:
                             const Float4x4& world, ID3D11Buffer* viewProj, uint32 viewProjOffset,
                             ID3D11Buffer* frustumPlanes, uint32 planeOffset);
     void RenderModelDepthCPU(ID3D11DeviceContext* context, const Camera& camera, const Float4x4& world,
-                            MeshData& meshData);
+                            MeshData& meshData, bool shadowRendering, float lodTexelSize);
+    Float4x4 SetDepthPositionStream(ID3D11DeviceContext* context, const MeshData& meshData,
+                                    bool shadowRendering);
+    void RenderInstancesDepth(ID3D11DeviceContext* context, const MeshData& meshData,
+                              bool shadowRendering, float lodTexelSize);
 
     void RenderModel(ID3D11DeviceContext* context, const Camera& camera, const Float4x4& world,
-                    MeshData& meshData);
+                    MeshData& meshData, bool depthOnly = false);
+
+    void SetMeshPSConstants(ID3D11DeviceContext* context, const Camera& camera);
 
     ID3D11DevicePtr device;
 
@@ -134,6 +184,7 @@ protected:
 
     MeshData scene;
     MeshData character;
+    MeshData instanced;
 
     ID3D11ShaderResourceViewPtr defaultTexture;
 
@@ -142,15 +193,52 @@ protected:
     RenderTarget2D tempVSM;
     ID3D11ShaderResourceViewPtr cascadeSlices[NumCascades];
 
+    // Min/max depth pyramid for PCSS, with views for each level of each cascade
+    RenderTarget2D shadowMinMaxMap;
+    std::vector<ID3D11RenderTargetViewPtr> minMaxLevelRTVs;
+    std::vector<ID3D11ShaderResourceViewPtr> minMaxLevelSRVs;
+
     ID3D11ShaderResourceViewPtr randomRotations;
 
+    // Static shadow caching: the scene gets rendered into a per-cascade depth cache that only
+    // gets updated when the cascade matrix changes, and the character is drawn on top of a copy
+    // of it every frame. The character's footprint from the last frame is kept so that the
+    // moment conversion can be limited to the texels that it touched.
+    DepthStencilBuffer staticShadowCache;
+    RenderTarget2D rawVSM;
+    ID3D11ShaderResourceViewPtr rawVSMArraySRV;
+    Float4x4 cachedCascadeMats[NumCascades];
+    bool cascadeCacheValid[NumCascades];
+    D3D11_RECT prevCharacterRects[NumCascades];
+    float characterBoundingRadius;
+
+    // Dedicated shadow map for the character, using an orthographic projection that's fitted to
+    // its bounding spheres instead of sharing texels with the rest of the scene in the cascades.
+    // The spheres are stored relative to the character's world matrix so that they can follow it.
+    DepthStencilBuffer characterShadowMap;
+    std::vector<Sphere> characterLocalSpheres;
+
+    // Screen-space shadow mask, which gets evaluated from the depth buffer before the main pass
+    // so that the forward pass only needs to read it. Visibility is in rgb, view depth in alpha.
+    // With temporal accumulation the last frame's mask gets swapped into the history target.
+    RenderTarget2D shadowMask;
+    RenderTarget2D shadowMaskHistory;
+    bool shadowMaskHistoryValid;
+    Float4x4 prevViewProjection;
+    uint64 shadowMaskFrame;
+    uint32 screenWidth;
+    uint32 screenHeight;
+
     ID3D11RasterizerStatePtr shadowRSState;
     ID3D11SamplerStatePtr evsmSamplers[uint64(ShadowAnisotropy::NumValues)];
 
-    VertexShaderPtr meshVS;
+    VertexShaderPtr meshVS[uint64(VertexFormat::NumValues)];
+    VertexShaderPtr meshInstancedVS[uint64(VertexFormat::NumValues)];
     PixelShaderPtr meshPS;
+    PixelShaderPtr shadowMaskPS;
 
     VertexShaderPtr meshDepthVS;
+    VertexShaderPtr meshDepthInstancedVS;
 
     VertexShaderPtr fullScreenVS;
     PixelShaderPtr vsmConvertPS[AppSettings::NumFilterableShadowModes][uint64(ShadowMSAA::NumValues)];
@@ -159,6 +247,9 @@ protected:
     PixelShaderPtr vsmBlurGPUH;
     PixelShaderPtr vsmBlurGPUV;
 
+    PixelShaderPtr minMaxInitialPS;
+    PixelShaderPtr minMaxPS;
+
     PixelShaderPtr depthReductionInitialPS;
     PixelShaderPtr depthReductionPS;
     ComputeShaderPtr depthReductionInitialCS;
@@ -173,7 +264,10 @@ protected:
     ComputeShaderPtr cullDrawCalls;
     ComputeShaderPtr batchDrawCalls;
     RWBuffer drawArgsBuffer;
-    ID3D11InputLayoutPtr depthGPUInputLayout;
+    ID3D11InputLayoutPtr depthInputLayout;
+    ID3D11InputLayoutPtr depthQuantizedInputLayout;
+    ID3D11InputLayoutPtr depthInstancedInputLayout;
+    ID3D11InputLayoutPtr depthQuantizedInstancedInputLayout;
     RWBuffer batchDispatchArgs;
 
     ComputeShaderPtr setupCascades;
@@ -200,6 +294,8 @@ protected:
     {
         Float4x4 World;
         Float4x4 ViewProjection;
+        Float4Align Float3 PositionScale;
+        Float4Align Float3 PositionBias;
     };
 
     struct MeshPSConstants
@@ -211,6 +307,23 @@ protected:
 
         Float4Align Float4 CascadeOffsets[NumCascades];
         Float4Align Float4 CascadeScales[NumCascades];
+
+        Float4Align Float4x4 CharacterShadowMatrix;
+
+        // Only used with the perspective warp, since the warped cascades can't be expressed as a
+        // scale and offset from the global shadow matrix
+        Float4Align Float4x4 CascadeMatrices[NumCascades];
+
+        // Rotation added to the random sample patterns every frame for temporal accumulation
+        Float4Align float SampleRotationOffset;
+    };
+
+    struct ShadowMaskConstants
+    {
+        Float4x4 InvViewProjection;
+        Float4x4 PrevViewProjection;
+        Float2 ProjectionParams;
+        float HistoryBlend;
     };
 
     struct VSMConstants
@@ -241,6 +354,7 @@ protected:
         Float3 CameraRight;
         float CameraNearClip;
         float CameraFarClip;
+        Float3 CameraForward;
     };
 
     struct FrustumConstants
@@ -258,6 +372,7 @@ protected:
     ConstantBuffer<DepthOnlyConstants> depthOnlyConstants;
     ConstantBuffer<MeshVSConstants> meshVSConstants;
     ConstantBuffer<MeshPSConstants> meshPSConstants;
+    ConstantBuffer<ShadowMaskConstants> shadowMaskConstants;
     ConstantBuffer<VSMConstants> vsmConstants;
     ConstantBuffer<ReductionConstants> reductionConstants;
     ConstantBuffer<GPUBatchConstants> gpuBatchConstants;
@@ -0,0 +1,375 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include <queue>
+#include <unordered_map>
+
+#include "MeshSimplifier.h"
+
+#include "SampleFramework11/Assert.h"
+#include "SampleFramework11/Utility.h"
+
+// Open edges get a plane perpendicular to their triangle, so that the silhouette of the
+// part doesn't shrink. This scales the weight of those planes relative to the triangle planes.
+static const double BorderPlaneWeight = 10.0;
+
+// Collapses that would turn a triangle by more than ~80 degrees are rejected
+static const double MinNormalCosine = 0.2;
+
+// Symmetric 4x4 matrix for the sum of squared distances to a set of planes, along with the sum
+// of the weights of those planes
+struct Quadric
+{
+    double A00, A01, A02, A03;
+    double A11, A12, A13;
+    double A22, A23;
+    double A33;
+    double Weight;
+
+    Quadric() : A00(0), A01(0), A02(0), A03(0), A11(0), A12(0), A13(0), A22(0), A23(0), A33(0), Weight(0) {}
+
+    // Adds the plane dot(n, p) + d = 0, where n is normalized
+    void AddPlane(double nx, double ny, double nz, double d, double weight)
+    {
+        A00 += weight * nx * nx;
+        A01 += weight * nx * ny;
+        A02 += weight * nx * nz;
+        A03 += weight * nx * d;
+        A11 += weight * ny * ny;
+        A12 += weight * ny * nz;
+        A13 += weight * ny * d;
+        A22 += weight * nz * nz;
+        A23 += weight * nz * d;
+        A33 += weight * d * d;
+        Weight += weight;
+    }
+
+    void Add(const Quadric& q)
+    {
+        A00 += q.A00; A01 += q.A01; A02 += q.A02; A03 += q.A03;
+        A11 += q.A11; A12 += q.A12; A13 += q.A13;
+        A22 += q.A22; A23 += q.A23;
+        A33 += q.A33;
+        Weight += q.Weight;
+    }
+
+    // Weighted average of the squared distance from p to the planes
+    double Evaluate(const Float3& p) const
+    {
+        const double x = p.x;
+        const double y = p.y;
+        const double z = p.z;
+        const double error = x * x * A00 + y * y * A11 + z * z * A22 + A33
+                           + 2.0 * (x * y * A01 + x * z * A02 + y * z * A12 + x * A03 + y * A13 + z * A23);
+        return Weight > 0.0 ? std::max(error, 0.0) / Weight : 0.0;
+    }
+};
+
+// A candidate edge collapse, which moves From onto To. The versions are the ones that the
+// vertices had when the cost was computed, so that stale entries can be detected when they come
+// out of the heap.
+struct EdgeCollapse
+{
+    double Cost;
+    uint32 From;
+    uint32 To;
+    uint32 FromVersion;
+    uint32 ToVersion;
+
+    bool operator>(const EdgeCollapse& other) const { return Cost > other.Cost; }
+};
+
+typedef std::priority_queue<EdgeCollapse, std::vector<EdgeCollapse>, std::greater<EdgeCollapse>> CollapseHeap;
+
+static uint64 EdgeKey(uint32 a, uint32 b)
+{
+    return a < b ? (uint64(a) << 32) | b : (uint64(b) << 32) | a;
+}
+
+// Unnormalized normal of a triangle, with a length of twice its area
+static Float3 TriangleNormal(const Float3& p0, const Float3& p1, const Float3& p2)
+{
+    return Float3::Cross(p1 - p0, p2 - p0);
+}
+
+// Picks the cheaper direction for collapsing the edge between a and b
+static EdgeCollapse ComputeCollapse(uint32 a, uint32 b, const std::vector<Float3>& positions,
+                                    const std::vector<Quadric>& quadrics, const std::vector<uint32>& versions)
+{
+    Quadric q = quadrics[a];
+    q.Add(quadrics[b]);
+
+    const double costAB = q.Evaluate(positions[b]);
+    const double costBA = q.Evaluate(positions[a]);
+
+    EdgeCollapse collapse;
+    collapse.Cost = std::min(costAB, costBA);
+    collapse.From = costAB <= costBA ? a : b;
+    collapse.To = costAB <= costBA ? b : a;
+    collapse.FromVersion = versions[collapse.From];
+    collapse.ToVersion = versions[collapse.To];
+    return collapse;
+}
+
+float SimplifyMesh(const Float3* positions, const uint32* indices, uint32 numIndices,
+                   uint32 targetIndices, float maxError, std::vector<uint32>& output)
+{
+    output.clear();
+
+    // Find the vertices that are referenced, and weld the ones with the same position so that
+    // splits in the normals or UVs don't turn into cracks
+    std::vector<uint32> vertices(indices, indices + numIndices);
+    std::sort(vertices.begin(), vertices.end());
+    vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+
+    std::vector<uint32> sorted(vertices.size());
+    for(uint32 i = 0; i < sorted.size(); ++i)
+        sorted[i] = i;
+
+    std::sort(sorted.begin(), sorted.end(), [&](uint32 a, uint32 b)
+    {
+        const Float3& pa = positions[vertices[a]];
+        const Float3& pb = positions[vertices[b]];
+        if(pa.x != pb.x)
+            return pa.x < pb.x;
+        if(pa.y != pb.y)
+            return pa.y < pb.y;
+        return pa.z < pb.z;
+    });
+
+    std::vector<uint32> welded(vertices.size());
+    std::vector<uint32> sourceVertices;
+    std::vector<Float3> weldedPositions;
+    for(uint32 i = 0; i < sorted.size(); ++i)
+    {
+        const Float3& p = positions[vertices[sorted[i]]];
+        if(i == 0 || memcmp(&p, &weldedPositions.back(), sizeof(Float3)) != 0)
+        {
+            sourceVertices.push_back(vertices[sorted[i]]);
+            weldedPositions.push_back(p);
+        }
+
+        welded[sorted[i]] = uint32(weldedPositions.size() - 1);
+    }
+
+    const uint32 numVertices = uint32(weldedPositions.size());
+
+    // Remap the triangles, and throw out the ones that became degenerate
+    std::vector<uint32> tris;
+    tris.reserve(numIndices);
+    for(uint32 i = 0; i + 2 < numIndices; i += 3)
+    {
+        uint32 tri[3];
+        for(uint32 j = 0; j < 3; ++j)
+        {
+            const uint64 vtxIdx = std::lower_bound(vertices.begin(), vertices.end(), indices[i + j]) - vertices.begin();
+            tri[j] = welded[vtxIdx];
+        }
+
+        if(tri[0] != tri[1] && tri[1] != tri[2] && tri[0] != tri[2])
+            tris.insert(tris.end(), tri, tri + 3);
+    }
+
+    const uint32 numTris = uint32(tris.size() / 3);
+
+    // Count how many triangles use each edge, so that the open ones can be found
+    std::unordered_map<uint64, uint32> edgeCounts;
+    edgeCounts.reserve(numTris * 3);
+    for(uint32 triIdx = 0; triIdx < numTris; ++triIdx)
+        for(uint32 j = 0; j < 3; ++j)
+            ++edgeCounts[EdgeKey(tris[triIdx * 3 + j], tris[triIdx * 3 + (j + 1) % 3])];
+
+    // Accumulate the area-weighted plane of each triangle into its vertices
+    std::vector<Quadric> quadrics(numVertices);
+    std::vector<std::vector<uint32>> vertexTris(numVertices);
+    for(uint32 triIdx = 0; triIdx < numTris; ++triIdx)
+    {
+        const uint32* tri = &tris[triIdx * 3];
+        const Float3& p0 = weldedPositions[tri[0]];
+        const Float3& p1 = weldedPositions[tri[1]];
+        const Float3& p2 = weldedPositions[tri[2]];
+
+        Float3 normal = TriangleNormal(p0, p1, p2);
+        const float length = Float3::Length(normal);
+        if(length > 0.0f)
+        {
+            normal /= length;
+            const double d = -Float3::Dot(normal, p0);
+            for(uint32 j = 0; j < 3; ++j)
+                quadrics[tri[j]].AddPlane(normal.x, normal.y, normal.z, d, length * 0.5);
+
+            for(uint32 j = 0; j < 3; ++j)
+            {
+                const uint32 v0 = tri[j];
+                const uint32 v1 = tri[(j + 1) % 3];
+                if(edgeCounts[EdgeKey(v0, v1)] != 1)
+                    continue;
+
+                const Float3 edge = weldedPositions[v1] - weldedPositions[v0];
+                const float edgeLength = Float3::Length(edge);
+                if(edgeLength == 0.0f)
+                    continue;
+
+                const Float3 borderNormal = Float3::Normalize(Float3::Cross(edge, normal));
+                const double borderD = -Float3::Dot(borderNormal, weldedPositions[v0]);
+                const double weight = BorderPlaneWeight * edgeLength * edgeLength;
+                quadrics[v0].AddPlane(borderNormal.x, borderNormal.y, borderNormal.z, borderD, weight);
+                quadrics[v1].AddPlane(borderNormal.x, borderNormal.y, borderNormal.z, borderD, weight);
+            }
+        }
+
+        for(uint32 j = 0; j < 3; ++j)
+            vertexTris[tri[j]].push_back(triIdx);
+    }
+
+    std::vector<uint32> versions(numVertices, 0);
+    std::vector<bool> vertexAlive(numVertices, true);
+    std::vector<bool> triAlive(numTris, true);
+
+    CollapseHeap heap;
+    for(auto edge = edgeCounts.begin(); edge != edgeCounts.end(); ++edge)
+        heap.push(ComputeCollapse(uint32(edge->first >> 32), uint32(edge->first & 0xFFFFFFFF), weldedPositions,
+                                  quadrics, versions));
+
+    const double maxCost = double(maxError) * maxError;
+    double collapsedCost = 0.0;
+    uint32 numAliveTris = numTris;
+    std::vector<uint32> neighbors;
+    while(numAliveTris * 3 > targetIndices && heap.empty() == false)
+    {
+        const EdgeCollapse collapse = heap.top();
+        heap.pop();
+
+        const uint32 from = collapse.From;
+        const uint32 to = collapse.To;
+        if(vertexAlive[from] == false || vertexAlive[to] == false)
+            continue;
+
+        if(collapse.FromVersion != versions[from] || collapse.ToVersion != versions[to])
+        {
+            // One of the quadrics changed since this was queued, so re-queue it with the new cost
+            // as long as the vertices are still connected
+            bool connected = false;
+            for(uint32 triIdx : vertexTris[from])
+            {
+                const uint32* tri = &tris[triIdx * 3];
+                connected |= triAlive[triIdx] && (tri[0] == to || tri[1] == to || tri[2] == to);
+            }
+
+            if(connected)
+                heap.push(ComputeCollapse(from, to, weldedPositions, quadrics, versions));
+            continue;
+        }
+
+        if(collapse.Cost > maxCost)
+            break;
+
+        // Reject the collapse if it would flip any of the triangles that are left over
+        bool flips = false;
+        for(uint32 triIdx : vertexTris[from])
+        {
+            const uint32* tri = &tris[triIdx * 3];
+            if(triAlive[triIdx] == false || tri[0] == to || tri[1] == to || tri[2] == to)
+                continue;
+
+            Float3 p[3] = { weldedPositions[tri[0]], weldedPositions[tri[1]], weldedPositions[tri[2]] };
+            const Float3 oldNormal = TriangleNormal(p[0], p[1], p[2]);
+            for(uint32 j = 0; j < 3; ++j)
+                if(tri[j] == from)
+                    p[j] = weldedPositions[to];
+            const Float3 newNormal = TriangleNormal(p[0], p[1], p[2]);
+
+            const double lengths = double(Float3::Length(oldNormal)) * Float3::Length(newNormal);
+            if(Float3::Dot(oldNormal, newNormal) <= MinNormalCosine * lengths)
+            {
+                flips = true;
+                break;
+            }
+        }
+
+        if(flips)
+            continue;
+
+        // Move the triangles over to the remaining vertex, and kill the ones that used the edge
+        for(uint32 triIdx : vertexTris[from])
+        {
+            if(triAlive[triIdx] == false)
+                continue;
+
+            uint32* tri = &tris[triIdx * 3];
+            if(tri[0] == to || tri[1] == to || tri[2] == to)
+            {
+                triAlive[triIdx] = false;
+                --numAliveTris;
+                continue;
+            }
+
+            for(uint32 j = 0; j < 3; ++j)
+                if(tri[j] == from)
+                    tri[j] = to;
+            vertexTris[to].push_back(triIdx);
+        }
+
+        vertexAlive[from] = false;
+        vertexTris[from].clear();
+        quadrics[to].Add(quadrics[from]);
+        ++versions[to];
+        collapsedCost = std::max(collapsedCost, collapse.Cost);
+
+        // Drop the dead triangles from the remaining vertex, and queue up its edges again
+        std::vector<uint32>& toTris = vertexTris[to];
+        toTris.erase(std::remove_if(toTris.begin(), toTris.end(), [&](uint32 triIdx)
+        {
+            return triAlive[triIdx] == false;
+        }), toTris.end());
+
+        neighbors.clear();
+        for(uint32 triIdx : toTris)
+            for(uint32 j = 0; j < 3; ++j)
+                if(tris[triIdx * 3 + j] != to)
+                    neighbors.push_back(tris[triIdx * 3 + j]);
+        std::sort(neighbors.begin(), neighbors.end());
+        neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+
+        for(uint32 neighbor : neighbors)
+            heap.push(ComputeCollapse(to, neighbor, weldedPositions, quadrics, versions));
+    }
+
+    output.reserve(numAliveTris * 3);
+    for(uint32 triIdx = 0; triIdx < numTris; ++triIdx)
+        if(triAlive[triIdx])
+            for(uint32 j = 0; j < 3; ++j)
+                output.push_back(sourceVertices[tris[triIdx * 3 + j]]);
+
+    return float(std::sqrt(collapsedCost));
+}
+
+std::string PartLODReport(const char* name, const MeshPartLOD* lods, uint32 numParts, float worldScale)
+{
+    std::string report = MakeString("Shadow caster LODs for %s (%u parts):\n", name, numParts);
+
+    for(uint32 lodIdx = 0; lodIdx < NumPartLODs; ++lodIdx)
+    {
+        uint64 numTris = 0;
+        float maxError = 0.0f;
+        for(uint32 partIdx = 0; partIdx < numParts; ++partIdx)
+        {
+            const MeshPartLOD& lod = lods[partIdx * NumPartLODs + lodIdx];
+            numTris += lod.NumIndices / 3;
+            maxError = std::max(maxError, lod.Error);
+        }
+
+        report += MakeString("  LOD %u: %9llu triangles, max error %.4f\n", lodIdx, numTris, maxError * worldScale);
+    }
+
+    return report;
+}
@@ -0,0 +1,54 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+#include "SampleFramework11/Math.h"
+
+using namespace SampleFramework11;
+
+// Import-time simplification of the position streams, used for building a chain of levels of
+// detail for each MeshPart. The distant cascades cover a lot of the scene with very few texels,
+// so they can get away with rendering a fraction of the triangles.
+
+// Number of levels of detail for each MeshPart, including the original triangles
+static const uint32 NumPartLODs = 4;
+
+// Fraction of the original triangles that each level of detail aims for
+static const float PartLODRatios[NumPartLODs] = { 1.0f, 0.5f, 0.2f, 0.08f };
+
+// Levels of detail aren't allowed to have an error larger than this fraction of the radius of the
+// part's bounding sphere
+static const float MaxPartLODError = 0.5f;
+
+// A range of the merged index stream for one level of detail of a MeshPart, along with the
+// object space distance between the simplified surface and the original one
+struct MeshPartLOD
+{
+    uint32 StartIndex;
+    uint32 NumIndices;
+    float Error;
+    uint32 Padding;
+};
+
+// Simplifies a triangle list by collapsing edges in order of their quadric error, as in "Surface
+// Simplification Using Quadric Error Metrics" by Garland and Heckbert. Vertices with the same
+// position get welded together first, and only positions are considered, so the result is only
+// suitable for depth rendering. Collapses stop once the triangle count reaches targetIndices / 3
+// or the next one would have an error above maxError. The output references the input vertices,
+// and the return value is the error of the simplified surface in the units of the positions
+// (the area-weighted RMS distance to the original planes, so the largest deviation can be
+// somewhat bigger).
+float SimplifyMesh(const Float3* positions, const uint32* indices, uint32 numIndices,
+                   uint32 targetIndices, float maxError, std::vector<uint32>& output);
+
+// Returns a report with the number of triangles at each level of detail, summed over all parts
+std::string PartLODReport(const char* name, const MeshPartLOD* lods, uint32 numParts, float worldScale);
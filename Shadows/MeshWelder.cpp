@@ -0,0 +1,437 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "MeshWelder.h"
+#include "MeshOptimizer.h"
+
+#include "SampleFramework11/Assert.h"
+#include "SampleFramework11/MurmurHash.h"
+#include "SampleFramework11/Utility.h"
+
+static const uint32 InvalidIndex = 0xFFFFFFFF;
+
+// Spacing of the grid that positions get quantized to when comparing parts. The positions are
+// relative to the first vertex of the part, so this needs to be coarser than the weld epsilon to
+// absorb the rounding from the subtraction.
+static const float DuplicatePartEpsilon = 1.0e-4f;
+
+// Number of components of a vertex element that gets quantized, or 0 if it gets compared bit for bit
+static uint32 NumFloatComponents(DXGI_FORMAT format)
+{
+    if(format == DXGI_FORMAT_R32_FLOAT)
+        return 1;
+    else if(format == DXGI_FORMAT_R32G32_FLOAT)
+        return 2;
+    else if(format == DXGI_FORMAT_R32G32B32_FLOAT)
+        return 3;
+    else if(format == DXGI_FORMAT_R32G32B32A32_FLOAT)
+        return 4;
+    return 0;
+}
+
+// Snaps a float to the closest multiple of epsilon, and returns the bits of the result. Values
+// that are too large for the grid to be finer than the float spacing get compared exactly, and
+// both zeros end up with the same bits.
+static uint32 QuantizeFloat(float value, float epsilon)
+{
+    if(epsilon > 0.0f)
+        value = float(std::floor(double(value) / epsilon + 0.5) * epsilon);
+
+    uint32 bits = 0;
+    if(value != 0.0f)
+        memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// Quantizes the float components of one vertex in place
+static void QuantizeVertex(uint8* vertex, const D3D11_INPUT_ELEMENT_DESC* elements, uint32 numElements,
+                           float epsilon)
+{
+    for(uint32 elemIdx = 0; elemIdx < numElements; ++elemIdx)
+    {
+        const uint32 numComponents = NumFloatComponents(elements[elemIdx].Format);
+        uint8* element = vertex + elements[elemIdx].AlignedByteOffset;
+        for(uint32 c = 0; c < numComponents; ++c)
+        {
+            float value = 0.0f;
+            memcpy(&value, element + c * sizeof(float), sizeof(float));
+            const uint32 q = QuantizeFloat(value, epsilon);
+            memcpy(element + c * sizeof(float), &q, sizeof(q));
+        }
+    }
+}
+
+static uint64 HashKey(const uint8* key, uint64 size)
+{
+    return GenerateHash(key, int(size)).A;
+}
+
+// Smallest power of two that leaves an open addressing table for numItems at most half full
+static uint64 HashTableSize(uint64 numItems)
+{
+    uint64 size = 16;
+    while(size < numItems * 2)
+        size *= 2;
+    return size;
+}
+
+// Looks for an item that equal() says matches in a table with linear probing, and inserts the
+// new item if there isn't one. Returns the item that's in the table.
+template<typename T> static uint32 FindOrInsert(std::vector<uint32>& table, uint64 hash, uint32 item, T equal)
+{
+    const uint64 mask = table.size() - 1;
+    uint64 slot = hash & mask;
+    while(table[slot] != InvalidIndex)
+    {
+        if(equal(table[slot]))
+            return table[slot];
+        slot = (slot + 1) & mask;
+    }
+
+    table[slot] = item;
+    return item;
+}
+
+uint32 WeldVertices(const uint8* vertices, uint32 numVertices, uint32 stride,
+                    const D3D11_INPUT_ELEMENT_DESC* elements, uint32 numElements,
+                    float epsilon, std::vector<uint32>& remap)
+{
+    Assert_(epsilon >= 0.0f);
+
+    std::vector<uint8> keys(vertices, vertices + uint64(numVertices) * stride);
+    std::vector<uint64> hashes(numVertices);
+    for(uint32 v = 0; v < numVertices; ++v)
+    {
+        uint8* key = &keys[uint64(v) * stride];
+        QuantizeVertex(key, elements, numElements, epsilon);
+        hashes[v] = HashKey(key, stride);
+    }
+
+    // The table holds the first vertex of every group, and remap holds the index of the group
+    std::vector<uint32> table(HashTableSize(numVertices), InvalidIndex);
+    remap.resize(numVertices);
+    uint32 numUnique = 0;
+    for(uint32 v = 0; v < numVertices; ++v)
+    {
+        const uint8* key = &keys[uint64(v) * stride];
+        const uint32 first = FindOrInsert(table, hashes[v], v, [&](uint32 other)
+        {
+            return hashes[other] == hashes[v] && memcmp(&keys[uint64(other) * stride], key, stride) == 0;
+        });
+
+        remap[v] = first == v ? numUnique++ : remap[first];
+    }
+
+    return numUnique;
+}
+
+// Returns the index of the first mesh with the same vertex layout
+static uint32 VertexLayoutIdx(const Model& model, uint32 meshIdx)
+{
+    const Mesh& mesh = model.Meshes()[meshIdx];
+    for(uint32 otherIdx = 0; otherIdx < meshIdx; ++otherIdx)
+    {
+        const Mesh& other = model.Meshes()[otherIdx];
+        if(other.VertexStride() != mesh.VertexStride() || other.NumInputElements() != mesh.NumInputElements())
+            continue;
+
+        bool match = true;
+        for(uint32 elemIdx = 0; elemIdx < mesh.NumInputElements() && match; ++elemIdx)
+        {
+            const D3D11_INPUT_ELEMENT_DESC& a = mesh.InputElements()[elemIdx];
+            const D3D11_INPUT_ELEMENT_DESC& b = other.InputElements()[elemIdx];
+            match = strcmp(a.SemanticName, b.SemanticName) == 0 && a.SemanticIndex == b.SemanticIndex &&
+                    a.Format == b.Format && a.AlignedByteOffset == b.AlignedByteOffset;
+        }
+
+        if(match)
+            return otherIdx;
+    }
+
+    return meshIdx;
+}
+
+// Finds the element for the positions, if they're stored as floats
+static const D3D11_INPUT_ELEMENT_DESC* FloatPositionElement(const Mesh& mesh)
+{
+    for(uint32 elemIdx = 0; elemIdx < mesh.NumInputElements(); ++elemIdx)
+    {
+        const D3D11_INPUT_ELEMENT_DESC& elem = mesh.InputElements()[elemIdx];
+        if(strcmp(elem.SemanticName, "POSITION") == 0 && elem.SemanticIndex == 0)
+            return elem.Format == DXGI_FORMAT_R32G32B32_FLOAT ? &elem : nullptr;
+    }
+
+    return nullptr;
+}
+
+// The geometry of a part in a form that doesn't depend on where its vertices are in the vertex
+// buffer or where it is in object space
+struct PartKey
+{
+    uint32 MeshIdx;
+    uint32 PartIdx;
+    Float3 Origin;
+    std::vector<uint8> Data;
+    uint64 Hash;
+};
+
+// Builds the key for a part: the vertex layout, the indices renumbered in the order that the
+// vertices are first referenced, and the quantized vertices in that order with the positions
+// relative to the first one
+static void BuildPartKey(const Model& model, uint32 meshIdx, uint32 partIdx, uint32 layoutIdx,
+                         const D3D11_INPUT_ELEMENT_DESC* posElem, float epsilon,
+                         std::vector<uint32>& localIndices, PartKey& key)
+{
+    const Mesh& mesh = model.Meshes()[meshIdx];
+    const MeshPart& part = mesh.MeshParts()[partIdx];
+    const uint32 stride = mesh.VertexStride();
+    const uint32 indexSize = mesh.IndexSize();
+
+    key.MeshIdx = meshIdx;
+    key.PartIdx = partIdx;
+    key.Origin = Float3(0.0f, 0.0f, 0.0f);
+
+    std::vector<uint32> vertices;
+    key.Data.resize(sizeof(uint32) * (part.IndexCount + 1));
+    memcpy(&key.Data[0], &layoutIdx, sizeof(uint32));
+    for(uint32 i = 0; i < part.IndexCount; ++i)
+    {
+        const uint32 index = GetIndex(mesh.Indices(), part.IndexStart + i, indexSize);
+        if(localIndices[index] == InvalidIndex)
+        {
+            localIndices[index] = uint32(vertices.size());
+            vertices.push_back(index);
+        }
+        memcpy(&key.Data[sizeof(uint32) * (i + 1)], &localIndices[index], sizeof(uint32));
+    }
+
+    if(posElem != nullptr && vertices.size() > 0)
+        memcpy(&key.Origin, mesh.Vertices() + uint64(vertices[0]) * stride + posElem->AlignedByteOffset,
+               sizeof(Float3));
+
+    const uint64 vertexStart = key.Data.size();
+    key.Data.resize(vertexStart + vertices.size() * stride);
+    for(uint64 i = 0; i < vertices.size(); ++i)
+    {
+        uint8* vertex = &key.Data[vertexStart + i * stride];
+        memcpy(vertex, mesh.Vertices() + uint64(vertices[i]) * stride, stride);
+        if(posElem != nullptr)
+        {
+            Float3 position;
+            memcpy(&position, vertex + posElem->AlignedByteOffset, sizeof(Float3));
+            position -= key.Origin;
+            memcpy(vertex + posElem->AlignedByteOffset, &position, sizeof(Float3));
+        }
+
+        QuantizeVertex(vertex, mesh.InputElements(), mesh.NumInputElements(), epsilon);
+        localIndices[vertices[i]] = InvalidIndex;
+    }
+
+    key.Hash = HashKey(key.Data.data(), key.Data.size());
+}
+
+// A MeshPart whose triangles and vertices are the same as those of an earlier part (the
+// prototype), apart from a translation
+struct DuplicatePart
+{
+    uint32 MeshIdx;
+    uint32 PartIdx;
+    uint32 PrototypeMeshIdx;
+    uint32 PrototypePartIdx;
+};
+
+// Finds every part whose geometry matches an earlier part in a mesh with the same vertex format.
+// The material isn't compared. Parts in meshes without 32-bit float positions only match other
+// parts of the same mesh that are in the same place.
+static void FindDuplicateParts(const Model& model, float epsilon, std::vector<DuplicatePart>& duplicates)
+{
+    duplicates.clear();
+
+    std::vector<PartKey> keys;
+    for(uint32 meshIdx = 0; meshIdx < model.Meshes().size(); ++meshIdx)
+    {
+        const Mesh& mesh = model.Meshes()[meshIdx];
+        const uint32 layoutIdx = VertexLayoutIdx(model, meshIdx);
+        const D3D11_INPUT_ELEMENT_DESC* posElem = FloatPositionElement(mesh);
+
+        std::vector<uint32> localIndices(mesh.NumVertices(), InvalidIndex);
+        for(uint32 partIdx = 0; partIdx < mesh.MeshParts().size(); ++partIdx)
+        {
+            if(mesh.MeshParts()[partIdx].IndexCount == 0)
+                continue;
+
+            keys.push_back(PartKey());
+            BuildPartKey(model, meshIdx, partIdx, layoutIdx, posElem, epsilon, localIndices, keys.back());
+
+            // Without float positions the offset isn't known, so only parts in the same place match
+            if(posElem == nullptr)
+                keys.back().Hash ^= uint64(meshIdx) << 32;
+        }
+    }
+
+    std::vector<uint32> table(HashTableSize(keys.size()), InvalidIndex);
+    for(uint32 keyIdx = 0; keyIdx < keys.size(); ++keyIdx)
+    {
+        const PartKey& key = keys[keyIdx];
+        const uint32 prototypeIdx = FindOrInsert(table, key.Hash, keyIdx, [&](uint32 other)
+        {
+            const PartKey& otherKey = keys[other];
+            if(otherKey.Hash != key.Hash || otherKey.Data != key.Data)
+                return false;
+            return FloatPositionElement(model.Meshes()[key.MeshIdx]) != nullptr || otherKey.MeshIdx == key.MeshIdx;
+        });
+
+        if(prototypeIdx == keyIdx)
+            continue;
+
+        const PartKey& prototype = keys[prototypeIdx];
+        DuplicatePart duplicate;
+        duplicate.MeshIdx = key.MeshIdx;
+        duplicate.PartIdx = key.PartIdx;
+        duplicate.PrototypeMeshIdx = prototype.MeshIdx;
+        duplicate.PrototypePartIdx = prototype.PartIdx;
+        duplicates.push_back(duplicate);
+    }
+}
+
+// Number of bytes of vertex and index data that a part uses
+static uint64 PartGeometrySize(const Mesh& mesh, const MeshPart& part, std::vector<bool>& used)
+{
+    uint64 numVertices = 0;
+    for(uint32 i = 0; i < part.IndexCount; ++i)
+    {
+        const uint32 index = GetIndex(mesh.Indices(), part.IndexStart + i, mesh.IndexSize());
+        if(used[index] == false)
+        {
+            used[index] = true;
+            ++numVertices;
+        }
+    }
+
+    for(uint32 i = 0; i < part.IndexCount; ++i)
+        used[GetIndex(mesh.Indices(), part.IndexStart + i, mesh.IndexSize())] = false;
+
+    return numVertices * mesh.VertexStride() + uint64(part.IndexCount) * mesh.IndexSize();
+}
+
+std::string WeldModelVertices(ID3D11Device* device, Model& model, float epsilon)
+{
+    std::string report = MakeString("Vertex welding (epsilon %g)\n", epsilon);
+    report += MakeString("%-24s %9s %9s %12s %12s\n", "Mesh", "Before", "After", "VB Before", "VB After");
+
+    std::vector<Mesh>& meshes = model.Meshes();
+    uint64 totalVerticesBefore = 0;
+    uint64 totalVerticesAfter = 0;
+    uint64 totalBytesBefore = 0;
+    uint64 totalBytesAfter = 0;
+
+    // The new meshes get built in place, since they can't be moved once they're initialized
+    std::vector<Mesh> newMeshes(meshes.size());
+    for(uint64 meshIdx = 0; meshIdx < meshes.size(); ++meshIdx)
+    {
+        const Mesh& mesh = meshes[meshIdx];
+        const uint32 numVertices = mesh.NumVertices();
+        const uint32 numIndices = mesh.NumIndices();
+        const uint32 stride = mesh.VertexStride();
+        const uint32 indexSize = mesh.IndexSize();
+
+        std::vector<uint32> remap;
+        const uint32 numWelded = WeldVertices(mesh.Vertices(), numVertices, stride, mesh.InputElements(),
+                                              mesh.NumInputElements(), epsilon, remap);
+
+        // The first vertex of each group is the one that's kept, so they stay in the same order
+        std::vector<uint8> vertices(uint64(numWelded) * stride);
+        uint32 numCopied = 0;
+        for(uint32 v = 0; v < numVertices; ++v)
+        {
+            if(remap[v] == numCopied)
+                memcpy(&vertices[uint64(numCopied++) * stride], mesh.Vertices() + uint64(v) * stride, stride);
+        }
+        Assert_(numCopied == numWelded);
+
+        std::vector<uint8> indexData(uint64(numIndices) * indexSize);
+        for(uint32 i = 0; i < numIndices; ++i)
+        {
+            const uint32 index = remap[GetIndex(mesh.Indices(), i, indexSize)];
+            if(indexSize == 2)
+                reinterpret_cast<uint16*>(indexData.data())[i] = uint16(index);
+            else
+                reinterpret_cast<uint32*>(indexData.data())[i] = index;
+        }
+
+        std::vector<MeshPart> parts = mesh.MeshParts();
+        for(uint64 partIdx = 0; partIdx < parts.size(); ++partIdx)
+        {
+            MeshPart& part = parts[partIdx];
+            uint32 minVertex = numWelded;
+            uint32 maxVertex = 0;
+            for(uint32 i = 0; i < part.IndexCount; ++i)
+            {
+                const uint32 index = GetIndex(indexData.data(), part.IndexStart + i, indexSize);
+                minVertex = std::min(minVertex, index);
+                maxVertex = std::max(maxVertex, index);
+            }
+            part.VertexStart = part.IndexCount > 0 ? minVertex : 0;
+            part.VertexCount = part.IndexCount > 0 ? maxVertex - minVertex + 1 : 0;
+        }
+
+        newMeshes[meshIdx].InitFromMesh(device, mesh, vertices.data(), numWelded, indexData.data(), numIndices,
+                                        mesh.IndexBufferType(), parts.data(), uint32(parts.size()), mesh.Name());
+
+        const uint64 bytesBefore = uint64(numVertices) * stride;
+        const uint64 bytesAfter = uint64(numWelded) * stride;
+        totalVerticesBefore += numVertices;
+        totalVerticesAfter += numWelded;
+        totalBytesBefore += bytesBefore;
+        totalBytesAfter += bytesAfter;
+
+        report += MakeString("%-24s %9u %9u %12llu %12llu\n", mesh.Name().c_str(), numVertices, numWelded,
+                             bytesBefore, bytesAfter);
+    }
+
+    meshes.swap(newMeshes);
+
+    report += MakeString("Total: %llu vertices -> %llu, vertex data %.2f KB -> %.2f KB (%.2f KB saved)\n",
+                         totalVerticesBefore, totalVerticesAfter, totalBytesBefore / 1024.0,
+                         totalBytesAfter / 1024.0, (totalBytesBefore - totalBytesAfter) / 1024.0);
+
+    std::vector<DuplicatePart> duplicates;
+    FindDuplicateParts(model, DuplicatePartEpsilon, duplicates);
+
+    uint64 numParts = 0;
+    uint64 maxVertices = 0;
+    for(uint64 meshIdx = 0; meshIdx < meshes.size(); ++meshIdx)
+    {
+        numParts += meshes[meshIdx].MeshParts().size();
+        maxVertices = std::max<uint64>(maxVertices, meshes[meshIdx].NumVertices());
+    }
+
+    std::vector<bool> used(maxVertices, false);
+    std::vector<uint64> prototypes(duplicates.size());
+    uint64 duplicateBytes = 0;
+    for(uint64 i = 0; i < duplicates.size(); ++i)
+    {
+        const DuplicatePart& duplicate = duplicates[i];
+        const Mesh& mesh = meshes[duplicate.MeshIdx];
+        duplicateBytes += PartGeometrySize(mesh, mesh.MeshParts()[duplicate.PartIdx], used);
+        prototypes[i] = (uint64(duplicate.PrototypeMeshIdx) << 32) | duplicate.PrototypePartIdx;
+    }
+
+    std::sort(prototypes.begin(), prototypes.end());
+    const uint64 numPrototypes = std::unique(prototypes.begin(), prototypes.end()) - prototypes.begin();
+
+    report += MakeString("Duplicate parts: %llu of %llu parts repeat %llu others, %.2f KB could be stored once "
+                         "and instanced\n", uint64(duplicates.size()), numParts, numPrototypes,
+                         duplicateBytes / 1024.0);
+
+    return report;
+}
@@ -0,0 +1,39 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+#include "SampleFramework11/Math.h"
+#include "SampleFramework11/Model.h"
+
+using namespace SampleFramework11;
+
+// Import-time removal of duplicated geometry. The exporters write out a separate copy of a vertex
+// for every face that uses it, and the scenes repeat the same props over and over.
+
+// Float attributes are quantized to a grid with this spacing before vertices get compared, so
+// anything closer than this gets welded. Values that are close but on different sides of a grid
+// line stay separate, which only costs a few extra vertices.
+static const float VertexWeldEpsilon = 1.0e-5f;
+
+// Builds a table that maps each vertex to the first vertex with the same attributes, and returns
+// the number of unique vertices. Attributes with a 32-bit float format are compared on a grid with
+// a spacing of epsilon (or exactly if it's 0), and everything else is compared bit for bit.
+uint32 WeldVertices(const uint8* vertices, uint32 numVertices, uint32 stride,
+                    const D3D11_INPUT_ELEMENT_DESC* elements, uint32 numElements,
+                    float epsilon, std::vector<uint32>& remap);
+
+// Welds the vertices of every mesh, re-creates the meshes, and returns a report with the vertex
+// counts and sizes before and after, as well as how much data the repeated parts could save if
+// they were stored once and instanced. Nothing draws them that way yet, so they keep their own
+// geometry. This needs to run before the other import steps, since it changes the number of
+// vertices.
+std::string WeldModelVertices(ID3D11Device* device, Model& model, float epsilon = VertexWeldEpsilon);
@@ -0,0 +1,92 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+// Moment conversion code that's shared between HLSL and C++. Everything in here sticks to
+// scalar math so that it compiles as both, and all of the bases are affine so that the
+// converted moments can still be filtered, blurred and mip-mapped.
+
+#if _WINDOWS
+
+#pragma once
+
+#include "SharedConstants.h"
+
+#endif
+
+// Optimized basis for storing 4 power moments in 16-bit UNORM, from "Moment Shadow Mapping"
+// by Peters and Klein. Both matrices are row-major, and are applied as row vector * matrix.
+static const float MSMBasisOffset = 0.035955884801f;
+
+static const float MSMBasis[16] =
+{
+    -2.07224649f,    13.7948857237f,  0.105877704f,   9.7924062118f,
+     32.23703778f,  -59.4683975703f, -1.9077466311f, -33.7652110555f,
+    -68.571074599f,  82.0359750338f,  9.3496555107f,  47.9456096605f,
+     39.3703274134f,-35.364903257f,  -6.6543490743f, -23.9728048165f,
+};
+
+static const float MSMInvBasis[16] =
+{
+    0.2227744146f, 0.1549679261f, 0.1451988946f, 0.163127443f,
+    0.0771972861f, 0.1394629426f, 0.2120202157f, 0.2591432266f,
+    0.7926986636f, 0.7963415838f, 0.7258694464f, 0.6539092497f,
+    0.0319417555f,-0.1722823173f,-0.2758014811f,-0.3376131734f,
+};
+
+// Returns the 4 power moments of a depth value
+inline float4 GetMSMMoments(float depth)
+{
+    float square = depth * depth;
+    return float4(depth, square, square * depth, square * square);
+}
+
+// Converts a depth value to the optimized 4-moment basis, suitable for 16-bit UNORM storage
+inline float4 GetOptimizedMoments(float depth)
+{
+    float4 m = GetMSMMoments(depth);
+
+    float4 optimized;
+    optimized.x = m.x * MSMBasis[0] + m.y * MSMBasis[4] + m.z * MSMBasis[8] + m.w * MSMBasis[12];
+    optimized.y = m.x * MSMBasis[1] + m.y * MSMBasis[5] + m.z * MSMBasis[9] + m.w * MSMBasis[13];
+    optimized.z = m.x * MSMBasis[2] + m.y * MSMBasis[6] + m.z * MSMBasis[10] + m.w * MSMBasis[14];
+    optimized.w = m.x * MSMBasis[3] + m.y * MSMBasis[7] + m.z * MSMBasis[11] + m.w * MSMBasis[15];
+    optimized.x += MSMBasisOffset;
+
+    return optimized;
+}
+
+// Converts (filtered) moments in the optimized basis back to power moments
+inline float4 ConvertOptimizedMoments(float4 optimizedMoments)
+{
+    float4 o = optimizedMoments;
+    o.x -= MSMBasisOffset;
+
+    float4 m;
+    m.x = o.x * MSMInvBasis[0] + o.y * MSMInvBasis[4] + o.z * MSMInvBasis[8] + o.w * MSMInvBasis[12];
+    m.y = o.x * MSMInvBasis[1] + o.y * MSMInvBasis[5] + o.z * MSMInvBasis[9] + o.w * MSMInvBasis[13];
+    m.z = o.x * MSMInvBasis[2] + o.y * MSMInvBasis[6] + o.z * MSMInvBasis[10] + o.w * MSMInvBasis[14];
+    m.w = o.x * MSMInvBasis[3] + o.y * MSMInvBasis[7] + o.z * MSMInvBasis[11] + o.w * MSMInvBasis[15];
+
+    return m;
+}
+
+// Optimized basis for storing the 2 VSM moments in 16-bit UNORM. Rather than storing depth^2
+// directly we store 4 * (depth - depth^2), which covers the full [0, 1] range and gives the
+// variance term (which is what the Chebyshev bound cares about) 4x the precision.
+inline float2 GetOptimizedVSMMoments(float depth)
+{
+    return float2(depth, 4.0f * (depth - depth * depth));
+}
+
+// Converts (filtered) moments in the optimized basis back to (depth, depth^2)
+inline float2 ConvertOptimizedVSMMoments(float2 optimizedMoments)
+{
+    return float2(optimizedMoments.x, optimizedMoments.x - 0.25f * optimizedMoments.y);
+}
@@ -0,0 +1,457 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include <intrin.h>
+#include <immintrin.h>
+#include <random>
+
+#include "MomentQuantization.h"
+#include "ShadowFilters.h"
+#include "MomentEncoding.h"
+
+#include "SampleFramework11/Utility.h"
+
+static const char* FilterableModeNames[] =
+{
+    "VSM",
+    "EVSM 2 Component",
+    "EVSM 4 Component",
+    "MSM Hamburger",
+    "MSM Hausdorff",
+    "ESM",
+};
+
+static const char* SMFormatNames[] =
+{
+    "16-bit",
+    "32-bit",
+    "16-bit (Optimized Basis)",
+    "16-bit (Raw Moments)",
+};
+
+// MSM has always used the optimized basis for 16-bit storage, and VSM only uses it for the
+// optimized format. The raw format stores power moments as they are, for comparison. EVSM and
+// ESM are stored as fp16, which doesn't benefit from an affine basis.
+static bool UseOptimizedBasis(ShadowMode shadowMode, SMFormat smFormat)
+{
+    if(AppSettings::UseMSM(uint32(shadowMode)))
+        return smFormat == SMFormat::SM16Bit || smFormat == SMFormat::SM16BitOptimized;
+    else if(AppSettings::UseEVSM(uint32(shadowMode)) || shadowMode == ShadowMode::ESM)
+        return false;
+    return smFormat == SMFormat::SM16BitOptimized;
+}
+
+DXGI_FORMAT MomentMapFormat(ShadowMode shadowMode, SMFormat smFormat)
+{
+    Assert_(AppSettings::UseFilterableShadows(uint32(shadowMode)));
+
+    const bool use16Bit = smFormat != SMFormat::SM32Bit;
+    if(shadowMode == ShadowMode::EVSM4)
+        return use16Bit ? DXGI_FORMAT_R16G16B16A16_FLOAT : DXGI_FORMAT_R32G32B32A32_FLOAT;
+    else if(shadowMode == ShadowMode::EVSM2)
+        return use16Bit ? DXGI_FORMAT_R16G16_FLOAT : DXGI_FORMAT_R32G32_FLOAT;
+    else if(shadowMode == ShadowMode::ESM)
+        return use16Bit ? DXGI_FORMAT_R16_FLOAT : DXGI_FORMAT_R32_FLOAT;
+    else if(AppSettings::UseMSM(uint32(shadowMode)))
+        return use16Bit ? DXGI_FORMAT_R16G16B16A16_UNORM : DXGI_FORMAT_R32G32B32A32_FLOAT;
+    else
+        return use16Bit ? DXGI_FORMAT_R16G16_UNORM : DXGI_FORMAT_R32G32_FLOAT;
+}
+
+uint32 NumMomentComponents(ShadowMode shadowMode)
+{
+    if(shadowMode == ShadowMode::EVSM4 || AppSettings::UseMSM(uint32(shadowMode)))
+        return 4;
+    else if(shadowMode == ShadowMode::ESM)
+        return 1;
+    return 2;
+}
+
+uint32 MomentMapTexelSize(ShadowMode shadowMode, SMFormat smFormat)
+{
+    const uint32 componentSize = smFormat == SMFormat::SM32Bit ? 4 : 2;
+    return NumMomentComponents(shadowMode) * componentSize;
+}
+
+uint64 MomentMapMemorySize(ShadowMode shadowMode, SMFormat smFormat, uint32 resolution, bool mipMaps)
+{
+    const uint64 texelSize = MomentMapTexelSize(shadowMode, smFormat);
+
+    uint64 sliceSize = 0;
+    uint32 mipSize = resolution;
+    do
+    {
+        sliceSize += uint64(mipSize) * mipSize * texelSize;
+        mipSize /= 2;
+    } while(mipMaps && mipSize > 0);
+
+    // The blur pass also needs a single temporary slice without mips
+    return sliceSize * NumCascades + uint64(resolution) * resolution * texelSize;
+}
+
+// F16C instructions are VEX-encoded, so the OS also needs to save the YMM state
+static bool CheckF16CSupport()
+{
+    int cpuInfo[4] = { 0 };
+    __cpuid(cpuInfo, 1);
+
+    const bool osxsave = (cpuInfo[2] & (1 << 27)) != 0;
+    const bool avx = (cpuInfo[2] & (1 << 28)) != 0;
+    const bool f16c = (cpuInfo[2] & (1 << 29)) != 0;
+    if(osxsave == false || avx == false || f16c == false)
+        return false;
+
+    return (_xgetbv(0) & 0x6) == 0x6;
+}
+
+bool CPUSupportsF16C()
+{
+    static const bool supported = CheckF16CSupport();
+    return supported;
+}
+
+void FloatToUNorm16(const float* src, uint16* dst, uint64 count)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(65535.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128i bias = _mm_set1_epi32(32768);
+    const __m128i flip = _mm_set1_epi16(short(0x8000));
+
+    // SSE2 only has a signed saturating pack, so we pack from [-32768, 32767] and flip the
+    // sign bit afterwards to get back to [0, 65535]
+    uint64 i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), zero), one);
+        __m128 b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4), zero), one);
+
+        __m128i ia = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(a, scale), half));
+        __m128i ib = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(b, scale), half));
+
+        __m128i packed = _mm_packs_epi32(_mm_sub_epi32(ia, bias), _mm_sub_epi32(ib, bias));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(packed, flip));
+    }
+
+    for(; i < count; ++i)
+        dst[i] = uint16(Saturate(src[i]) * 65535.0f + 0.5f);
+}
+
+void UNorm16ToFloat(const uint16* src, float* dst, uint64 count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scale = _mm_set1_ps(1.0f / 65535.0f);
+
+    uint64 i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+        __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(lo, scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(hi, scale));
+    }
+
+    for(; i < count; ++i)
+        dst[i] = src[i] * (1.0f / 65535.0f);
+}
+
+void FloatToHalf(const float* src, uint16* dst, uint64 count)
+{
+    uint64 i = 0;
+    if(CPUSupportsF16C())
+    {
+        for(; i + 4 <= count; i += 4)
+        {
+            __m128i h = _mm_cvtps_ph(_mm_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), h);
+        }
+    }
+
+    if(i < count)
+        PackedVector::XMConvertFloatToHalfStream(dst + i, sizeof(uint16), src + i, sizeof(float), size_t(count - i));
+}
+
+void HalfToFloat(const uint16* src, float* dst, uint64 count)
+{
+    uint64 i = 0;
+    if(CPUSupportsF16C())
+    {
+        for(; i + 4 <= count; i += 4)
+        {
+            __m128i h = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i));
+            _mm_storeu_ps(dst + i, _mm_cvtph_ps(h));
+        }
+    }
+
+    if(i < count)
+        PackedVector::XMConvertHalfToFloatStream(dst + i, sizeof(float), src + i, sizeof(uint16), size_t(count - i));
+}
+
+void ComputeMoments(const float* depths, uint64 numTexels, ShadowMode shadowMode, SMFormat smFormat,
+                    const FilterableShadowParams& params, float* moments)
+{
+    const uint32 numComponents = NumMomentComponents(shadowMode);
+    const bool optimizedBasis = UseOptimizedBasis(shadowMode, smFormat);
+
+    for(uint64 i = 0; i < numTexels; ++i)
+    {
+        const float depth = depths[i];
+        float* texel = moments + i * numComponents;
+
+        if(AppSettings::UseMSM(uint32(shadowMode)))
+        {
+            Float4 m = optimizedBasis ? GetOptimizedMoments(depth) : GetMSMMoments(depth);
+            texel[0] = m.x;
+            texel[1] = m.y;
+            texel[2] = m.z;
+            texel[3] = m.w;
+        }
+        else if(AppSettings::UseEVSM(uint32(shadowMode)))
+        {
+            Float2 warped = WarpDepth(depth, params.EVSMExponents);
+            if(shadowMode == ShadowMode::EVSM4)
+            {
+                texel[0] = warped.x;
+                texel[1] = warped.y;
+                texel[2] = warped.x * warped.x;
+                texel[3] = warped.y * warped.y;
+            }
+            else
+            {
+                texel[0] = warped.x;
+                texel[1] = warped.x * warped.x;
+            }
+        }
+        else if(shadowMode == ShadowMode::ESM)
+        {
+            texel[0] = WarpDepth(depth, Float2(params.ESMExponent, 0.0f)).x;
+        }
+        else
+        {
+            Float2 m = optimizedBasis ? GetOptimizedVSMMoments(depth) : Float2(depth, depth * depth);
+            texel[0] = m.x;
+            texel[1] = m.y;
+        }
+    }
+}
+
+void QuantizeMoments(const float* moments, uint64 numTexels, ShadowMode shadowMode, SMFormat smFormat,
+                     void* output)
+{
+    const uint64 count = numTexels * NumMomentComponents(shadowMode);
+
+    if(smFormat == SMFormat::SM32Bit)
+        memcpy(output, moments, count * sizeof(float));
+    else if(AppSettings::UseEVSM(uint32(shadowMode)) || shadowMode == ShadowMode::ESM)
+        FloatToHalf(moments, reinterpret_cast<uint16*>(output), count);
+    else
+        FloatToUNorm16(moments, reinterpret_cast<uint16*>(output), count);
+}
+
+void DequantizeMoments(const void* input, uint64 numTexels, ShadowMode shadowMode, SMFormat smFormat,
+                       float* moments)
+{
+    const uint64 count = numTexels * NumMomentComponents(shadowMode);
+
+    if(smFormat == SMFormat::SM32Bit)
+        memcpy(moments, input, count * sizeof(float));
+    else if(AppSettings::UseEVSM(uint32(shadowMode)) || shadowMode == ShadowMode::ESM)
+        HalfToFloat(reinterpret_cast<const uint16*>(input), moments, count);
+    else
+        UNorm16ToFloat(reinterpret_cast<const uint16*>(input), moments, count);
+}
+
+void ConvertToStandardMoments(float* moments, uint64 numTexels, ShadowMode shadowMode, SMFormat smFormat)
+{
+    if(UseOptimizedBasis(shadowMode, smFormat) == false)
+        return;
+
+    if(AppSettings::UseMSM(uint32(shadowMode)))
+    {
+        for(uint64 i = 0; i < numTexels; ++i)
+        {
+            float* texel = moments + i * 4;
+            Float4 m = ConvertOptimizedMoments(Float4(texel[0], texel[1], texel[2], texel[3]));
+            texel[0] = m.x;
+            texel[1] = m.y;
+            texel[2] = m.z;
+            texel[3] = m.w;
+        }
+    }
+    else
+    {
+        for(uint64 i = 0; i < numTexels; ++i)
+        {
+            float* texel = moments + i * 2;
+            Float2 m = ConvertOptimizedVSMMoments(Float2(texel[0], texel[1]));
+            texel[0] = m.x;
+            texel[1] = m.y;
+        }
+    }
+}
+
+void EncodeMoments(const float* depths, uint64 numTexels, ShadowMode shadowMode, SMFormat smFormat,
+                   const FilterableShadowParams& params, void* output)
+{
+    std::vector<float> moments(size_t(numTexels * NumMomentComponents(shadowMode)));
+    ComputeMoments(depths, numTexels, shadowMode, smFormat, params, moments.data());
+    QuantizeMoments(moments.data(), numTexels, shadowMode, smFormat, output);
+}
+
+void DecodeMoments(const void* input, uint64 numTexels, ShadowMode shadowMode, SMFormat smFormat,
+                   Float4* moments)
+{
+    const uint32 numComponents = NumMomentComponents(shadowMode);
+    std::vector<float> decoded(size_t(numTexels * numComponents));
+    DequantizeMoments(input, numTexels, shadowMode, smFormat, decoded.data());
+    ConvertToStandardMoments(decoded.data(), numTexels, shadowMode, smFormat);
+
+    for(uint64 i = 0; i < numTexels; ++i)
+    {
+        const float* texel = decoded.data() + i * numComponents;
+        float padded[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for(uint32 c = 0; c < numComponents; ++c)
+            padded[c] = texel[c];
+        moments[i] = Float4(padded[0], padded[1], padded[2], padded[3]);
+    }
+}
+
+// Synthetic filter footprints used for measuring quantization error. Each footprint covers
+// two occluders at different depths, with a receiver somewhere behind the closest one.
+struct MomentFootprints
+{
+    std::vector<float> NearDepths;
+    std::vector<float> FarDepths;
+    std::vector<float> NearCoverage;
+    std::vector<float> ReceiverDepths;
+};
+
+static void GenerateFootprints(uint32 numFootprints, MomentFootprints& footprints)
+{
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+    footprints.NearDepths.resize(numFootprints);
+    footprints.FarDepths.resize(numFootprints);
+    footprints.NearCoverage.resize(numFootprints);
+    footprints.ReceiverDepths.resize(numFootprints);
+
+    for(uint32 i = 0; i < numFootprints; ++i)
+    {
+        const float nearDepth = dist(rng) * 0.95f;
+        footprints.NearDepths[i] = nearDepth;
+        footprints.FarDepths[i] = nearDepth + dist(rng) * (1.0f - nearDepth);
+        footprints.NearCoverage[i] = dist(rng);
+        footprints.ReceiverDepths[i] = nearDepth + dist(rng) * (1.0f - nearDepth);
+    }
+}
+
+// Filters the footprints in the storage basis, optionally round-trips the result through the
+// storage format, and evaluates the visibility for each footprint
+static void EvaluateFootprints(const MomentFootprints& footprints, ShadowMode shadowMode, SMFormat smFormat,
+                               bool quantize, std::vector<float>& visibility)
+{
+    const uint64 numFootprints = footprints.NearDepths.size();
+    const uint32 numComponents = NumMomentComponents(shadowMode);
+    const FilterableShadowParams params = FilterableShadowParamsFromSettings(smFormat);
+
+    std::vector<float> nearMoments(size_t(numFootprints * numComponents));
+    std::vector<float> farMoments(size_t(numFootprints * numComponents));
+    ComputeMoments(footprints.NearDepths.data(), numFootprints, shadowMode, smFormat,
+                   params, nearMoments.data());
+    ComputeMoments(footprints.FarDepths.data(), numFootprints, shadowMode, smFormat,
+                   params, farMoments.data());
+
+    std::vector<float> filtered(size_t(numFootprints * numComponents));
+    for(uint64 i = 0; i < numFootprints; ++i)
+    {
+        const float coverage = footprints.NearCoverage[i];
+        for(uint32 c = 0; c < numComponents; ++c)
+        {
+            const uint64 idx = i * numComponents + c;
+            filtered[idx] = Lerp(farMoments[idx], nearMoments[idx], coverage);
+        }
+    }
+
+    if(quantize)
+    {
+        std::vector<uint8> stored(size_t(numFootprints * MomentMapTexelSize(shadowMode, smFormat)));
+        QuantizeMoments(filtered.data(), numFootprints, shadowMode, smFormat, stored.data());
+        DequantizeMoments(stored.data(), numFootprints, shadowMode, smFormat, filtered.data());
+    }
+
+    ConvertToStandardMoments(filtered.data(), numFootprints, shadowMode, smFormat);
+
+    visibility.resize(size_t(numFootprints));
+    for(uint64 i = 0; i < numFootprints; ++i)
+    {
+        const float* texel = filtered.data() + i * numComponents;
+        float padded[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for(uint32 c = 0; c < numComponents; ++c)
+            padded[c] = texel[c];
+        Float4 moments = Float4(padded[0], padded[1], padded[2], padded[3]);
+        visibility[i] = EvaluateFilterableShadow(shadowMode, moments, footprints.ReceiverDepths[i], params);
+    }
+}
+
+std::string MomentQuantizationReport(uint32 resolution, bool mipMaps, uint32 numTrials)
+{
+    static const SMFormat Formats[] = { SMFormat::SM32Bit, SMFormat::SM16Bit, SMFormat::SM16BitOptimized,
+                                        SMFormat::SM16BitRaw };
+    StaticAssert_(ArraySize_(FilterableModeNames) == AppSettings::NumFilterableShadowModes);
+    StaticAssert_(ArraySize_(SMFormatNames) == uint64(SMFormat::NumValues));
+
+    MomentFootprints footprints;
+    GenerateFootprints(numTrials, footprints);
+
+    std::string report = MakeString("Moment shadow map storage at %ux%u, %u cascades%s, F16C %s\n",
+                                    resolution, resolution, NumCascades, mipMaps ? " with mips" : "",
+                                    CPUSupportsF16C() ? "enabled" : "not available");
+    report += MakeString("Visibility error is measured against 32-bit storage over %u random filter footprints, "
+                         "using the current bias/exponent settings\n", numTrials);
+    report += MakeString("%-18s %-26s %12s %10s %10s %10s\n", "Mode", "Format", "Memory (MB)",
+                         "Max Error", "Mean Error", "RMS Error");
+
+    std::vector<float> reference;
+    std::vector<float> visibility;
+    for(uint64 modeIdx = 0; modeIdx < AppSettings::NumFilterableShadowModes; ++modeIdx)
+    {
+        const ShadowMode shadowMode = ShadowMode(modeIdx + uint64(ShadowMode::VSM));
+        EvaluateFootprints(footprints, shadowMode, SMFormat::SM32Bit, false, reference);
+
+        for(uint64 formatIdx = 0; formatIdx < ArraySize_(Formats); ++formatIdx)
+        {
+            const SMFormat smFormat = Formats[formatIdx];
+            EvaluateFootprints(footprints, shadowMode, smFormat, true, visibility);
+
+            double maxError = 0.0;
+            double errorSum = 0.0;
+            double errorSqSum = 0.0;
+            for(uint32 i = 0; i < numTrials; ++i)
+            {
+                double error = std::abs(double(visibility[i]) - double(reference[i]));
+                maxError = std::max(maxError, error);
+                errorSum += error;
+                errorSqSum += error * error;
+            }
+
+            const double memoryMB = MomentMapMemorySize(shadowMode, smFormat, resolution, mipMaps) / (1024.0 * 1024.0);
+            report += MakeString("%-18s %-26s %12.2f %10.6f %10.6f %10.6f\n", FilterableModeNames[modeIdx],
+                                 SMFormatNames[uint64(smFormat)], memoryMB, maxError, errorSum / numTrials,
+                                 std::sqrt(errorSqSum / numTrials));
+        }
+    }
+
+    return report;
+}
@@ -0,0 +1,59 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+#include "SampleFramework11/Math.h"
+
+#include "AppSettings.h"
+#include "ShadowFilters.h"
+
+using namespace SampleFramework11;
+
+// Storage info for moment (VSM/EVSM/ESM/MSM) shadow maps
+DXGI_FORMAT MomentMapFormat(ShadowMode shadowMode, SMFormat smFormat);
+uint32 NumMomentComponents(ShadowMode shadowMode);
+uint32 MomentMapTexelSize(ShadowMode shadowMode, SMFormat smFormat);
+
+// Total size of the moment shadow map cascades + the temporary blur target
+uint64 MomentMapMemorySize(ShadowMode shadowMode, SMFormat smFormat, uint32 resolution, bool mipMaps);
+
+// Bulk conversion between 32-bit floats and 16-bit UNORM/half, using SSE2 and F16C
+bool CPUSupportsF16C();
+void FloatToUNorm16(const float* src, uint16* dst, uint64 count);
+void UNorm16ToFloat(const uint16* src, float* dst, uint64 count);
+void FloatToHalf(const float* src, uint16* dst, uint64 count);
+void HalfToFloat(const uint16* src, float* dst, uint64 count);
+
+// Converts depth values to moments in the basis used for the given mode and format, which
+// matches what ConvertToVSM in VSMConvert.hlsl outputs. The output has
+// NumMomentComponents(shadowMode) floats per texel.
+void ComputeMoments(const float* depths, uint64 numTexels, ShadowMode shadowMode, SMFormat smFormat,
+                    const FilterableShadowParams& params, float* moments);
+
+// Quantizes moments to the storage format of the moment shadow map, and back
+void QuantizeMoments(const float* moments, uint64 numTexels, ShadowMode shadowMode, SMFormat smFormat,
+                     void* output);
+void DequantizeMoments(const void* input, uint64 numTexels, ShadowMode shadowMode, SMFormat smFormat,
+                       float* moments);
+
+// Converts moments from the storage basis back to the standard basis, in place
+void ConvertToStandardMoments(float* moments, uint64 numTexels, ShadowMode shadowMode, SMFormat smFormat);
+
+// Depth -> stored texels, and stored texels -> standard moments (zero-padded to 4 components)
+void EncodeMoments(const float* depths, uint64 numTexels, ShadowMode shadowMode, SMFormat smFormat,
+                   const FilterableShadowParams& params, void* output);
+void DecodeMoments(const void* input, uint64 numTexels, ShadowMode shadowMode, SMFormat smFormat,
+                   Float4* moments);
+
+// Builds a table of memory usage vs. the shadowing error introduced by each storage format,
+// for every filterable shadow mode
+std::string MomentQuantizationReport(uint32 resolution, bool mipMaps, uint32 numTrials = 4096);
@@ -0,0 +1,85 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "PCFKernels.h"
+
+#include "SampleFramework11/Utility.h"
+#include "SampleFramework11/FileIO.h"
+
+using namespace SampleFramework11;
+
+std::string PCFKernelsHLSL()
+{
+    std::string hlsl = "//=================================================================================================\n"
+                       "//\n"
+                       "//\tShadows Sample\n"
+                       "//  by MJP\n"
+                       "//  http://mynameismjp.wordpress.com/\n"
+                       "//\n"
+                       "//  All code licensed under the MIT license\n"
+                       "//\n"
+                       "//=================================================================================================\n"
+                       "\n"
+                       "// This file is generated by UpdatePCFKernelsHeader() in PCFKernels.cpp, don't edit it by hand\n"
+                       "\n"
+                       "#ifndef FilterSize_\n"
+                       "    #define FilterSize_ 2\n"
+                       "#endif\n";
+
+    for(uint32 kernelSize = 3; kernelSize <= MaxPCFKernelSize; kernelSize += 2)
+    {
+        const int32 radius = int32(kernelSize / 2);
+        hlsl += MakeString("\n#%s FilterSize_ == %u\n\n", kernelSize == 3 ? "if" : "elif", kernelSize);
+
+        // Disc kernel for FixedSizePCF
+        hlsl += MakeString("// -- %ux%u disc kernel\n", kernelSize, kernelSize);
+        hlsl += MakeString("static const float W[%u][%u] =\n{\n", kernelSize, kernelSize);
+        for(int32 y = -radius; y <= radius; ++y)
+        {
+            hlsl += "    { ";
+            for(int32 x = -radius; x <= radius; ++x)
+                hlsl += MakeString("%.1f%s", DiscKernelWeight(radius, x, y), x < radius ? "," : " ");
+            hlsl += y < radius ? "},\n" : "}\n";
+        }
+        hlsl += "};\n\n";
+
+        // Fetch weights for OptimizedPCF
+        const uint32 numFetches = NumOptimizedPCFFetches(kernelSize);
+        const float kernelSum = float(SmoothKernelSum(kernelSize));
+        hlsl += "// -- Per-axis fetches for OptimizedPCF, with the weight and the second texel weight of each\n";
+        hlsl += "// fetch stored as base + slope * subTexelOffset\n";
+        hlsl += MakeString("static const uint NumOptimizedPCFFetches = %u;\n", numFetches);
+        hlsl += MakeString("static const float OptimizedPCFNormalization = 1.0f / %.1f;\n", kernelSum * kernelSum);
+        hlsl += MakeString("static const float4 OptimizedPCFFetches[%u] =\n{\n", numFetches);
+        for(uint32 i = 0; i < numFetches; ++i)
+            hlsl += MakeString("    float4(%.1f, %.1f, %.1f, %.1f),\n", OptimizedPCFWeightBase(kernelSize, i),
+                               OptimizedPCFWeightSlope(kernelSize, i), OptimizedPCFSecondTexelBase(kernelSize, i),
+                               OptimizedPCFSecondTexelSlope(kernelSize, i));
+        hlsl += "};\n";
+    }
+
+    hlsl += "\n#endif\n"
+            "\n"
+            "// For Poisson Disk PCF sampling\n"
+            "#include \"SampleSets.hlsl\"\n";
+
+    return hlsl;
+}
+
+void UpdatePCFKernelsHeader(const wchar* filePath)
+{
+    const std::string hlsl = PCFKernelsHLSL();
+    if(FileExists(filePath) && ReadFileAsString(filePath) == hlsl)
+        return;
+
+    WriteStringAsFile(filePath, hlsl);
+}
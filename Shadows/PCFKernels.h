@@ -0,0 +1,164 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+#include "SampleFramework11/Assert.h"
+
+// Kernel weights for the FixedSizePCF and OptimizedPCF shadow modes. Everything here is
+// constexpr so that the weights can be used in static tables, and PCFKernels.hlsl gets
+// generated from the same functions so that the CPU and GPU versions always match.
+
+// Largest odd kernel size that the generator supports
+static const uint32 MaxPCFKernelSize = 15;
+
+// Weight of the disc-shaped kernel used for FixedSizePCF, at an offset of (x, y) texels from the
+// center. Texels that are inside the radius get a weight of 1, and the ones just outside get
+// 0.5 so that the edge of the disc gets smoothed out.
+constexpr float DiscKernelWeight(int32 radius, int32 x, int32 y)
+{
+    return x * x + y * y <= radius * radius ? 1.0f :
+          (x * x + y * y <= radius * radius + 1 ? 0.5f : 0.0f);
+}
+
+// 1D weights of the separable kernel used for OptimizedPCF, which is [1, 2, 1] convolved with
+// [1, 1, 1] until it's the right size. This gives a smooth falloff that approaches a Gaussian.
+constexpr uint32 SmoothKernelWeight(uint32 kernelSize, int32 idx)
+{
+    return idx < 0 || idx >= int32(kernelSize) ? 0 :
+          (kernelSize <= 3 ? (idx == 1 ? 2 : 1) :
+           SmoothKernelWeight(kernelSize - 2, idx - 2) + SmoothKernelWeight(kernelSize - 2, idx - 1) +
+           SmoothKernelWeight(kernelSize - 2, idx));
+}
+
+constexpr uint32 SmoothKernelSum(uint32 kernelSize)
+{
+    return kernelSize <= 3 ? 4 : SmoothKernelSum(kernelSize - 2) * 3;
+}
+
+// OptimizedPCF filters the bilinear PCF result with the smooth kernel. For a sub-texel offset s,
+// texel i of the kernelSize + 1 texels that get touched has a weight of
+// (1 - s) * K[i] + s * K[i - 1], and each pair of texels gets merged into a single bilinear fetch.
+// This means that an NxN kernel only needs ((N + 1) / 2)^2 fetches.
+constexpr uint32 NumOptimizedPCFFetches(uint32 kernelSize)
+{
+    return (kernelSize + 1) / 2;
+}
+
+// The weight of fetch i is WeightBase + WeightSlope * s
+constexpr float OptimizedPCFWeightBase(uint32 kernelSize, uint32 fetchIdx)
+{
+    return float(SmoothKernelWeight(kernelSize, fetchIdx * 2) + SmoothKernelWeight(kernelSize, fetchIdx * 2 + 1));
+}
+
+constexpr float OptimizedPCFWeightSlope(uint32 kernelSize, uint32 fetchIdx)
+{
+    return float(SmoothKernelWeight(kernelSize, int32(fetchIdx * 2) - 1)) -
+           float(SmoothKernelWeight(kernelSize, fetchIdx * 2 + 1));
+}
+
+// The weight of the second texel of fetch i is SecondTexelBase + SecondTexelSlope * s, and the
+// fetch is placed at TexelOffset + secondTexelWeight / fetchWeight
+constexpr float OptimizedPCFSecondTexelBase(uint32 kernelSize, uint32 fetchIdx)
+{
+    return float(SmoothKernelWeight(kernelSize, fetchIdx * 2 + 1));
+}
+
+constexpr float OptimizedPCFSecondTexelSlope(uint32 kernelSize, uint32 fetchIdx)
+{
+    return float(SmoothKernelWeight(kernelSize, fetchIdx * 2)) -
+           float(SmoothKernelWeight(kernelSize, fetchIdx * 2 + 1));
+}
+
+constexpr float OptimizedPCFTexelOffset(uint32 kernelSize, uint32 fetchIdx)
+{
+    return float(int32(fetchIdx * 2) - int32(kernelSize / 2));
+}
+
+StaticAssert_(SmoothKernelWeight(5, 2) == 4 && SmoothKernelSum(5) == 12);
+StaticAssert_(SmoothKernelSum(MaxPCFKernelSize) < (1 << 24));
+
+// Computes the weight and position of fetch i along one axis, relative to the texel grid
+inline void OptimizedPCFFetch(uint32 kernelSize, uint32 fetchIdx, float s, float& weight, float& offset)
+{
+    weight = OptimizedPCFWeightBase(kernelSize, fetchIdx) + OptimizedPCFWeightSlope(kernelSize, fetchIdx) * s;
+    const float secondTexelWeight = OptimizedPCFSecondTexelBase(kernelSize, fetchIdx) +
+                                    OptimizedPCFSecondTexelSlope(kernelSize, fetchIdx) * s;
+    offset = OptimizedPCFTexelOffset(kernelSize, fetchIdx) + secondTexelWeight / weight;
+}
+
+// CPU versions of SampleShadowMapFixedSizePCF and SampleShadowMapOptimizedPCF from Mesh.hlsl.
+// The position is in texels (uv * shadowMapSize), and sampleCmp(texelX, texelY) needs to return
+// the result of a bilinear SampleCmp at the given position.
+template<typename TSampleCmp> float EvaluateFixedSizePCF(uint32 kernelSize, float texelX, float texelY,
+                                                         const TSampleCmp& sampleCmp)
+{
+    if(kernelSize < 3)
+        return sampleCmp(texelX, texelY);
+
+    Assert_(kernelSize <= MaxPCFKernelSize && (kernelSize & 1) == 1);
+
+    const int32 radius = int32(kernelSize / 2);
+    float sum = 0.0f;
+    float weightSum = 0.0f;
+    for(int32 y = -radius; y <= radius; ++y)
+    {
+        for(int32 x = -radius; x <= radius; ++x)
+        {
+            const float weight = DiscKernelWeight(radius, x, y);
+            if(weight > 0.0f)
+                sum += weight * sampleCmp(texelX + x, texelY + y);
+            weightSum += weight;
+        }
+    }
+
+    return sum / weightSum;
+}
+
+template<typename TSampleCmp> float EvaluateOptimizedPCF(uint32 kernelSize, float texelX, float texelY,
+                                                         const TSampleCmp& sampleCmp)
+{
+    if(kernelSize < 3)
+        return sampleCmp(texelX, texelY);
+
+    Assert_(kernelSize <= MaxPCFKernelSize && (kernelSize & 1) == 1);
+
+    const float baseX = std::floor(texelX + 0.5f);
+    const float baseY = std::floor(texelY + 0.5f);
+    const float s = texelX + 0.5f - baseX;
+    const float t = texelY + 0.5f - baseY;
+
+    const uint32 numFetches = NumOptimizedPCFFetches(kernelSize);
+    float uw[NumOptimizedPCFFetches(MaxPCFKernelSize)];
+    float u[NumOptimizedPCFFetches(MaxPCFKernelSize)];
+    float vw[NumOptimizedPCFFetches(MaxPCFKernelSize)];
+    float v[NumOptimizedPCFFetches(MaxPCFKernelSize)];
+    for(uint32 i = 0; i < numFetches; ++i)
+    {
+        OptimizedPCFFetch(kernelSize, i, s, uw[i], u[i]);
+        OptimizedPCFFetch(kernelSize, i, t, vw[i], v[i]);
+    }
+
+    float sum = 0.0f;
+    for(uint32 row = 0; row < numFetches; ++row)
+        for(uint32 col = 0; col < numFetches; ++col)
+            sum += uw[col] * vw[row] * sampleCmp(baseX - 0.5f + u[col], baseY - 0.5f + v[row]);
+
+    const float kernelSum = float(SmoothKernelSum(kernelSize));
+    return sum / (kernelSum * kernelSum);
+}
+
+// Returns the contents of PCFKernels.hlsl
+std::string PCFKernelsHLSL();
+
+// Re-generates PCFKernels.hlsl if the contents have changed, which needs to happen before any
+// of the shaders get compiled
+void UpdatePCFKernelsHeader(const wchar* filePath);
@@ -0,0 +1,175 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "PCSS.h"
+#include "SharedConstants.h"
+
+#include "SampleFramework11/Assert.h"
+
+MinMaxDepthPyramid::MinMaxDepthPyramid() : resolution(0)
+{
+}
+
+void MinMaxDepthPyramid::Build(const float* depths, uint32 resolution_)
+{
+    Assert_(resolution_ >= 2 && (resolution_ & (resolution_ - 1)) == 0);
+
+    resolution = resolution_;
+    levels.clear();
+
+    for(uint32 size = resolution / 2; size >= 1; size /= 2)
+    {
+        levels.push_back(std::vector<Float2>(size * size));
+
+        const uint32 levelIdx = uint32(levels.size()) - 1;
+        std::vector<Float2>& level = levels[levelIdx];
+        const uint32 srcSize = size * 2;
+        for(uint32 y = 0; y < size; ++y)
+        {
+            for(uint32 x = 0; x < size; ++x)
+            {
+                Float2 minMax = Float2(FLT_MAX, -FLT_MAX);
+                for(uint32 i = 0; i < 4; ++i)
+                {
+                    const uint32 srcIdx = (y * 2 + i / 2) * srcSize + x * 2 + (i & 1);
+                    const Float2 src = levelIdx == 0 ? Float2(depths[srcIdx], depths[srcIdx])
+                                                     : levels[levelIdx - 1][srcIdx];
+                    minMax.x = std::min(minMax.x, src.x);
+                    minMax.y = std::max(minMax.y, src.y);
+                }
+
+                level[y * size + x] = minMax;
+            }
+        }
+    }
+}
+
+Float2 MinMaxDepthPyramid::MinMax(uint32 level, int32 x, int32 y) const
+{
+    Assert_(level < NumLevels());
+    const int32 maxCoord = int32(LevelSize(level)) - 1;
+    x = Clamp(x, 0, maxCoord);
+    y = Clamp(y, 0, maxCoord);
+    return levels[level][y * LevelSize(level) + x];
+}
+
+Float2 MinMaxDepthPyramid::RegionMinMax(float texelX, float texelY, float radius, uint64& numFetches) const
+{
+    // A texel of level n covers 2^(n + 1) shadow map texels, so 2x2 of them always cover the
+    // region once that's at least as big as the width of the region
+    uint32 level = 0;
+    while(level + 1 < NumLevels() && float(2u << level) < radius * 2.0f)
+        ++level;
+
+    const float cellSize = float(2u << level);
+    const int32 cellX = int32(std::floor((texelX - radius) / cellSize));
+    const int32 cellY = int32(std::floor((texelY - radius) / cellSize));
+
+    Float2 result = Float2(FLT_MAX, -FLT_MAX);
+    for(int32 y = 0; y < 2; ++y)
+    {
+        for(int32 x = 0; x < 2; ++x)
+        {
+            const Float2 minMax = MinMax(level, cellX + x, cellY + y);
+            result.x = std::min(result.x, minMax.x);
+            result.y = std::max(result.y, minMax.y);
+        }
+    }
+
+    numFetches += 4;
+    return result;
+}
+
+uint64 MinMaxDepthPyramidMemorySize(uint32 resolution)
+{
+    uint64 size = 0;
+    for(uint32 levelSize = resolution / 2; levelSize >= 1; levelSize /= 2)
+        size += uint64(levelSize) * levelSize * sizeof(Float2);
+    return size;
+}
+
+PCSSParams::PCSSParams() : PenumbraScale(0.0f, 0.0f), NumFilterSamples(1), PoissonSamples(nullptr)
+{
+}
+
+PCSSStats::PCSSStats() : NumEvaluations(0), NumFetches(0), NumFullyLit(0), NumFullyShadowed(0)
+{
+}
+
+void PCSSStats::Add(const PCSSStats& other)
+{
+    NumEvaluations += other.NumEvaluations;
+    NumFetches += other.NumFetches;
+    NumFullyLit += other.NumFullyLit;
+    NumFullyShadowed += other.NumFullyShadowed;
+}
+
+bool PCSSBlockerSearch(const float* depths, uint32 resolution, const MinMaxDepthPyramid* pyramid,
+                       float texelX, float texelY, float depth, const PCSSParams& params,
+                       float& visibility, Float2& filterSize, PCSSStats& stats)
+{
+    Assert_(params.PoissonSamples != nullptr);
+
+    ++stats.NumEvaluations;
+
+    // With a directional light the blockers can be anywhere between the receiver and the near plane
+    const Float2 searchSize = Float2(Clamp(params.PenumbraScale.x * depth, 1.0f, MaxPCSSKernelSize),
+                                     Clamp(params.PenumbraScale.y * depth, 1.0f, MaxPCSSKernelSize));
+
+    if(pyramid != nullptr)
+    {
+        // The bilinear filter taps can touch one texel past the search region
+        const float regionRadius = std::max(searchSize.x, searchSize.y) * 0.5f + 1.0f;
+        const Float2 minMax = pyramid->RegionMinMax(texelX, texelY, regionRadius, stats.NumFetches);
+        if(depth <= minMax.x)
+        {
+            ++stats.NumFullyLit;
+            visibility = 1.0f;
+            return false;
+        }
+        else if(depth > minMax.y)
+        {
+            ++stats.NumFullyShadowed;
+            visibility = 0.0f;
+            return false;
+        }
+    }
+
+    const int32 maxCoord = int32(resolution) - 1;
+    float blockerSum = 0.0f;
+    uint32 numBlockers = 0;
+    for(uint32 i = 0; i < NumPCSSBlockerSamples; ++i)
+    {
+        const int32 x = Clamp(int32(std::floor(texelX + params.PoissonSamples[i].x * searchSize.x * 0.5f)), 0, maxCoord);
+        const int32 y = Clamp(int32(std::floor(texelY + params.PoissonSamples[i].y * searchSize.y * 0.5f)), 0, maxCoord);
+        const float blockerDepth = depths[y * resolution + x];
+        if(blockerDepth < depth)
+        {
+            blockerSum += blockerDepth;
+            ++numBlockers;
+        }
+    }
+
+    stats.NumFetches += NumPCSSBlockerSamples;
+
+    if(numBlockers == 0)
+    {
+        visibility = 1.0f;
+        return false;
+    }
+
+    // The penumbra gets wider as the distance between the blocker and receiver increases
+    const float blockerDistance = depth - blockerSum / numBlockers;
+    filterSize.x = Clamp(params.PenumbraScale.x * blockerDistance, 1.0f, searchSize.x);
+    filterSize.y = Clamp(params.PenumbraScale.y * blockerDistance, 1.0f, searchSize.y);
+    return true;
+}
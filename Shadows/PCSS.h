@@ -0,0 +1,107 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+#include "SampleFramework11/Math.h"
+
+using namespace SampleFramework11;
+
+// CPU reference for the PCSS shadow mode, which matches SampleShadowMapPCSS in Mesh.hlsl and the
+// min/max pyramid that MeshRenderer builds for every cascade with ShadowMinMax.hlsl.
+
+// Pyramid of min and max depths, where each texel of level 0 covers a 2x2 block of shadow map
+// texels and every level after that halves the resolution until it gets to 1x1
+class MinMaxDepthPyramid
+{
+
+public:
+
+    MinMaxDepthPyramid();
+
+    void Build(const float* depths, uint32 resolution);
+
+    uint32 NumLevels() const { return uint32(levels.size()); }
+    uint32 LevelSize(uint32 level) const { return std::max(resolution >> (level + 1), 1u); }
+
+    // Min and max depth of a texel, with the coordinates clamped to the edges of the level
+    Float2 MinMax(uint32 level, int32 x, int32 y) const;
+
+    // Returns a conservative min and max depth for every shadow map texel within radius texels
+    // of the given position, using 2x2 texels from the first level that's big enough
+    Float2 RegionMinMax(float texelX, float texelY, float radius, uint64& numFetches) const;
+
+protected:
+
+    uint32 resolution;
+    std::vector<std::vector<Float2>> levels;
+};
+
+// Memory used by the pyramid for a single cascade
+uint64 MinMaxDepthPyramidMemorySize(uint32 resolution);
+
+struct PCSSParams
+{
+    Float2 PenumbraScale;       // Penumbra width in texels per unit of depth between the blocker and receiver
+    uint32 NumFilterSamples;
+    const Float2* PoissonSamples;
+
+    PCSSParams();
+};
+
+// Fetch counts and early-out rates for the blocker search
+struct PCSSStats
+{
+    uint64 NumEvaluations;
+    uint64 NumFetches;
+    uint64 NumFullyLit;
+    uint64 NumFullyShadowed;
+
+    PCSSStats();
+
+    void Add(const PCSSStats& other);
+};
+
+// Runs the blocker search for a receiver at the given position (in texels) and normalized depth.
+// If the pyramid is null, every receiver gets the full search. Returns false if the receiver is
+// fully lit or fully shadowed, in which case visibility is set and there's nothing to filter.
+// Otherwise filterSize gets set to the width of the penumbra in texels.
+bool PCSSBlockerSearch(const float* depths, uint32 resolution, const MinMaxDepthPyramid* pyramid,
+                       float texelX, float texelY, float depth, const PCSSParams& params,
+                       float& visibility, Float2& filterSize, PCSSStats& stats);
+
+// CPU version of SampleShadowMapPCSS. sampleCmp(texelX, texelY) needs to return the result of
+// a bilinear SampleCmp at the given position.
+template<typename TSampleCmp> float EvaluatePCSS(const float* depths, uint32 resolution,
+                                                 const MinMaxDepthPyramid* pyramid, float texelX,
+                                                 float texelY, float depth, const PCSSParams& params,
+                                                 const TSampleCmp& sampleCmp, PCSSStats& stats)
+{
+    float visibility = 1.0f;
+    Float2 filterSize;
+    if(PCSSBlockerSearch(depths, resolution, pyramid, texelX, texelY, depth, params, visibility,
+                         filterSize, stats) == false)
+        return visibility;
+
+    if(filterSize.x <= 1.0f && filterSize.y <= 1.0f)
+    {
+        stats.NumFetches += 1;
+        return sampleCmp(texelX, texelY);
+    }
+
+    float sum = 0.0f;
+    for(uint32 i = 0; i < params.NumFilterSamples; ++i)
+        sum += sampleCmp(texelX + params.PoissonSamples[i].x * filterSize.x * 0.5f,
+                         texelY + params.PoissonSamples[i].y * filterSize.y * 0.5f);
+
+    stats.NumFetches += params.NumFilterSamples;
+    return sum / params.NumFilterSamples;
+}
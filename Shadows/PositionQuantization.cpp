@@ -0,0 +1,94 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "PositionQuantization.h"
+#include "MomentQuantization.h"
+
+#include "SampleFramework11/Utility.h"
+
+PositionQuantization QuantizePositions(const Float3* positions, uint32 numPositions, uint16* output)
+{
+    PositionQuantization quantization;
+    if(numPositions == 0)
+        return quantization;
+
+    Float3 minPos = positions[0];
+    Float3 maxPos = positions[0];
+    for(uint32 i = 1; i < numPositions; ++i)
+    {
+        minPos.x = std::min(minPos.x, positions[i].x);
+        minPos.y = std::min(minPos.y, positions[i].y);
+        minPos.z = std::min(minPos.z, positions[i].z);
+        maxPos.x = std::max(maxPos.x, positions[i].x);
+        maxPos.y = std::max(maxPos.y, positions[i].y);
+        maxPos.z = std::max(maxPos.z, positions[i].z);
+    }
+
+    // Flat axes still need a non-zero scale so that they don't divide by zero
+    Float3 extents = maxPos - minPos;
+    extents.x = extents.x > 0.0f ? extents.x : 1.0f;
+    extents.y = extents.y > 0.0f ? extents.y : 1.0f;
+    extents.z = extents.z > 0.0f ? extents.z : 1.0f;
+    quantization.Scale = extents;
+    quantization.Bias = minPos;
+
+    // Normalize to [0, 1] and convert in bulk, with w left at 0
+    std::vector<float> normalized(uint64(numPositions) * 4);
+    for(uint32 i = 0; i < numPositions; ++i)
+    {
+        const Float3 n = (positions[i] - minPos) / extents;
+        normalized[i * 4 + 0] = n.x;
+        normalized[i * 4 + 1] = n.y;
+        normalized[i * 4 + 2] = n.z;
+        normalized[i * 4 + 3] = 0.0f;
+    }
+
+    FloatToUNorm16(normalized.data(), output, normalized.size());
+
+    // Dequantize the same way that the input assembler and the folded world matrix will
+    UNorm16ToFloat(output, normalized.data(), normalized.size());
+    double errorSum = 0.0;
+    for(uint32 i = 0; i < numPositions; ++i)
+    {
+        const Float3 n(normalized[i * 4 + 0], normalized[i * 4 + 1], normalized[i * 4 + 2]);
+        const float error = Float3::Length(n * extents + minPos - positions[i]);
+        quantization.MaxError = std::max(quantization.MaxError, error);
+        errorSum += error;
+    }
+    quantization.AvgError = float(errorSum / numPositions);
+
+    return quantization;
+}
+
+Float4x4 DequantizationMatrix(const PositionQuantization& quantization)
+{
+    Float4x4 m = Float4x4::ScaleMatrix(quantization.Scale);
+    m.SetTranslation(quantization.Bias);
+    return m;
+}
+
+std::string PositionQuantizationReport(const char* name, const PositionQuantization& quantization,
+                                       uint32 numPositions, uint32 fullVertexBytes, float worldScale)
+{
+    const float fullMB = numPositions * fullVertexBytes / (1024.0f * 1024.0f);
+    const float floatMB = numPositions * sizeof(Float3) / (1024.0f * 1024.0f);
+    const float quantizedMB = numPositions * QuantizedPositionStride / (1024.0f * 1024.0f);
+
+    std::string report = MakeString("Depth position stream for %s: %u vertices\n", name, numPositions);
+    report += MakeString("  Full vertex (%2u B): %7.2f MB\n", fullVertexBytes, fullMB);
+    report += MakeString("  Float3      (%2u B): %7.2f MB\n", uint32(sizeof(Float3)), floatMB);
+    report += MakeString("  UNORM16     (%2u B): %7.2f MB\n", QuantizedPositionStride, quantizedMB);
+    report += MakeString("  Quantization error: max %.6f avg %.6f (object space), max %.6f avg %.6f (world space)\n",
+                         quantization.MaxError, quantization.AvgError, quantization.MaxError * worldScale,
+                         quantization.AvgError * worldScale);
+    return report;
+}
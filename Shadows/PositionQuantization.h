@@ -0,0 +1,45 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+#include "SampleFramework11/Math.h"
+
+using namespace SampleFramework11;
+
+// Depth-only passes only need positions, so they get their own stream that can optionally be
+// stored as 16-bit UNORM relative to the bounding box of the mesh. There's no 3-component 16-bit
+// format, so each position takes 8 bytes (R16G16B16A16_UNORM) instead of 12.
+static const uint32 QuantizedPositionStride = sizeof(uint16) * 4;
+
+struct PositionQuantization
+{
+    // Object space position = UNORM position * Scale + Bias
+    Float3 Scale;
+    Float3 Bias;
+
+    // Distance between the original and dequantized positions, in object space
+    float MaxError;
+    float AvgError;
+
+    PositionQuantization() : Scale(1.0f), Bias(0.0f), MaxError(0.0f), AvgError(0.0f) {}
+};
+
+// Quantizes the positions to 4 uint16's each, and measures the error after dequantizing
+PositionQuantization QuantizePositions(const Float3* positions, uint32 numPositions, uint16* output);
+
+// Maps UNORM positions back to object space. This gets folded into the world matrix, so the
+// vertex shader doesn't need to know that the positions are quantized.
+Float4x4 DequantizationMatrix(const PositionQuantization& quantization);
+
+// Summary of the stream sizes and the error, with the error also in world units
+std::string PositionQuantizationReport(const char* name, const PositionQuantization& quantization,
+                                       uint32 numPositions, uint32 fullVertexBytes, float worldScale);
@@ -18,6 +18,7 @@
 #include "FileIO.h"
 #include "Settings.h"
 #include "TwHelper.h"
+#include "TextureCache.h"
 
 namespace SampleFramework11
 {
@@ -116,6 +117,8 @@ void App::Run()
         exception.ShowErrorMessage();
     }
 
+    GUIObject::DestroyGlobalResources();
+    TextureCache::GlobalCache.Shutdown();
     ShutdownShaders();
 
     TwCall(TwTerminate());
@@ -211,4 +211,65 @@ uint64 File::Size() const
     return fileSize.QuadPart;
 }
 
+// == MappedFile ==================================================================================
+
+MappedFile::MappedFile() : fileHandle(INVALID_HANDLE_VALUE), mappingHandle(NULL), data(nullptr), size(0)
+{
+}
+
+MappedFile::MappedFile(const wchar* filePath) : fileHandle(INVALID_HANDLE_VALUE), mappingHandle(NULL),
+                                                data(nullptr), size(0)
+{
+    Open(filePath);
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+void MappedFile::Open(const wchar* filePath)
+{
+    Assert_(fileHandle == INVALID_HANDLE_VALUE);
+    Assert_(FileExists(filePath));
+
+    fileHandle = CreateFile(filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if(fileHandle == INVALID_HANDLE_VALUE)
+        Win32Call(false);
+
+    LARGE_INTEGER fileSize;
+    Win32Call(GetFileSizeEx(fileHandle, &fileSize));
+    size = fileSize.QuadPart;
+
+    // Empty files can't be mapped
+    if(size == 0)
+        return;
+
+    mappingHandle = CreateFileMapping(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(mappingHandle == NULL)
+        Win32Call(false);
+
+    data = reinterpret_cast<const uint8*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if(data == nullptr)
+        Win32Call(false);
+}
+
+void MappedFile::Close()
+{
+    if(data != nullptr)
+        Win32Call(UnmapViewOfFile(data));
+
+    if(mappingHandle != NULL)
+        Win32Call(CloseHandle(mappingHandle));
+
+    if(fileHandle != INVALID_HANDLE_VALUE)
+        Win32Call(CloseHandle(fileHandle));
+
+    fileHandle = INVALID_HANDLE_VALUE;
+    mappingHandle = NULL;
+    data = nullptr;
+    size = 0;
+}
+
 }
\ No newline at end of file
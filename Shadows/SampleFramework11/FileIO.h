@@ -80,6 +80,38 @@ template<typename T> void File::Write(const T& data) const
     Write(sizeof(T), &data);
 }
 
+// Read-only view of an entire file that's mapped into the address space, so that the OS pages
+// it in on demand instead of it getting copied into a buffer
+class MappedFile
+{
+
+private:
+
+    HANDLE fileHandle;
+    HANDLE mappingHandle;
+    const uint8* data;
+    uint64 size;
+
+    MappedFile(const MappedFile& other);
+    MappedFile& operator=(const MappedFile& other);
+
+public:
+
+    // Lifetime
+    MappedFile();
+    MappedFile(const wchar* filePath);
+    ~MappedFile();
+
+    // Explicit Open and close
+    void Open(const wchar* filePath);
+    void Close();
+
+    // Accessors
+    bool IsOpen() const { return data != nullptr; }
+    const uint8* Data() const { return data; }
+    uint64 Size() const { return size; }
+};
+
 // Templated helper functions
 
 // Reads a POD type from a file
@@ -14,6 +14,7 @@
 #include "GUIObject.h"
 
 #include "Utility.h"
+#include "TextureCache.h"
 
 namespace SampleFramework11
 {
@@ -31,4 +32,13 @@ void GUIObject::InitGlobalResources(ID3D11Device* device)
     font.Initialize(L"Microsoft Sans Serif", 8.5f, SpriteFont::Regular, true, device);
 }
 
+void GUIObject::DestroyGlobalResources()
+{
+    // The textures came from the texture cache, so the references need to go back to it
+    TextureCache::GlobalCache.Release(barTexture);
+    TextureCache::GlobalCache.Release(knobTexture);
+    barTexture = nullptr;
+    knobTexture = nullptr;
+}
+
 }
\ No newline at end of file
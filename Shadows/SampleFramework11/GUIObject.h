@@ -35,6 +35,7 @@ public:
     bool Enabled() const { return enabled; };
 
     static void InitGlobalResources(ID3D11Device* device);
+    static void DestroyGlobalResources();
 
 protected:
 
@@ -0,0 +1,281 @@
+//=================================================================================================
+//
+//  MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "JobGraph.h"
+#include "Exceptions.h"
+#include "Assert.h"
+
+namespace SampleFramework11
+{
+
+JobGraph::JobGraph() : numUnfinished(0), numFinished(0), stopping(false)
+{
+}
+
+JobGraph::~JobGraph()
+{
+    Shutdown();
+}
+
+void JobGraph::Start(uint32 numThreads)
+{
+    Assert_(workers.size() == 0);
+
+    // There always needs to be at least one worker, since the device thread only runs device jobs
+    if(numThreads == 0)
+        numThreads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+    stopping = false;
+    for(uint32 i = 0; i < numThreads; ++i)
+        workers.push_back(std::thread(&JobGraph::WorkerThread, this));
+}
+
+void JobGraph::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        workerQueue.clear();
+        deviceQueue.clear();
+    }
+
+    workerCV.notify_all();
+    for(uint64 i = 0; i < workers.size(); ++i)
+        workers[i].join();
+    workers.clear();
+}
+
+JobGraph::JobID JobGraph::AddJob(const JobFunc& func, const JobID* dependencies, uint32 numDependencies)
+{
+    return Add(func, dependencies, numDependencies, false);
+}
+
+JobGraph::JobID JobGraph::AddJob(const JobFunc& func, JobID dependency)
+{
+    return Add(func, &dependency, 1, false);
+}
+
+JobGraph::JobID JobGraph::AddDeviceJob(const JobFunc& func, const JobID* dependencies, uint32 numDependencies)
+{
+    return Add(func, dependencies, numDependencies, true);
+}
+
+JobGraph::JobID JobGraph::AddDeviceJob(const JobFunc& func, JobID dependency)
+{
+    return Add(func, &dependency, 1, true);
+}
+
+JobGraph::JobID JobGraph::Add(const JobFunc& func, const JobID* dependencies, uint32 numDependencies, bool deviceJob)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const JobID jobID = JobID(jobs.size());
+    jobs.push_back(Job());
+    Job& job = jobs.back();
+    job.Func = func;
+    job.NumPendingDependencies = 0;
+    job.DeviceJob = deviceJob;
+    job.Finished = false;
+    job.Skip = false;
+    ++numUnfinished;
+
+    for(uint32 i = 0; i < numDependencies; ++i)
+    {
+        Assert_(dependencies[i] < jobID);
+        Job& dependency = jobs[dependencies[i]];
+        if(dependency.Finished)
+        {
+            job.Skip = job.Skip || dependency.Skip;
+        }
+        else
+        {
+            dependency.Dependents.push_back(jobID);
+            ++job.NumPendingDependencies;
+        }
+    }
+
+    if(job.NumPendingDependencies == 0)
+        Enqueue(jobID);
+
+    return jobID;
+}
+
+// Puts a job whose dependencies have all finished on the worker or device queue. The mutex
+// needs to be locked.
+void JobGraph::Enqueue(JobID jobID)
+{
+    if(jobs[jobID].DeviceJob)
+    {
+        deviceQueue.push_back(jobID);
+        finishedCV.notify_all();
+    }
+    else
+    {
+        workerQueue.push_back(jobID);
+        workerCV.notify_one();
+    }
+}
+
+// Runs a job with the mutex unlocked, and then releases its dependents. The lock is held again
+// when this returns.
+void JobGraph::Run(JobID jobID, std::unique_lock<std::mutex>& lock)
+{
+    JobFunc func;
+    func.swap(jobs[jobID].Func);
+    bool skip = jobs[jobID].Skip;
+
+    if(skip == false)
+    {
+        lock.unlock();
+        try
+        {
+            func();
+        }
+        catch(...)
+        {
+            skip = true;
+            lock.lock();
+            if(!error)
+                error = std::current_exception();
+            lock.unlock();
+        }
+
+        // Release whatever the job captured before taking the lock again
+        func = nullptr;
+        lock.lock();
+    }
+
+    Job& job = jobs[jobID];
+    job.Finished = true;
+    job.Skip = skip;
+    --numUnfinished;
+    ++numFinished;
+
+    for(uint64 i = 0; i < job.Dependents.size(); ++i)
+    {
+        Job& dependent = jobs[job.Dependents[i]];
+        dependent.Skip = dependent.Skip || skip;
+        Assert_(dependent.NumPendingDependencies > 0);
+        if(--dependent.NumPendingDependencies == 0)
+            Enqueue(job.Dependents[i]);
+    }
+
+    job.Dependents.clear();
+    finishedCV.notify_all();
+}
+
+void JobGraph::RethrowError()
+{
+    std::exception_ptr jobError;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobError = error;
+        error = nullptr;
+    }
+
+    if(jobError)
+        std::rethrow_exception(jobError);
+}
+
+uint32 JobGraph::RunDeviceJobs()
+{
+    RethrowError();
+
+    uint32 numJobsRun = 0;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while(deviceQueue.size() > 0)
+        {
+            const JobID jobID = deviceQueue.front();
+            deviceQueue.pop_front();
+            Run(jobID, lock);
+            ++numJobsRun;
+        }
+    }
+
+    RethrowError();
+
+    return numJobsRun;
+}
+
+void JobGraph::WaitUntil(const std::function<bool()>& condition)
+{
+    while(true)
+    {
+        RunDeviceJobs();
+
+        // Remember how many jobs had finished before checking, so that a job finishing in between
+        // can't be missed
+        uint64 finishedBefore = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finishedBefore = numFinished;
+        }
+
+        if(condition())
+            return;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if(numUnfinished == 0 && numFinished == finishedBefore)
+            throw Exception(L"All jobs finished before the condition of JobGraph::WaitUntil was met");
+
+        finishedCV.wait(lock, [&]()
+        {
+            return numFinished != finishedBefore || deviceQueue.size() > 0 || error;
+        });
+    }
+}
+
+void JobGraph::Wait(JobID job)
+{
+    WaitUntil([&]() { return Finished(job); });
+}
+
+void JobGraph::WaitForAll()
+{
+    WaitUntil([&]() { return Idle(); });
+}
+
+bool JobGraph::Finished(JobID job) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Assert_(job < jobs.size());
+    return jobs[job].Finished;
+}
+
+bool JobGraph::Idle() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return numUnfinished == 0;
+}
+
+void JobGraph::WorkerThread()
+{
+    // WIC and the other COM-based loaders need COM on every thread that uses them
+    CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true)
+    {
+        workerCV.wait(lock, [&]() { return stopping || workerQueue.size() > 0; });
+        if(stopping)
+            break;
+
+        const JobID jobID = workerQueue.front();
+        workerQueue.pop_front();
+        Run(jobID, lock);
+    }
+
+    lock.unlock();
+    CoUninitialize();
+}
+
+}
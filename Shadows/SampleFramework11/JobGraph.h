@@ -0,0 +1,110 @@
+//=================================================================================================
+//
+//  MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "PCH.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace SampleFramework11
+{
+
+// A set of jobs with dependencies between them, run by a pool of worker threads. Jobs that need
+// the immediate context (or otherwise have to stay on the main thread) are added as device jobs,
+// which only run inside RunDeviceJobs and the Wait functions. Jobs can be added from any thread,
+// including from inside other jobs.
+//
+// If a job throws, everything that depends on it gets skipped and the exception is re-thrown on
+// the device thread the next time it runs jobs or waits.
+class JobGraph
+{
+
+public:
+
+    typedef uint32 JobID;
+    typedef std::function<void()> JobFunc;
+
+    JobGraph();
+    ~JobGraph();
+
+    // Starts the worker threads. With numThreads = 0 there's one for each hardware thread, except
+    // the one that's left for the device thread.
+    void Start(uint32 numThreads = 0);
+
+    // Stops the workers once they've finished their current job, and drops everything else
+    void Shutdown();
+
+    // Adds a job that runs on a worker once all of its dependencies have finished
+    JobID AddJob(const JobFunc& func, const JobID* dependencies = nullptr, uint32 numDependencies = 0);
+    JobID AddJob(const JobFunc& func, JobID dependency);
+
+    // Adds a job that runs on the device thread once all of its dependencies have finished
+    JobID AddDeviceJob(const JobFunc& func, const JobID* dependencies = nullptr, uint32 numDependencies = 0);
+    JobID AddDeviceJob(const JobFunc& func, JobID dependency);
+
+    // Runs the device jobs that are ready without waiting for any others, and returns how many ran
+    uint32 RunDeviceJobs();
+
+    // Runs device jobs until the condition is true, sleeping while the workers are busy. The
+    // condition gets checked each time a job finishes.
+    void WaitUntil(const std::function<bool()>& condition);
+
+    // Runs device jobs until the given job or every job has finished
+    void Wait(JobID job);
+    void WaitForAll();
+
+    bool Finished(JobID job) const;
+    bool Idle() const;
+
+    uint32 NumWorkers() const { return uint32(workers.size()); }
+
+protected:
+
+    struct Job
+    {
+        JobFunc Func;
+        std::vector<JobID> Dependents;
+        uint32 NumPendingDependencies;
+        bool DeviceJob;
+        bool Finished;
+        bool Skip;
+    };
+
+    JobID Add(const JobFunc& func, const JobID* dependencies, uint32 numDependencies, bool deviceJob);
+    void Run(JobID jobID, std::unique_lock<std::mutex>& lock);
+    void Enqueue(JobID jobID);
+    void RethrowError();
+    void WorkerThread();
+
+    std::deque<Job> jobs;
+    std::deque<JobID> workerQueue;
+    std::deque<JobID> deviceQueue;
+    uint32 numUnfinished;
+    uint64 numFinished;
+
+    std::vector<std::thread> workers;
+    bool stopping;
+
+    std::exception_ptr error;
+
+    mutable std::mutex mutex;
+    std::condition_variable workerCV;
+    std::condition_variable finishedCV;
+
+    JobGraph(const JobGraph& other);
+    JobGraph& operator=(const JobGraph& other);
+};
+
+}
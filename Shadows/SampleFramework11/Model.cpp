@@ -9,14 +9,20 @@
 
 #include "PCH.h"
 
+#include <emmintrin.h>
+#include <random>
+#include <thread>
+
 #include "Model.h"
 
-#include "SDKmesh.h"
+#include "SDKMeshReader.h"
 #include "Exceptions.h"
 #include "Utility.h"
 #include "GraphicsTypes.h"
 #include "Serialization.h"
 #include "FileIO.h"
+#include "Timer.h"
+#include "TextureCache.h"
 
 using std::string;
 using std::wstring;
@@ -71,7 +77,11 @@ static const D3D11_INPUT_ELEMENT_DESC VertexInputs[5] =
 
 Mesh::Mesh() :  vertexStride(0),
                 numVertices(0),
-                numIndices(0)
+                numIndices(0),
+                externalVertices(nullptr),
+                externalIndices(nullptr),
+                positionScale(1.0f),
+                positionBias(0.0f)
 {
 }
 
@@ -79,64 +89,41 @@ Mesh::~Mesh()
 {
 }
 
-void Mesh::Initialize(ID3D11Device* device, SDKMesh& sdkMesh, uint32 meshIdx, bool generateTangents)
+void Mesh::Initialize(ID3D11Device* device, const SDKMeshReader& sdkMesh, uint32 meshIdx, bool generateTangents)
 {
-    const SDKMESH_MESH& sdkMeshData = *sdkMesh.GetMesh(meshIdx);
-
-    uint32 indexSize = 2;
-    indexType = Mesh::Index16Bit;
-    if(sdkMesh.GetIndexType(meshIdx) == IT_32BIT)
-    {
-        indexSize = 4;
-        indexType = Mesh::Index32Bit;
-    }
-
-    vertexStride = sdkMesh.GetVertexStride(meshIdx, 0);
-    numVertices = static_cast<uint32>(sdkMesh.GetNumVertices(meshIdx, 0));
-    numIndices = static_cast<uint32>(sdkMesh.GetNumIndices(meshIdx));
+    const SDKMeshMeshData& sdkMeshData = sdkMesh.MeshData(meshIdx);
     const uint32 vbIdx = sdkMeshData.VertexBuffers[0];
     const uint32 ibIdx = sdkMeshData.IndexBuffer;
+    const SDKMeshVertexBufferData& vbData = sdkMesh.VertexBuffer(vbIdx);
+
+    const uint32 indexSize = sdkMesh.IndexSize(ibIdx);
+    indexType = indexSize == 4 ? Mesh::Index32Bit : Mesh::Index16Bit;
 
-    CreateInputElements(sdkMesh.VBElements(0));
+    vertexStride = static_cast<uint32>(vbData.StrideBytes);
+    numVertices = static_cast<uint32>(vbData.NumVertices);
+    numIndices = static_cast<uint32>(sdkMesh.IndexBuffer(ibIdx).NumIndices);
 
-    vertices.resize(vertexStride * numVertices, 0);
-    memcpy(vertices.data(), sdkMesh.GetRawVerticesAt(vbIdx), vertexStride * numVertices);
+    CreateInputElements(vbData.Decl, sdkMesh.NumVertexElements(vbIdx));
 
-    indices.resize(indexSize * numIndices, 0);
-    memcpy(indices.data(), sdkMesh.GetRawIndicesAt(ibIdx), indexSize * numIndices);
+    // The reader has already checked that the buffers and indices are inside the file
+    const SDKMeshSpan<uint8> vertexData = sdkMesh.VertexData(vbIdx);
+    vertices.assign(vertexData.begin(), vertexData.end());
+
+    const SDKMeshSpan<uint8> indexData = sdkMesh.IndexData(ibIdx);
+    indices.assign(indexData.begin(), indexData.end());
 
     name = sdkMeshData.Name;
 
     if(generateTangents)
         GenerateTangentFrame();
 
-    D3D11_BUFFER_DESC bufferDesc;
-    bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
-    bufferDesc.ByteWidth = vertexStride * numVertices;
-    bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-    bufferDesc.CPUAccessFlags = 0;
-    bufferDesc.MiscFlags = 0;
-    bufferDesc.StructureByteStride = 0;
-
-    D3D11_SUBRESOURCE_DATA initData;
-    initData.pSysMem = vertices.data();
-    initData.SysMemPitch = 0;
-    initData.SysMemSlicePitch = 0;
-    DXCall(device->CreateBuffer(&bufferDesc, &initData, &vertexBuffer));
-
-    bufferDesc.ByteWidth = indexSize * numIndices;
-    bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-    bufferDesc.MiscFlags = 0;
-    bufferDesc.StructureByteStride = 0;
-
-    initData.pSysMem = indices.data();
-    DXCall(device->CreateBuffer(&bufferDesc, &initData, &indexBuffer));
+    CreateBuffers(device);
 
-    const uint32 numSubsets = sdkMesh.GetNumSubsets(meshIdx);
+    const uint32 numSubsets = sdkMeshData.NumSubsets;
     meshParts.resize(numSubsets);
     for(uint32 i = 0; i < numSubsets; ++i)
     {
-        const SDKMESH_SUBSET& subset = *sdkMesh.GetSubset(meshIdx, i);
+        const SDKMeshSubsetData& subset = sdkMesh.Subset(meshIdx, i);
         MeshPart& part = meshParts[i];
         part.IndexStart = static_cast<uint32>(subset.IndexStart);
         part.IndexCount = static_cast<uint32>(subset.IndexCount);
@@ -377,54 +364,238 @@ void Mesh::InitPlane(ID3D11Device* device, const Float2& dimensions, const Float
     part.MaterialIdx = materialIdx;
 }
 
-void Mesh::GenerateTangentFrame()
+void Mesh::InitFromMemory(ID3D11Device* device, const uint8* vertexData, uint32 numVertices_,
+                          uint32 vertexStride_, const uint8* indexData, uint32 numIndices_,
+                          IndexType indexType_, const D3D11_INPUT_ELEMENT_DESC* elements,
+                          uint32 numElements, const MeshPart* parts, uint32 numParts, const char* name_)
 {
-    // Make sure that we have a position + texture coordinate + normal
-    uint32 posOffset = 0xFFFFFFFF;
-    uint32 nmlOffset = 0xFFFFFFFF;
-    uint32 tcOffset = 0xFFFFFFFF;
-    for(uint32 i = 0; i < inputElements.size(); ++i)
+    Assert_(vertexData != nullptr && indexData != nullptr);
+
+    numVertices = numVertices_;
+    vertexStride = vertexStride_;
+    numIndices = numIndices_;
+    indexType = indexType_;
+    name = name_ != nullptr ? name_ : "";
+
+    vertices.clear();
+    indices.clear();
+    externalVertices = vertexData;
+    externalIndices = indexData;
+
+    inputElements.assign(elements, elements + numElements);
+    inputElementNames.clear();
+    meshParts.assign(parts, parts + numParts);
+    positionScale = 1.0f;
+    positionBias = 0.0f;
+
+    CreateBuffers(device);
+}
+
+void Mesh::InitFromMesh(ID3D11Device* device, const Mesh& source, const uint8* vertexData, uint32 numVertices_,
+                        const uint8* indexData, uint32 numIndices_, IndexType indexType_,
+                        const MeshPart* parts, uint32 numParts, const std::string& name_)
+{
+    Assert_(&source != this);
+
+    vertexStride = source.vertexStride;
+    numVertices = numVertices_;
+    numIndices = numIndices_;
+    indexType = indexType_;
+    name = name_;
+
+    vertices.assign(vertexData, vertexData + uint64(vertexStride) * numVertices);
+    indices.assign(indexData, indexData + uint64(IndexSize()) * numIndices);
+    externalVertices = nullptr;
+    externalIndices = nullptr;
+
+    // The semantic names either point into the source's own copies, which need to be copied
+    // again so that they stay alive with this mesh, or somewhere that outlives both meshes
+    inputElements = source.inputElements;
+    inputElementNames = source.inputElementNames;
+    for(uint64 i = 0; i < inputElements.size(); ++i)
     {
-        const std::string semantic = inputElements[i].SemanticName;
-        const uint32 offset = inputElements[i].AlignedByteOffset;
+        for(uint64 nameIdx = 0; nameIdx < source.inputElementNames.size(); ++nameIdx)
+        {
+            if(inputElements[i].SemanticName == source.inputElementNames[nameIdx].c_str())
+                inputElements[i].SemanticName = inputElementNames[nameIdx].c_str();
+        }
+    }
+
+    meshParts.assign(parts, parts + numParts);
+    positionScale = source.positionScale;
+    positionBias = source.positionBias;
+
+    CreateBuffers(device);
+}
+
+void Mesh::UpdateGeometry(ID3D11Device* device, const uint8* vertexData, const uint8* indexData)
+{
+    // Copy first, since the new data could be coming from the old external pointers
+    std::vector<uint8> newVertices(vertexData, vertexData + vertexStride * numVertices);
+    std::vector<uint8> newIndices(indexData, indexData + IndexSize() * numIndices);
+    vertices.swap(newVertices);
+    indices.swap(newIndices);
+    externalVertices = nullptr;
+    externalIndices = nullptr;
+
+    CreateBuffers(device);
+}
+
+void Mesh::SetVertexFormat(ID3D11Device* device, const uint8* vertexData, uint32 vertexStride_,
+                           const D3D11_INPUT_ELEMENT_DESC* elements, uint32 numElements)
+{
+    // Copy the indices too if they're external, so that the mesh owns all of its data again
+    std::vector<uint8> newVertices(vertexData, vertexData + vertexStride_ * numVertices);
+    if(externalIndices != nullptr)
+        indices.assign(externalIndices, externalIndices + IndexSize() * numIndices);
+    vertices.swap(newVertices);
+    externalVertices = nullptr;
+    externalIndices = nullptr;
+
+    vertexStride = vertexStride_;
+    inputElements.assign(elements, elements + numElements);
+    inputElementNames.clear();
+
+    CreateBuffers(device);
+}
+
+void Mesh::SetPositionDequantization(const Float3& scale, const Float3& bias)
+{
+    positionScale = scale;
+    positionBias = bias;
+}
+
+// Creates immutable vertex and index buffers from the CPU copies
+void Mesh::CreateBuffers(ID3D11Device* device)
+{
+    if(device == nullptr)
+        return;
+
+    D3D11_BUFFER_DESC bufferDesc;
+    bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+    bufferDesc.ByteWidth = vertexStride * numVertices;
+    bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    bufferDesc.CPUAccessFlags = 0;
+    bufferDesc.MiscFlags = 0;
+    bufferDesc.StructureByteStride = 0;
+
+    D3D11_SUBRESOURCE_DATA initData;
+    initData.pSysMem = Vertices();
+    initData.SysMemPitch = 0;
+    initData.SysMemSlicePitch = 0;
+    DXCall(device->CreateBuffer(&bufferDesc, &initData, &vertexBuffer));
+
+    bufferDesc.ByteWidth = IndexSize() * numIndices;
+    bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+
+    initData.pSysMem = Indices();
+    DXCall(device->CreateBuffer(&bufferDesc, &initData, &indexBuffer));
+}
+
+// Where the attributes that the tangent frame is computed from live in a mesh's vertices
+struct TangentFrameInput
+{
+    const uint8* Vertices;
+    uint32 VertexStride;
+    uint32 NumVertices;
+    uint32 PosOffset;
+    uint32 NmlOffset;
+    uint32 TCOffset;
+
+    const uint8* Indices;
+    uint32 IndexSize;
+    uint32 NumIndices;
+};
+
+// Finds the position, normal, and texture coordinate elements. Returns false if one is missing.
+static bool GetTangentFrameInput(const Mesh& mesh, TangentFrameInput& input)
+{
+    input.PosOffset = 0xFFFFFFFF;
+    input.NmlOffset = 0xFFFFFFFF;
+    input.TCOffset = 0xFFFFFFFF;
+    for(uint32 i = 0; i < mesh.NumInputElements(); ++i)
+    {
+        const std::string semantic = mesh.InputElements()[i].SemanticName;
+        const uint32 offset = mesh.InputElements()[i].AlignedByteOffset;
         if(semantic == "POSITION")
-            posOffset = offset;
+            input.PosOffset = offset;
         else if(semantic == "NORMAL")
-            nmlOffset = offset;
+            input.NmlOffset = offset;
         else if(semantic == "TEXCOORD")
-            tcOffset = offset;
+            input.TCOffset = offset;
     }
 
-    if(posOffset == 0xFFFFFFFF || nmlOffset == 0xFFFFFFFF || tcOffset == 0xFFFFFFFF)
-        throw Exception(L"Can't generate a tangent frame, mesh doesn't have positions, normals, and texcoords");
+    input.Vertices = mesh.Vertices();
+    input.VertexStride = mesh.VertexStride();
+    input.NumVertices = mesh.NumVertices();
+    input.Indices = mesh.Indices();
+    input.IndexSize = mesh.IndexSize();
+    input.NumIndices = mesh.NumIndices();
 
-    // Clone the mesh
-    std::vector<Vertex> newVertices(numVertices);
+    return input.PosOffset != 0xFFFFFFFF && input.NmlOffset != 0xFFFFFFFF && input.TCOffset != 0xFFFFFFFF;
+}
 
-    const uint8* vtxData = vertices.data();
-    for(uint32 i = 0; i < numVertices; ++i)
+// Copies the position, normal, and texture coordinate of a vertex
+static void CloneTangentFrameVertex(const TangentFrameInput& input, uint32 vtxIdx, Vertex& vertex)
+{
+    const uint8* vtxData = input.Vertices + uint64(vtxIdx) * input.VertexStride;
+    vertex.Position = *reinterpret_cast<const Float3*>(vtxData + input.PosOffset);
+    vertex.Normal = *reinterpret_cast<const Float3*>(vtxData + input.NmlOffset);
+    vertex.TexCoord = *reinterpret_cast<const Float2*>(vtxData + input.TCOffset);
+}
+
+// Orthogonalizes the summed tangent against the normal, and picks the handedness of the bitangent
+static void FinalizeTangentFrame(Vertex& vertex, const Float3& t, const Float3& bitangentSum)
+{
+    Float3& n = vertex.Normal;
+
+    // Gram-Schmidt orthogonalize
+    Float3 tangent = (t - n * Float3::Dot(n, t));
+    bool zeroTangent = false;
+    if(tangent.Length() > 0.00001f)
+        Float3::Normalize(tangent);
+    else if(n.Length() > 0.00001f)
     {
-        newVertices[i].Position = *reinterpret_cast<const Float3*>(vtxData + posOffset);
-        newVertices[i].Normal = *reinterpret_cast<const Float3*>(vtxData + nmlOffset);
-        newVertices[i].TexCoord = *reinterpret_cast<const Float2*>(vtxData + tcOffset);
-        vtxData += vertexStride;
+        tangent = Float3::Perpendicular(n);
+        zeroTangent = true;
     }
 
-    // Compute the tangent frame for each vertex. The following code is based on
-    // "Computing Tangent Space Basis Vectors for an Arbitrary Mesh", by Eric Lengyel
-    // http://www.terathon.com/code/tangent.html
+    float sign = 1.0f;
+
+    if(!zeroTangent)
+    {
+        Float3 b;
+        b = Float3::Cross(n, t);
+        sign = (Float3::Dot(b, bitangentSum) < 0.0f) ? -1.0f : 1.0f;
+    }
+
+    // Store the tangent + bitangent
+    vertex.Tangent = Float3::Normalize(tangent);
+
+    vertex.Bitangent = Float3::Normalize(Float3::Cross(n, tangent));
+    vertex.Bitangent *= sign;
+}
+
+// Computes the tangent frame for each vertex one triangle at a time, scattering the per-triangle
+// directions into the vertices. The following code is based on "Computing Tangent Space Basis
+// Vectors for an Arbitrary Mesh", by Eric Lengyel
+// http://www.terathon.com/code/tangent.html
+static void ComputeTangentFrameSerial(const TangentFrameInput& input, Vertex* newVertices)
+{
+    const uint32 numVertices = input.NumVertices;
+    for(uint32 i = 0; i < numVertices; ++i)
+        CloneTangentFrameVertex(input, i, newVertices[i]);
 
     // Make temporary arrays for the tangent and the bitangent
     std::vector<Float3> tangents(numVertices);
     std::vector<Float3> bitangents(numVertices);
 
     // Loop through each triangle
-    const uint32 indexSize = indexType == Index16Bit ? 2 : 4;
-    for (uint32 i = 0; i < numIndices; i += 3)
+    for (uint32 i = 0; i < input.NumIndices; i += 3)
     {
-        uint32 i1 = GetIndex(indices.data(), i + 0, indexSize);
-        uint32 i2 = GetIndex(indices.data(), i + 1, indexSize);
-        uint32 i3 = GetIndex(indices.data(), i + 2, indexSize);
+        uint32 i1 = GetIndex(input.Indices, i + 0, input.IndexSize);
+        uint32 i2 = GetIndex(input.Indices, i + 1, input.IndexSize);
+        uint32 i3 = GetIndex(input.Indices, i + 2, input.IndexSize);
 
         const Float3& v1 = newVertices[i1].Position;
         const Float3& v2 = newVertices[i2].Position;
@@ -460,48 +631,200 @@ void Mesh::GenerateTangentFrame()
     }
 
     for (uint32 i = 0; i < numVertices; ++i)
+        FinalizeTangentFrame(newVertices[i], tangents[i], bitangents[i]);
+}
+
+// Same as ComputeTangentFrameSerial, but split into passes that can each run on all cores
+// without any atomics:
+//
+//  1. The triangle directions get computed 4 at a time with SSE in SoA form, and stored with the
+//     6 values of each triangle next to each other so that the gather only touches one line
+//  2. A CSR (compressed sparse row) list of the triangles using each vertex gets built
+//  3. Each vertex gathers the directions of its triangles, and finalizes its tangent frame
+//
+// The triangles of each vertex are listed in the same order that the serial version visits them,
+// and the SSE code does the same operations in the same order as the scalar code, so the results
+// are bit-for-bit the same.
+static void ComputeTangentFrameParallel(const TangentFrameInput& input, Vertex* newVertices)
+{
+    const uint32 numVertices = input.NumVertices;
+    const uint32 numTris = input.NumIndices / 3;
+
+    ParallelFor(numVertices, 0, [&](uint32 start, uint32 end)
     {
-        Float3& n = newVertices[i].Normal;
-        Float3& t = tangents[i];
-
-        // Gram-Schmidt orthogonalize
-        Float3 tangent = (t - n * Float3::Dot(n, t));
-        bool zeroTangent = false;
-        if(tangent.Length() > 0.00001f)
-            Float3::Normalize(tangent);
-        else if(n.Length() > 0.00001f)
+        for(uint32 i = start; i < end; ++i)
+            CloneTangentFrameVertex(input, i, newVertices[i]);
+    }, 4096);
+
+    // Pad to a multiple of 4 triangles, so that the SSE loop never needs a remainder. The padding
+    // triangles use vertex 0, and their results are never read.
+    const uint32 numTriBlocks = (numTris + 3) / 4;
+    std::vector<uint32> indices(uint64(numTriBlocks) * 4 * 3, 0);
+    ParallelFor(numTris * 3, 0, [&](uint32 start, uint32 end)
+    {
+        for(uint32 i = start; i < end; ++i)
+            indices[i] = GetIndex(input.Indices, i, input.IndexSize);
+    }, 16384);
+
+    // Each triangle gets its sDir followed by its tDir
+    std::vector<float> triDirs(uint64(numTriBlocks) * 4 * 6);
+
+    ParallelFor(numTriBlocks, 0, [&](uint32 start, uint32 end)
+    {
+        for(uint32 block = start; block < end; ++block)
         {
-            tangent = Float3::Perpendicular(n);
-            zeroTangent = true;
+            // Transpose the positions and texture coordinates of 4 triangles into SoA form
+            Float4Align float v[3][3][4];
+            Float4Align float w[3][2][4];
+            for(uint32 lane = 0; lane < 4; ++lane)
+            {
+                const uint32* triIndices = &indices[(block * 4 + lane) * 3];
+                for(uint32 corner = 0; corner < 3; ++corner)
+                {
+                    const Vertex& vtx = newVertices[triIndices[corner]];
+                    v[corner][0][lane] = vtx.Position.x;
+                    v[corner][1][lane] = vtx.Position.y;
+                    v[corner][2][lane] = vtx.Position.z;
+                    w[corner][0][lane] = vtx.TexCoord.x;
+                    w[corner][1][lane] = vtx.TexCoord.y;
+                }
+            }
+
+            const __m128 v1x = _mm_load_ps(v[0][0]);
+            const __m128 v1y = _mm_load_ps(v[0][1]);
+            const __m128 v1z = _mm_load_ps(v[0][2]);
+
+            const __m128 x1 = _mm_sub_ps(_mm_load_ps(v[1][0]), v1x);
+            const __m128 x2 = _mm_sub_ps(_mm_load_ps(v[2][0]), v1x);
+            const __m128 y1 = _mm_sub_ps(_mm_load_ps(v[1][1]), v1y);
+            const __m128 y2 = _mm_sub_ps(_mm_load_ps(v[2][1]), v1y);
+            const __m128 z1 = _mm_sub_ps(_mm_load_ps(v[1][2]), v1z);
+            const __m128 z2 = _mm_sub_ps(_mm_load_ps(v[2][2]), v1z);
+
+            const __m128 w1x = _mm_load_ps(w[0][0]);
+            const __m128 w1y = _mm_load_ps(w[0][1]);
+            const __m128 s1 = _mm_sub_ps(_mm_load_ps(w[1][0]), w1x);
+            const __m128 s2 = _mm_sub_ps(_mm_load_ps(w[2][0]), w1x);
+            const __m128 t1 = _mm_sub_ps(_mm_load_ps(w[1][1]), w1y);
+            const __m128 t2 = _mm_sub_ps(_mm_load_ps(w[2][1]), w1y);
+
+            // A real divide rather than _mm_rcp_ps, to match the scalar code
+            const __m128 r = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sub_ps(_mm_mul_ps(s1, t2), _mm_mul_ps(s2, t1)));
+
+            Float4Align float dirs[6][4];
+            _mm_store_ps(dirs[0], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, x1), _mm_mul_ps(t1, x2)), r));
+            _mm_store_ps(dirs[1], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, y1), _mm_mul_ps(t1, y2)), r));
+            _mm_store_ps(dirs[2], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, z1), _mm_mul_ps(t1, z2)), r));
+            _mm_store_ps(dirs[3], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(s1, x2), _mm_mul_ps(s2, x1)), r));
+            _mm_store_ps(dirs[4], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(s1, y2), _mm_mul_ps(s2, y1)), r));
+            _mm_store_ps(dirs[5], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(s1, z2), _mm_mul_ps(s2, z1)), r));
+
+            float* dst = &triDirs[uint64(block) * 4 * 6];
+            for(uint32 lane = 0; lane < 4; ++lane)
+                for(uint32 i = 0; i < 6; ++i)
+                    dst[lane * 6 + i] = dirs[i][lane];
         }
+    }, 1024);
+
+    // Build the vertex -> triangle adjacency. Each thread owns a range of vertices and streams
+    // through all of the indices, so that no two threads ever touch the same counter. Filling it
+    // in triangle order is what keeps the sums in the same order as the serial version.
+    const uint32 numRanges = std::max(std::thread::hardware_concurrency(), 1u);
+    const uint32 rangeSize = (numVertices + numRanges - 1) / numRanges;
+    std::vector<uint32> vertexTriStart(numVertices + 1, 0);
+    ParallelFor(numRanges, numRanges, [&](uint32 start, uint32 end)
+    {
+        const uint32 rangeStart = std::min(start * rangeSize, numVertices);
+        const uint32 rangeCount = std::min(end * rangeSize, numVertices) - rangeStart;
+        for(uint32 i = 0; i < numTris * 3; ++i)
+            if(indices[i] - rangeStart < rangeCount)
+                ++vertexTriStart[indices[i] + 1];
+    }, 1);
 
-        float sign = 1.0f;
+    for(uint32 i = 0; i < numVertices; ++i)
+        vertexTriStart[i + 1] += vertexTriStart[i];
 
-        if(!zeroTangent)
+    std::vector<uint32> vertexTris(numTris * 3);
+    std::vector<uint32> fillOffsets(vertexTriStart.begin(), vertexTriStart.end() - 1);
+    ParallelFor(numRanges, numRanges, [&](uint32 start, uint32 end)
+    {
+        const uint32 rangeStart = std::min(start * rangeSize, numVertices);
+        const uint32 rangeCount = std::min(end * rangeSize, numVertices) - rangeStart;
+        for(uint32 i = 0; i < numTris * 3; ++i)
+            if(indices[i] - rangeStart < rangeCount)
+                vertexTris[fillOffsets[indices[i]]++] = i / 3;
+    }, 1);
+
+    ParallelFor(numVertices, 0, [&](uint32 start, uint32 end)
+    {
+        for(uint32 vtxIdx = start; vtxIdx < end; ++vtxIdx)
         {
-            Float3 b;
-            b = Float3::Cross(n, t);
-            sign = (Float3::Dot(b, bitangents[i]) < 0.0f) ? -1.0f : 1.0f;
+            Float3 tangent;
+            Float3 bitangent;
+            for(uint32 i = vertexTriStart[vtxIdx]; i < vertexTriStart[vtxIdx + 1]; ++i)
+            {
+                const float* dirs = &triDirs[uint64(vertexTris[i]) * 6];
+                tangent += Float3(dirs[0], dirs[1], dirs[2]);
+                bitangent += Float3(dirs[3], dirs[4], dirs[5]);
+            }
+
+            FinalizeTangentFrame(newVertices[vtxIdx], tangent, bitangent);
         }
+    }, 1024);
+}
 
-        // Store the tangent + bitangent
-        newVertices[i].Tangent = Float3::Normalize(tangent);
+void Mesh::GenerateTangentFrame()
+{
+    // Make sure that we have a position + texture coordinate + normal
+    TangentFrameInput input;
+    if(GetTangentFrameInput(*this, input) == false)
+        throw Exception(L"Can't generate a tangent frame, mesh doesn't have positions, normals, and texcoords");
 
-        newVertices[i].Bitangent = Float3::Normalize(Float3::Cross(n, tangent));
-        newVertices[i].Bitangent *= sign;
-    }
+    std::vector<uint8> newVertices(numVertices * sizeof(Vertex));
+    ComputeTangentFrameParallel(input, reinterpret_cast<Vertex*>(newVertices.data()));
 
     inputElements.clear();
     inputElements.resize(sizeof(VertexInputs) / sizeof(D3D11_INPUT_ELEMENT_DESC));
     memcpy(inputElements.data(), VertexInputs, sizeof(VertexInputs));
 
     vertexStride = sizeof(Vertex);
-    vertices.clear();
-    vertices.resize(numVertices * vertexStride);
-    memcpy(vertices.data(), newVertices.data(), numVertices * vertexStride);
+    vertices.swap(newVertices);
+    externalVertices = nullptr;
 }
 
-void Mesh::CreateInputElements(const D3DVERTEXELEMENT9* declaration)
+std::string Mesh::BenchmarkTangentFrame(uint32 numIterations) const
+{
+    TangentFrameInput input;
+    if(GetTangentFrameInput(*this, input) == false)
+        return MakeString("%-24s skipped, needs positions, normals, and texcoords\n", name.c_str());
+
+    std::vector<Vertex> serialVertices(numVertices);
+    std::vector<Vertex> parallelVertices(numVertices);
+
+    double serialTime = 0.0;
+    double parallelTime = 0.0;
+    for(uint32 i = 0; i < numIterations; ++i)
+    {
+        Timer serialTimer;
+        ComputeTangentFrameSerial(input, serialVertices.data());
+        serialTimer.Update();
+        serialTime += serialTimer.ElapsedMillisecondsD();
+
+        Timer parallelTimer;
+        ComputeTangentFrameParallel(input, parallelVertices.data());
+        parallelTimer.Update();
+        parallelTime += parallelTimer.ElapsedMillisecondsD();
+    }
+
+    const bool identical = memcmp(serialVertices.data(), parallelVertices.data(), numVertices * sizeof(Vertex)) == 0;
+    serialTime /= std::max(numIterations, 1u);
+    parallelTime /= std::max(numIterations, 1u);
+    return MakeString("%-24s %9u %9u %10.2f %10.2f %8.2fx %10s\n", name.c_str(), numVertices, numIndices / 3,
+                      serialTime, parallelTime, serialTime / std::max(parallelTime, 0.001),
+                      identical ? "yes" : "NO");
+}
+
+void Mesh::CreateInputElements(const SDKMeshVertexElement* declaration, uint32 numElements)
 {
     map<BYTE, LPCSTR> nameMap;
     nameMap[D3DDECLUSAGE_POSITION] = "POSITION";
@@ -532,11 +855,9 @@ void Mesh::CreateInputElements(const D3DVERTEXELEMENT9* declaration)
     formatMap[D3DDECLTYPE_FLOAT16_2] = DXGI_FORMAT_R16G16_FLOAT;
     formatMap[D3DDECLTYPE_FLOAT16_4] = DXGI_FORMAT_R16G16B16A16_FLOAT;
 
-    // Figure out the number of elements
-    uint32 numInputElements = 0;
-    while(declaration[numInputElements].Stream != 0xFF)
+    for(uint32 i = 0; i < numElements; ++i)
     {
-        const D3DVERTEXELEMENT9& element9 = declaration[numInputElements];
+        const SDKMeshVertexElement& element9 = declaration[i];
         D3D11_INPUT_ELEMENT_DESC element11;
         element11.InputSlot = 0;
         element11.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
@@ -546,8 +867,6 @@ void Mesh::CreateInputElements(const D3DVERTEXELEMENT9* declaration)
         element11.AlignedByteOffset = element9.Offset;
         element11.SemanticIndex = element9.UsageIndex;
         inputElements.push_back(element11);
-
-        numInputElements++;
     }
 }
 
@@ -578,6 +897,12 @@ Model::Model()
 
 Model::~Model()
 {
+    // Gives back the references to the cached textures, so that they can be evicted
+    for(uint64 i = 0; i < meshMaterials.size(); ++i)
+    {
+        TextureCache::GlobalCache.Release(meshMaterials[i].DiffuseMap);
+        TextureCache::GlobalCache.Release(meshMaterials[i].NormalMap);
+    }
 }
 
 void Model::CreateFromSDKMeshFile(ID3D11Device* device, LPCWSTR fileName, const wchar* normalMapSuffix,
@@ -585,27 +910,29 @@ void Model::CreateFromSDKMeshFile(ID3D11Device* device, LPCWSTR fileName, const
 {
     Assert_(FileExists(fileName));
 
-    // Use the SDKMesh class to load in the data
-    SDKMesh sdkMesh;
-    sdkMesh.Create(fileName);
+    // Map the file and parse it in place, so that the vertex and index data only gets copied once
+    MappedFile file(fileName);
+    SDKMeshReader sdkMesh;
+    if(sdkMesh.Parse(file.Data(), file.Size()) == false)
+        throw Exception(wstring(L"Failed to load ") + fileName + L": " + AnsiToWString(sdkMesh.Error()));
 
     wstring directory = GetDirectoryFromFilePath(fileName);
 
     // Make materials
-    uint32 numMaterials = sdkMesh.GetNumMaterials();
+    uint32 numMaterials = sdkMesh.NumMaterials();
     for(uint32 i = 0; i < numMaterials; ++i)
     {
         MeshMaterial material;
-        SDKMESH_MATERIAL* mat = sdkMesh.GetMaterial(i);
-        memcpy(&material.AmbientAlbedo, &mat->Ambient, sizeof(Float4));
-        memcpy(&material.DiffuseAlbedo, &mat->Diffuse, sizeof(Float4));
-        memcpy(&material.SpecularAlbedo, &mat->Specular, sizeof(Float4));
-        memcpy(&material.Emissive, &mat->Emissive, sizeof(Float4));
-        material.Alpha = mat->Diffuse.w;
-        material.SpecularPower = mat->Power;
-        material.DiffuseMapName = AnsiToWString(mat->DiffuseTexture);
-        material.NormalMapName = AnsiToWString(mat->NormalTexture);
-        material.Name = mat->Name;
+        const SDKMeshMaterialData& mat = sdkMesh.Material(i);
+        material.AmbientAlbedo = Float3(mat.Ambient[0], mat.Ambient[1], mat.Ambient[2]);
+        material.DiffuseAlbedo = Float3(mat.Diffuse[0], mat.Diffuse[1], mat.Diffuse[2]);
+        material.SpecularAlbedo = Float3(mat.Specular[0], mat.Specular[1], mat.Specular[2]);
+        material.Emissive = Float3(mat.Emissive[0], mat.Emissive[1], mat.Emissive[2]);
+        material.Alpha = mat.Diffuse[3];
+        material.SpecularPower = mat.Power;
+        material.DiffuseMapName = AnsiToWString(mat.DiffuseTexture);
+        material.NormalMapName = AnsiToWString(mat.NormalTexture);
+        material.Name = mat.Name;
 
         // Add the normal map prefix
         if (normalMapSuffix && material.DiffuseMapName.length() > 0
@@ -616,12 +943,13 @@ void Model::CreateFromSDKMeshFile(ID3D11Device* device, LPCWSTR fileName, const
             material.NormalMapName = base + normalMapSuffix + L"." + extension;
         }
 
-        LoadMaterialResources(material, directory, device);
+        if(device != nullptr)
+            LoadMaterialResources(material, directory, device);
 
         meshMaterials.push_back(material);
     }
 
-    uint32 numMeshes = sdkMesh.GetNumMeshes();
+    uint32 numMeshes = sdkMesh.NumMeshes();
     meshes.resize(numMeshes);
     for(uint32 meshIdx = 0; meshIdx < numMeshes; ++meshIdx)
         meshes[meshIdx].Initialize(device, sdkMesh, meshIdx, generateTangentFrame);
@@ -653,18 +981,248 @@ void Model::GeneratePlaneScene(ID3D11Device* device, const Float2& dimensions, c
     meshes[0].InitPlane(device, dimensions, position, orientation, 0);
 }
 
+// Appends a box where every face is split into a grid of gridSize x gridSize quads. The indices
+// are relative to the start of verts.
+static void AddSubdividedBox(const Float3& dimensions, const Float3& position, const Quaternion& orientation,
+                             uint32 gridSize, std::vector<Vertex>& verts, std::vector<uint16>& indices)
+{
+    static const Float3 FaceNormals[6] =
+    {
+        Float3(0.0f, 1.0f, 0.0f), Float3(0.0f, -1.0f, 0.0f),
+        Float3(0.0f, 0.0f, -1.0f), Float3(0.0f, 0.0f, 1.0f),
+        Float3(-1.0f, 0.0f, 0.0f), Float3(1.0f, 0.0f, 0.0f),
+    };
+
+    const uint32 rowSize = gridSize + 1;
+    for(uint32 face = 0; face < 6; ++face)
+    {
+        // Same winding and tangent frame as InitBox, where the bitangent is normal x tangent
+        const Float3 normal = FaceNormals[face];
+        const Float3 tangent = normal.y != 0.0f ? Float3(1.0f, 0.0f, 0.0f)
+                                                : Float3::Cross(Float3(0.0f, 1.0f, 0.0f), normal);
+        const Float3 bitangent = Float3::Cross(normal, tangent);
+
+        const uint32 faceStart = uint32(verts.size());
+        for(uint32 y = 0; y < rowSize; ++y)
+        {
+            for(uint32 x = 0; x < rowSize; ++x)
+            {
+                const Float2 uv = Float2(float(x) / gridSize, float(y) / gridSize);
+                const Float3 pos = normal + tangent * (uv.x * 2.0f - 1.0f) + bitangent * (uv.y * 2.0f - 1.0f);
+                Vertex vertex(pos, normal, uv, tangent, bitangent);
+                vertex.Transform(position, dimensions * 0.5f, orientation);
+                verts.push_back(vertex);
+            }
+        }
+
+        for(uint32 y = 0; y < gridSize; ++y)
+        {
+            for(uint32 x = 0; x < gridSize; ++x)
+            {
+                const uint16 v00 = uint16(faceStart + y * rowSize + x);
+                const uint16 v10 = uint16(v00 + 1);
+                const uint16 v01 = uint16(v00 + rowSize);
+                const uint16 v11 = uint16(v01 + 1);
+                indices.push_back(v00);
+                indices.push_back(v10);
+                indices.push_back(v11);
+                indices.push_back(v11);
+                indices.push_back(v01);
+                indices.push_back(v00);
+            }
+        }
+    }
+}
+
+void Model::GenerateStressScene(ID3D11Device* device, const StressSceneDesc& desc)
+{
+    Assert_(desc.NumParts > 0 && desc.NumParts <= MaxStressSceneParts);
+
+    MeshMaterial material;
+    material.DiffuseMapName = L"White.png";
+    material.NormalMapName = L"Hex.png";
+    if(device != nullptr)
+        LoadMaterialResources(material, L"..\\Content\\Textures\\", device);
+    meshMaterials.push_back(material);
+
+    // A box with a grid of n x n quads on each face has 12 * n * n triangles, and 6 * (n + 1)^2
+    // vertices which need to fit in 16-bit indices
+    const uint32 MaxGridSize = 103;
+    const float gridSizeF = std::sqrt(desc.TrianglesPerPart / 12.0f) + 0.5f;
+    const uint32 gridSize = Clamp<uint32>(uint32(gridSizeF), 1, MaxGridSize);
+    const uint32 vertsPerPart = 6 * (gridSize + 1) * (gridSize + 1);
+    const uint32 indicesPerPart = 36 * gridSize * gridSize;
+    const uint32 partsPerMesh = 65536 / vertsPerPart;
+
+    std::mt19937 rng(desc.Seed);
+    std::uniform_real_distribution<float> unitDist(0.0f, 1.0f);
+    const float halfArea = desc.AreaSize * 0.5f;
+
+    // Clusters have roughly 500 parts each, and spread out less as there are more of them
+    const uint32 numClusters = std::max<uint32>(desc.NumParts / 500, 1);
+    const float clusterSpread = desc.AreaSize * 0.25f / std::sqrt(float(numClusters));
+    std::vector<Float2> clusterCenters(numClusters);
+    for(uint32 i = 0; i < numClusters; ++i)
+    {
+        const float x = (unitDist(rng) * 2.0f - 1.0f) * halfArea * 0.9f;
+        const float z = (unitDist(rng) * 2.0f - 1.0f) * halfArea * 0.9f;
+        clusterCenters[i] = Float2(x, z);
+    }
+    std::normal_distribution<float> clusterDist(0.0f, clusterSpread);
+
+    // The city grid has one cell per part, with a building or a prop in the middle of each one
+    const uint32 cityCells = uint32(std::ceil(std::sqrt(float(desc.NumParts))));
+    const float cellSize = desc.AreaSize / cityCells;
+    const float blockSize = cellSize * 0.7f;
+
+    const uint32 numMeshes = (desc.NumParts + partsPerMesh - 1) / partsPerMesh;
+    meshes.resize(numMeshes);
+
+    std::vector<Vertex> verts;
+    std::vector<uint16> partIndices;
+    uint32 partIdx = 0;
+    for(uint32 meshIdx = 0; meshIdx < numMeshes; ++meshIdx)
+    {
+        Mesh& mesh = meshes[meshIdx];
+        const uint32 numMeshParts = std::min(partsPerMesh, desc.NumParts - partIdx);
+        verts.clear();
+        verts.reserve(numMeshParts * vertsPerPart);
+        partIndices.clear();
+        partIndices.reserve(numMeshParts * indicesPerPart);
+        mesh.meshParts.resize(numMeshParts);
+
+        for(uint32 i = 0; i < numMeshParts; ++i, ++partIdx)
+        {
+            // Spreads the occluders evenly through the parts, with exactly the requested share
+            const bool occluder = uint64(double(partIdx + 1) * desc.OccluderShare) !=
+                                  uint64(double(partIdx) * desc.OccluderShare);
+
+            Float3 dimensions;
+            if(occluder)
+                dimensions = Float3(6.0f + unitDist(rng) * 6.0f, 4.0f + unitDist(rng) * 4.0f, 0.5f);
+            else
+                dimensions = Float3(0.5f + unitDist(rng) * 1.5f, 0.5f + unitDist(rng) * 1.5f, 0.5f + unitDist(rng) * 1.5f);
+
+            Float2 pos;
+            float angle = unitDist(rng) * XM_2PI;
+            if(desc.PartDistribution == StressSceneDesc::Clustered)
+            {
+                const Float2 center = clusterCenters[partIdx % numClusters];
+                const float x = center.x + clusterDist(rng);
+                const float z = center.y + clusterDist(rng);
+                pos = Float2(Clamp(x, -halfArea, halfArea), Clamp(z, -halfArea, halfArea));
+            }
+            else if(desc.PartDistribution == StressSceneDesc::CityGrid)
+            {
+                // Buildings fill their block, and props sit somewhere inside of theirs
+                const uint32 cellX = partIdx % cityCells;
+                const uint32 cellZ = partIdx / cityCells;
+                pos = Float2((cellX + 0.5f) * cellSize - halfArea, (cellZ + 0.5f) * cellSize - halfArea);
+                angle = 0.0f;
+                if(occluder)
+                {
+                    dimensions = Float3(blockSize, blockSize * (1.0f + unitDist(rng) * 3.0f), blockSize);
+                }
+                else
+                {
+                    dimensions.x = std::min(dimensions.x, blockSize);
+                    dimensions.z = std::min(dimensions.z, blockSize);
+                    pos.x += (unitDist(rng) - 0.5f) * (blockSize - dimensions.x);
+                    pos.y += (unitDist(rng) - 0.5f) * (blockSize - dimensions.z);
+                }
+            }
+            else
+            {
+                const float x = (unitDist(rng) * 2.0f - 1.0f) * halfArea;
+                const float z = (unitDist(rng) * 2.0f - 1.0f) * halfArea;
+                pos = Float2(x, z);
+            }
+
+            MeshPart& part = mesh.meshParts[i];
+            part.VertexStart = uint32(verts.size());
+            part.VertexCount = vertsPerPart;
+            part.IndexStart = uint32(partIndices.size());
+            part.IndexCount = indicesPerPart;
+            part.MaterialIdx = 0;
+
+            const Float3 position = Float3(pos.x, dimensions.y * 0.5f, pos.y);
+            const Quaternion orientation(Float3(0.0f, 1.0f, 0.0f), angle);
+            AddSubdividedBox(dimensions, position, orientation, gridSize, verts, partIndices);
+        }
+
+        mesh.indexType = Mesh::Index16Bit;
+        mesh.vertexStride = sizeof(Vertex);
+        mesh.numVertices = uint32(verts.size());
+        mesh.numIndices = uint32(partIndices.size());
+
+        mesh.inputElements.resize(ArraySize_(VertexInputs));
+        memcpy(mesh.inputElements.data(), VertexInputs, sizeof(VertexInputs));
+
+        const uint8* vertexData = reinterpret_cast<const uint8*>(verts.data());
+        mesh.vertices.assign(vertexData, vertexData + verts.size() * sizeof(Vertex));
+        const uint8* indexData = reinterpret_cast<const uint8*>(partIndices.data());
+        mesh.indices.assign(indexData, indexData + partIndices.size() * sizeof(uint16));
+
+        mesh.name = MakeString("Stress%u", meshIdx);
+        mesh.CreateBuffers(device);
+    }
+}
+
 void Model::LoadMaterialResources(MeshMaterial& material, const wstring& directory, ID3D11Device* device)
+{
+    MeshMaterialTextures textures;
+    DecodeMaterialResources(material, directory, device, textures);
+    CreateMaterialResources(material, device, textures);
+}
+
+// Reads and decodes the diffuse and normal maps, if they exist
+void Model::DecodeMaterialResources(const MeshMaterial& material, const wstring& directory, ID3D11Device* device,
+                                    MeshMaterialTextures& textures)
 {
     // Load the diffuse map
     wstring diffuseMapPath = directory + material.DiffuseMapName;
-    if(material.DiffuseMapName.length() > 1 && FileExists(diffuseMapPath.c_str()))
-        material.DiffuseMap = LoadTexture(device, diffuseMapPath.c_str());
+    textures.HasDiffuseMap = material.DiffuseMapName.length() > 1 && FileExists(diffuseMapPath.c_str());
+    if(textures.HasDiffuseMap)
+        DecodeTexture(device, diffuseMapPath.c_str(), textures.DiffuseMap);
 
     // Load the normal map
     wstring normalMapPath = directory + material.NormalMapName;
 
-    if(material.NormalMapName.length() > 1 && FileExists(normalMapPath.c_str()))
-        material.NormalMap = LoadTexture(device, normalMapPath.c_str());
+    textures.HasNormalMap = material.NormalMapName.length() > 1 && FileExists(normalMapPath.c_str());
+    if(textures.HasNormalMap)
+        DecodeTexture(device, normalMapPath.c_str(), textures.NormalMap);
+}
+
+void Model::CreateMaterialResources(MeshMaterial& material, ID3D11Device* device, const MeshMaterialTextures& textures)
+{
+    if(textures.HasDiffuseMap)
+        material.DiffuseMap = CreateTexture(device, textures.DiffuseMap);
+
+    if(textures.HasNormalMap)
+        material.NormalMap = CreateTexture(device, textures.NormalMap);
+}
+
+void Model::LoadMaterialTextures(ID3D11Device* device, const wstring& directory)
+{
+    for(uint64 i = 0; i < meshMaterials.size(); ++i)
+        LoadMaterialResources(meshMaterials[i], directory, device);
+}
+
+void Model::DecodeMaterialTextures(ID3D11Device* device, uint64 materialIdx, const wstring& directory,
+                                   MeshMaterialTextures& textures) const
+{
+    DecodeMaterialResources(meshMaterials[materialIdx], directory, device, textures);
+}
+
+void Model::CreateMaterialTextures(ID3D11Device* device, uint64 materialIdx, const MeshMaterialTextures& textures)
+{
+    CreateMaterialResources(meshMaterials[materialIdx], device, textures);
+}
+
+void Model::CreateBuffers(ID3D11Device* device)
+{
+    for(uint64 i = 0; i < meshes.size(); ++i)
+        meshes[i].CreateBuffers(device);
 }
 
 void Model::WriteToFile(const wchar* path, ID3D11Device* device, ID3D11DeviceContext* context)
@@ -909,7 +1467,7 @@ void Model::SaveAsOBJ(const wchar* path)
 
             for(uint32 vtxIdx = 0; vtxIdx < mesh.numVertices; ++vtxIdx)
             {
-                const Float3* pos = (const Float3*)&mesh.vertices[vtxIdx * mesh.vertexStride + posElem.AlignedByteOffset];
+                const Float3* pos = (const Float3*)&mesh.Vertices()[vtxIdx * mesh.vertexStride + posElem.AlignedByteOffset];
                 objContents += MakeString("v %f %f %f\n", pos->x, pos->y, pos->z);
             }
         }
@@ -924,7 +1482,7 @@ void Model::SaveAsOBJ(const wchar* path)
 
             for(uint32 vtxIdx = 0; vtxIdx < mesh.numVertices; ++vtxIdx)
             {
-                const Float2* uv = (const Float2*)&mesh.vertices[vtxIdx * mesh.vertexStride + uvElem.AlignedByteOffset];
+                const Float2* uv = (const Float2*)&mesh.Vertices()[vtxIdx * mesh.vertexStride + uvElem.AlignedByteOffset];
                 objContents += MakeString("vt %f %f\n", uv->x, 1.0f - uv->y);
             }
         }
@@ -939,7 +1497,7 @@ void Model::SaveAsOBJ(const wchar* path)
 
             for(uint32 vtxIdx = 0; vtxIdx < mesh.numVertices; ++vtxIdx)
             {
-                const Float3* nml = (const Float3*)&mesh.vertices[vtxIdx * mesh.vertexStride + nmlElem.AlignedByteOffset];
+                const Float3* nml = (const Float3*)&mesh.Vertices()[vtxIdx * mesh.vertexStride + nmlElem.AlignedByteOffset];
                 objContents += MakeString("vn %f %f %f\n", nml->x, nml->y, nml->z);
             }
         }
@@ -954,8 +1512,8 @@ void Model::SaveAsOBJ(const wchar* path)
                 objContents += MakeString("g %s_%u\n", mesh.name.c_str(), meshPartIdx);
                 objContents += MakeString("usemtl %s\n", meshMaterials[meshPart.MaterialIdx].Name.c_str());
 
-                const uint16* indices16 = (const uint16*)(mesh.indices.data() + (meshPart.IndexStart * 2));
-                const uint32* indices32 = (const uint32*)(mesh.indices.data() + (meshPart.IndexStart * 4));
+                const uint16* indices16 = (const uint16*)(mesh.Indices() + (meshPart.IndexStart * 2));
+                const uint32* indices32 = (const uint32*)(mesh.Indices() + (meshPart.IndexStart * 4));
 
                 Assert_(meshPart.IndexCount % 3 == 0);
                 const uint32 numTris = meshPart.IndexCount / 3;
@@ -980,4 +1538,16 @@ void Model::SaveAsOBJ(const wchar* path)
     }
 }
 
+std::string Model::BenchmarkTangentFrames(uint32 numIterations) const
+{
+    std::string report = MakeString("Tangent frame generation, average of %u runs:\n", numIterations);
+    report += MakeString("%-24s %9s %9s %10s %10s %9s %10s\n", "Mesh", "Verts", "Tris", "Serial ms",
+                         "Parallel ms", "Speedup", "Identical");
+
+    for(uint64 i = 0; i < meshes.size(); ++i)
+        report += meshes[i].BenchmarkTangentFrame(numIterations);
+
+    return report;
+}
+
 }
\ No newline at end of file
@@ -13,11 +13,13 @@
 
 #include "InterfacePointers.h"
 #include "Math.h"
+#include "Utility.h"
 
 namespace SampleFramework11
 {
 
-class SDKMesh;
+class SDKMeshReader;
+struct SDKMeshVertexElement;
 
 struct MeshMaterial
 {
@@ -38,6 +40,19 @@ struct MeshMaterial
     }
 };
 
+// The diffuse and normal maps for a MeshMaterial, read and decoded but not created yet
+struct MeshMaterialTextures
+{
+    bool HasDiffuseMap;
+    bool HasNormalMap;
+    TextureData DiffuseMap;
+    TextureData NormalMap;
+
+    MeshMaterialTextures() : HasDiffuseMap(false), HasNormalMap(false)
+    {
+    }
+};
+
 struct MeshPart
 {
     uint32 VertexStart;
@@ -67,8 +82,9 @@ public:
     Mesh();
     ~Mesh();
 
-    // Init from loaded files
-    void Initialize(ID3D11Device* device, SDKMesh& sdkmesh, uint32 meshIdx, bool generateTangents);
+    // Init from loaded files. All of the Init/Update/Set functions skip creating the buffers if
+    // the device is null, so that they can be called from worker threads.
+    void Initialize(ID3D11Device* device, const SDKMeshReader& sdkMesh, uint32 meshIdx, bool generateTangents);
 
     // Procedural generation
     void InitBox(ID3D11Device* device, const Float3& dimensions, const Float3& position,
@@ -77,6 +93,37 @@ public:
     void InitPlane(ID3D11Device* device, const Float2& dimensions, const Float3& position,
                    const Quaternion& orientation, uint32 materialIdx);
 
+    // Init from vertex and index data that's owned by someone else (such as a memory-mapped
+    // file), which needs to stay alive for as long as the mesh does. Nothing gets copied except
+    // the parts and input elements, and the semantic names need to stay alive as well.
+    void InitFromMemory(ID3D11Device* device, const uint8* vertexData, uint32 numVertices,
+                        uint32 vertexStride, const uint8* indexData, uint32 numIndices,
+                        IndexType indexType, const D3D11_INPUT_ELEMENT_DESC* elements,
+                        uint32 numElements, const MeshPart* parts, uint32 numParts, const char* name);
+
+    // Init with a copy of the given vertex and index data, in the same vertex format (and with the
+    // same position dequantization) as another mesh, such as when splitting it into pieces
+    void InitFromMesh(ID3D11Device* device, const Mesh& source, const uint8* vertexData, uint32 numVertices,
+                      const uint8* indexData, uint32 numIndices, IndexType indexType,
+                      const MeshPart* parts, uint32 numParts, const std::string& name);
+
+    // Replaces the vertices and indices with data of the same size (such as a reordered copy of
+    // the current data), and re-creates the buffers
+    void UpdateGeometry(ID3D11Device* device, const uint8* vertexData, const uint8* indexData);
+
+    // Replaces the vertices with data in a different vertex format (such as a compressed copy of
+    // the current data), and re-creates the vertex buffer. The semantic names need to stay alive
+    // for as long as the mesh does.
+    void SetVertexFormat(ID3D11Device* device, const uint8* vertexData, uint32 vertexStride,
+                         const D3D11_INPUT_ELEMENT_DESC* elements, uint32 numElements);
+
+    // Scale and bias that map quantized positions back to object space
+    void SetPositionDequantization(const Float3& scale, const Float3& bias);
+
+    // Times the serial and parallel tangent frame generation on the current vertices and checks
+    // that they give the same results, without modifying the mesh. Returns a line for a report.
+    std::string BenchmarkTangentFrame(uint32 numIterations) const;
+
     // Rendering
     void Render(ID3D11DeviceContext* context);
 
@@ -100,13 +147,19 @@ public:
     DXGI_FORMAT IndexBufferFormat() const { return indexType == Index32Bit ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT; }
     uint32 IndexSize() const { return indexType == Index32Bit ? 4 : 2; }
 
-    const uint8* Vertices() const { return vertices.data(); }
-    const uint8* Indices() const { return indices.data(); }
+    const uint8* Vertices() const { return externalVertices != nullptr ? externalVertices : vertices.data(); }
+    const uint8* Indices() const { return externalIndices != nullptr ? externalIndices : indices.data(); }
+
+    const std::string& Name() const { return name; }
+
+    const Float3& PositionScale() const { return positionScale; }
+    const Float3& PositionBias() const { return positionBias; }
 
 protected:
 
     void GenerateTangentFrame();
-    void CreateInputElements(const D3DVERTEXELEMENT9* declaration);
+    void CreateInputElements(const SDKMeshVertexElement* declaration, uint32 numElements);
+    void CreateBuffers(ID3D11Device* device);
 
     ID3D11BufferPtr vertexBuffer;
     ID3D11BufferPtr indexBuffer;
@@ -125,9 +178,40 @@ protected:
     std::vector<uint8> vertices;
     std::vector<uint8> indices;
 
+    const uint8* externalVertices;
+    const uint8* externalIndices;
+
     std::string name;
+
+    Float3 positionScale;
+    Float3 positionBias;
+};
+
+// Parameters for Model::GenerateStressScene
+struct StressSceneDesc
+{
+    enum Distribution
+    {
+        Uniform = 0,        // Spread evenly over the whole area
+        Clustered = 1,      // Bunched up around random points, with empty space in between
+        CityGrid = 2,       // Axis-aligned blocks on a grid, with streets in between
+    };
+
+    uint32 NumParts;
+    Distribution PartDistribution;
+    uint32 TrianglesPerPart;        // Rounded to the nearest box subdivision
+    float OccluderShare;            // Fraction of the parts that are large walls or buildings
+    float AreaSize;                 // Size of the square around the origin that gets filled
+    uint32 Seed;
+
+    StressSceneDesc() : NumParts(10000), PartDistribution(Uniform), TrianglesPerPart(12),
+                        OccluderShare(0.05f), AreaSize(200.0f), Seed(1)
+    {
+    }
 };
 
+static const uint32 MaxStressSceneParts = 1024 * 1024;
+
 class Model
 {
 public:
@@ -136,7 +220,8 @@ public:
     Model();
     ~Model();
 
-    // Loading from file formats
+    // Loading from file formats. With a null device the model only gets its CPU data, and the
+    // buffers and textures need to be created afterwards.
     void CreateFromSDKMeshFile(ID3D11Device* device, LPCWSTR fileName,
                                 const wchar* normalMapSuffix = NULL,
                                 bool generateTangentFrame = false,
@@ -147,12 +232,32 @@ public:
     void GeneratePlaneScene(ID3D11Device* device, const Float2& dimensions, const Float3& position,
                             const Quaternion& orientation);
 
+    // Generates a scene of boxes sitting on the XZ plane for benchmarking, where every box is its
+    // own MeshPart so that it gets culled on its own. The boxes get packed into meshes with 16-bit
+    // indices. With a null device only the CPU data gets created, as with CreateFromSDKMeshFile.
+    void GenerateStressScene(ID3D11Device* device, const StressSceneDesc& desc);
+
     // Serialization
     void WriteToFile(const wchar* path, ID3D11Device* device, ID3D11DeviceContext* context);
     void ReadFromFile(const wchar* path, ID3D11Device* device);
 
     void SaveAsOBJ(const wchar* path);
 
+    // Runs Mesh::BenchmarkTangentFrame on every mesh, and returns a report
+    std::string BenchmarkTangentFrames(uint32 numIterations) const;
+
+    // Loads the diffuse and normal maps for all materials, relative to the given directory
+    void LoadMaterialTextures(ID3D11Device* device, const std::wstring& directory);
+
+    // LoadMaterialTextures for a single material, split so that the files can be read and decoded
+    // on a worker thread and the textures created later on the thread that owns the device
+    void DecodeMaterialTextures(ID3D11Device* device, uint64 materialIdx, const std::wstring& directory,
+                                MeshMaterialTextures& textures) const;
+    void CreateMaterialTextures(ID3D11Device* device, uint64 materialIdx, const MeshMaterialTextures& textures);
+
+    // Creates the vertex and index buffers of meshes that were loaded without a device
+    void CreateBuffers(ID3D11Device* device);
+
     // Accessors
     std::vector<MeshMaterial>& Materials() { return meshMaterials; };
     const std::vector<MeshMaterial>& Materials() const { return meshMaterials; };
@@ -163,6 +268,10 @@ public:
 protected:
 
     static void LoadMaterialResources(MeshMaterial& material, const std::wstring& directory, ID3D11Device* device);
+    static void DecodeMaterialResources(const MeshMaterial& material, const std::wstring& directory,
+                                        ID3D11Device* device, MeshMaterialTextures& textures);
+    static void CreateMaterialResources(MeshMaterial& material, ID3D11Device* device,
+                                        const MeshMaterialTextures& textures);
 
     std::vector<Mesh> meshes;
     std::vector<MeshMaterial> meshMaterials;
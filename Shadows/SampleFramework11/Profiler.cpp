@@ -76,11 +76,12 @@ void Profiler::EndProfile(const wstring& name)
     profileData.QueryFinished = true;
 }
 
+// CPU profiles can be started and ended multiple times per frame, in which case the
+// time is accumulated
 void Profiler::StartCPUProfile(const wstring& name)
 {
     ProfileData& profileData = profiles[name];
     Assert_(profileData.QueryStarted == false);
-    Assert_(profileData.QueryFinished == false);
     profileData.CPUProfile = true;
     profileData.Active = true;
 
@@ -98,6 +99,7 @@ void Profiler::EndCPUProfile(const wstring& name)
 
     timer.Update();
     profileData.EndTime = timer.ElapsedMicroseconds();
+    profileData.CPUTime += profileData.EndTime - profileData.StartTime;
 
     profileData.QueryStarted = false;
     profileData.QueryFinished = true;
@@ -134,7 +136,8 @@ void Profiler::EndFrame(SpriteRenderer& spriteRenderer, SpriteFont& spriteFont)
         float time = 0.0f;
         if(profile.CPUProfile)
         {
-            time = (profile.EndTime - profile.StartTime) / 1000.0f;
+            time = profile.CPUTime / 1000.0f;
+            profile.CPUTime = 0;
         }
         else
         {
@@ -178,6 +181,16 @@ void Profiler::EndFrame(SpriteRenderer& spriteRenderer, SpriteFont& spriteFont)
     }
 }
 
+float Profiler::LastTime(const wstring& name) const
+{
+    auto iter = profiles.find(name);
+    if(iter == profiles.end())
+        return 0.0f;
+
+    const ProfileData& profile = (*iter).second;
+    return profile.TimeSamples[(profile.CurrSample + ProfileData::FilterSize - 1) % ProfileData::FilterSize];
+}
+
 // == ProfileBlock ================================================================================
 
 ProfileBlock::ProfileBlock(const std::wstring& name) : name(name)
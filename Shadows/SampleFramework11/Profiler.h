@@ -37,6 +37,9 @@ public:
 
     void EndFrame(SpriteRenderer& spriteRenderer, SpriteFont& spriteFont);
 
+    // Returns the time in milliseconds recorded for a profile in the last frame, or 0 if it doesn't exist
+    float LastTime(const std::wstring& name) const;
+
 protected:
 
     // Constants
@@ -54,13 +57,14 @@ protected:
         bool CPUProfile;
         int64 StartTime;
         int64 EndTime;
+        int64 CPUTime;
 
         static const uint32 FilterSize = 64;
         float TimeSamples[FilterSize];
         uint32 CurrSample;
 
         ProfileData() : QueryStarted(false), QueryFinished(false), Active(false),
-                        CPUProfile(false), StartTime(0), EndTime(0), CurrSample(0)
+                        CPUProfile(false), StartTime(0), EndTime(0), CPUTime(0), CurrSample(0)
         {
             for(uint32 i = 0; i < FilterSize; ++i)
                 TimeSamples[i] = 0.0f;
@@ -0,0 +1,413 @@
+//=================================================================================================
+//
+//  MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+// This header only depends on the C/C++ standard library, so that it can be used by tools and
+// benchmarks that get built without the Windows and D3D headers
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef uint8_t uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef uint64_t uint64;
+
+namespace SampleFramework11
+{
+
+// Mirrors of the structures in SDKMesh.h, with the pointer unions replaced by their 64-bit
+// offsets and the D3D9 types replaced by plain integers
+static const uint32 SDKMeshFileVersion = 101;
+static const uint32 SDKMeshMaxVertexElements = 32;
+static const uint32 SDKMeshMaxVertexStreams = 16;
+static const uint32 SDKMeshMaxNameLength = 100;
+static const uint32 SDKMeshMaxPathLength = 260;
+
+struct SDKMeshHeaderData
+{
+    uint32 Version;
+    uint8 IsBigEndian;
+    uint64 HeaderSize;
+    uint64 NonBufferDataSize;
+    uint64 BufferDataSize;
+
+    uint32 NumVertexBuffers;
+    uint32 NumIndexBuffers;
+    uint32 NumMeshes;
+    uint32 NumTotalSubsets;
+    uint32 NumFrames;
+    uint32 NumMaterials;
+
+    uint64 VertexStreamHeadersOffset;
+    uint64 IndexStreamHeadersOffset;
+    uint64 MeshDataOffset;
+    uint64 SubsetDataOffset;
+    uint64 FrameDataOffset;
+    uint64 MaterialDataOffset;
+};
+
+// Same layout as D3DVERTEXELEMENT9, where a Stream of 0xFF marks the end of the declaration
+struct SDKMeshVertexElement
+{
+    uint16 Stream;
+    uint16 Offset;
+    uint8 Type;
+    uint8 Method;
+    uint8 Usage;
+    uint8 UsageIndex;
+};
+
+struct SDKMeshVertexBufferData
+{
+    uint64 NumVertices;
+    uint64 SizeBytes;
+    uint64 StrideBytes;
+    SDKMeshVertexElement Decl[SDKMeshMaxVertexElements];
+    uint64 DataOffset;
+};
+
+struct SDKMeshIndexBufferData
+{
+    uint64 NumIndices;
+    uint64 SizeBytes;
+    uint32 IndexType;
+    uint64 DataOffset;
+};
+
+struct SDKMeshMeshData
+{
+    char Name[SDKMeshMaxNameLength];
+    uint8 NumVertexBuffers;
+    uint32 VertexBuffers[SDKMeshMaxVertexStreams];
+    uint32 IndexBuffer;
+    uint32 NumSubsets;
+    uint32 NumFrameInfluences;
+    float BoundingBoxCenter[3];
+    float BoundingBoxExtents[3];
+    uint64 SubsetOffset;
+    uint64 FrameInfluenceOffset;
+};
+
+struct SDKMeshSubsetData
+{
+    char Name[SDKMeshMaxNameLength];
+    uint32 MaterialID;
+    uint32 PrimitiveType;
+    uint64 IndexStart;
+    uint64 IndexCount;
+    uint64 VertexStart;
+    uint64 VertexCount;
+};
+
+struct SDKMeshMaterialData
+{
+    char Name[SDKMeshMaxNameLength];
+    char MaterialInstancePath[SDKMeshMaxPathLength];
+    char DiffuseTexture[SDKMeshMaxPathLength];
+    char NormalTexture[SDKMeshMaxPathLength];
+    char SpecularTexture[SDKMeshMaxPathLength];
+    float Diffuse[4];
+    float Ambient[4];
+    float Specular[4];
+    float Emissive[4];
+    float Power;
+    uint64 RuntimePointers[6];
+};
+
+static_assert(sizeof(SDKMeshHeaderData) == 104, "SDKMesh header layout doesn't match the file format");
+static_assert(sizeof(SDKMeshVertexElement) == 8, "SDKMesh vertex element layout doesn't match the file format");
+static_assert(sizeof(SDKMeshVertexBufferData) == 288, "SDKMesh vertex buffer layout doesn't match the file format");
+static_assert(sizeof(SDKMeshIndexBufferData) == 32, "SDKMesh index buffer layout doesn't match the file format");
+static_assert(sizeof(SDKMeshMeshData) == 224, "SDKMesh mesh layout doesn't match the file format");
+static_assert(sizeof(SDKMeshSubsetData) == 144, "SDKMesh subset layout doesn't match the file format");
+static_assert(sizeof(SDKMeshMaterialData) == 1256, "SDKMesh material layout doesn't match the file format");
+
+// Size in bytes of a vertex element with the given D3DDECLTYPE, or 0 for types that can't be in a
+// vertex declaration
+inline uint32 SDKMeshVertexElementSize(uint8 type)
+{
+    static const uint8 Sizes[] =
+    {
+        4, 8, 12, 16,       // FLOAT1, FLOAT2, FLOAT3, FLOAT4
+        4, 4, 4, 8,         // D3DCOLOR, UBYTE4, SHORT2, SHORT4
+        4, 4, 8, 4, 8,      // UBYTE4N, SHORT2N, SHORT4N, USHORT2N, USHORT4N
+        4, 4,               // UDEC3, DEC3N
+        4, 8,               // FLOAT16_2, FLOAT16_4
+    };
+
+    return type < sizeof(Sizes) ? Sizes[type] : 0;
+}
+
+// Read-only view of an array inside the file
+template<typename T> struct SDKMeshSpan
+{
+    const T* Data;
+    uint64 Count;
+
+    SDKMeshSpan() : Data(nullptr), Count(0) {}
+    SDKMeshSpan(const T* data, uint64 count) : Data(data), Count(count) {}
+
+    const T& operator[](uint64 idx) const { return Data[idx]; }
+    const T* begin() const { return Data; }
+    const T* end() const { return Data + Count; }
+    uint64 Size() const { return Count; }
+};
+
+// Parses an .sdkmesh file that's already in memory (typically a MappedFile), without copying or
+// patching any of it. Every offset and count in the file gets checked against the size of the
+// file before anything gets handed out, including the index values, so the accessors can't be
+// used to read outside of the file. The data needs to stay alive while the reader is in use.
+class SDKMeshReader
+{
+
+public:
+
+    SDKMeshReader() : fileData(nullptr), fileSize(0), header(nullptr), error("No data")
+    {
+    }
+
+    // Returns false if the file isn't a valid .sdkmesh, in which case Error() says why
+    bool Parse(const uint8* data, uint64 size)
+    {
+        fileData = data;
+        fileSize = size;
+        header = nullptr;
+        error = nullptr;
+
+        if(data == nullptr || size < sizeof(SDKMeshHeaderData))
+            return Fail("File is smaller than the header");
+
+        const SDKMeshHeaderData* h = reinterpret_cast<const SDKMeshHeaderData*>(data);
+        if(h->Version != SDKMeshFileVersion)
+            return Fail("Unsupported file version");
+        if(h->IsBigEndian != 0)
+            return Fail("Big-endian files aren't supported");
+
+        // The header and tables come first, followed by the vertex and index data
+        const uint64 staticSize = h->HeaderSize + h->NonBufferDataSize;
+        if(h->HeaderSize < sizeof(SDKMeshHeaderData) || staticSize < h->HeaderSize || staticSize > size ||
+           h->BufferDataSize > size - staticSize)
+            return Fail("Header sizes are outside of the file");
+
+        if(Table<SDKMeshVertexBufferData>(h->VertexStreamHeadersOffset, h->NumVertexBuffers, staticSize) == false ||
+           Table<SDKMeshIndexBufferData>(h->IndexStreamHeadersOffset, h->NumIndexBuffers, staticSize) == false ||
+           Table<SDKMeshMeshData>(h->MeshDataOffset, h->NumMeshes, staticSize) == false ||
+           Table<SDKMeshSubsetData>(h->SubsetDataOffset, h->NumTotalSubsets, staticSize) == false ||
+           Table<SDKMeshMaterialData>(h->MaterialDataOffset, h->NumMaterials, staticSize) == false)
+            return Fail("Header tables are outside of the file");
+
+        header = h;
+        const uint64 bufferEnd = staticSize + h->BufferDataSize;
+
+        for(uint32 vbIdx = 0; vbIdx < h->NumVertexBuffers; ++vbIdx)
+        {
+            const SDKMeshVertexBufferData& vb = VertexBuffer(vbIdx);
+            if(vb.StrideBytes == 0 || vb.StrideBytes > UINT32_MAX || vb.NumVertices > UINT32_MAX ||
+               vb.NumVertices > vb.SizeBytes / vb.StrideBytes)
+                return Fail("Vertex buffer has an invalid size");
+            if(RangeInside(vb.DataOffset, vb.SizeBytes, 1, staticSize, bufferEnd) == false)
+                return Fail("Vertex buffer data is outside of the file");
+            if(NumVertexElements(vbIdx) == SDKMeshMaxVertexElements)
+                return Fail("Vertex declaration isn't terminated");
+
+            for(uint32 i = 0; i < NumVertexElements(vbIdx); ++i)
+            {
+                const uint32 elementSize = SDKMeshVertexElementSize(vb.Decl[i].Type);
+                if(elementSize == 0)
+                    return Fail("Vertex element has an unknown type");
+                if(vb.Decl[i].Offset + elementSize > vb.StrideBytes)
+                    return Fail("Vertex element is outside of the vertex stride");
+            }
+        }
+
+        for(uint32 ibIdx = 0; ibIdx < h->NumIndexBuffers; ++ibIdx)
+        {
+            const SDKMeshIndexBufferData& ib = IndexBuffer(ibIdx);
+            if(ib.IndexType > 1 || ib.NumIndices > UINT32_MAX || ib.NumIndices > ib.SizeBytes / IndexSize(ibIdx))
+                return Fail("Index buffer has an invalid size");
+            if(RangeInside(ib.DataOffset, ib.SizeBytes, 1, staticSize, bufferEnd) == false)
+                return Fail("Index buffer data is outside of the file");
+        }
+
+        for(uint32 meshIdx = 0; meshIdx < h->NumMeshes; ++meshIdx)
+        {
+            const SDKMeshMeshData& mesh = MeshData(meshIdx);
+            if(Terminated(mesh.Name) == false)
+                return Fail("Mesh name isn't terminated");
+            if(mesh.NumVertexBuffers == 0 || mesh.NumVertexBuffers > SDKMeshMaxVertexStreams ||
+               mesh.IndexBuffer >= h->NumIndexBuffers)
+                return Fail("Mesh references an invalid buffer");
+            for(uint32 i = 0; i < mesh.NumVertexBuffers; ++i)
+                if(mesh.VertexBuffers[i] >= h->NumVertexBuffers)
+                    return Fail("Mesh references an invalid buffer");
+            if(Table<uint32>(mesh.SubsetOffset, mesh.NumSubsets, staticSize) == false)
+                return Fail("Mesh subset list is outside of the file");
+
+            // Every index needs to reference a vertex in the mesh's first stream
+            const uint64 numVertices = VertexBuffer(mesh.VertexBuffers[0]).NumVertices;
+            const uint64 numIndices = IndexBuffer(mesh.IndexBuffer).NumIndices;
+            const uint8* indices = IndexData(mesh.IndexBuffer).Data;
+            const bool indices32 = IndexSize(mesh.IndexBuffer) == 4;
+            for(uint64 i = 0; i < numIndices; ++i)
+            {
+                const uint32 idx = indices32 ? ReadIndex32(indices, i) : ReadIndex16(indices, i);
+                if(idx >= numVertices)
+                    return Fail("Index references a vertex outside of the vertex buffer");
+            }
+
+            const SDKMeshSpan<uint32> subsetIndices = SubsetIndices(meshIdx);
+            for(uint32 i = 0; i < subsetIndices.Size(); ++i)
+            {
+                if(subsetIndices[i] >= h->NumTotalSubsets)
+                    return Fail("Mesh references an invalid subset");
+
+                const SDKMeshSubsetData& subset = Subset(meshIdx, i);
+                if(Terminated(subset.Name) == false)
+                    return Fail("Subset name isn't terminated");
+                if(subset.IndexStart > numIndices || subset.IndexCount > numIndices - subset.IndexStart)
+                    return Fail("Subset is outside of the index buffer");
+                if(subset.MaterialID >= h->NumMaterials)
+                    return Fail("Subset references an invalid material");
+            }
+        }
+
+        for(uint32 matIdx = 0; matIdx < h->NumMaterials; ++matIdx)
+        {
+            const SDKMeshMaterialData& material = Material(matIdx);
+            if(Terminated(material.Name) == false || Terminated(material.MaterialInstancePath) == false ||
+               Terminated(material.DiffuseTexture) == false || Terminated(material.NormalTexture) == false ||
+               Terminated(material.SpecularTexture) == false)
+                return Fail("Material string isn't terminated");
+        }
+
+        return true;
+    }
+
+    bool Valid() const { return header != nullptr; }
+    const char* Error() const { return error; }
+
+    // Accessors, which are only valid after a successful Parse()
+    const SDKMeshHeaderData& Header() const { return *header; }
+
+    uint32 NumMeshes() const { return header->NumMeshes; }
+    uint32 NumMaterials() const { return header->NumMaterials; }
+    uint32 NumVertexBuffers() const { return header->NumVertexBuffers; }
+    uint32 NumIndexBuffers() const { return header->NumIndexBuffers; }
+
+    const SDKMeshMeshData& MeshData(uint32 meshIdx) const
+    {
+        return At<SDKMeshMeshData>(header->MeshDataOffset)[meshIdx];
+    }
+
+    const SDKMeshMaterialData& Material(uint32 matIdx) const
+    {
+        return At<SDKMeshMaterialData>(header->MaterialDataOffset)[matIdx];
+    }
+
+    const SDKMeshVertexBufferData& VertexBuffer(uint32 vbIdx) const
+    {
+        return At<SDKMeshVertexBufferData>(header->VertexStreamHeadersOffset)[vbIdx];
+    }
+
+    const SDKMeshIndexBufferData& IndexBuffer(uint32 ibIdx) const
+    {
+        return At<SDKMeshIndexBufferData>(header->IndexStreamHeadersOffset)[ibIdx];
+    }
+
+    // Number of elements in a vertex declaration, not counting the terminator
+    uint32 NumVertexElements(uint32 vbIdx) const
+    {
+        const SDKMeshVertexBufferData& vb = VertexBuffer(vbIdx);
+        uint32 numElements = 0;
+        while(numElements < SDKMeshMaxVertexElements && vb.Decl[numElements].Stream != 0xFF)
+            ++numElements;
+        return numElements;
+    }
+
+    uint32 IndexSize(uint32 ibIdx) const { return IndexBuffer(ibIdx).IndexType == 1 ? 4 : 2; }
+
+    // Only the vertices and indices that are in use (NumVertices * StrideBytes)
+    SDKMeshSpan<uint8> VertexData(uint32 vbIdx) const
+    {
+        const SDKMeshVertexBufferData& vb = VertexBuffer(vbIdx);
+        return SDKMeshSpan<uint8>(fileData + vb.DataOffset, vb.NumVertices * vb.StrideBytes);
+    }
+
+    SDKMeshSpan<uint8> IndexData(uint32 ibIdx) const
+    {
+        const SDKMeshIndexBufferData& ib = IndexBuffer(ibIdx);
+        return SDKMeshSpan<uint8>(fileData + ib.DataOffset, ib.NumIndices * IndexSize(ibIdx));
+    }
+
+    SDKMeshSpan<uint32> SubsetIndices(uint32 meshIdx) const
+    {
+        const SDKMeshMeshData& mesh = MeshData(meshIdx);
+        return SDKMeshSpan<uint32>(At<uint32>(mesh.SubsetOffset), mesh.NumSubsets);
+    }
+
+    const SDKMeshSubsetData& Subset(uint32 meshIdx, uint32 subsetIdx) const
+    {
+        return At<SDKMeshSubsetData>(header->SubsetDataOffset)[SubsetIndices(meshIdx)[subsetIdx]];
+    }
+
+protected:
+
+    bool Fail(const char* message)
+    {
+        header = nullptr;
+        error = message;
+        return false;
+    }
+
+    template<typename T> const T* At(uint64 offset) const
+    {
+        return reinterpret_cast<const T*>(fileData + offset);
+    }
+
+    // Returns true if count elements of elemSize bytes starting at offset are within [begin, end)
+    static bool RangeInside(uint64 offset, uint64 count, uint64 elemSize, uint64 begin, uint64 end)
+    {
+        return offset >= begin && offset <= end && count <= (end - offset) / elemSize;
+    }
+
+    // Tables get accessed in place, so they also need to be aligned
+    template<typename T> bool Table(uint64 offset, uint64 count, uint64 end) const
+    {
+        return offset % alignof(T) == 0 && RangeInside(offset, count, sizeof(T), 0, end);
+    }
+
+    template<size_t N> static bool Terminated(const char (&str)[N])
+    {
+        return memchr(str, 0, N) != nullptr;
+    }
+
+    static uint32 ReadIndex16(const uint8* indices, uint64 idx)
+    {
+        uint16 index;
+        memcpy(&index, indices + idx * 2, 2);
+        return index;
+    }
+
+    static uint32 ReadIndex32(const uint8* indices, uint64 idx)
+    {
+        uint32 index;
+        memcpy(&index, indices + idx * 4, 4);
+        return index;
+    }
+
+    const uint8* fileData;
+    uint64 fileSize;
+    const SDKMeshHeaderData* header;
+    const char* error;
+};
+
+}
@@ -241,7 +241,7 @@ BoolSetting::operator bool32()
 
 // == EnumSetting =================================================================================
 
-EnumSetting::EnumSetting() : val(0), oldVal(0), numValues(0)
+EnumSetting::EnumSetting() : val(0), oldVal(0), numValues(0), labels(nullptr)
 {
 }
 
@@ -252,6 +252,7 @@ void EnumSetting::Initialize(TwBar* tweakBar_, const char* name_,
 {
     val = std::min(initialVal, numValues - 1);
     numValues = numValues_;
+    labels = valueLabels;
 
     // Register an enum type
     std::vector<TwEnumVal> enumValues(numValues);
@@ -282,6 +283,12 @@ void EnumSetting::SetValue(uint32 newVal)
     val = std::min(newVal, numValues - 1);
 }
 
+const char* EnumSetting::ValueLabel(uint32 value) const
+{
+    Assert_(value < numValues);
+    return labels[value];
+}
+
 EnumSetting::operator uint32()
 {
     return val;
@@ -165,6 +165,7 @@ protected:
     uint32 val;
     uint32 oldVal;
     uint32 numValues;
+    const char* const* labels;
 
 public:
 
@@ -179,6 +180,9 @@ public:
     uint32 Value() const;
     void SetValue(uint32 newVal);
 
+    uint32 NumValues() const { return numValues; }
+    const char* ValueLabel(uint32 value) const;
+
     operator uint32();
 };
 
@@ -207,7 +211,7 @@ public:
 
     void SetValue(T newVal)
     {
-        SetValue(uint32(newVal));
+        EnumSetting::SetValue(uint32(newVal));
     }
 };
 
@@ -0,0 +1,202 @@
+//=================================================================================================
+//
+//  MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "TextureCache.h"
+
+#include "Exceptions.h"
+#include "Utility.h"
+
+namespace SampleFramework11
+{
+
+TextureCache TextureCache::GlobalCache;
+
+TextureCache::TextureCache() : budget(DefaultBudget), totalBytes(0), useCounter(0),
+                               numHits(0), numMisses(0), numEvictions(0), bytesSaved(0)
+{
+}
+
+std::wstring TextureCache::NormalizePath(const wchar* filePath)
+{
+    wchar fullPath[MAX_PATH];
+    const DWORD length = GetFullPathNameW(filePath, MAX_PATH, fullPath, nullptr);
+    std::wstring path = (length > 0 && length < MAX_PATH) ? std::wstring(fullPath, length) : std::wstring(filePath);
+
+    for(uint64 i = 0; i < path.length(); ++i)
+        path[i] = path[i] == L'/' ? L'\\' : wchar(towlower(path[i]));
+
+    return path;
+}
+
+bool TextureCache::FindByPath(const std::wstring& path, uint64 timestamp, Hash& contentHash)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::map<std::wstring, PathEntry>::const_iterator pathEntry = paths.find(path);
+    if(pathEntry == paths.end() || pathEntry->second.Timestamp != timestamp)
+        return false;
+
+    // The texture might have been evicted since
+    std::map<Hash, Entry, HashLess>::iterator entry = entries.find(pathEntry->second.ContentHash);
+    if(entry == entries.end())
+        return false;
+
+    AddReference(entry->second);
+    contentHash = entry->first;
+    return true;
+}
+
+bool TextureCache::FindByContents(const std::wstring& path, uint64 timestamp, const Hash& contentHash)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    PathEntry& pathEntry = paths[path];
+    pathEntry.Timestamp = timestamp;
+    pathEntry.ContentHash = contentHash;
+
+    // Misses get counted by Add, since another thread can add the same contents before then
+    std::map<Hash, Entry, HashLess>::iterator entry = entries.find(contentHash);
+    if(entry == entries.end())
+        return false;
+
+    AddReference(entry->second);
+    return true;
+}
+
+ID3D11ShaderResourceViewPtr TextureCache::Acquire(const Hash& contentHash)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Entries with references can't be evicted, so the one from the Find is still there
+    std::map<Hash, Entry, HashLess>::iterator entry = entries.find(contentHash);
+    Assert_(entry != entries.end() && entry->second.NumReferences > 0);
+    entry->second.LastUse = ++useCounter;
+    return entry->second.Texture;
+}
+
+ID3D11ShaderResourceViewPtr TextureCache::Add(const std::wstring& path, uint64 timestamp, const Hash& contentHash,
+                                              ID3D11ShaderResourceView* texture, uint64 numBytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    PathEntry& pathEntry = paths[path];
+    pathEntry.Timestamp = timestamp;
+    pathEntry.ContentHash = contentHash;
+
+    // Two threads can decode the same file at once, in which case the second one still saves
+    // creating a second copy of the texture, and counts as a hit
+    std::map<Hash, Entry, HashLess>::iterator existing = entries.find(contentHash);
+    if(existing != entries.end())
+    {
+        AddReference(existing->second);
+        return existing->second.Texture;
+    }
+
+    ++numMisses;
+
+    Entry& entry = entries[contentHash];
+    entry.Texture = texture;
+    entry.NumBytes = numBytes;
+    entry.NumReferences = 1;
+    entry.LastUse = ++useCounter;
+    totalBytes += numBytes;
+    textures[texture] = contentHash;
+
+    Evict(budget);
+
+    return entry.Texture;
+}
+
+void TextureCache::Release(ID3D11ShaderResourceView* texture)
+{
+    if(texture == nullptr)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::map<ID3D11ShaderResourceView*, Hash>::const_iterator cached = textures.find(texture);
+    if(cached == textures.end())
+        return;
+
+    Entry& entry = entries[cached->second];
+    Assert_(entry.NumReferences > 0);
+    if(--entry.NumReferences == 0)
+        Evict(budget);
+}
+
+void TextureCache::SetBudget(uint64 numBytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    budget = numBytes;
+    Evict(budget);
+}
+
+void TextureCache::Trim()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    Evict(0);
+}
+
+void TextureCache::Shutdown()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    entries.clear();
+    paths.clear();
+    textures.clear();
+    totalBytes = 0;
+}
+
+std::string TextureCache::Report() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const double MB = 1024.0 * 1024.0;
+    return MakeString("Texture cache: %u hits, %u misses, %.2fMB saved, %u textures using %.2fMB of a "
+                      "%.2fMB budget, %u evicted\n", numHits, numMisses, bytesSaved / MB,
+                      uint32(entries.size()), totalBytes / MB, budget / MB, numEvictions);
+}
+
+// Counts a hit, and marks the entry as just used. The mutex needs to be locked.
+void TextureCache::AddReference(Entry& entry)
+{
+    ++entry.NumReferences;
+    entry.LastUse = ++useCounter;
+    ++numHits;
+    bytesSaved += entry.NumBytes;
+}
+
+// Evicts the least recently used entries without references until the total is under the
+// budget. The mutex needs to be locked.
+void TextureCache::Evict(uint64 maxBytes)
+{
+    while(totalBytes > maxBytes)
+    {
+        std::map<Hash, Entry, HashLess>::iterator oldest = entries.end();
+        for(std::map<Hash, Entry, HashLess>::iterator it = entries.begin(); it != entries.end(); ++it)
+        {
+            if(it->second.NumReferences == 0 && (oldest == entries.end() || it->second.LastUse < oldest->second.LastUse))
+                oldest = it;
+        }
+
+        if(oldest == entries.end())
+            return;
+
+        totalBytes -= oldest->second.NumBytes;
+        textures.erase(oldest->second.Texture.GetInterfacePtr());
+        entries.erase(oldest);
+        ++numEvictions;
+    }
+}
+
+}
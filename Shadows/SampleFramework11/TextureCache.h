@@ -0,0 +1,121 @@
+//=================================================================================================
+//
+//  MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "PCH.h"
+
+#include <mutex>
+
+#include "InterfacePointers.h"
+#include "MurmurHash.h"
+
+namespace SampleFramework11
+{
+
+// Process-wide cache for the textures made by DecodeTexture and CreateTexture, so that a file
+// that's shared between models only gets decoded and uploaded once. A texture is looked up by its
+// normalized path first, which skips reading the file if it hasn't changed since it was cached.
+// After that it's looked up by a hash of the file contents, which also finds copies of the same
+// file in other directories.
+//
+// Every texture that CreateTexture returns holds a reference, which needs to be given back with
+// Release. Textures without references stay cached until the total size goes over the budget,
+// and then the least recently used ones get evicted. Textures that are still referenced never
+// get evicted, so the total can go over the budget. All functions can be called from any thread.
+class TextureCache
+{
+
+public:
+
+    static TextureCache GlobalCache;
+
+    static const uint64 DefaultBudget = 256 * 1024 * 1024;
+
+    TextureCache();
+
+    // Lower case full path with backslashes, so that different paths to a file match
+    static std::wstring NormalizePath(const wchar* filePath);
+
+    // Looks for a texture that was cached from the same path, and hasn't changed since. On a hit
+    // this returns the hash of the contents, and takes a reference that the next Acquire for the
+    // hash hands out.
+    bool FindByPath(const std::wstring& path, uint64 timestamp, Hash& contentHash);
+
+    // Looks for a texture with the same file contents, and takes a reference on a hit like
+    // FindByPath. On a miss the texture needs to be created and passed to Add.
+    bool FindByContents(const std::wstring& path, uint64 timestamp, const Hash& contentHash);
+
+    // Returns the texture for a reference that was taken by one of the Find functions
+    ID3D11ShaderResourceViewPtr Acquire(const Hash& contentHash);
+
+    // Adds a texture after a miss, with one reference. If another thread added the same contents
+    // in the meantime, that texture gets returned instead.
+    ID3D11ShaderResourceViewPtr Add(const std::wstring& path, uint64 timestamp, const Hash& contentHash,
+                                    ID3D11ShaderResourceView* texture, uint64 numBytes);
+
+    // Gives back a reference to a texture, which does nothing for textures that weren't cached
+    void Release(ID3D11ShaderResourceView* texture);
+
+    void SetBudget(uint64 numBytes);
+
+    // Evicts everything that doesn't have any references
+    void Trim();
+
+    // Drops all textures, including the ones that still have references, so that none of them
+    // outlive the device. Releasing a texture after this does nothing.
+    void Shutdown();
+
+    // Hit and miss counts, the bytes that were saved by the hits, and the current size
+    std::string Report() const;
+
+protected:
+
+    struct HashLess
+    {
+        bool operator()(const Hash& a, const Hash& b) const
+        {
+            return a.A < b.A || (a.A == b.A && a.B < b.B);
+        }
+    };
+
+    struct Entry
+    {
+        ID3D11ShaderResourceViewPtr Texture;
+        uint64 NumBytes;
+        uint32 NumReferences;
+        uint64 LastUse;
+    };
+
+    struct PathEntry
+    {
+        uint64 Timestamp;
+        Hash ContentHash;
+    };
+
+    void AddReference(Entry& entry);
+    void Evict(uint64 budget);
+
+    std::map<Hash, Entry, HashLess> entries;
+    std::map<std::wstring, PathEntry> paths;
+    std::map<ID3D11ShaderResourceView*, Hash> textures;
+
+    uint64 budget;
+    uint64 totalBytes;
+    uint64 useCounter;
+
+    uint32 numHits;
+    uint32 numMisses;
+    uint32 numEvictions;
+    uint64 bytesSaved;
+
+    mutable std::mutex mutex;
+};
+
+}
@@ -9,12 +9,16 @@
 
 #include "PCH.h"
 
+#include <atomic>
+#include <thread>
+
 #include "Utility.h"
 #include "Exceptions.h"
 #include "InterfacePointers.h"
 #include "DDSTextureLoader.h"
 #include "WICTextureLoader.h"
 #include "FileIO.h"
+#include "TextureCache.h"
 #include "ShaderCompilation.h"
 #include "GraphicsTypes.h"
 
@@ -73,6 +77,41 @@ XMVECTOR BarycentricToCartesian(const XMFLOAT3& r, FXMVECTOR pos1, FXMVECTOR pos
     return rvec;
 }
 
+void ParallelFor(uint32 count, uint32 numThreads, const std::function<void(uint32, uint32)>& func,
+                 uint32 batchSize)
+{
+    Assert_(batchSize > 0);
+    if(numThreads == 0)
+        numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    numThreads = std::min(numThreads, uint32((uint64(count) + batchSize - 1) / batchSize));
+
+    if(numThreads <= 1)
+    {
+        func(0, count);
+        return;
+    }
+
+    std::atomic<uint32> nextItem(0);
+    auto worker = [&]()
+    {
+        while(true)
+        {
+            uint32 start = nextItem.fetch_add(batchSize);
+            if(start >= count)
+                break;
+            func(start, std::min(start + batchSize, count));
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(uint32 i = 1; i < numThreads; ++i)
+        threads.push_back(std::thread(worker));
+    worker();
+
+    for(std::thread& thread : threads)
+        thread.join();
+}
+
 // Returns true if the given barycentric coordinate is in the triangle
 BOOL PointIsInTriangle(const XMFLOAT3& r, float epsilon)
 {
@@ -146,23 +185,75 @@ void SetCSConstants(ID3D11DeviceContext* context, ID3D11Buffer* constantBuffer,
 // Loads a texture, using either the DDS loader or the WIC loader
 ID3D11ShaderResourceViewPtr LoadTexture(ID3D11Device* device, const wchar* filePath)
 {
-    ID3D11DeviceContextPtr context;
-    device->GetImmediateContext(&context);
+    TextureData data;
+    DecodeTexture(device, filePath, data);
+    return CreateTexture(device, data);
+}
+
+// Reads a texture file, and decodes it if it isn't a DDS
+void DecodeTexture(ID3D11Device* device, const wchar* filePath, TextureData& data)
+{
+    TextureCache& cache = TextureCache::GlobalCache;
+    data.CachePath = TextureCache::NormalizePath(filePath);
+    data.Timestamp = GetFileTimestamp(filePath);
+    data.Cached = cache.FindByPath(data.CachePath, data.Timestamp, data.ContentHash);
+    if(data.Cached)
+        return;
+
+    File file(filePath, File::OpenRead);
+    data.FileData.resize(size_t(file.Size()));
+    if(data.FileData.size() > 0)
+        file.Read(data.FileData.size(), data.FileData.data());
+
+    data.ContentHash = GenerateHash(data.FileData.data(), int(data.FileData.size()));
+    data.Cached = cache.FindByContents(data.CachePath, data.Timestamp, data.ContentHash);
+    if(data.Cached)
+    {
+        std::vector<uint8>().swap(data.FileData);
+        return;
+    }
+
+    const std::wstring extension = GetFileExtension(filePath);
+    data.IsDDS = extension == L"DDS" || extension == L"dds";
+    if(data.IsDDS)
+        return;
+
+    // The mips get generated on the immediate context once the texture is created
+    DXCall(DecodeWICTextureFromMemory(device, data.FileData.data(), data.FileData.size(), true, data.Image, 0));
+    data.FileData.clear();
+    data.FileData.shrink_to_fit();
+}
+
+// Creates the texture for a file that was read by DecodeTexture, or returns the cached one
+ID3D11ShaderResourceViewPtr CreateTexture(ID3D11Device* device, const TextureData& data)
+{
+    TextureCache& cache = TextureCache::GlobalCache;
+    if(data.Cached)
+        return cache.Acquire(data.ContentHash);
 
     ID3D11ResourcePtr resource;
     ID3D11ShaderResourceViewPtr srv;
+    uint64 numBytes = 0;
 
-    const std::wstring extension = GetFileExtension(filePath);
-    if(extension == L"DDS" || extension == L"dds")
+    if(data.IsDDS)
     {
-        DXCall(CreateDDSTextureFromFile(device, filePath, &resource, &srv, 0));
-        return srv;
+        DXCall(CreateDDSTextureFromMemory(device, data.FileData.data(), data.FileData.size(), &resource, &srv, 0));
+        numBytes = data.FileData.size();
     }
     else
     {
-        DXCall(CreateWICTextureFromFile(device, context, filePath, &resource, &srv, 0));
-        return srv;
+        ID3D11DeviceContextPtr context;
+        device->GetImmediateContext(&context);
+
+        DXCall(CreateWICTextureFromDecoded(device, context, data.Image, &resource, &srv));
+
+        // The mip chain adds another third
+        numBytes = data.Image.Pixels.size();
+        if(data.Image.GenerateMips)
+            numBytes += numBytes / 3;
     }
+
+    return cache.Add(data.CachePath, data.Timestamp, data.ContentHash, srv, numBytes);
 }
 
 
@@ -15,6 +15,8 @@
 #include "InterfacePointers.h"
 #include "Math.h"
 #include "Assert.h"
+#include "WICTextureLoader.h"
+#include "MurmurHash.h"
 
 namespace SampleFramework11
 {
@@ -112,6 +114,13 @@ inline void DebugPrint(const std::wstring& str)
     OutputDebugStringW(output.c_str());
 }
 
+// Writes a report to the console and the debugger output
+inline void PrintReport(const std::string& report)
+{
+    std::printf("%s", report.c_str());
+    OutputDebugStringA(report.c_str());
+}
+
 // Returns the number of mip levels given a texture size
 inline UINT NumMipLevels(UINT width, UINT height)
 {
@@ -169,6 +178,14 @@ XMFLOAT2 BarycentricToCartesian(const XMFLOAT3& r, const XMFLOAT2& pos1, const X
 XMVECTOR BarycentricToCartesian(const XMFLOAT3& r, FXMVECTOR pos1, FXMVECTOR pos2, FXMVECTOR pos3);
 BOOL PointIsInTriangle(const XMFLOAT3& r, float epsilon = 0.0f);
 
+// Number of work items that a thread grabs at once in ParallelFor
+static const uint32 DefaultParallelForBatchSize = 64;
+
+// Runs func(start, end) over [0, count) on multiple threads, using one thread per core when
+// numThreads is 0. Each call of func gets a batch of at most batchSize items.
+void ParallelFor(uint32 count, uint32 numThreads, const std::function<void(uint32, uint32)>& func,
+                 uint32 batchSize = DefaultParallelForBatchSize);
+
 // Compute shader helpers
 uint32 DispatchSize(uint32 tgSize, uint32 numElements);
 void SetCSInputs(ID3D11DeviceContext* context, ID3D11ShaderResourceView* srv0, ID3D11ShaderResourceView* srv1 = NULL,
@@ -183,9 +200,35 @@ void SetCSSamplers(ID3D11DeviceContext* context, ID3D11SamplerState* sampler0, I
 void SetCSShader(ID3D11DeviceContext* context, ID3D11ComputeShader* shader);
 void SetCSConstants(ID3D11DeviceContext* context, ID3D11Buffer* constantBuffer, uint32 slot);
 
+// A texture file that's been read and decoded, but doesn't have a D3D resource yet
+struct TextureData
+{
+    bool IsDDS;
+    std::vector<uint8> FileData;    // DDS files get created straight from the file contents
+    WICDecodedImage Image;          // Everything else gets decoded by WIC
+
+    // Where the texture goes in the TextureCache. When it was already cached nothing gets read or
+    // decoded, and CreateTexture returns the cached texture.
+    std::wstring CachePath;
+    uint64 Timestamp;
+    Hash ContentHash;
+    bool Cached;
+
+    TextureData() : IsDDS(false), Timestamp(0), Cached(false)
+    {
+    }
+};
+
 // Texture loading
 ID3D11ShaderResourceViewPtr LoadTexture(ID3D11Device* device, const wchar* filePath);
 
+// LoadTexture split in two, so that the file can be read and decoded on a worker thread (which
+// needs to have called CoInitializeEx) and only the resource creation and mip generation need to
+// happen on the thread that owns the immediate context. Both go through TextureCache::GlobalCache,
+// and the textures that come out of them should be given back with TextureCache::Release.
+void DecodeTexture(ID3D11Device* device, const wchar* filePath, TextureData& data);
+ID3D11ShaderResourceViewPtr CreateTexture(ID3D11Device* device, const TextureData& data);
+
 // Decode a texture into 32-bit floats and copies it to the CPU
 void GetTextureData(ID3D11Device* device, ID3D11ShaderResourceView* texture,
                     std::vector<Float4>& textureData);
@@ -7,7 +7,9 @@
 // Note: Assumes application has already called CoInitializeEx
 //
 // Warning: CreateWICTexture* functions are not thread-safe if given a d3dContext instance for
-//          auto-gen mipmap support.
+//          auto-gen mipmap support. DecodeWICTextureFromMemory doesn't use the context, so it can
+//          run on a worker thread, with CreateWICTextureFromDecoded called later on the thread
+//          that owns the context.
 //
 // Note these functions are useful for images created as simple 2D textures. For
 // more complex resources, DDSTextureLoader is an excellent light-weight runtime loader.
@@ -31,6 +33,8 @@
 #include "PCH.h"
 #include "WICTextureLoader.h"
 
+#include <mutex>
+
 namespace SampleFramework11
 {
 
@@ -198,6 +202,10 @@ static WICConvert g_WICConvert[] =
 static IWICImagingFactory* _GetWIC()
 {
     static IWICImagingFactory* s_Factory = nullptr;
+    static std::mutex s_FactoryMutex;
+
+    // Images can be decoded from worker threads, so creating the factory needs to be serialized
+    std::lock_guard<std::mutex> lock( s_FactoryMutex );
 
     if ( s_Factory )
         return s_Factory;
@@ -261,12 +269,11 @@ static size_t _WICBitsPerPixel( REFGUID targetGuid )
 }
 
 //---------------------------------------------------------------------------------
-static HRESULT CreateTextureFromWIC( _In_ ID3D11Device* d3dDevice,
-                                     _In_opt_ ID3D11DeviceContext* d3dContext,
-                                     _In_ IWICBitmapFrameDecode *frame,
-                                     _Out_opt_ ID3D11Resource** texture,
-                                     _Out_opt_ ID3D11ShaderResourceView** textureView,
-                                     _In_ size_t maxsize )
+static HRESULT DecodeWICFrame( _In_ ID3D11Device* d3dDevice,
+                               _In_ IWICBitmapFrameDecode *frame,
+                               _In_ bool generateMips,
+                               _In_ size_t maxsize,
+                               _Out_ WICDecodedImage& image )
 {
     UINT width, height;
     HRESULT hr = frame->GetSize( &width, &height );
@@ -363,7 +370,7 @@ static HRESULT CreateTextureFromWIC( _In_ ID3D11Device* d3dDevice,
     }
 
 #if (_WIN32_WINNT >= 0x0602 /*_WIN32_WINNT_WIN8*/)
-    if ( (format == DXGI_FORMAT_R32G32B32_FLOAT) && d3dContext != 0 && textureView != 0 )
+    if ( (format == DXGI_FORMAT_R32G32B32_FLOAT) && generateMips )
     {
         // Special case test for optional device support for autogen mipchains for R32G32B32_FLOAT
         UINT fmtSupport = 0;
@@ -397,7 +404,8 @@ static HRESULT CreateTextureFromWIC( _In_ ID3D11Device* d3dDevice,
     size_t rowPitch = ( twidth * bpp + 7 ) / 8;
     size_t imageSize = rowPitch * theight;
 
-    std::unique_ptr<uint8_t[]> temp( new uint8_t[ imageSize ] );
+    image.Pixels.resize( imageSize );
+    uint8_t* temp = image.Pixels.data();
 
     // Load image data
     if ( memcmp( &convertGUID, &pixelFormat, sizeof(GUID) ) == 0
@@ -405,7 +413,7 @@ static HRESULT CreateTextureFromWIC( _In_ ID3D11Device* d3dDevice,
          && theight == height )
     {
         // No format conversion or resize needed
-        hr = frame->CopyPixels( 0, static_cast<UINT>( rowPitch ), static_cast<UINT>( imageSize ), temp.get() );
+        hr = frame->CopyPixels( 0, static_cast<UINT>( rowPitch ), static_cast<UINT>( imageSize ), temp );
         if ( FAILED(hr) )
             return hr;
     }
@@ -433,7 +441,7 @@ static HRESULT CreateTextureFromWIC( _In_ ID3D11Device* d3dDevice,
         if ( memcmp( &convertGUID, &pfScaler, sizeof(GUID) ) == 0 )
         {
             // No format conversion needed
-            hr = scaler->CopyPixels( 0, static_cast<UINT>( rowPitch ), static_cast<UINT>( imageSize ), temp.get() );
+            hr = scaler->CopyPixels( 0, static_cast<UINT>( rowPitch ), static_cast<UINT>( imageSize ), temp );
             if ( FAILED(hr) )
                 return hr;
         }
@@ -448,7 +456,7 @@ static HRESULT CreateTextureFromWIC( _In_ ID3D11Device* d3dDevice,
             if ( FAILED(hr) )
                 return hr;
 
-            hr = FC->CopyPixels( 0, static_cast<UINT>( rowPitch ), static_cast<UINT>( imageSize ), temp.get() );
+            hr = FC->CopyPixels( 0, static_cast<UINT>( rowPitch ), static_cast<UINT>( imageSize ), temp );
             if ( FAILED(hr) )
                 return hr;
         }
@@ -469,27 +477,49 @@ static HRESULT CreateTextureFromWIC( _In_ ID3D11Device* d3dDevice,
         if ( FAILED(hr) )
             return hr;
 
-        hr = FC->CopyPixels( 0, static_cast<UINT>( rowPitch ), static_cast<UINT>( imageSize ), temp.get() );
+        hr = FC->CopyPixels( 0, static_cast<UINT>( rowPitch ), static_cast<UINT>( imageSize ), temp );
         if ( FAILED(hr) )
             return hr;
     }
 
     // See if format is supported for auto-gen mipmaps (varies by feature level)
-    bool autogen = false;
-    if ( d3dContext != 0 && textureView != 0 ) // Must have context and shader-view to auto generate mipmaps
+    image.GenerateMips = false;
+    if ( generateMips )
     {
         UINT fmtSupport = 0;
         hr = d3dDevice->CheckFormatSupport( format, &fmtSupport );
         if ( SUCCEEDED(hr) && ( fmtSupport & D3D11_FORMAT_SUPPORT_MIP_AUTOGEN ) )
         {
-            autogen = true;
+            image.GenerateMips = true;
         }
     }
 
+    image.Width = twidth;
+    image.Height = theight;
+    image.Format = format;
+    image.RowPitch = rowPitch;
+
+    return S_OK;
+}
+
+//---------------------------------------------------------------------------------
+static HRESULT CreateTextureFromDecoded( _In_ ID3D11Device* d3dDevice,
+                                         _In_opt_ ID3D11DeviceContext* d3dContext,
+                                         _In_ const WICDecodedImage& image,
+                                         _Out_opt_ ID3D11Resource** texture,
+                                         _Out_opt_ ID3D11ShaderResourceView** textureView )
+{
+    // Must have context and shader-view to auto generate mipmaps
+    const bool autogen = image.GenerateMips && d3dContext != 0 && textureView != 0;
+    const DXGI_FORMAT format = image.Format;
+    const size_t rowPitch = image.RowPitch;
+    const size_t imageSize = image.Pixels.size();
+    const uint8_t* temp = image.Pixels.data();
+
     // Create texture
     D3D11_TEXTURE2D_DESC desc;
-    desc.Width = twidth;
-    desc.Height = theight;
+    desc.Width = image.Width;
+    desc.Height = image.Height;
     desc.MipLevels = (autogen) ? 0 : 1;
     desc.ArraySize = 1;
     desc.Format = format;
@@ -501,7 +531,7 @@ static HRESULT CreateTextureFromWIC( _In_ ID3D11Device* d3dDevice,
     desc.MiscFlags = (autogen) ? D3D11_RESOURCE_MISC_GENERATE_MIPS : 0;
 
     D3D11_SUBRESOURCE_DATA initData;
-    initData.pSysMem = temp.get();
+    initData.pSysMem = temp;
     initData.SysMemPitch = static_cast<UINT>( rowPitch );
     initData.SysMemSlicePitch = static_cast<UINT>( imageSize );
 
@@ -527,7 +557,7 @@ static HRESULT CreateTextureFromWIC( _In_ ID3D11Device* d3dDevice,
             if ( autogen )
             {
                 assert( d3dContext != 0 );
-                d3dContext->UpdateSubresource( tex, 0, nullptr, temp.get(), static_cast<UINT>(rowPitch), static_cast<UINT>(imageSize) );
+                d3dContext->UpdateSubresource( tex, 0, nullptr, temp, static_cast<UINT>(rowPitch), static_cast<UINT>(imageSize) );
                 d3dContext->GenerateMips( *textureView );
             }
         }
@@ -551,6 +581,22 @@ static HRESULT CreateTextureFromWIC( _In_ ID3D11Device* d3dDevice,
     return hr;
 }
 
+//---------------------------------------------------------------------------------
+static HRESULT CreateTextureFromWIC( _In_ ID3D11Device* d3dDevice,
+                                     _In_opt_ ID3D11DeviceContext* d3dContext,
+                                     _In_ IWICBitmapFrameDecode *frame,
+                                     _Out_opt_ ID3D11Resource** texture,
+                                     _Out_opt_ ID3D11ShaderResourceView** textureView,
+                                     _In_ size_t maxsize )
+{
+    WICDecodedImage image;
+    HRESULT hr = DecodeWICFrame( d3dDevice, frame, d3dContext != 0 && textureView != 0, maxsize, image );
+    if ( FAILED(hr) )
+        return hr;
+
+    return CreateTextureFromDecoded( d3dDevice, d3dContext, image, texture, textureView );
+}
+
 //--------------------------------------------------------------------------------------
 HRESULT CreateWICTextureFromMemory( _In_ ID3D11Device* d3dDevice,
                                     _In_opt_ ID3D11DeviceContext* d3dContext,
@@ -626,6 +672,96 @@ HRESULT CreateWICTextureFromMemory( _In_ ID3D11Device* d3dDevice,
     return hr;
 }
 
+//--------------------------------------------------------------------------------------
+HRESULT DecodeWICTextureFromMemory( _In_ ID3D11Device* d3dDevice,
+                                    _In_bytecount_(wicDataSize) const uint8_t* wicData,
+                                    _In_ size_t wicDataSize,
+                                    _In_ bool generateMips,
+                                    _Out_ WICDecodedImage& image,
+                                    _In_ size_t maxsize
+                                  )
+{
+    if (!d3dDevice || !wicData)
+    {
+        return E_INVALIDARG;
+    }
+
+    if ( !wicDataSize )
+    {
+        return E_FAIL;
+    }
+
+#ifdef _M_AMD64
+    if ( wicDataSize > 0xFFFFFFFF )
+        return HRESULT_FROM_WIN32( ERROR_FILE_TOO_LARGE );
+#endif
+
+    IWICImagingFactory* pWIC = _GetWIC();
+    if ( !pWIC )
+        return E_NOINTERFACE;
+
+    // Create input stream for memory
+    ScopedObject<IWICStream> stream;
+    HRESULT hr = pWIC->CreateStream( &stream );
+    if ( FAILED(hr) )
+        return hr;
+
+    hr = stream->InitializeFromMemory( const_cast<uint8_t*>( wicData ), static_cast<DWORD>( wicDataSize ) );
+    if ( FAILED(hr) )
+        return hr;
+
+    // Initialize WIC
+    ScopedObject<IWICBitmapDecoder> decoder;
+    hr = pWIC->CreateDecoderFromStream( stream.Get(), 0, WICDecodeMetadataCacheOnDemand, &decoder );
+    if ( FAILED(hr) )
+        return hr;
+
+    ScopedObject<IWICBitmapFrameDecode> frame;
+    hr = decoder->GetFrame( 0, &frame );
+    if ( FAILED(hr) )
+        return hr;
+
+    return DecodeWICFrame( d3dDevice, frame.Get(), generateMips, maxsize, image );
+}
+
+//--------------------------------------------------------------------------------------
+HRESULT CreateWICTextureFromDecoded( _In_ ID3D11Device* d3dDevice,
+                                     _In_opt_ ID3D11DeviceContext* d3dContext,
+                                     _In_ const WICDecodedImage& image,
+                                     _Out_opt_ ID3D11Resource** texture,
+                                     _Out_opt_ ID3D11ShaderResourceView** textureView
+                                   )
+{
+    if (!d3dDevice || image.Pixels.empty() || (!texture && !textureView))
+    {
+        return E_INVALIDARG;
+    }
+
+    HRESULT hr = CreateTextureFromDecoded( d3dDevice, d3dContext, image, texture, textureView );
+    if ( FAILED(hr))
+        return hr;
+
+#if defined(_DEBUG) || defined(PROFILE)
+    if (texture != 0 && *texture != 0)
+    {
+        (*texture)->SetPrivateData( WKPDID_D3DDebugObjectName,
+                                    sizeof("WICTextureLoader")-1,
+                                    "WICTextureLoader"
+                                  );
+    }
+
+    if (textureView != 0 && *textureView != 0)
+    {
+        (*textureView)->SetPrivateData( WKPDID_D3DDebugObjectName,
+                                        sizeof("WICTextureLoader")-1,
+                                        "WICTextureLoader"
+                                      );
+    }
+#endif
+
+    return hr;
+}
+
 //--------------------------------------------------------------------------------------
 HRESULT CreateWICTextureFromFile( _In_ ID3D11Device* d3dDevice,
                                   _In_opt_ ID3D11DeviceContext* d3dContext,
@@ -32,6 +32,22 @@
 namespace SampleFramework11
 {
 
+// An image that's been decoded by WIC (and converted to a DXGI format and resized), but doesn't
+// have a texture yet
+struct WICDecodedImage
+{
+    UINT Width;
+    UINT Height;
+    DXGI_FORMAT Format;
+    size_t RowPitch;
+    bool GenerateMips;
+    std::vector<uint8_t> Pixels;
+
+    WICDecodedImage() : Width(0), Height(0), Format(DXGI_FORMAT_UNKNOWN), RowPitch(0), GenerateMips(false)
+    {
+    }
+};
+
 HRESULT CreateWICTextureFromMemory( _In_ ID3D11Device* d3dDevice,
                                     _In_opt_ ID3D11DeviceContext* d3dContext,
                                     _In_bytecount_(wicDataSize) const uint8_t* wicData,
@@ -49,4 +65,23 @@ HRESULT CreateWICTextureFromFile( _In_ ID3D11Device* d3dDevice,
                                   _In_ size_t maxsize = 0
                                 );
 
-}
\ No newline at end of file
+// Decodes an image without creating a texture, which only uses the device for checking format
+// support and so is safe to call from any thread that has called CoInitializeEx. Set generateMips
+// if the texture will get a context for generating its mip chain.
+HRESULT DecodeWICTextureFromMemory( _In_ ID3D11Device* d3dDevice,
+                                    _In_bytecount_(wicDataSize) const uint8_t* wicData,
+                                    _In_ size_t wicDataSize,
+                                    _In_ bool generateMips,
+                                    _Out_ WICDecodedImage& image,
+                                    _In_ size_t maxsize = 0
+                                  );
+
+// Creates the texture for an image from DecodeWICTextureFromMemory
+HRESULT CreateWICTextureFromDecoded( _In_ ID3D11Device* d3dDevice,
+                                     _In_opt_ ID3D11DeviceContext* d3dContext,
+                                     _In_ const WICDecodedImage& image,
+                                     _Out_opt_ ID3D11Resource** texture,
+                                     _Out_opt_ ID3D11ShaderResourceView** textureView
+                                   );
+
+}
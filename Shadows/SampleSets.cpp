@@ -0,0 +1,292 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include <random>
+
+#include "SampleSets.h"
+
+#include "SampleFramework11/Utility.h"
+#include "SampleFramework11/FileIO.h"
+
+// Seed used for the table that gets baked into the shaders
+static const uint32 PoissonSamplesSeed = 1;
+
+// The best-candidate algorithm takes CandidatesPerSample * numExistingSamples candidates
+// for each new sample, which is clamped so that large sample sets don't take forever
+static const uint32 CandidatesPerSample = 16;
+static const uint32 MaxCandidates = 1024;
+
+// Fraction of texels that are set in the initial void-and-cluster pattern
+static const float InitialPatternDensity = 0.1f;
+
+static Float2 RandomPointInDomain(SampleDomain domain, std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    const float u = dist(rng);
+    const float v = dist(rng);
+
+    if(domain == SampleDomain::Disc)
+    {
+        const float r = std::sqrt(u);
+        const float theta = v * XM_2PI;
+        return Float2(r * std::cos(theta), r * std::sin(theta));
+    }
+
+    return Float2(u * 2.0f - 1.0f, v * 2.0f - 1.0f);
+}
+
+void GeneratePoissonSamples(SampleDomain domain, uint32 numSamples, uint32 seed, Float2* samples)
+{
+    if(numSamples == 0)
+        return;
+
+    std::mt19937 rng(seed);
+
+    samples[0] = RandomPointInDomain(domain, rng);
+    for(uint32 sampleIdx = 1; sampleIdx < numSamples; ++sampleIdx)
+    {
+        const uint32 numCandidates = std::min(sampleIdx * CandidatesPerSample, MaxCandidates);
+
+        Float2 bestCandidate;
+        float bestDistSq = -1.0f;
+        for(uint32 candidateIdx = 0; candidateIdx < numCandidates; ++candidateIdx)
+        {
+            const Float2 candidate = RandomPointInDomain(domain, rng);
+
+            float minDistSq = FLT_MAX;
+            for(uint32 i = 0; i < sampleIdx && minDistSq > bestDistSq; ++i)
+            {
+                const Float2 delta = candidate - samples[i];
+                minDistSq = std::min(minDistSq, delta.x * delta.x + delta.y * delta.y);
+            }
+
+            if(minDistSq > bestDistSq)
+            {
+                bestDistSq = minDistSq;
+                bestCandidate = candidate;
+            }
+        }
+
+        samples[sampleIdx] = bestCandidate;
+    }
+}
+
+void GenerateShaderPoissonSamples(Float2* samples)
+{
+    GeneratePoissonSamples(SampleDomain::Disc, NumPoissonSamples, PoissonSamplesSeed, samples);
+}
+
+float MinSampleDistance(const Float2* samples, uint32 numSamples)
+{
+    float minDistSq = FLT_MAX;
+    for(uint32 i = 0; i < numSamples; ++i)
+    {
+        for(uint32 j = i + 1; j < numSamples; ++j)
+        {
+            const Float2 delta = samples[i] - samples[j];
+            minDistSq = std::min(minDistSq, delta.x * delta.x + delta.y * delta.y);
+        }
+    }
+
+    return numSamples > 1 ? std::sqrt(minDistSq) : 0.0f;
+}
+
+// Energy of a binary pattern is the sum of a Gaussian centered on every set texel, with
+// distances that wrap around so that the result tiles. Toggling a texel adds or subtracts
+// the Gaussian, which is pre-computed for every offset.
+class VoidAndClusterPattern
+{
+
+public:
+
+    VoidAndClusterPattern(uint32 size, float sigma) : size(size), numTexels(size * size)
+    {
+        gaussian.resize(numTexels);
+        for(uint32 y = 0; y < size; ++y)
+        {
+            for(uint32 x = 0; x < size; ++x)
+            {
+                const float dx = float(std::min(x, size - x));
+                const float dy = float(std::min(y, size - y));
+                gaussian[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2.0f * sigma * sigma));
+            }
+        }
+
+        pattern.assign(numTexels, 0);
+        energy.assign(numTexels, 0.0f);
+    }
+
+    void Toggle(uint32 texelIdx)
+    {
+        const float sign = pattern[texelIdx] ? -1.0f : 1.0f;
+        pattern[texelIdx] = pattern[texelIdx] ? 0 : 1;
+
+        // The Gaussian is stored relative to texel 0, so each row gets split in two where
+        // the offset wraps around
+        const uint32 tx = texelIdx % size;
+        const uint32 ty = texelIdx / size;
+        for(uint32 y = 0; y < size; ++y)
+        {
+            const uint32 gy = (y + size - ty) % size;
+            float* energyRow = &energy[y * size];
+            const float* gaussianRow = &gaussian[gy * size];
+            for(uint32 x = 0; x < tx; ++x)
+                energyRow[x] += sign * gaussianRow[x + size - tx];
+            for(uint32 x = tx; x < size; ++x)
+                energyRow[x] += sign * gaussianRow[x - tx];
+        }
+    }
+
+    // Set texel with the highest energy
+    uint32 TightestCluster() const
+    {
+        uint32 result = 0;
+        float maxEnergy = -FLT_MAX;
+        for(uint32 i = 0; i < numTexels; ++i)
+        {
+            if(pattern[i] && energy[i] > maxEnergy)
+            {
+                maxEnergy = energy[i];
+                result = i;
+            }
+        }
+
+        return result;
+    }
+
+    // Empty texel with the lowest energy
+    uint32 LargestVoid() const
+    {
+        uint32 result = 0;
+        float minEnergy = FLT_MAX;
+        for(uint32 i = 0; i < numTexels; ++i)
+        {
+            if(pattern[i] == 0 && energy[i] < minEnergy)
+            {
+                minEnergy = energy[i];
+                result = i;
+            }
+        }
+
+        return result;
+    }
+
+    bool IsSet(uint32 texelIdx) const { return pattern[texelIdx] != 0; }
+
+protected:
+
+    uint32 size;
+    uint32 numTexels;
+    std::vector<float> gaussian;
+    std::vector<uint8> pattern;
+    std::vector<float> energy;
+};
+
+void GenerateBlueNoiseTexture(uint32 size, uint32 seed, uint8* texels, float sigma)
+{
+    Assert_(size > 0);
+
+    const uint32 numTexels = size * size;
+    const uint32 numInitial = std::max(uint32(numTexels * InitialPatternDensity), 1u);
+
+    // Start with a random pattern, and move the texel in the tightest cluster into the
+    // largest void until that stops changing anything
+    VoidAndClusterPattern prototype(size, sigma);
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32> texelDist(0, numTexels - 1);
+    for(uint32 numSet = 0; numSet < numInitial; )
+    {
+        const uint32 texelIdx = texelDist(rng);
+        if(prototype.IsSet(texelIdx) == false)
+        {
+            prototype.Toggle(texelIdx);
+            ++numSet;
+        }
+    }
+
+    for(uint32 iteration = 0; iteration < numTexels; ++iteration)
+    {
+        const uint32 cluster = prototype.TightestCluster();
+        prototype.Toggle(cluster);
+        const uint32 largestVoid = prototype.LargestVoid();
+        if(largestVoid == cluster)
+        {
+            prototype.Toggle(cluster);
+            break;
+        }
+
+        prototype.Toggle(largestVoid);
+    }
+
+    std::vector<uint32> ranks(numTexels, 0);
+
+    // Phase 1: remove the tightest clusters from the initial pattern, ranking them in
+    // reverse order
+    VoidAndClusterPattern pattern = prototype;
+    for(uint32 rank = numInitial; rank > 0; --rank)
+    {
+        const uint32 cluster = pattern.TightestCluster();
+        pattern.Toggle(cluster);
+        ranks[cluster] = rank - 1;
+    }
+
+    // Phase 2 and 3: starting from the initial pattern again, fill in the largest voids
+    pattern = prototype;
+    for(uint32 rank = numInitial; rank < numTexels; ++rank)
+    {
+        const uint32 largestVoid = pattern.LargestVoid();
+        pattern.Toggle(largestVoid);
+        ranks[largestVoid] = rank;
+    }
+
+    for(uint32 i = 0; i < numTexels; ++i)
+        texels[i] = uint8((uint64(ranks[i]) * 256) / numTexels);
+}
+
+std::string SampleSetsHLSL()
+{
+    Float2 samples[NumPoissonSamples];
+    GenerateShaderPoissonSamples(samples);
+
+    std::string hlsl = "//=================================================================================================\n"
+                       "//\n"
+                       "//\tShadows Sample\n"
+                       "//  by MJP\n"
+                       "//  http://mynameismjp.wordpress.com/\n"
+                       "//\n"
+                       "//  All code licensed under the MIT license\n"
+                       "//\n"
+                       "//=================================================================================================\n"
+                       "\n"
+                       "// This file is generated by UpdateSampleSetsHeader() in SampleSets.cpp, don't edit it by hand\n"
+                       "\n";
+
+    hlsl += MakeString("// Progressive Poisson disc samples (best-candidate), so that the first N samples are\n"
+                       "// well distributed for any N. Minimum distance for all %u samples: %f\n",
+                       NumPoissonSamples, MinSampleDistance(samples, NumPoissonSamples));
+    hlsl += MakeString("static const uint NumPoissonSamples = %u;\n", NumPoissonSamples);
+    hlsl += MakeString("static const float2 PoissonSamples[%u] =\n{\n", NumPoissonSamples);
+    for(uint32 i = 0; i < NumPoissonSamples; ++i)
+        hlsl += MakeString("    float2(%.9ff, %.9ff),\n", samples[i].x, samples[i].y);
+    hlsl += "};\n";
+
+    return hlsl;
+}
+
+void UpdateSampleSetsHeader(const wchar* filePath)
+{
+    const std::string hlsl = SampleSetsHLSL();
+    if(FileExists(filePath) && ReadFileAsString(filePath) == hlsl)
+        return;
+
+    WriteStringAsFile(filePath, hlsl);
+}
@@ -0,0 +1,53 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+#include "SampleFramework11/Math.h"
+
+using namespace SampleFramework11;
+
+// Area covered by a sample set
+enum class SampleDomain
+{
+    Disc = 0,       // Unit disc, used for the random disc PCF kernel
+    Square = 1,     // [-1, 1] square, for grid-shaped kernels
+};
+
+// Generates a progressive Poisson-disc sample set using Mitchell's best-candidate algorithm.
+// Every sample is placed as far away as possible from the samples before it, so any prefix
+// of the set is also well distributed. This lets the shader take the first N samples.
+void GeneratePoissonSamples(SampleDomain domain, uint32 numSamples, uint32 seed, Float2* samples);
+
+// Fills out the NumPoissonSamples disc samples that get baked into SampleSets.hlsl, for CPU
+// code that needs to match the shaders
+void GenerateShaderPoissonSamples(Float2* samples);
+
+// Smallest distance between any two samples in a set
+float MinSampleDistance(const Float2* samples, uint32 numSamples);
+
+// Generates a tileable size x size blue noise texture using the void-and-cluster method.
+// Every texel gets a unique rank, which is stored as a normalized value in [0, 255].
+void GenerateBlueNoiseTexture(uint32 size, uint32 seed, uint8* texels, float sigma = 1.5f);
+
+// Number of samples in the generated PoissonSamples table, which is also the upper limit of
+// the NumDiscSamples setting
+static const uint32 NumPoissonSamples = 64;
+
+// Size of the blue noise rotation texture used for randomized disc PCF
+static const uint32 BlueNoiseTextureSize = 64;
+
+// Returns the contents of SampleSets.hlsl
+std::string SampleSetsHLSL();
+
+// Re-generates the sample set header used by the shaders, only touching the file if the
+// contents have changed. Needs to happen before any of the shaders get compiled.
+void UpdateSampleSetsHeader(const wchar* filePath);
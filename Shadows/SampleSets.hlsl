@@ -0,0 +1,82 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+// This file is generated by UpdateSampleSetsHeader() in SampleSets.cpp, don't edit it by hand
+
+// Progressive Poisson disc samples (best-candidate), so that the first N samples are
+// well distributed for any N. Minimum distance for all 64 samples: 0.186931
+static const uint NumPoissonSamples = 64;
+static const float2 PoissonSamples[64] =
+{
+    float2(0.645671368f, -0.011421891f),
+    float2(-0.817952871f, -0.127171710f),
+    float2(-0.204982772f, 0.806138456f),
+    float2(0.016582018f, -0.946367443f),
+    float2(-0.112118714f, 0.085495748f),
+    float2(0.557530463f, 0.702790380f),
+    float2(0.596243918f, -0.675538242f),
+    float2(-0.649674773f, 0.433778197f),
+    float2(-0.607250214f, -0.742599249f),
+    float2(-0.189075157f, -0.442665637f),
+    float2(0.919356525f, 0.382269740f),
+    float2(0.939563394f, -0.335071623f),
+    float2(0.265060067f, -0.360451460f),
+    float2(0.325752318f, 0.291127712f),
+    float2(-0.064669006f, 0.458569169f),
+    float2(0.233144045f, 0.951861858f),
+    float2(-0.412059963f, -0.047790386f),
+    float2(0.362477005f, -0.912679195f),
+    float2(-0.951289177f, 0.256257087f),
+    float2(-0.554274797f, 0.814900458f),
+    float2(0.620194316f, -0.332951039f),
+    float2(-0.563572407f, -0.385486841f),
+    float2(0.011310115f, -0.191898674f),
+    float2(0.987023056f, 0.064487785f),
+    float2(0.214872971f, 0.627675176f),
+    float2(-0.270764053f, -0.784650207f),
+    float2(0.073960476f, -0.634777009f),
+    float2(-0.885715902f, -0.431236953f),
+    float2(0.307785720f, -0.025739970f),
+    float2(0.612567842f, 0.409408361f),
+    float2(-0.361008912f, 0.517735422f),
+    float2(-0.518413544f, 0.194026127f),
+    float2(0.330137700f, -0.619336724f),
+    float2(-0.755359769f, 0.108708464f),
+    float2(0.796990037f, 0.602657497f),
+    float2(0.109429076f, 0.186120600f),
+    float2(-0.269416958f, 0.267093122f),
+    float2(-0.386668950f, -0.559756935f),
+    float2(-0.766833127f, 0.640847623f),
+    float2(-0.004636029f, 0.963867843f),
+    float2(0.761181474f, 0.211150423f),
+    float2(-0.224102661f, -0.202585444f),
+    float2(0.000353010f, 0.710197091f),
+    float2(0.810430348f, -0.583760142f),
+    float2(-0.596663475f, -0.171330944f),
+    float2(0.448387355f, -0.199177951f),
+    float2(0.815678775f, -0.150051132f),
+    float2(-0.991757572f, 0.022690631f),
+    float2(-0.771788418f, -0.619149029f),
+    float2(0.527083516f, 0.203303754f),
+    float2(-0.078282274f, -0.755517244f),
+    float2(0.397306472f, 0.521478117f),
+    float2(-0.870321751f, 0.455174178f),
+    float2(0.013482735f, -0.410061806f),
+    float2(0.192525759f, -0.798526168f),
+    float2(0.465819359f, -0.457410395f),
+    float2(0.145564005f, 0.406348825f),
+    float2(0.369540870f, 0.797425568f),
+    float2(-0.456662357f, -0.879992008f),
+    float2(-0.407997727f, -0.262352914f),
+    float2(0.115427189f, -0.014257952f),
+    float2(-0.592511475f, 0.016928328f),
+    float2(-0.529798806f, 0.607370853f),
+    float2(-0.173899621f, 0.611240923f),
+};
@@ -24,6 +24,7 @@ cbuffer SetupConstants : register(b0)
     float3 CameraRight;
     float CameraNearClip;
     float CameraFarClip;
+    float3 CameraForward;
 }
 
 //=================================================================================================
@@ -74,6 +75,59 @@ float4x4 InverseScaleTranslation(in float4x4 m)
     return inv;
 }
 
+// Sine of the angle between the view direction and the light direction below which the cascades
+// don't get warped, since the optimal n for LiSPSM goes to infinity as the angle goes to 0
+static const float MinLiSPSMSinGamma = 0.01f;
+
+// HLSL version of MakeLiSPSMProjection from MeshRenderer.cpp
+float4x4 LiSPSMProjection(in float4x4 lightView, in float3 sliceCornersWS[8], in float sliceNear,
+                          in float sliceFar, in float sinGamma, in float filterScale)
+{
+    const float MaxFloat = 3.402823466e+38F;
+    float3 mins = float3(MaxFloat, MaxFloat, MaxFloat);
+    float3 maxes = float3(-MaxFloat, -MaxFloat, -MaxFloat);
+    uint i = 0;
+    for(i = 0; i < 8; ++i)
+    {
+        float3 corner = mul(float4(sliceCornersWS[i], 1.0f), lightView).xyz;
+        mins = min(mins, corner);
+        maxes = max(maxes, corner);
+    }
+
+    float n = (sliceNear + sqrt(sliceNear * sliceFar)) / sinGamma;
+    float f = n + maxes.y - mins.y;
+
+    // A perspective projection along the y axis, which divides everything along a light ray
+    // by the same w so that the depth ordering along the ray is preserved
+    float4x4 translation = float4x4(float4(1.0f, 0.0f, 0.0f, 0.0f),
+                                    float4(0.0f, 1.0f, 0.0f, 0.0f),
+                                    float4(0.0f, 0.0f, 1.0f, 0.0f),
+                                    float4(-(mins.x + maxes.x) * 0.5f, n - mins.y, 0.0f, 1.0f));
+    float4x4 perspective = float4x4(float4(1.0f, 0.0f, 0.0f, 0.0f),
+                                    float4(0.0f, (f + n) / (f - n), 0.0f, 1.0f),
+                                    float4(0.0f, 0.0f, 1.0f, 0.0f),
+                                    float4(0.0f, -2.0f * f * n / (f - n), 0.0f, 0.0f));
+    float4x4 warp = mul(translation, perspective);
+
+    // Fit the warped slice to the [-1, 1] x [-1, 1] x [0, 1] clip space box
+    float4x4 viewWarp = mul(lightView, warp);
+    float3 warpedMins = float3(MaxFloat, MaxFloat, MaxFloat);
+    float3 warpedMaxes = float3(-MaxFloat, -MaxFloat, -MaxFloat);
+    for(i = 0; i < 8; ++i)
+    {
+        float4 corner = mul(float4(sliceCornersWS[i], 1.0f), viewWarp);
+        warpedMins = min(warpedMins, corner.xyz / corner.w);
+        warpedMaxes = max(warpedMaxes, corner.xyz / corner.w);
+    }
+
+    float3 center = (warpedMins + warpedMaxes) * 0.5f;
+    float3 halfSize = (warpedMaxes - warpedMins) * (0.5f * filterScale);
+    float4x4 fit = OrthographicProjection(center.x - halfSize.x, center.y - halfSize.y,
+                                          center.x + halfSize.x, center.y + halfSize.y,
+                                          warpedMins.z, warpedMaxes.z);
+    return mul(warp, fit);
+}
+
 float4 PlaneFromPoints(in float3 point1, in float3 point2, in float3 point3)
 {
     float3 v21 = point1 - point2;
@@ -179,11 +233,15 @@ void SetupCascades(in uint3 GroupID : SV_GroupID, in uint3 GroupThreadID : SV_Gr
         frustumCenter += frustumCornersWS[i];
     frustumCenter /= 8.0f;
 
+    // The perspective warp changes the cascade every time the camera moves, so there's no
+    // point in stabilizing it
+    const bool stabilize = StabilizeCascades && !PerspectiveWarp;
+
     // Pick the up vector to use for the light camera
     float3 upDir = CameraRight;
 
     // This needs to be constant it to be stable
-    if(StabilizeCascades)
+    if(stabilize)
         upDir = float3(0.0f, 1.0f, 0.0f);
 
     // Create a temporary view matrix for the light
@@ -196,7 +254,7 @@ void SetupCascades(in uint3 GroupID : SV_GroupID, in uint3 GroupThreadID : SV_Gr
 
     float3 minExtents;
     float3 maxExtents;
-    if(StabilizeCascades)
+    if(stabilize)
     {
         // Calculate the radius of a bounding sphere surrounding the frustum corners
         float sphereRadius = 0.0f;
@@ -246,7 +304,7 @@ void SetupCascades(in uint3 GroupID : SV_GroupID, in uint3 GroupThreadID : SV_Gr
     float4x4 shadowProj = OrthographicProjection(minExtents.x, minExtents.y, maxExtents.x,
                                            maxExtents.y, 0.0f, cascadeExtents.z);
 
-    if(StabilizeCascades)
+    if(stabilize)
     {
         // Create the rounding matrix, by projecting the world-space origin and determining
         // the fractional offset in texel space
@@ -265,6 +323,26 @@ void SetupCascades(in uint3 GroupID : SV_GroupID, in uint3 GroupThreadID : SV_Gr
     }
 
     float4x4 shadowRenderingMatrix = mul(shadowView, shadowProj);
+
+    // With the perspective warp the cascade gets rendered with a light view that's aligned with
+    // the view direction, while the cascade offsets and scales keep using the unwarped projection
+    float sinGamma = length(cross(CameraForward, LightDirection));
+    const bool warpCascade = PerspectiveWarp && sinGamma >= MinLiSPSMSinGamma;
+    if(warpCascade)
+    {
+        float3x3 warpCameraRot;
+        warpCameraRot[2] = -LightDirection;
+        warpCameraRot[0] = normalize(cross(CameraForward, warpCameraRot[2]));
+        warpCameraRot[1] = cross(warpCameraRot[2], warpCameraRot[0]);
+        float4x4 warpView = InverseRotationTranslation(warpCameraRot, frustumCenter);
+
+        float sliceNear = CameraNearClip + prevSplitDist * (CameraFarClip - CameraNearClip);
+        float sliceFar = CameraNearClip + splitDist * (CameraFarClip - CameraNearClip);
+        float filterScale = (sMapSize + 9.0f) / sMapSize;
+        shadowRenderingMatrix = mul(warpView, LiSPSMProjection(warpView, frustumCornersWS, sliceNear,
+                                                               sliceFar, sinGamma, filterScale));
+    }
+
     ShadowRenderingMatrices[cascadeIdx * 4 + 0] = shadowRenderingMatrix._11_21_31_41;
     ShadowRenderingMatrices[cascadeIdx * 4 + 1] = shadowRenderingMatrix._12_22_32_42;
     ShadowRenderingMatrices[cascadeIdx * 4 + 2] = shadowRenderingMatrix._13_23_33_43;
@@ -276,35 +354,57 @@ void SetupCascades(in uint3 GroupID : SV_GroupID, in uint3 GroupThreadID : SV_Gr
                                 float4(shadowCameraPos, 1.0f));
     float4x4 invProj = InverseScaleTranslation(shadowProj);
 
-    float4x4 shadowRenderingInv = mul(invProj, invView);
-
-    // Create frustum planes for the shadow rendering matrix
-    float3 corners[8] =
+    float4 frustumPlanes[6];
+    if(warpCascade)
     {
-        float3( 1.0f, -1.0f, 0.0f),
-        float3(-1.0f, -1.0f, 0.0f),
-        float3( 1.0f,  1.0f, 0.0f),
-        float3(-1.0f,  1.0f, 0.0f),
-        float3( 1.0f, -1.0f, 1.0f),
-        float3(-1.0f, -1.0f, 1.0f),
-        float3( 1.0f,  1.0f, 1.0f),
-        float3(-1.0f,  1.0f, 1.0f),
-    };
+        // The warped projection doesn't have a simple inverse, so the planes get extracted
+        // from the columns of the shadow rendering matrix instead
+        float4 column0 = shadowRenderingMatrix._11_21_31_41;
+        float4 column1 = shadowRenderingMatrix._12_22_32_42;
+        float4 column2 = shadowRenderingMatrix._13_23_33_43;
+        float4 column3 = shadowRenderingMatrix._14_24_34_44;
+        frustumPlanes[0] = column3 - column0;
+        frustumPlanes[1] = column3 + column0;
+        frustumPlanes[2] = column3 - column1;
+        frustumPlanes[3] = column3 + column1;
+        frustumPlanes[4] = column3 - column2;
+        frustumPlanes[5] = column2;
 
-    [unroll]
-    for(i = 0; i < 8; ++i)
-    {
-        float4 corner = mul(float4(corners[i], 1.0f), shadowRenderingInv);
-        corners[i] = corner.xyz / corner.w;
+        [unroll]
+        for(i = 0; i < 6; ++i)
+            frustumPlanes[i] /= length(frustumPlanes[i].xyz);
     }
+    else
+    {
+        float4x4 shadowRenderingInv = mul(invProj, invView);
 
-    float4 frustumPlanes[6];
-    frustumPlanes[0] = PlaneFromPoints(corners[0], corners[4], corners[2]);
-    frustumPlanes[1] = PlaneFromPoints(corners[1], corners[3], corners[5]);
-    frustumPlanes[2] = PlaneFromPoints(corners[3], corners[2], corners[7]);
-    frustumPlanes[3] = PlaneFromPoints(corners[1], corners[5], corners[0]);
-    frustumPlanes[4] = PlaneFromPoints(corners[5], corners[7], corners[4]);
-    frustumPlanes[5] = PlaneFromPoints(corners[1], corners[0], corners[3]);
+        // Create frustum planes for the shadow rendering matrix
+        float3 corners[8] =
+        {
+            float3( 1.0f, -1.0f, 0.0f),
+            float3(-1.0f, -1.0f, 0.0f),
+            float3( 1.0f,  1.0f, 0.0f),
+            float3(-1.0f,  1.0f, 0.0f),
+            float3( 1.0f, -1.0f, 1.0f),
+            float3(-1.0f, -1.0f, 1.0f),
+            float3( 1.0f,  1.0f, 1.0f),
+            float3(-1.0f,  1.0f, 1.0f),
+        };
+
+        [unroll]
+        for(i = 0; i < 8; ++i)
+        {
+            float4 corner = mul(float4(corners[i], 1.0f), shadowRenderingInv);
+            corners[i] = corner.xyz / corner.w;
+        }
+
+        frustumPlanes[0] = PlaneFromPoints(corners[0], corners[4], corners[2]);
+        frustumPlanes[1] = PlaneFromPoints(corners[1], corners[3], corners[5]);
+        frustumPlanes[2] = PlaneFromPoints(corners[3], corners[2], corners[7]);
+        frustumPlanes[3] = PlaneFromPoints(corners[1], corners[5], corners[0]);
+        frustumPlanes[4] = PlaneFromPoints(corners[5], corners[7], corners[4]);
+        frustumPlanes[5] = PlaneFromPoints(corners[1], corners[0], corners[3]);
+    }
 
     [unroll]
     for(i = 0; i < 6; ++i)
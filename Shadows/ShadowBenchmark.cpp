@@ -0,0 +1,317 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "ShadowBenchmark.h"
+
+#include "SampleFramework11/Profiler.h"
+#include "SampleFramework11/Utility.h"
+#include "SampleFramework11/FileIO.h"
+
+// Frames rendered with a configuration before we start measuring. This needs to be more than
+// the latency of the GPU profiler queries, and gives the shadow maps and shaders time to get
+// re-created after a settings change.
+static const uint32 WarmupFrames = 8;
+
+// Frames that are averaged for each configuration
+static const uint32 MeasureFrames = 32;
+
+// Receivers used for the quality metrics
+static const uint32 NumQualityReceivers = 65536;
+
+// Keyframes of the camera path that gets replayed for every configuration
+struct CameraKeyframe
+{
+    Float3 Position;
+    float XRotation;
+    float YRotation;
+};
+
+static const CameraKeyframe CameraPath[] =
+{
+    { Float3(40.0f, 5.0f, 5.0f), 0.0f, -XM_PIDIV2 },
+    { Float3(25.0f, 6.0f, 15.0f), 0.15f, -XM_PI * 0.75f },
+    { Float3(10.0f, 4.0f, 5.0f), 0.05f, -XM_PIDIV2 },
+    { Float3(25.0f, 10.0f, -10.0f), 0.3f, -XM_PIDIV4 },
+};
+
+static const uint32 NumCameraKeyframes = _countof(CameraPath);
+
+// Places the camera at t in [0, 1] along the path
+static void ApplyCameraPath(FirstPersonCamera& camera, float t)
+{
+    const float segment = Saturate(t) * (NumCameraKeyframes - 1);
+    const uint32 k0 = std::min(uint32(segment), NumCameraKeyframes - 2);
+    const float lerpAmt = segment - k0;
+
+    const CameraKeyframe& a = CameraPath[k0];
+    const CameraKeyframe& b = CameraPath[k0 + 1];
+    camera.SetPosition(Lerp(a.Position, b.Position, lerpAmt));
+    camera.SetXRotation(Lerp(a.XRotation, b.XRotation, lerpAmt));
+    camera.SetYRotation(Lerp(a.YRotation, b.YRotation, lerpAmt));
+}
+
+// Scene is the slowest-changing parameter, so that the quality reference only needs to be
+// rebuilt once per scene
+static BenchmarkConfig ConfigFromIndex(uint32 configIdx)
+{
+    BenchmarkConfig config;
+    config.Partitioning = PartitionMode(configIdx % uint32(PartitionMode::NumValues));
+    configIdx /= uint32(PartitionMode::NumValues);
+    config.FilterSize = FixedFilterSize(configIdx % uint32(FixedFilterSize::NumValues));
+    configIdx /= uint32(FixedFilterSize::NumValues);
+    config.Size = ShadowMapSize(configIdx % uint32(ShadowMapSize::NumValues));
+    configIdx /= uint32(ShadowMapSize::NumValues);
+    config.Mode = ShadowMode(configIdx % uint32(ShadowMode::NumValues));
+    configIdx /= uint32(ShadowMode::NumValues);
+    config.TestScene = Scene(configIdx);
+    return config;
+}
+
+// Only FixedSizePCF and OptimizedPCF use the fixed filter size, so the other modes skip all but
+// the first one
+static bool ConfigIsRedundant(const BenchmarkConfig& config)
+{
+    const bool usesFilterSize = config.Mode == ShadowMode::FixedSizePCF || config.Mode == ShadowMode::OptimizedPCF;
+    return usesFilterSize == false && config.FilterSize != FixedFilterSize(0);
+}
+
+static void AddElapsed(float& total, const wchar* profileName)
+{
+    total += Profiler::GlobalProfiler.LastTime(profileName);
+}
+
+ShadowBenchmark::ShadowBenchmark() : running(false), numConfigs(0), currConfig(0), currFrame(0),
+                                     evaluatorScene(Scene::NumValues), savedAnimateLight(false)
+{
+    numConfigs = uint32(Scene::NumValues) * uint32(ShadowMode::NumValues) * uint32(ShadowMapSize::NumValues)
+               * uint32(FixedFilterSize::NumValues) * uint32(PartitionMode::NumValues);
+}
+
+void ShadowBenchmark::Start(const std::wstring& outputPath_, AddSceneFunction addScene_)
+{
+    if(running)
+        return;
+
+    outputPath = outputPath_;
+    addScene = addScene_;
+
+    savedConfig.TestScene = AppSettings::CurrentScene;
+    savedConfig.Mode = AppSettings::ShadowMode;
+    savedConfig.Size = AppSettings::ShadowMapSize;
+    savedConfig.FilterSize = AppSettings::FixedFilterSize;
+    savedConfig.Partitioning = AppSettings::PartitionMode;
+    savedAnimateLight = AppSettings::AnimateLight;
+
+    // The light needs to stay put so that every configuration sees the same shadows
+    AppSettings::AnimateLight.SetValue(false);
+
+    results.clear();
+    qualityCache.clear();
+    evaluatorScene = Scene::NumValues;
+    running = true;
+
+    currConfig = 0;
+    while(ApplyConfig(currConfig) == false)
+        ++currConfig;
+    currFrame = 0;
+}
+
+void ShadowBenchmark::Update(FirstPersonCamera& camera, const Timer& timer)
+{
+    if(running == false)
+        return;
+
+    // Record the frame that was rendered last time around
+    if(currFrame > WarmupFrames)
+        RecordFrame(timer);
+
+    if(currFrame == WarmupFrames + MeasureFrames)
+    {
+        FinishConfig();
+
+        do
+        {
+            ++currConfig;
+        } while(currConfig < numConfigs && ApplyConfig(currConfig) == false);
+
+        if(currConfig == numConfigs)
+        {
+            WriteResults();
+            RestoreSettings();
+            running = false;
+            return;
+        }
+
+        currFrame = 0;
+    }
+
+    // The camera sits at the start of the path while warming up
+    float t = 0.0f;
+    if(currFrame >= WarmupFrames)
+        t = (currFrame - WarmupFrames) / float(MeasureFrames - 1);
+    ApplyCameraPath(camera, t);
+
+    ++currFrame;
+}
+
+float ShadowBenchmark::Progress() const
+{
+    if(running == false)
+        return 0.0f;
+
+    const uint32 framesPerConfig = WarmupFrames + MeasureFrames;
+    return (currConfig * framesPerConfig + currFrame) / float(numConfigs * framesPerConfig);
+}
+
+// Applies the settings for a configuration, returns false if the configuration is skipped
+bool ShadowBenchmark::ApplyConfig(uint32 configIdx)
+{
+    const BenchmarkConfig config = ConfigFromIndex(configIdx);
+    if(ConfigIsRedundant(config))
+        return false;
+
+    AppSettings::CurrentScene.SetValue(config.TestScene);
+    AppSettings::ShadowMode.SetValue(config.Mode);
+    AppSettings::ShadowMapSize.SetValue(config.Size);
+    AppSettings::FixedFilterSize.SetValue(config.FilterSize);
+    AppSettings::PartitionMode.SetValue(config.Partitioning);
+
+    if(config.TestScene != evaluatorScene)
+    {
+        sceneBVH.Clear();
+        addScene(config.TestScene, sceneBVH);
+        sceneBVH.Build();
+        evaluator.Initialize(sceneBVH, AppSettings::LightDirection, NumQualityReceivers);
+        evaluatorScene = config.TestScene;
+        qualityCache.clear();
+    }
+
+    currResult = BenchmarkResult();
+    currResult.Config = config;
+
+    return true;
+}
+
+void ShadowBenchmark::RecordFrame(const Timer& timer)
+{
+    currResult.FrameTime += timer.DeltaMillisecondsF();
+
+    AddElapsed(currResult.CPUCulling, L"CPU Culling");
+    AddElapsed(currResult.CPUCascadeSetup, L"CPU Cascade Setup");
+    AddElapsed(currResult.CPUSubmission, L"CPU Submission");
+    AddElapsed(currResult.CPUDepthReduction, L"CPU Depth Reduction");
+
+    AddElapsed(currResult.GPUDepthPrepass, L"Depth Prepass");
+    AddElapsed(currResult.GPUShadowMap, L"Shadow Map Rendering");
+    AddElapsed(currResult.GPUShadowMap, L"Shadow Map Rendering/Setup");
+    AddElapsed(currResult.GPUDepthReduction, L"Depth Reduction");
+    AddElapsed(currResult.GPUMeshRendering, L"Mesh Rendering");
+}
+
+void ShadowBenchmark::FinishConfig()
+{
+    const float scale = 1.0f / MeasureFrames;
+    currResult.FrameTime *= scale;
+    currResult.CPUCulling *= scale;
+    currResult.CPUCascadeSetup *= scale;
+    currResult.CPUSubmission *= scale;
+    currResult.CPUDepthReduction *= scale;
+    currResult.GPUDepthPrepass *= scale;
+    currResult.GPUShadowMap *= scale;
+    currResult.GPUDepthReduction *= scale;
+    currResult.GPUMeshRendering *= scale;
+
+    const BenchmarkConfig& config = currResult.Config;
+    const uint32 resolution = AppSettings::ShadowMapResolution(uint32(config.Size));
+    currResult.ShadowMemory = ShadowMapMemorySize(config.Mode, AppSettings::SMFormat, resolution);
+
+    // Partitioning doesn't affect the simulated single-cascade shadow map
+    const uint32 qualityKey = uint32(config.Mode) | (uint32(config.Size) << 8) | (uint32(config.FilterSize) << 16);
+    auto cached = qualityCache.find(qualityKey);
+    if(cached != qualityCache.end())
+    {
+        currResult.Quality = cached->second;
+    }
+    else
+    {
+        ShadowTechniqueDesc desc = ShadowTechniqueFromSettings(config.Mode, resolution);
+        desc.FixedFilterSize = AppSettings::FixedFilterKernelSize(uint32(config.FilterSize));
+        currResult.Quality = evaluator.Evaluate(desc);
+        qualityCache[qualityKey] = currResult.Quality;
+    }
+
+    results.push_back(currResult);
+}
+
+void ShadowBenchmark::WriteResults() const
+{
+    std::string csv = "Scene,ShadowMode,ShadowMapSize,FixedFilterSize,PartitionMode,FrameTimeMs,"
+                      "CPUCullingMs,CPUCascadeSetupMs,CPUSubmissionMs,CPUDepthReductionMs,GPUDepthPrepassMs,"
+                      "GPUShadowMapMs,GPUDepthReductionMs,GPUMeshRenderingMs,ShadowMemoryBytes,"
+                      "MeanError,RMSError,MaxError,FalseShadowRate,FalseLitRate\n";
+
+    std::string json = "{\n";
+    json += MakeString("  \"warmupFrames\": %u,\n  \"measureFrames\": %u,\n  \"qualityReceivers\": %u,\n",
+                       WarmupFrames, MeasureFrames, NumQualityReceivers);
+    json += "  \"results\": [\n";
+
+    for(uint64 i = 0; i < results.size(); ++i)
+    {
+        const BenchmarkResult& r = results[i];
+        const char* sceneName = AppSettings::CurrentScene.ValueLabel(uint32(r.Config.TestScene));
+        const char* modeName = AppSettings::ShadowMode.ValueLabel(uint32(r.Config.Mode));
+        const char* partitionName = AppSettings::PartitionMode.ValueLabel(uint32(r.Config.Partitioning));
+        const uint32 resolution = AppSettings::ShadowMapResolution(uint32(r.Config.Size));
+        const uint32 kernelSize = AppSettings::FixedFilterKernelSize(uint32(r.Config.FilterSize));
+
+        csv += MakeString("%s,%s,%u,%u,%s,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%llu,%.6f,%.6f,%.6f,%.6f,%.6f\n",
+                          sceneName, modeName, resolution, kernelSize, partitionName, r.FrameTime, r.CPUCulling,
+                          r.CPUCascadeSetup, r.CPUSubmission, r.CPUDepthReduction, r.GPUDepthPrepass,
+                          r.GPUShadowMap, r.GPUDepthReduction, r.GPUMeshRendering, r.ShadowMemory,
+                          r.Quality.MeanError, r.Quality.RMSError, r.Quality.MaxError,
+                          r.Quality.FalseShadowRate, r.Quality.FalseLitRate);
+
+        json += MakeString("    { \"scene\": \"%s\", \"shadowMode\": \"%s\", \"shadowMapSize\": %u, "
+                           "\"fixedFilterSize\": %u, \"partitionMode\": \"%s\",\n",
+                           sceneName, modeName, resolution, kernelSize, partitionName);
+        json += MakeString("      \"frameTimeMs\": %.4f, \"cpuCullingMs\": %.4f, \"cpuCascadeSetupMs\": %.4f, "
+                           "\"cpuSubmissionMs\": %.4f, \"cpuDepthReductionMs\": %.4f,\n",
+                           r.FrameTime, r.CPUCulling, r.CPUCascadeSetup, r.CPUSubmission, r.CPUDepthReduction);
+        json += MakeString("      \"gpuDepthPrepassMs\": %.4f, \"gpuShadowMapMs\": %.4f, \"gpuDepthReductionMs\": %.4f, "
+                           "\"gpuMeshRenderingMs\": %.4f, \"shadowMemoryBytes\": %llu,\n",
+                           r.GPUDepthPrepass, r.GPUShadowMap, r.GPUDepthReduction, r.GPUMeshRendering,
+                           r.ShadowMemory);
+        json += MakeString("      \"meanError\": %.6f, \"rmsError\": %.6f, \"maxError\": %.6f, "
+                           "\"falseShadowRate\": %.6f, \"falseLitRate\": %.6f }%s\n",
+                           r.Quality.MeanError, r.Quality.RMSError, r.Quality.MaxError, r.Quality.FalseShadowRate,
+                           r.Quality.FalseLitRate, i + 1 < results.size() ? "," : "");
+    }
+
+    json += "  ]\n}\n";
+
+    WriteStringAsFile((outputPath + L".csv").c_str(), csv);
+    WriteStringAsFile((outputPath + L".json").c_str(), json);
+
+    std::string summary = MakeString("Shadow benchmark finished: %u configurations written to %ls.csv/.json\n",
+                                     uint32(results.size()), outputPath.c_str());
+    PrintReport(summary);
+}
+
+void ShadowBenchmark::RestoreSettings()
+{
+    AppSettings::CurrentScene.SetValue(savedConfig.TestScene);
+    AppSettings::ShadowMode.SetValue(savedConfig.Mode);
+    AppSettings::ShadowMapSize.SetValue(savedConfig.Size);
+    AppSettings::FixedFilterSize.SetValue(savedConfig.FilterSize);
+    AppSettings::PartitionMode.SetValue(savedConfig.Partitioning);
+    AppSettings::AnimateLight.SetValue(savedAnimateLight);
+}
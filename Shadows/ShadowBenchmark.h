@@ -0,0 +1,100 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+#include "SampleFramework11/Camera.h"
+#include "SampleFramework11/Timer.h"
+
+#include "AppSettings.h"
+#include "BVH.h"
+#include "ShadowReference.h"
+
+using namespace SampleFramework11;
+
+// One combination of the settings that get swept by the benchmark
+struct BenchmarkConfig
+{
+    Scene TestScene;
+    ShadowMode Mode;
+    ShadowMapSize Size;
+    FixedFilterSize FilterSize;
+    PartitionMode Partitioning;
+};
+
+// Timings and quality for a single configuration, all times are in milliseconds
+struct BenchmarkResult
+{
+    BenchmarkConfig Config;
+    float FrameTime;
+    float CPUCulling;
+    float CPUCascadeSetup;
+    float CPUSubmission;
+    float CPUDepthReduction;
+    float GPUDepthPrepass;
+    float GPUShadowMap;
+    float GPUDepthReduction;
+    float GPUMeshRendering;
+    uint64 ShadowMemory;
+    ShadowErrorMetrics Quality;
+};
+
+// Sweeps Scene x ShadowMode x ShadowMapSize x FixedFilterSize x PartitionMode, replaying the
+// same camera path for each combination. Timings come from the profiler, and quality comes
+// from comparing a CPU simulation of each technique against ray traced visibility.
+class ShadowBenchmark
+{
+
+public:
+
+    // Adds the triangles of a scene to a BVH, which is used for the quality metrics
+    typedef std::function<void(Scene scene, BVH& bvh)> AddSceneFunction;
+
+    ShadowBenchmark();
+
+    // Starts the benchmark, which writes outputPath.csv and outputPath.json when finished
+    void Start(const std::wstring& outputPath, AddSceneFunction addScene);
+
+    // Needs to be called at the start of every frame. This records the results of the
+    // previous frame, and applies the settings and camera for the next one.
+    void Update(FirstPersonCamera& camera, const Timer& timer);
+
+    bool Running() const { return running; }
+    float Progress() const;
+
+protected:
+
+    bool ApplyConfig(uint32 configIdx);
+    void RecordFrame(const Timer& timer);
+    void FinishConfig();
+    void WriteResults() const;
+    void RestoreSettings();
+
+    bool running;
+    std::wstring outputPath;
+    AddSceneFunction addScene;
+
+    uint32 numConfigs;
+    uint32 currConfig;
+    uint32 currFrame;
+    BenchmarkResult currResult;
+    std::vector<BenchmarkResult> results;
+
+    // Quality only depends on the scene and the technique, so it's cached per scene
+    BVH sceneBVH;
+    ShadowQualityEvaluator evaluator;
+    Scene evaluatorScene;
+    std::map<uint32, ShadowErrorMetrics> qualityCache;
+
+    // Settings to restore once the benchmark is done
+    BenchmarkConfig savedConfig;
+    bool32 savedAnimateLight;
+};
@@ -0,0 +1,236 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "ShadowFilters.h"
+
+FilterableShadowParams::FilterableShadowParams() : EVSMExponents(0.0f, 0.0f), ESMExponent(0.0f), VSMBias(0.0f),
+                                                   MSMDepthBias(0.0f), MSMMomentBias(0.0f),
+                                                   LightBleedingReduction(0.0f)
+{
+}
+
+// Fills out the filterable shadow parameters from the current app settings
+FilterableShadowParams FilterableShadowParamsFromSettings(SMFormat smFormat)
+{
+    FilterableShadowParams params;
+    params.EVSMExponents = GetEVSMExponents(AppSettings::PositiveExponent, AppSettings::NegativeExponent, smFormat);
+    params.ESMExponent = GetESMExponent(AppSettings::PositiveExponent, smFormat);
+    params.VSMBias = AppSettings::VSMBias;
+    params.MSMDepthBias = AppSettings::MSMDepthBias;
+    params.MSMMomentBias = AppSettings::MSMMomentBias;
+    params.LightBleedingReduction = AppSettings::LightBleedingReduction;
+    return params;
+}
+
+// Clamps the EVSM exponents to the maximum range of fp32/fp16 to prevent overflow/underflow
+Float2 GetEVSMExponents(float positiveExponent, float negativeExponent, SMFormat smFormat)
+{
+    const float maxExponent = smFormat == SMFormat::SM32Bit ? 42.0f : 5.54f;
+    return Float2(std::min(positiveExponent, maxExponent), std::min(negativeExponent, maxExponent));
+}
+
+// ESM only stores the warped depth and not its square, so it can use twice the range of EVSM
+float GetESMExponent(float positiveExponent, SMFormat smFormat)
+{
+    const float maxExponent = smFormat == SMFormat::SM32Bit ? 84.0f : 11.08f;
+    return std::min(positiveExponent, maxExponent);
+}
+
+// Applies exponential warp to shadow map depth, input depth should be in [0, 1]
+Float2 WarpDepth(float depth, const Float2& exponents)
+{
+    // Rescale depth into [-1, 1]
+    depth = 2.0f * depth - 1.0f;
+    float pos =  std::exp( exponents.x * depth);
+    float neg = -std::exp(-exponents.y * depth);
+    return Float2(pos, neg);
+}
+
+// Reduces VSM light bleeding by removing the [0, amount] tail and linearly rescaling (amount, 1]
+float ReduceLightBleeding(float pMax, float amount)
+{
+    if(amount >= 1.0f)
+        return pMax >= 1.0f ? 1.0f : 0.0f;
+    return Saturate((pMax - amount) / (1.0f - amount));
+}
+
+float ChebyshevUpperBound(const Float2& moments, float mean, float minVariance, float lightBleedingReduction)
+{
+    // Compute variance
+    float variance = moments.y - (moments.x * moments.x);
+    variance = std::max(variance, minVariance);
+
+    // Compute probabilistic upper bound
+    float d = mean - moments.x;
+    float pMax = variance / (variance + (d * d));
+
+    pMax = ReduceLightBleeding(pMax, lightBleedingReduction);
+
+    // One-tailed Chebyshev
+    return (mean <= moments.x ? 1.0f : pMax);
+}
+
+// Shared setup for the MSM functions: computes the biased moments and the depth values of
+// the 3-delta solution
+static void SolveMSM(const Float4& moments, float fragmentDepth, float depthBias, float momentBias,
+                     float b[4], float z[3])
+{
+    // Bias input data to avoid artifacts
+    b[0] = Lerp(moments.x, 0.5f, momentBias);
+    b[1] = Lerp(moments.y, 0.5f, momentBias);
+    b[2] = Lerp(moments.z, 0.5f, momentBias);
+    b[3] = Lerp(moments.w, 0.5f, momentBias);
+    z[0] = fragmentDepth - depthBias;
+
+    // Compute a Cholesky factorization of the Hankel matrix B storing only non-
+    // trivial entries or related products
+    float L32D22 = -b[0] * b[1] + b[2];
+    float D22 = -b[0] * b[0] + b[1];
+    float squaredDepthVariance = -b[1] * b[1] + b[3];
+    float D33D22 = squaredDepthVariance * D22 - L32D22 * L32D22;
+    float InvD22 = 1.0f / D22;
+    float L32 = L32D22 * InvD22;
+
+    // Obtain a scaled inverse image of bz = (1,z[0],z[0]*z[0])^T
+    float c[3] = { 1.0f, z[0], z[0] * z[0] };
+
+    // Forward substitution to solve L*c1=bz
+    c[1] -= b[0];
+    c[2] -= b[1] + L32 * c[1];
+
+    // Scaling to solve D*c2=c1
+    c[1] *= InvD22;
+    c[2] *= D22 / D33D22;
+
+    // Backward substitution to solve L^T*c3=c2
+    c[1] -= L32 * c[2];
+    c[0] -= c[1] * b[0] + c[2] * b[1];
+
+    // Solve the quadratic equation c[0]+c[1]*z+c[2]*z^2 to obtain solutions
+    // z[1] and z[2]
+    float p = c[1] / c[2];
+    float q = c[0] / c[2];
+    float D = (p * p * 0.25f) - q;
+    float r = std::sqrt(D);
+    z[1] = -p * 0.5f - r;
+    z[2] = -p * 0.5f + r;
+}
+
+// Computes the shadow intensity of the 3-delta solution
+static float ThreeDeltaIntensity(const float b[4], const float z[3])
+{
+    float switchVal[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    if(z[2] < z[0])
+    {
+        switchVal[0] = z[1];
+        switchVal[1] = z[0];
+        switchVal[2] = 1.0f;
+        switchVal[3] = 1.0f;
+    }
+    else if(z[1] < z[0])
+    {
+        switchVal[0] = z[0];
+        switchVal[1] = z[1];
+        switchVal[2] = 0.0f;
+        switchVal[3] = 1.0f;
+    }
+
+    float quotient = (switchVal[0] * z[2] - b[0] * (switchVal[0] + z[2]) + b[1]) / ((z[2] - switchVal[1]) * (z[0] - z[1]));
+    return switchVal[2] + switchVal[3] * quotient;
+}
+
+float ComputeMSMHamburger(const Float4& moments, float fragmentDepth, float depthBias, float momentBias)
+{
+    float b[4];
+    float z[3];
+    SolveMSM(moments, fragmentDepth, depthBias, momentBias, b, z);
+
+    return 1.0f - Saturate(ThreeDeltaIntensity(b, z));
+}
+
+float ComputeMSMHausdorff(const Float4& moments, float fragmentDepth, float depthBias, float momentBias)
+{
+    float b[4];
+    float z[3];
+    SolveMSM(moments, fragmentDepth, depthBias, momentBias, b, z);
+
+    float shadowIntensity = 1.0f;
+
+    // Use a solution made of four deltas if the solution with three deltas is invalid
+    if(z[1] < 0.0f || z[2] > 1.0f)
+    {
+        float zFree = ((b[2] - b[1]) * z[0] + b[2] - b[3]) / ((b[1] - b[0]) * z[0] + b[1] - b[2]);
+        float w1Factor = (z[0] > zFree) ? 1.0f : 0.0f;
+        shadowIntensity = (b[1] - b[0] + (b[2] - b[0] - (zFree + 1.0f) * (b[1] - b[0])) * (zFree - w1Factor - z[0])
+                                                / (z[0] * (z[0] - zFree))) / (zFree - w1Factor) + 1.0f - b[0];
+    }
+    else
+    {
+        shadowIntensity = ThreeDeltaIntensity(b, z);
+    }
+
+    return 1.0f - Saturate(shadowIntensity);
+}
+
+// Mirrors SampleShadowMapVSM/SampleShadowMapEVSM/SampleShadowMapMSM from Mesh.hlsl
+float EvaluateFilterableShadow(ShadowMode shadowMode, const Float4& moments, float depth,
+                               const FilterableShadowParams& params)
+{
+    if(shadowMode == ShadowMode::VSM)
+    {
+        return ChebyshevUpperBound(Float2(moments.x, moments.y), depth, params.VSMBias * 0.01f,
+                                   params.LightBleedingReduction);
+    }
+    else if(shadowMode == ShadowMode::EVSM2 || shadowMode == ShadowMode::EVSM4)
+    {
+        Float2 warpedDepth = WarpDepth(depth, params.EVSMExponents);
+
+        // Derivative of warping at depth
+        Float2 depthScale = Float2(params.VSMBias * 0.01f) * params.EVSMExponents * warpedDepth;
+        Float2 minVariance = depthScale * depthScale;
+
+        if(shadowMode == ShadowMode::EVSM4)
+        {
+            float posContrib = ChebyshevUpperBound(Float2(moments.x, moments.z), warpedDepth.x, minVariance.x,
+                                                   params.LightBleedingReduction);
+            float negContrib = ChebyshevUpperBound(Float2(moments.y, moments.w), warpedDepth.y, minVariance.y,
+                                                   params.LightBleedingReduction);
+            return std::min(posContrib, negContrib);
+        }
+
+        // Positive only
+        return ChebyshevUpperBound(Float2(moments.x, moments.y), warpedDepth.x, minVariance.x,
+                                   params.LightBleedingReduction);
+    }
+    else if(shadowMode == ShadowMode::MSMHamburger || shadowMode == ShadowMode::MSMHausdorff)
+    {
+        float result = 0.0f;
+        if(shadowMode == ShadowMode::MSMHausdorff)
+            result = ComputeMSMHausdorff(moments, depth, params.MSMDepthBias * 0.001f, params.MSMMomentBias * 0.001f);
+        else
+            result = ComputeMSMHamburger(moments, depth, params.MSMDepthBias * 0.001f, params.MSMMomentBias * 0.001f);
+
+        return ReduceLightBleeding(result, params.LightBleedingReduction);
+    }
+    else if(shadowMode == ShadowMode::ESM)
+    {
+        // The filtered map stores E[exp(c * occluder)], so dividing by exp(c * receiver) gives
+        // exp(c * (occluder - receiver)) for a single occluder
+        float warpedDepth = WarpDepth(depth, Float2(params.ESMExponent, 0.0f)).x;
+        float result = Saturate(moments.x / warpedDepth);
+
+        return ReduceLightBleeding(result, params.LightBleedingReduction);
+    }
+
+    Assert_(false);
+    return 1.0f;
+}
@@ -0,0 +1,52 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+#include "SampleFramework11/Math.h"
+
+#include "AppSettings.h"
+
+using namespace SampleFramework11;
+
+// CPU versions of the shadow filtering functions from VSM.hlsl and MSM.hlsl. These are kept
+// as close as possible to the shader code so that they can be used as a reference when
+// measuring the precision/quality of the different shadow techniques and storage formats.
+
+// Parameters used for evaluating filterable (VSM/EVSM/ESM/MSM) shadows, with the same scaling
+// as the UI settings
+struct FilterableShadowParams
+{
+    Float2 EVSMExponents;
+    float ESMExponent;
+    float VSMBias;
+    float MSMDepthBias;
+    float MSMMomentBias;
+    float LightBleedingReduction;
+
+    FilterableShadowParams();
+};
+
+FilterableShadowParams FilterableShadowParamsFromSettings(SMFormat smFormat);
+
+Float2 GetEVSMExponents(float positiveExponent, float negativeExponent, SMFormat smFormat);
+float GetESMExponent(float positiveExponent, SMFormat smFormat);
+Float2 WarpDepth(float depth, const Float2& exponents);
+float ReduceLightBleeding(float pMax, float amount);
+float ChebyshevUpperBound(const Float2& moments, float mean, float minVariance, float lightBleedingReduction);
+float ComputeMSMHamburger(const Float4& moments, float fragmentDepth, float depthBias, float momentBias);
+float ComputeMSMHausdorff(const Float4& moments, float fragmentDepth, float depthBias, float momentBias);
+
+// Evaluates the visibility term of a filterable shadow mode for a receiver at the given depth.
+// The moments need to be laid out the same way as they are in the moment shadow map, but
+// converted back to the standard basis.
+float EvaluateFilterableShadow(ShadowMode shadowMode, const Float4& moments, float depth,
+                               const FilterableShadowParams& params);
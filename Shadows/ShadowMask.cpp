@@ -0,0 +1,323 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "ShadowMask.h"
+#include "SharedConstants.h"
+
+#include "SampleFramework11/Assert.h"
+#include "SampleFramework11/Utility.h"
+
+// Scale of the mask that gets checked by ShadowMaskReport, which matches the half resolution mode
+static const uint32 ReportMaskScale = 2;
+
+// Direction of the ray through the center of a pixel, scaled so that its view-space z is 1. The
+// distance to a hit along the ray is then the view-space depth.
+static Float3 PixelRayDirection(const Camera& camera, uint32 x, uint32 y, uint32 width, uint32 height)
+{
+    const Float4x4& projection = camera.ProjectionMatrix();
+    const float ndcX = (x + 0.5f) / width * 2.0f - 1.0f;
+    const float ndcY = 1.0f - (y + 0.5f) / height * 2.0f;
+    const Float3 dirVS = Float3(ndcX / projection._11, ndcY / projection._22, 1.0f);
+    return Float3::TransformDirection(dirVS, camera.WorldMatrix());
+}
+
+ShadowMaskImage::ShadowMaskImage() : Width(0), Height(0)
+{
+}
+
+void ShadowMaskImage::Initialize(uint32 width, uint32 height)
+{
+    Width = width;
+    Height = height;
+    Visibility.assign(width * height, 1.0f);
+    Depth.assign(width * height, 0.0f);
+}
+
+void DownsampleShadowMask(const ShadowMaskImage& src, uint32 scale, ShadowMaskImage& dst)
+{
+    Assert_(scale >= 1);
+
+    dst.Initialize((src.Width + scale - 1) / scale, (src.Height + scale - 1) / scale);
+    for(uint32 y = 0; y < dst.Height; ++y)
+    {
+        for(uint32 x = 0; x < dst.Width; ++x)
+        {
+            const uint32 srcIdx = y * scale * src.Width + x * scale;
+            dst.Visibility[y * dst.Width + x] = src.Visibility[srcIdx];
+            dst.Depth[y * dst.Width + x] = src.Depth[srcIdx];
+        }
+    }
+}
+
+float SampleShadowMask(const ShadowMaskImage& mask, uint32 scale, uint32 x, uint32 y, float depthVS,
+                       bool* usedFallback)
+{
+    Assert_(mask.Width > 0 && mask.Height > 0);
+    Assert_(depthVS > 0.0f);
+
+    const uint32 baseX = x / scale;
+    const uint32 baseY = y / scale;
+    const float lerpX = float(x) / scale - baseX;
+    const float lerpY = float(y) / scale - baseY;
+
+    float sum = 0.0f;
+    float weightSum = 0.0f;
+    float closest = 1.0f;
+    float closestDiff = FLT_MAX;
+    for(uint32 i = 0; i < 4; ++i)
+    {
+        const uint32 offsetX = i & 1;
+        const uint32 offsetY = i >> 1;
+        const uint32 texelIdx = std::min(baseY + offsetY, mask.Height - 1) * mask.Width +
+                                std::min(baseX + offsetX, mask.Width - 1);
+
+        const float bilinear = (offsetX == 1 ? lerpX : 1.0f - lerpX) * (offsetY == 1 ? lerpY : 1.0f - lerpY);
+        const float depthDiff = std::abs(mask.Depth[texelIdx] - depthVS) / depthVS;
+        const float weight = bilinear * Saturate(1.0f - depthDiff / ShadowMaskDepthThreshold);
+        sum += mask.Visibility[texelIdx] * weight;
+        weightSum += weight;
+
+        if(depthDiff < closestDiff)
+        {
+            closest = mask.Visibility[texelIdx];
+            closestDiff = depthDiff;
+        }
+    }
+
+    const bool fallback = weightSum < ShadowMaskMinWeight;
+    if(usedFallback != nullptr)
+        *usedFallback = fallback;
+
+    return fallback ? closest : sum / weightSum;
+}
+
+void UpsampleShadowMask(const ShadowMaskImage& mask, uint32 scale, const float* depthVS,
+                        uint32 width, uint32 height, float* visibility, uint32* numFallbacks)
+{
+    uint32 fallbackCount = 0;
+    for(uint32 y = 0; y < height; ++y)
+    {
+        for(uint32 x = 0; x < width; ++x)
+        {
+            bool usedFallback = false;
+            const uint32 idx = y * width + x;
+            visibility[idx] = SampleShadowMask(mask, scale, x, y, depthVS[idx], &usedFallback);
+            fallbackCount += usedFallback ? 1 : 0;
+        }
+    }
+
+    if(numFallbacks != nullptr)
+        *numFallbacks = fallbackCount;
+}
+
+ShadowErrorMetrics ShadowMaskUpsampleError(const ShadowMaskImage& fullRes, uint32 scale,
+                                           uint32* numFallbacks)
+{
+    ShadowMaskImage lowRes;
+    DownsampleShadowMask(fullRes, scale, lowRes);
+
+    std::vector<float> upsampled(fullRes.Visibility.size());
+    UpsampleShadowMask(lowRes, scale, fullRes.Depth.data(), fullRes.Width, fullRes.Height,
+                       upsampled.data(), numFallbacks);
+
+    return ComputeShadowErrorMetrics(fullRes.Visibility.data(), upsampled.data(), uint32(upsampled.size()));
+}
+
+float ShadowSampleRotation(uint64 frameIndex)
+{
+    // Wrap the index first so that the float doesn't run out of precision
+    const float rotation = float(frameIndex % 4096) * GoldenRatioFrac;
+    return rotation - std::floor(rotation);
+}
+
+bool ReprojectShadowMaskPosition(const Float3& positionWS, const Float4x4& prevViewProjection,
+                                 uint32 screenWidth, uint32 screenHeight, uint32 scale,
+                                 Float2& historyTexelPos, float& prevDepthVS)
+{
+    const Float4x4& m = prevViewProjection;
+    const float x = positionWS.x * m._11 + positionWS.y * m._21 + positionWS.z * m._31 + m._41;
+    const float y = positionWS.x * m._12 + positionWS.y * m._22 + positionWS.z * m._32 + m._42;
+    const float w = positionWS.x * m._14 + positionWS.y * m._24 + positionWS.z * m._34 + m._44;
+    if(w <= 0.0f)
+        return false;
+
+    const Float2 uv = Float2(x / w * 0.5f + 0.5f, y / w * -0.5f + 0.5f);
+    if(uv.x < 0.0f || uv.y < 0.0f || uv.x > 1.0f || uv.y > 1.0f)
+        return false;
+
+    // Mask texel i sits on screen pixel i * scale, so the center of pixel i * scale maps to the
+    // center of the texel
+    historyTexelPos.x = (uv.x * screenWidth - 0.5f) / scale + 0.5f;
+    historyTexelPos.y = (uv.y * screenHeight - 0.5f) / scale + 0.5f;
+    prevDepthVS = w;
+    return true;
+}
+
+float SampleShadowMaskBilinear(const ShadowMaskImage& mask, const Float2& texelPos, float& depthVS)
+{
+    Assert_(mask.Width > 0 && mask.Height > 0);
+
+    const float baseX = std::floor(texelPos.x - 0.5f);
+    const float baseY = std::floor(texelPos.y - 0.5f);
+    const float lerpX = texelPos.x - 0.5f - baseX;
+    const float lerpY = texelPos.y - 0.5f - baseY;
+
+    float visibility = 0.0f;
+    depthVS = 0.0f;
+    for(uint32 i = 0; i < 4; ++i)
+    {
+        const uint32 offsetX = i & 1;
+        const uint32 offsetY = i >> 1;
+        const int32 x = Clamp(int32(baseX) + int32(offsetX), 0, int32(mask.Width) - 1);
+        const int32 y = Clamp(int32(baseY) + int32(offsetY), 0, int32(mask.Height) - 1);
+        const uint32 texelIdx = uint32(y) * mask.Width + uint32(x);
+
+        const float weight = (offsetX == 1 ? lerpX : 1.0f - lerpX) * (offsetY == 1 ? lerpY : 1.0f - lerpY);
+        visibility += mask.Visibility[texelIdx] * weight;
+        depthVS += mask.Depth[texelIdx] * weight;
+    }
+
+    return visibility;
+}
+
+bool ShadowHistoryMatches(float historyDepthVS, float prevDepthVS)
+{
+    return std::abs(historyDepthVS - prevDepthVS) <= ShadowHistoryDepthThreshold * prevDepthVS;
+}
+
+float AccumulateShadowHistory(const ShadowMaskImage& history, const Float3& positionWS,
+                              const Float4x4& prevViewProjection, uint32 screenWidth,
+                              uint32 screenHeight, uint32 scale, uint32 historyFrames,
+                              float visibility, bool* historyRejected)
+{
+    Assert_(historyFrames >= 1);
+
+    if(historyRejected != nullptr)
+        *historyRejected = true;
+
+    Float2 historyTexelPos;
+    float prevDepthVS = 0.0f;
+    if(ReprojectShadowMaskPosition(positionWS, prevViewProjection, screenWidth, screenHeight, scale,
+                                   historyTexelPos, prevDepthVS) == false)
+        return visibility;
+
+    float historyDepthVS = 0.0f;
+    const float historyVisibility = SampleShadowMaskBilinear(history, historyTexelPos, historyDepthVS);
+    if(ShadowHistoryMatches(historyDepthVS, prevDepthVS) == false)
+        return visibility;
+
+    if(historyRejected != nullptr)
+        *historyRejected = false;
+
+    return Lerp(historyVisibility, visibility, 1.0f / historyFrames);
+}
+
+void TraceShadowMask(const BVH& bvh, const Camera& camera, const Float3& lightDir, uint32 width,
+                     uint32 height, ShadowMaskImage& mask, uint32 numThreads)
+{
+    Assert_(bvh.Built());
+
+    mask.Initialize(width, height);
+    const Float3 toLight = Float3::Normalize(lightDir);
+    const float offset = RayOffset(bvh);
+
+    ParallelFor(height, numThreads, [&](uint32 startY, uint32 endY)
+    {
+        for(uint32 y = startY; y < endY; ++y)
+        {
+            for(uint32 x = 0; x < width; ++x)
+            {
+                const uint32 idx = y * width + x;
+                const Float3 dir = PixelRayDirection(camera, x, y, width, height);
+                const float depthVS = bvh.Intersect(camera.Position(), dir, camera.NearClip(), camera.FarClip());
+                if(depthVS >= camera.FarClip())
+                {
+                    mask.Depth[idx] = camera.FarClip();
+                    continue;
+                }
+
+                // There's no surface normal, so the shadow ray gets pushed back towards the camera
+                const Float3 positionWS = camera.Position() + dir * depthVS;
+                const Float3 origin = positionWS - Float3::Normalize(dir) * offset;
+                mask.Depth[idx] = depthVS;
+                mask.Visibility[idx] = bvh.Occluded(origin, toLight, 0.0f, FLT_MAX) ? 0.0f : 1.0f;
+            }
+        }
+    }, 1);
+}
+
+std::string ShadowMaskReport(const BVH& bvh, const FirstPersonCamera& camera, const Float3& lightDir,
+                             uint32 width, uint32 height, uint32 historyFrames)
+{
+    ShadowMaskImage fullRes;
+    TraceShadowMask(bvh, camera, lightDir, width, height, fullRes);
+
+    std::string report = MakeString("\nShadow mask report: %ux%u pixels traced from the camera, mask at 1/%u "
+                                    "resolution\n", width, height, ReportMaskScale);
+
+    uint32 numFallbacks = 0;
+    const ShadowErrorMetrics upsample = ShadowMaskUpsampleError(fullRes, ReportMaskScale, &numFallbacks);
+    report += MakeString("Bilateral upsample: mean %.4f, RMS %.4f, max %.4f, %.2f%% false shadow, "
+                         "%.2f%% false lit, %.2f%% of pixels used the fallback\n", upsample.MeanError,
+                         upsample.RMSError, upsample.MaxError, upsample.FalseShadowRate * 100.0f,
+                         upsample.FalseLitRate * 100.0f, numFallbacks * 100.0f / (width * height));
+
+    // Trace the previous frame from a slightly different spot, and accumulate each texel of the
+    // current mask with it. The visibility is exact in both frames, so any error comes from the
+    // reprojection and the depth rejection.
+    FirstPersonCamera prevCamera = camera;
+    const float moveDistance = Float3::Length(bvh.BoundsMax() - bvh.BoundsMin()) * 0.002f;
+    prevCamera.SetPosition(camera.Position() + camera.Right() * moveDistance);
+
+    ShadowMaskImage prevFullRes;
+    TraceShadowMask(bvh, prevCamera, lightDir, width, height, prevFullRes);
+
+    ShadowMaskImage history;
+    ShadowMaskImage current;
+    DownsampleShadowMask(prevFullRes, ReportMaskScale, history);
+    DownsampleShadowMask(fullRes, ReportMaskScale, current);
+
+    std::vector<float> accumulated(current.Visibility);
+    uint32 numSurfaceTexels = 0;
+    uint32 numRejected = 0;
+    for(uint32 y = 0; y < current.Height; ++y)
+    {
+        for(uint32 x = 0; x < current.Width; ++x)
+        {
+            // The mask isn't evaluated for the sky
+            const uint32 idx = y * current.Width + x;
+            if(current.Depth[idx] >= camera.FarClip())
+                continue;
+
+            const uint32 pixelX = x * ReportMaskScale;
+            const uint32 pixelY = y * ReportMaskScale;
+            const Float3 positionWS = camera.Position() + PixelRayDirection(camera, pixelX, pixelY, width, height)
+                                                        * current.Depth[idx];
+
+            bool rejected = false;
+            accumulated[idx] = AccumulateShadowHistory(history, positionWS, prevCamera.ViewProjectionMatrix(),
+                                                       width, height, ReportMaskScale, historyFrames,
+                                                       current.Visibility[idx], &rejected);
+            numRejected += rejected ? 1 : 0;
+            ++numSurfaceTexels;
+        }
+    }
+
+    const ShadowErrorMetrics temporal = ComputeShadowErrorMetrics(current.Visibility.data(), accumulated.data(),
+                                                                  uint32(accumulated.size()));
+    report += MakeString("Temporal accumulation (%u frames, camera moved %.3f): mean %.4f, RMS %.4f, max %.4f, "
+                         "%.2f%% of the history was rejected\n", historyFrames, moveDistance, temporal.MeanError,
+                         temporal.RMSError, temporal.MaxError,
+                         numRejected * 100.0f / std::max(numSurfaceTexels, 1u));
+
+    return report;
+}
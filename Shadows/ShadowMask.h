@@ -0,0 +1,96 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+#include "SampleFramework11/Math.h"
+#include "SampleFramework11/Camera.h"
+
+#include "ShadowReference.h"
+
+using namespace SampleFramework11;
+
+// CPU reference for the shadow mask, which matches ShadowMaskPS and SampleShadowMask in Mesh.hlsl.
+// The upsample can be checked by evaluating a full resolution mask, running it through
+// DownsampleShadowMask and comparing the result of UpsampleShadowMask against the original.
+// ShadowMaskReport does this with a mask that's ray traced from the camera.
+
+// One visibility value and one view-space depth per texel. Sky texels should get a visibility of 1
+// and the far clip distance as their depth, which is what comes out of the depth buffer.
+struct ShadowMaskImage
+{
+    uint32 Width;
+    uint32 Height;
+    std::vector<float> Visibility;
+    std::vector<float> Depth;
+
+    ShadowMaskImage();
+
+    void Initialize(uint32 width, uint32 height);
+};
+
+// Makes a mask that's scale times smaller in each dimension, where every texel keeps the
+// top-left pixel of its block just like ShadowMaskPS does
+void DownsampleShadowMask(const ShadowMaskImage& src, uint32 scale, ShadowMaskImage& dst);
+
+// CPU version of SampleShadowMask, for the pixel at (x, y) of the full resolution image. If
+// usedFallback isn't null, it gets set to whether none of the texels were on the same surface.
+float SampleShadowMask(const ShadowMaskImage& mask, uint32 scale, uint32 x, uint32 y, float depthVS,
+                       bool* usedFallback = nullptr);
+
+// Upsamples the mask to the resolution of the depth buffer, using the depth of every pixel
+void UpsampleShadowMask(const ShadowMaskImage& mask, uint32 scale, const float* depthVS,
+                        uint32 width, uint32 height, float* visibility, uint32* numFallbacks = nullptr);
+
+// Error from evaluating the shadows at a lower resolution and upsampling them, using a full
+// resolution mask as the reference
+ShadowErrorMetrics ShadowMaskUpsampleError(const ShadowMaskImage& fullRes, uint32 scale,
+                                           uint32* numFallbacks = nullptr);
+
+// Temporal accumulation, which matches AccumulateShadowHistory in Mesh.hlsl.
+
+// Extra rotation of the random disc and PCSS sample patterns for a frame, as a fraction of a full
+// turn. This follows the golden ratio sequence so that any run of consecutive frames ends up
+// with rotations that are spread out evenly.
+float ShadowSampleRotation(uint64 frameIndex);
+
+// Projects a world-space position with the previous frame's camera, and returns its position in
+// texels of a shadow mask with the given scale, along with its view-space depth from that camera.
+// Returns false if the position was behind the camera or off-screen.
+bool ReprojectShadowMaskPosition(const Float3& positionWS, const Float4x4& prevViewProjection,
+                                 uint32 screenWidth, uint32 screenHeight, uint32 scale,
+                                 Float2& historyTexelPos, float& prevDepthVS);
+
+// Bilinear fetch of a mask texel position, clamped to the edges. Returns the visibility, and the
+// filtered depth in depthVS.
+float SampleShadowMaskBilinear(const ShadowMaskImage& mask, const Float2& texelPos, float& depthVS);
+
+// Whether a history texel belongs to the same surface as the reprojected position
+bool ShadowHistoryMatches(float historyDepthVS, float prevDepthVS);
+
+// Blends the visibility of the current frame with the history texel that the position reprojects
+// to, where historyFrames controls the exponential falloff. Falls back to the current visibility
+// if the history was rejected.
+float AccumulateShadowHistory(const ShadowMaskImage& history, const Float3& positionWS,
+                              const Float4x4& prevViewProjection, uint32 screenWidth,
+                              uint32 screenHeight, uint32 scale, uint32 historyFrames,
+                              float visibility, bool* historyRejected = nullptr);
+
+// Ray traces exact visibility (0 or 1) for every pixel of the camera's view, along with the
+// view-space depth of the closest hit. Pixels that don't hit anything get the sky values.
+void TraceShadowMask(const BVH& bvh, const Camera& camera, const Float3& lightDir, uint32 width,
+                     uint32 height, ShadowMaskImage& mask, uint32 numThreads = 0);
+
+// Error of the half resolution upsample and of the temporal accumulation, compared to a mask that's
+// ray traced from the camera. The history for the temporal accumulation is traced with the camera
+// moved slightly to the side, like it would be after a frame of strafing.
+std::string ShadowMaskReport(const BVH& bvh, const FirstPersonCamera& camera, const Float3& lightDir,
+                             uint32 width, uint32 height, uint32 historyFrames);
@@ -0,0 +1,69 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+//=================================================================================================
+// Resources
+//=================================================================================================
+
+// Single-slice view of a shadow map cascade
+Texture2DArray<float> DepthMap : register(t0);
+
+// Single-mip view of the previous level of the pyramid
+Texture2DArray<float2> MinMaxMap : register(t0);
+
+// ------------------------------------------------------------------------------------------------
+// Returns the min of 4 values
+// ------------------------------------------------------------------------------------------------
+float Min4(in float4 values)
+{
+    return min(min(values.x, values.y), min(values.z, values.w));
+}
+
+// ------------------------------------------------------------------------------------------------
+// Returns the max of 4 values
+// ------------------------------------------------------------------------------------------------
+float Max4(in float4 values)
+{
+    return max(max(values.x, values.y), max(values.z, values.w));
+}
+
+// ------------------------------------------------------------------------------------------------
+// Builds the first level of the min/max depth pyramid used for PCSS, where each texel stores
+// the min and max of a 2x2 block of shadow map texels
+// ------------------------------------------------------------------------------------------------
+float2 MinMaxInitialPS(in float4 PositionSS : SV_Position,
+                       in float2 TexCoord : TEXCOORD0) : SV_Target0
+{
+    int2 srcPos = int2(PositionSS.xy) * 2;
+
+    float4 depths;
+    depths.x = DepthMap.Load(int4(srcPos + int2(0, 0), 0, 0));
+    depths.y = DepthMap.Load(int4(srcPos + int2(1, 0), 0, 0));
+    depths.z = DepthMap.Load(int4(srcPos + int2(0, 1), 0, 0));
+    depths.w = DepthMap.Load(int4(srcPos + int2(1, 1), 0, 0));
+
+    return float2(Min4(depths), Max4(depths));
+}
+
+// ------------------------------------------------------------------------------------------------
+// Builds the rest of the pyramid levels by combining 2x2 texels from the previous level
+// ------------------------------------------------------------------------------------------------
+float2 MinMaxPS(in float4 PositionSS : SV_Position,
+                in float2 TexCoord : TEXCOORD0) : SV_Target0
+{
+    int2 srcPos = int2(PositionSS.xy) * 2;
+
+    float2 t0 = MinMaxMap.Load(int4(srcPos + int2(0, 0), 0, 0));
+    float2 t1 = MinMaxMap.Load(int4(srcPos + int2(1, 0), 0, 0));
+    float2 t2 = MinMaxMap.Load(int4(srcPos + int2(0, 1), 0, 0));
+    float2 t3 = MinMaxMap.Load(int4(srcPos + int2(1, 1), 0, 0));
+
+    return float2(Min4(float4(t0.x, t1.x, t2.x, t3.x)), Max4(float4(t0.y, t1.y, t2.y, t3.y)));
+}
@@ -0,0 +1,682 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include <mutex>
+#include <random>
+
+#include "ShadowReference.h"
+#include "MomentQuantization.h"
+#include "PCFKernels.h"
+#include "SampleSets.h"
+#include "SharedConstants.h"
+
+#include "SampleFramework11/Utility.h"
+#include "SampleFramework11/Timer.h"
+
+float RayOffset(const BVH& bvh)
+{
+    return Float3::Length(bvh.BoundsMax() - bvh.BoundsMin()) * 1e-5f;
+}
+
+Float3 ShadowLightSpace::Project(const Float3& pos) const
+{
+    float x = (Float3::Dot(pos, Right) - MinXY.x) / Extents.x;
+    float y = (Float3::Dot(pos, Up) - MinXY.y) / Extents.y;
+    float z = (Float3::Dot(pos, Forward) - MinZ) / DepthRange;
+    return Float3(x, y, z);
+}
+
+ShadowLightSpace FitShadowLightSpace(const BVH& bvh, const ShadowReceivers& receivers, const Float3& lightDir)
+{
+    ShadowLightSpace lightSpace;
+    lightSpace.Forward = Float3::Normalize(-lightDir);
+    lightSpace.Right = Float3::Normalize(Float3::Perpendicular(lightSpace.Forward));
+    lightSpace.Up = Float3::Cross(lightSpace.Forward, lightSpace.Right);
+
+    Float2 minXY = Float2(FLT_MAX, FLT_MAX);
+    Float2 maxXY = Float2(-FLT_MAX, -FLT_MAX);
+    for(const Float3& pos : receivers.Positions)
+    {
+        float x = Float3::Dot(pos, lightSpace.Right);
+        float y = Float3::Dot(pos, lightSpace.Up);
+        minXY = Float2(std::min(minXY.x, x), std::min(minXY.y, y));
+        maxXY = Float2(std::max(maxXY.x, x), std::max(maxXY.y, y));
+    }
+
+    // The depth range needs to cover all potential occluders, not just the receivers
+    float minZ = FLT_MAX;
+    float maxZ = -FLT_MAX;
+    const Float3 bounds[2] = { bvh.BoundsMin(), bvh.BoundsMax() };
+    for(uint32 i = 0; i < 8; ++i)
+    {
+        Float3 corner = Float3(bounds[i & 1].x, bounds[(i >> 1) & 1].y, bounds[(i >> 2) & 1].z);
+        float z = Float3::Dot(corner, lightSpace.Forward);
+        minZ = std::min(minZ, z);
+        maxZ = std::max(maxZ, z);
+    }
+
+    lightSpace.MinXY = minXY;
+    lightSpace.Extents = Float2(std::max(maxXY.x - minXY.x, 1e-4f), std::max(maxXY.y - minXY.y, 1e-4f));
+    lightSpace.MinZ = minZ;
+    lightSpace.DepthRange = std::max(maxZ - minZ, 1e-4f);
+
+    return lightSpace;
+}
+
+// Renders a depth map by casting a ray from the near plane for each texel
+static void RenderShadowMap(const BVH& bvh, const ShadowLightSpace& lightSpace, uint32 resolution,
+                            uint32 numThreads, std::vector<float>& depthMap)
+{
+    depthMap.resize(resolution * resolution);
+
+    // Start the rays just in front of the near plane
+    const float startZ = lightSpace.MinZ - lightSpace.DepthRange * 0.01f;
+    const float startOffset = lightSpace.MinZ - startZ;
+
+    ParallelFor(resolution, numThreads, [&](uint32 startRow, uint32 endRow)
+    {
+        for(uint32 y = startRow; y < endRow; ++y)
+        {
+            const float ly = lightSpace.MinXY.y + (y + 0.5f) / resolution * lightSpace.Extents.y;
+            for(uint32 x = 0; x < resolution; x += 4)
+            {
+                RayPacket packet;
+                packet.Direction = lightSpace.Forward;
+                for(uint32 i = 0; i < 4 && x + i < resolution; ++i)
+                {
+                    const float lx = lightSpace.MinXY.x + (x + i + 0.5f) / resolution * lightSpace.Extents.x;
+                    Float3 origin = lightSpace.Right * lx + lightSpace.Up * ly + lightSpace.Forward * startZ;
+                    packet.OriginX[i] = origin.x;
+                    packet.OriginY[i] = origin.y;
+                    packet.OriginZ[i] = origin.z;
+                    packet.ActiveMask |= 1 << i;
+                }
+
+                float hitT[4];
+                bvh.IntersectPacket(packet, hitT);
+
+                for(uint32 i = 0; i < 4 && x + i < resolution; ++i)
+                {
+                    float depth = hitT[i] == FLT_MAX ? 1.0f : (hitT[i] - startOffset) / lightSpace.DepthRange;
+                    depthMap[y * resolution + x + i] = Saturate(depth);
+                }
+            }
+        }
+    });
+}
+
+// Bilinear-filtered depth comparison, same as SampleCmpLevelZero with a linear filter
+static float SampleCmpBilinear(const std::vector<float>& depthMap, uint32 resolution, float texelX, float texelY,
+                               float depth)
+{
+    texelX -= 0.5f;
+    texelY -= 0.5f;
+    const float x0f = std::floor(texelX);
+    const float y0f = std::floor(texelY);
+    const float fracX = texelX - x0f;
+    const float fracY = texelY - y0f;
+
+    const int32 maxCoord = int32(resolution) - 1;
+    const int32 x0 = Clamp(int32(x0f), 0, maxCoord);
+    const int32 y0 = Clamp(int32(y0f), 0, maxCoord);
+    const int32 x1 = Clamp(int32(x0f) + 1, 0, maxCoord);
+    const int32 y1 = Clamp(int32(y0f) + 1, 0, maxCoord);
+
+    auto cmp = [&](int32 x, int32 y) { return depth <= depthMap[y * resolution + x] ? 1.0f : 0.0f; };
+    float top = Lerp(cmp(x0, y0), cmp(x1, y0), fracX);
+    float bottom = Lerp(cmp(x0, y1), cmp(x1, y1), fracX);
+    return Lerp(top, bottom, fracY);
+}
+
+// Bilinear fetch from a moment map with numComponents floats per texel
+static void SampleMomentsBilinear(const std::vector<float>& momentMap, uint32 resolution, uint32 numComponents,
+                                  float texelX, float texelY, float* moments)
+{
+    texelX -= 0.5f;
+    texelY -= 0.5f;
+    const float x0f = std::floor(texelX);
+    const float y0f = std::floor(texelY);
+    const float fracX = texelX - x0f;
+    const float fracY = texelY - y0f;
+
+    const int32 maxCoord = int32(resolution) - 1;
+    const int32 x0 = Clamp(int32(x0f), 0, maxCoord);
+    const int32 y0 = Clamp(int32(y0f), 0, maxCoord);
+    const int32 x1 = Clamp(int32(x0f) + 1, 0, maxCoord);
+    const int32 y1 = Clamp(int32(y0f) + 1, 0, maxCoord);
+
+    const float* t00 = &momentMap[(y0 * resolution + x0) * numComponents];
+    const float* t10 = &momentMap[(y0 * resolution + x1) * numComponents];
+    const float* t01 = &momentMap[(y1 * resolution + x0) * numComponents];
+    const float* t11 = &momentMap[(y1 * resolution + x1) * numComponents];
+    for(uint32 i = 0; i < numComponents; ++i)
+        moments[i] = Lerp(Lerp(t00[i], t10[i], fracX), Lerp(t01[i], t11[i], fracX), fracY);
+}
+
+// Round-trips the moment map through its storage format
+static void QuantizeMomentMap(std::vector<float>& momentMap, uint32 numTexels, ShadowMode mode, SMFormat format)
+{
+    std::vector<uint8> stored(numTexels * MomentMapTexelSize(mode, format));
+    QuantizeMoments(momentMap.data(), numTexels, mode, format, stored.data());
+    DequantizeMoments(stored.data(), numTexels, mode, format, momentMap.data());
+}
+
+// Separable box filter, with clamping at the edges
+static void BoxBlurMomentMap(std::vector<float>& momentMap, uint32 resolution, uint32 numComponents,
+                             uint32 filterWidth, ShadowMode mode, SMFormat format, uint32 numThreads)
+{
+    if(filterWidth <= 1)
+        return;
+
+    const int32 radius = int32(filterWidth / 2);
+    const int32 maxCoord = int32(resolution) - 1;
+    const float weight = 1.0f / (radius * 2 + 1);
+    std::vector<float> temp(momentMap.size());
+
+    for(uint32 pass = 0; pass < 2; ++pass)
+    {
+        const std::vector<float>& src = pass == 0 ? momentMap : temp;
+        std::vector<float>& dst = pass == 0 ? temp : momentMap;
+
+        ParallelFor(resolution, numThreads, [&](uint32 startRow, uint32 endRow)
+        {
+            for(uint32 y = startRow; y < endRow; ++y)
+            {
+                for(uint32 x = 0; x < resolution; ++x)
+                {
+                    float* output = &dst[(y * resolution + x) * numComponents];
+                    for(uint32 c = 0; c < numComponents; ++c)
+                        output[c] = 0.0f;
+
+                    for(int32 offset = -radius; offset <= radius; ++offset)
+                    {
+                        int32 sx = pass == 0 ? Clamp(int32(x) + offset, 0, maxCoord) : int32(x);
+                        int32 sy = pass == 1 ? Clamp(int32(y) + offset, 0, maxCoord) : int32(y);
+                        const float* input = &src[(sy * resolution + sx) * numComponents];
+                        for(uint32 c = 0; c < numComponents; ++c)
+                            output[c] += input[c] * weight;
+                    }
+                }
+            }
+        });
+
+        // The blur targets use the same format as the shadow map
+        QuantizeMomentMap(dst, resolution * resolution, mode, format);
+    }
+}
+
+// Evaluates a shadow technique for all receivers, given the depth map rendered for it
+static void EvaluateShadowTechnique(const std::vector<float>& depthMap, const ShadowLightSpace& lightSpace,
+                                    const ShadowReceivers& receivers, const ShadowTechniqueDesc& desc,
+                                    float* visibility, uint32 numThreads, PCSSStats* pcssStats)
+{
+    const uint32 resolution = desc.Resolution;
+    const uint32 numReceivers = receivers.NumReceivers();
+
+    if(AppSettings::UseFilterableShadows(uint32(desc.Mode)))
+    {
+        const uint32 numTexels = resolution * resolution;
+        const uint32 numComponents = NumMomentComponents(desc.Mode);
+
+        std::vector<float> momentMap(numTexels * numComponents);
+        ComputeMoments(depthMap.data(), numTexels, desc.Mode, desc.Format, desc.FilterableParams, momentMap.data());
+        QuantizeMomentMap(momentMap, numTexels, desc.Mode, desc.Format);
+
+        const uint32 filterWidth = std::max(uint32(desc.FilterSize + 0.5f), 1u);
+        BoxBlurMomentMap(momentMap, resolution, numComponents, filterWidth, desc.Mode, desc.Format, numThreads);
+
+        ParallelFor(numReceivers, numThreads, [&](uint32 start, uint32 end)
+        {
+            for(uint32 i = start; i < end; ++i)
+            {
+                Float3 shadowPos = lightSpace.Project(receivers.Positions[i]);
+                float moments[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+                SampleMomentsBilinear(momentMap, resolution, numComponents, shadowPos.x * resolution,
+                                      shadowPos.y * resolution, moments);
+                ConvertToStandardMoments(moments, 1, desc.Mode, desc.Format);
+
+                Float4 m = Float4(moments[0], moments[1], moments[2], moments[3]);
+                visibility[i] = EvaluateFilterableShadow(desc.Mode, m, shadowPos.z, desc.FilterableParams);
+            }
+        });
+    }
+    else if(desc.Mode == ShadowMode::FixedSizePCF || desc.Mode == ShadowMode::OptimizedPCF)
+    {
+        // The fixed size kernels use the same weights as the shaders
+        ParallelFor(numReceivers, numThreads, [&](uint32 start, uint32 end)
+        {
+            for(uint32 i = start; i < end; ++i)
+            {
+                Float3 shadowPos = lightSpace.Project(receivers.Positions[i]);
+                const float depth = shadowPos.z - desc.Bias;
+                auto sampleCmp = [&](float texelX, float texelY)
+                {
+                    return SampleCmpBilinear(depthMap, resolution, texelX, texelY, depth);
+                };
+
+                const float texelX = shadowPos.x * resolution;
+                const float texelY = shadowPos.y * resolution;
+                if(desc.Mode == ShadowMode::FixedSizePCF)
+                    visibility[i] = EvaluateFixedSizePCF(desc.FixedFilterSize, texelX, texelY, sampleCmp);
+                else
+                    visibility[i] = EvaluateOptimizedPCF(desc.FixedFilterSize, texelX, texelY, sampleCmp);
+            }
+        });
+    }
+    else if(desc.Mode == ShadowMode::PCSS)
+    {
+        Float2 poissonSamples[NumPoissonSamples];
+        GenerateShaderPoissonSamples(poissonSamples);
+
+        MinMaxDepthPyramid pyramid;
+        if(desc.PCSSUseMinMaxPyramid)
+            pyramid.Build(depthMap.data(), resolution);
+
+        // Convert from world units to texels per unit of normalized depth
+        PCSSParams params;
+        params.PenumbraScale.x = desc.PCSSLightSize * lightSpace.DepthRange / lightSpace.Extents.x * resolution;
+        params.PenumbraScale.y = desc.PCSSLightSize * lightSpace.DepthRange / lightSpace.Extents.y * resolution;
+        params.NumFilterSamples = Clamp(desc.NumDiscSamples, 1u, NumPoissonSamples);
+        params.PoissonSamples = poissonSamples;
+
+        PCSSStats totalStats;
+        std::mutex statsMutex;
+        ParallelFor(numReceivers, numThreads, [&](uint32 start, uint32 end)
+        {
+            PCSSStats stats;
+            for(uint32 i = start; i < end; ++i)
+            {
+                Float3 shadowPos = lightSpace.Project(receivers.Positions[i]);
+                const float depth = shadowPos.z - desc.Bias;
+                auto sampleCmp = [&](float texelX, float texelY)
+                {
+                    return SampleCmpBilinear(depthMap, resolution, texelX, texelY, depth);
+                };
+
+                visibility[i] = EvaluatePCSS(depthMap.data(), resolution, desc.PCSSUseMinMaxPyramid ? &pyramid : nullptr,
+                                             shadowPos.x * resolution, shadowPos.y * resolution, depth, params,
+                                             sampleCmp, stats);
+            }
+
+            std::lock_guard<std::mutex> lock(statsMutex);
+            totalStats.Add(stats);
+        });
+
+        if(pcssStats != nullptr)
+            *pcssStats = totalStats;
+    }
+    else
+    {
+        // Grid and random disc PCF are evaluated with a grid of bilinear PCF taps that covers
+        // the kernel width, which is exact for grid PCF and a close match for the random disc
+        const uint32 kernelWidth = Clamp(uint32(desc.FilterSize + 0.5f), 2u, uint32(MaxKernelSize));
+        const uint32 numTaps = kernelWidth - 1;
+        const float tapOffset = (numTaps - 1) * 0.5f;
+
+        ParallelFor(numReceivers, numThreads, [&](uint32 start, uint32 end)
+        {
+            for(uint32 i = start; i < end; ++i)
+            {
+                Float3 shadowPos = lightSpace.Project(receivers.Positions[i]);
+                const float depth = shadowPos.z - desc.Bias;
+                const float texelX = shadowPos.x * resolution;
+                const float texelY = shadowPos.y * resolution;
+
+                float sum = 0.0f;
+                for(uint32 ty = 0; ty < numTaps; ++ty)
+                    for(uint32 tx = 0; tx < numTaps; ++tx)
+                        sum += SampleCmpBilinear(depthMap, resolution, texelX + tx - tapOffset,
+                                                 texelY + ty - tapOffset, depth);
+
+                visibility[i] = sum / (numTaps * numTaps);
+            }
+        });
+    }
+}
+
+uint64 ShadowMapMemorySize(ShadowMode mode, SMFormat format, uint32 resolution)
+{
+    const uint64 depthTexelSize = AppSettings::DepthBufferFormat == DepthBufferFormats::DB16Unorm ? 2 : 4;
+    const uint64 numTexels = uint64(resolution) * resolution;
+
+    // The static shadow cache keeps a copy of the depth for every cascade
+    const bool cacheStaticShadows = AppSettings::CacheStaticShadows && AppSettings::GPUSceneSubmission == false;
+
+    // The character's shadow map is always a plain depth buffer, regardless of the mode
+    const uint32 characterResolution = AppSettings::ShadowMapResolution(AppSettings::CharacterShadowMapSize);
+    const uint64 characterSize = AppSettings::CharacterShadowMap ? uint64(characterResolution) * characterResolution *
+                                                                   depthTexelSize : 0;
+
+    if(AppSettings::UseFilterableShadows(uint32(mode)))
+    {
+        // A single MSAA depth buffer that gets converted into the moment map cascades
+        uint64 size = numTexels * depthTexelSize * AppSettings::MSAASamples() +
+                      MomentMapMemorySize(mode, format, resolution, AppSettings::EnableShadowMips != 0);
+
+        // Partial conversion also needs a slice for the unblurred moments
+        if(cacheStaticShadows)
+            size += numTexels * depthTexelSize * AppSettings::MSAASamples() * NumCascades +
+                    numTexels * MomentMapTexelSize(mode, format);
+
+        return size + characterSize;
+    }
+
+    uint64 size = numTexels * depthTexelSize * NumCascades;
+    if(cacheStaticShadows)
+        size *= 2;
+    if(mode == ShadowMode::PCSS)
+        size += MinMaxDepthPyramidMemorySize(resolution) * NumCascades;
+
+    return size + characterSize;
+}
+
+ShadowErrorMetrics::ShadowErrorMetrics() : MeanError(0.0f), RMSError(0.0f), MaxError(0.0f),
+                                           FalseShadowRate(0.0f), FalseLitRate(0.0f), NumReceivers(0)
+{
+}
+
+ShadowTechniqueDesc::ShadowTechniqueDesc() : Mode(ShadowMode::FixedSizePCF), Resolution(1024),
+                                             Format(SMFormat::SM32Bit), FixedFilterSize(2), FilterSize(0.0f),
+                                             Bias(0.0f), NumDiscSamples(8), PCSSLightSize(0.05f),
+                                             PCSSUseMinMaxPyramid(true)
+{
+}
+
+// Fills out a technique description from the current app settings
+ShadowTechniqueDesc ShadowTechniqueFromSettings(ShadowMode mode, uint32 resolution)
+{
+    ShadowTechniqueDesc desc;
+    desc.Mode = mode;
+    desc.Resolution = resolution;
+    desc.Format = AppSettings::SMFormat;
+    desc.FixedFilterSize = AppSettings::FixedFilterKernelSize();
+    desc.FilterSize = AppSettings::FilterSize;
+    desc.Bias = AppSettings::Bias;
+    desc.FilterableParams = FilterableShadowParamsFromSettings(desc.Format);
+    desc.NumDiscSamples = uint32(AppSettings::NumDiscSamples);
+    desc.PCSSLightSize = AppSettings::PCSSLightSize;
+    return desc;
+}
+
+void GenerateShadowReceivers(const BVH& bvh, const Float3& lightDir, uint32 numReceivers, uint32 seed,
+                             ShadowReceivers& receivers)
+{
+    receivers.Positions.clear();
+    receivers.Normals.clear();
+
+    const std::vector<BVHTriangle>& triangles = bvh.Triangles();
+    const Float3 toLight = Float3::Normalize(lightDir);
+
+    // Build a CDF over the area of all triangles that aren't at a grazing angle to the light.
+    // Normals are flipped towards the light, since we don't know the winding order.
+    std::vector<float> areaCDF(triangles.size());
+    std::vector<Float3> normals(triangles.size());
+    float totalArea = 0.0f;
+    for(uint64 i = 0; i < triangles.size(); ++i)
+    {
+        Float3 n = Float3::Cross(triangles[i].E1, triangles[i].E2);
+        const float length = Float3::Length(n);
+        float area = 0.0f;
+        if(length > 0.0f)
+        {
+            n /= length;
+            if(Float3::Dot(n, toLight) < 0.0f)
+                n = -n;
+            if(Float3::Dot(n, toLight) > 0.05f)
+                area = length * 0.5f;
+        }
+
+        normals[i] = n;
+        totalArea += area;
+        areaCDF[i] = totalArea;
+    }
+
+    if(totalArea <= 0.0f)
+        return;
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+    receivers.Positions.reserve(numReceivers);
+    receivers.Normals.reserve(numReceivers);
+    for(uint32 i = 0; i < numReceivers; ++i)
+    {
+        const float r = dist(rng) * totalArea;
+        uint64 triIdx = std::upper_bound(areaCDF.begin(), areaCDF.end(), r) - areaCDF.begin();
+        triIdx = std::min<uint64>(triIdx, triangles.size() - 1);
+
+        // Uniform barycentrics
+        const float sqrtU = std::sqrt(dist(rng));
+        const float v = dist(rng);
+        const float b1 = sqrtU * (1.0f - v);
+        const float b2 = sqrtU * v;
+
+        const BVHTriangle& tri = triangles[triIdx];
+        receivers.Positions.push_back(tri.V0 + tri.E1 * b1 + tri.E2 * b2);
+        receivers.Normals.push_back(normals[triIdx]);
+    }
+}
+
+void ComputeReferenceVisibility(const BVH& bvh, const ShadowReceivers& receivers, const Float3& lightDir,
+                                float* visibility, uint32 numThreads)
+{
+    const uint32 numReceivers = receivers.NumReceivers();
+    const Float3 toLight = Float3::Normalize(lightDir);
+    const float offset = RayOffset(bvh);
+
+    // Each batch is a multiple of 4, so packets never straddle two batches
+    StaticAssert_(DefaultParallelForBatchSize % 4 == 0);
+
+    ParallelFor(numReceivers, numThreads, [&](uint32 start, uint32 end)
+    {
+        for(uint32 base = start; base < end; base += 4)
+        {
+            RayPacket packet;
+            packet.Direction = toLight;
+            for(uint32 i = 0; i < 4 && base + i < end; ++i)
+            {
+                Float3 origin = receivers.Positions[base + i] + receivers.Normals[base + i] * offset;
+                packet.OriginX[i] = origin.x;
+                packet.OriginY[i] = origin.y;
+                packet.OriginZ[i] = origin.z;
+                packet.ActiveMask |= 1 << i;
+            }
+
+            const uint32 occluded = bvh.OccludedPacket(packet);
+            for(uint32 i = 0; i < 4 && base + i < end; ++i)
+                visibility[base + i] = (occluded & (1 << i)) ? 0.0f : 1.0f;
+        }
+    });
+}
+
+void SimulateShadowTechnique(const BVH& bvh, const ShadowReceivers& receivers, const Float3& lightDir,
+                             const ShadowTechniqueDesc& desc, float* visibility, uint32 numThreads,
+                             PCSSStats* pcssStats)
+{
+    ShadowLightSpace lightSpace = FitShadowLightSpace(bvh, receivers, lightDir);
+
+    std::vector<float> depthMap;
+    RenderShadowMap(bvh, lightSpace, desc.Resolution, numThreads, depthMap);
+    EvaluateShadowTechnique(depthMap, lightSpace, receivers, desc, visibility, numThreads, pcssStats);
+}
+
+ShadowErrorMetrics ComputeShadowErrorMetrics(const float* reference, const float* visibility, uint32 count)
+{
+    ShadowErrorMetrics metrics;
+    metrics.NumReceivers = count;
+    if(count == 0)
+        return metrics;
+
+    double errorSum = 0.0;
+    double sqErrorSum = 0.0;
+    uint32 numLit = 0;
+    uint32 numShadowed = 0;
+    uint32 numFalseShadow = 0;
+    uint32 numFalseLit = 0;
+    for(uint32 i = 0; i < count; ++i)
+    {
+        const float error = std::abs(visibility[i] - reference[i]);
+        errorSum += error;
+        sqErrorSum += error * error;
+        metrics.MaxError = std::max(metrics.MaxError, error);
+
+        if(reference[i] >= 0.5f)
+        {
+            ++numLit;
+            if(visibility[i] < 0.5f)
+                ++numFalseShadow;
+        }
+        else
+        {
+            ++numShadowed;
+            if(visibility[i] >= 0.5f)
+                ++numFalseLit;
+        }
+    }
+
+    metrics.MeanError = float(errorSum / count);
+    metrics.RMSError = float(std::sqrt(sqErrorSum / count));
+    metrics.FalseShadowRate = numLit > 0 ? float(numFalseShadow) / numLit : 0.0f;
+    metrics.FalseLitRate = numShadowed > 0 ? float(numFalseLit) / numShadowed : 0.0f;
+    return metrics;
+}
+
+ShadowQualityEvaluator::ShadowQualityEvaluator() : bvh(nullptr), numThreads(0), referenceTime(0.0f)
+{
+}
+
+void ShadowQualityEvaluator::Initialize(const BVH& bvh_, const Float3& lightDir, uint32 numReceivers,
+                                        uint32 numThreads_)
+{
+    Assert_(bvh_.Built());
+
+    bvh = &bvh_;
+    numThreads = numThreads_;
+    depthMaps.clear();
+
+    GenerateShadowReceivers(*bvh, lightDir, numReceivers, 1234, receivers);
+
+    Timer timer;
+    reference.resize(receivers.NumReceivers());
+    ComputeReferenceVisibility(*bvh, receivers, lightDir, reference.data(), numThreads);
+    timer.Update();
+    referenceTime = timer.ElapsedSecondsF();
+
+    visibility.resize(receivers.NumReceivers());
+    lightSpace = FitShadowLightSpace(*bvh, receivers, lightDir);
+}
+
+ShadowErrorMetrics ShadowQualityEvaluator::Evaluate(const ShadowTechniqueDesc& desc, PCSSStats* pcssStats)
+{
+    Assert_(bvh != nullptr);
+    if(receivers.NumReceivers() == 0)
+        return ShadowErrorMetrics();
+
+    // The depth map only depends on the resolution, so it's shared by all techniques
+    std::vector<float>& depthMap = depthMaps[desc.Resolution];
+    if(depthMap.size() == 0)
+        RenderShadowMap(*bvh, lightSpace, desc.Resolution, numThreads, depthMap);
+
+    EvaluateShadowTechnique(depthMap, lightSpace, receivers, desc, visibility.data(), numThreads, pcssStats);
+    return ComputeShadowErrorMetrics(reference.data(), visibility.data(), receivers.NumReceivers());
+}
+
+std::string ShadowQualityReport(const BVH& bvh, const Float3& lightDir, uint32 numReceivers, float maxRMSError)
+{
+    Assert_(bvh.Built());
+
+    std::string report = MakeString("Shadow quality report: %u triangles, %u BVH nodes (depth %u), built in %.2fms\n",
+                                    bvh.NumTriangles(), bvh.NumNodes(), bvh.MaxDepth(), bvh.BuildTime() * 1000.0f);
+
+    ShadowQualityEvaluator evaluator;
+    evaluator.Initialize(bvh, lightDir, numReceivers);
+
+    const uint32 numEvalReceivers = evaluator.Receivers().NumReceivers();
+    if(numEvalReceivers == 0)
+        return report + "No receivers facing the light\n";
+
+    uint32 numLit = 0;
+    for(float v : evaluator.ReferenceVisibility())
+        numLit += v > 0.0f ? 1 : 0;
+
+    const double rayTime = std::max(double(evaluator.ReferenceTime()), 1e-9);
+    report += MakeString("Reference: %u receivers, %.1f%% lit, traced in %.2fms (%.2f Mrays/s)\n",
+                         numEvalReceivers, numLit * 100.0f / numEvalReceivers, rayTime * 1000.0,
+                         numEvalReceivers / rayTime / 1000000.0);
+    report += "The shadow maps are simulated as a single cascade that covers all receivers\n\n";
+    report += MakeString("%-18s %6s %12s %10s %10s %10s %12s %12s\n", "Mode", "Size", "Memory (MB)", "Mean Err",
+                         "RMS Err", "Max Err", "False Shadow", "False Lit");
+
+    uint64 bestMemory = UINT64_MAX;
+    std::string bestConfig = "None";
+
+    for(uint32 sizeIdx = 0; sizeIdx < uint32(ShadowMapSize::NumValues); ++sizeIdx)
+    {
+        const uint32 resolution = AppSettings::ShadowMapResolution(sizeIdx);
+        for(uint32 modeIdx = 0; modeIdx < uint32(ShadowMode::NumValues); ++modeIdx)
+        {
+            ShadowTechniqueDesc desc = ShadowTechniqueFromSettings(ShadowMode(modeIdx), resolution);
+            ShadowErrorMetrics metrics = evaluator.Evaluate(desc);
+            const uint64 memory = ShadowMapMemorySize(desc.Mode, desc.Format, resolution);
+            const char* modeName = AppSettings::ShadowMode.ValueLabel(modeIdx);
+
+            report += MakeString("%-18s %6u %12.2f %10.4f %10.4f %10.4f %11.2f%% %11.2f%%\n", modeName,
+                                 resolution, memory / (1024.0 * 1024.0), metrics.MeanError, metrics.RMSError,
+                                 metrics.MaxError, metrics.FalseShadowRate * 100.0f, metrics.FalseLitRate * 100.0f);
+
+            if(metrics.RMSError <= maxRMSError && memory < bestMemory)
+            {
+                bestMemory = memory;
+                bestConfig = MakeString("%s at %u", modeName, resolution);
+            }
+        }
+    }
+
+    report += MakeString("\nCheapest configuration with RMS error <= %.3f: %s\n", maxRMSError, bestConfig.c_str());
+
+    // Compare the PCSS blocker search with and without the min/max pyramid. Both should give the
+    // same results, since the pyramid only skips receivers that can't be partially shadowed.
+    report += MakeString("\nPCSS blocker search (light size %.3f, %u filter samples)\n",
+                         AppSettings::PCSSLightSize.Value(), uint32(AppSettings::NumDiscSamples));
+    report += MakeString("%6s %16s %16s %10s %12s %16s %10s\n", "Size", "Naive Fetches", "Pyramid Fetches",
+                         "Speedup", "Fully Lit", "Fully Shadowed", "Max Diff");
+
+    std::vector<float> naiveVisibility;
+    for(uint32 sizeIdx = 0; sizeIdx < uint32(ShadowMapSize::NumValues); ++sizeIdx)
+    {
+        const uint32 resolution = AppSettings::ShadowMapResolution(sizeIdx);
+        ShadowTechniqueDesc desc = ShadowTechniqueFromSettings(ShadowMode::PCSS, resolution);
+
+        PCSSStats naiveStats;
+        desc.PCSSUseMinMaxPyramid = false;
+        evaluator.Evaluate(desc, &naiveStats);
+        naiveVisibility = evaluator.Visibility();
+
+        PCSSStats pyramidStats;
+        desc.PCSSUseMinMaxPyramid = true;
+        evaluator.Evaluate(desc, &pyramidStats);
+
+        float maxDiff = 0.0f;
+        for(uint32 i = 0; i < numEvalReceivers; ++i)
+            maxDiff = std::max(maxDiff, std::abs(naiveVisibility[i] - evaluator.Visibility()[i]));
+
+        const double numEvals = double(std::max<uint64>(pyramidStats.NumEvaluations, 1));
+        const double naiveFetches = naiveStats.NumFetches / numEvals;
+        const double pyramidFetches = pyramidStats.NumFetches / numEvals;
+        report += MakeString("%6u %16.2f %16.2f %9.2fx %11.2f%% %15.2f%% %10.4f\n", resolution, naiveFetches,
+                             pyramidFetches, naiveFetches / std::max(pyramidFetches, 1e-9),
+                             pyramidStats.NumFullyLit * 100.0 / numEvals,
+                             pyramidStats.NumFullyShadowed * 100.0 / numEvals, maxDiff);
+    }
+
+    return report;
+}
@@ -0,0 +1,137 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+#include "SampleFramework11/Math.h"
+
+#include "AppSettings.h"
+#include "BVH.h"
+#include "ShadowFilters.h"
+#include "PCSS.h"
+
+using namespace SampleFramework11;
+
+// Surface points that receive shadows, in world space
+struct ShadowReceivers
+{
+    std::vector<Float3> Positions;
+    std::vector<Float3> Normals;
+
+    uint32 NumReceivers() const { return uint32(Positions.size()); }
+};
+
+// Error of a shadow technique compared to the ray traced reference
+struct ShadowErrorMetrics
+{
+    float MeanError;
+    float RMSError;
+    float MaxError;
+    float FalseShadowRate;      // Fraction of lit receivers that came out >= 50% shadowed
+    float FalseLitRate;         // Fraction of shadowed receivers that came out >= 50% lit
+    uint32 NumReceivers;
+
+    ShadowErrorMetrics();
+};
+
+// Describes a shadow technique that gets simulated on the CPU
+struct ShadowTechniqueDesc
+{
+    ShadowMode Mode;
+    uint32 Resolution;
+    SMFormat Format;
+    uint32 FixedFilterSize;     // Kernel width in texels for FixedSizePCF and OptimizedPCF
+    float FilterSize;           // Kernel width in texels for the other modes
+    float Bias;
+    FilterableShadowParams FilterableParams;
+    uint32 NumDiscSamples;
+    float PCSSLightSize;        // Penumbra width per world unit between the blocker and receiver
+    bool PCSSUseMinMaxPyramid;
+
+    ShadowTechniqueDesc();
+};
+
+ShadowTechniqueDesc ShadowTechniqueFromSettings(ShadowMode mode, uint32 resolution);
+
+// An orthographic projection aligned with the light, used for the simulated shadow maps
+struct ShadowLightSpace
+{
+    Float3 Right;
+    Float3 Up;
+    Float3 Forward;
+    Float2 MinXY;
+    Float2 Extents;
+    float MinZ;
+    float DepthRange;
+
+    // Returns the shadow map UV in xy, and normalized depth in z
+    Float3 Project(const Float3& pos) const;
+};
+
+// Fits the light space projection to the receivers, with a depth range that covers the whole scene
+ShadowLightSpace FitShadowLightSpace(const BVH& bvh, const ShadowReceivers& receivers, const Float3& lightDir);
+
+// Picks area-weighted random points on the scene triangles that face the light
+void GenerateShadowReceivers(const BVH& bvh, const Float3& lightDir, uint32 numReceivers, uint32 seed,
+                             ShadowReceivers& receivers);
+
+// Offset used to push ray origins off of the receiver surface
+float RayOffset(const BVH& bvh);
+
+// Exact directional light visibility (0 or 1) for each receiver, traced in packets of 4
+void ComputeReferenceVisibility(const BVH& bvh, const ShadowReceivers& receivers, const Float3& lightDir,
+                                float* visibility, uint32 numThreads = 0);
+
+// Renders a single shadow map that covers all receivers by ray casting, and evaluates the
+// shadow technique for each receiver using the CPU filter library
+void SimulateShadowTechnique(const BVH& bvh, const ShadowReceivers& receivers, const Float3& lightDir,
+                             const ShadowTechniqueDesc& desc, float* visibility, uint32 numThreads = 0,
+                             PCSSStats* pcssStats = nullptr);
+
+// Compares shadow factors (simulated or captured from the GPU) against the reference
+ShadowErrorMetrics ComputeShadowErrorMetrics(const float* reference, const float* visibility, uint32 count);
+
+// Memory used by all shadow map textures for a technique at the given resolution
+uint64 ShadowMapMemorySize(ShadowMode mode, SMFormat format, uint32 resolution);
+
+// Keeps the receivers, reference visibility and ray traced depth maps for a scene around,
+// so that many techniques can be evaluated against the same reference
+class ShadowQualityEvaluator
+{
+
+public:
+
+    ShadowQualityEvaluator();
+
+    void Initialize(const BVH& bvh, const Float3& lightDir, uint32 numReceivers, uint32 numThreads = 0);
+    ShadowErrorMetrics Evaluate(const ShadowTechniqueDesc& desc, PCSSStats* pcssStats = nullptr);
+
+    const ShadowReceivers& Receivers() const { return receivers; }
+    const std::vector<float>& ReferenceVisibility() const { return reference; }
+    const std::vector<float>& Visibility() const { return visibility; }
+    float ReferenceTime() const { return referenceTime; }
+
+protected:
+
+    const BVH* bvh;
+    uint32 numThreads;
+    ShadowReceivers receivers;
+    std::vector<float> reference;
+    std::vector<float> visibility;
+    ShadowLightSpace lightSpace;
+    std::map<uint32, std::vector<float>> depthMaps;
+    float referenceTime;
+};
+
+// Runs every shadow mode at every shadow map size and returns a table of error vs. cost,
+// along with the cheapest configuration that stays under maxRMSError
+std::string ShadowQualityReport(const BVH& bvh, const Float3& lightDir, uint32 numReceivers,
+                                float maxRMSError = 0.1f);
@@ -10,10 +10,19 @@
 
 #include "PCH.h"
 
+#include <random>
+
 #include "Shadows.h"
 #include "resource.h"
 #include "SharedConstants.h"
 #include "AppSettings.h"
+#include "MomentQuantization.h"
+#include "BVH.h"
+#include "ShadowReference.h"
+#include "ShadowMask.h"
+#include "MeshOptimizer.h"
+#include "VertexCompression.h"
+#include "MeshWelder.h"
 
 #include "SampleFramework11/InterfacePointers.h"
 #include "SampleFramework11/Window.h"
@@ -22,11 +31,14 @@
 #include "SampleFramework11/SpriteRenderer.h"
 #include "SampleFramework11/Model.h"
 #include "SampleFramework11/Utility.h"
+#include "SampleFramework11/FileIO.h"
 #include "SampleFramework11/Camera.h"
 #include "SampleFramework11/ShaderCompilation.h"
 #include "SampleFramework11/Profiler.h"
 #include "SampleFramework11/Settings.h"
 #include "SampleFramework11/TwHelper.h"
+#include "SampleFramework11/MurmurHash.h"
+#include "SampleFramework11/TextureCache.h"
 
 using namespace SampleFramework11;
 using std::wstring;
@@ -47,20 +59,115 @@ static const wstring MeshFileNames[] =
     L"Columns\\Columns.sdkmesh",
 };
 
-// Scale values applied to the mesh
+// Scale values applied to the mesh, where the last one is for the generated stress scene
 static const float MeshScales[] =
 {
     0.5f,
     0.025f,
     0.25f,
+    1.0f,
 };
 
+static const wstring StressSceneTextureDirectory = L"..\\Content\\Textures\\";
+
+// Size that the texture cache can grow to before it starts evicting the least recently used
+// textures that no model holds a reference to
+static const uint64 TextureCacheBudget = 512 * 1024 * 1024;
+
 static const float CharacterScale = 1.0f;
 static const Float3 CharacterPos = Float3(25.0f, 0.0f, 3.0f);
 
+// Size of the square around the origin that the prop instances get scattered over, and the
+// range of their scales
+static const float PropAreaSize = 100.0f;
+static const float PropMinScale = 0.1f;
+static const float PropMaxScale = 0.4f;
+
+// Width of the image that gets traced for the shadow mask report, with the height following the
+// camera's aspect ratio
+static const uint32 ShadowMaskReportWidth = 640;
+
+// Loads a model from the mesh cache next to the .sdkmesh file. If the cache is missing or older
+// than the .sdkmesh, the model gets loaded from the .sdkmesh and the cache gets re-written.
+// Compressed and full-precision vertices get cached in separate files. No D3D resources get
+// created, so that this can run on a worker thread.
+static void LoadModelData(const wstring& path, Model& model, MeshCache& cache, bool compressVertices)
+{
+    const wstring directory = GetDirectoryFromFilePath(path.c_str());
+    const wstring cachePath = directory + GetFileNameWithoutExtension(path.c_str()) +
+                              (compressVertices ? L".compressed.meshcache" : L".meshcache");
+    const uint64 timestamp = GetFileTimestamp(path.c_str());
+    if(cache.Open(cachePath.c_str(), timestamp))
+    {
+        cache.CreateModel(nullptr, model, directory);
+        return;
+    }
+
+    model.CreateFromSDKMeshFile(nullptr, path.c_str());
+
+    // Welding, splitting and reordering are too slow to do on every launch, so they only happen
+    // when the cache gets built
+    std::string report = WeldModelVertices(nullptr, model);
+    report += SplitModelMeshes(nullptr, model);
+    report += OptimizeModelMeshes(nullptr, model);
+    if(compressVertices)
+        report += CompressModelVertices(nullptr, model);
+    PrintReport(report);
+
+    MeshStreams streams;
+    BuildMeshStreams(model, streams);
+    WriteMeshCache(cachePath.c_str(), model, streams, timestamp);
+    cache.Open(cachePath.c_str(), timestamp);
+}
+
+// Generates the stress scene, or loads it from its cache if it was already generated with the same
+// settings. A hash of the settings stands in for the timestamp of the source file.
+static void LoadStressSceneData(const StressSceneDesc& desc, Model& model, MeshCache& cache, bool compressVertices)
+{
+    const wstring cachePath = compressVertices ? L"..\\Content\\Models\\Stress.compressed.meshcache"
+                                               : L"..\\Content\\Models\\Stress.meshcache";
+    const uint64 settingsHash = GenerateHash(&desc, sizeof(desc)).A;
+    if(cache.Open(cachePath.c_str(), settingsHash))
+    {
+        cache.CreateModel(nullptr, model, StressSceneTextureDirectory);
+        return;
+    }
+
+    Timer timer;
+    model.GenerateStressScene(nullptr, desc);
+    timer.Update();
+
+    std::string report = MakeString("Generated a stress scene with %u parts in %u meshes in %.2fms\n", desc.NumParts,
+                                    uint32(model.Meshes().size()), timer.ElapsedMillisecondsD());
+    if(compressVertices)
+        report += CompressModelVertices(nullptr, model);
+    PrintReport(report);
+
+    MeshStreams streams;
+    BuildMeshStreams(model, streams);
+    WriteMeshCache(cachePath.c_str(), model, streams, settingsHash);
+    cache.Open(cachePath.c_str(), settingsHash);
+}
+
+// Returns the cached streams for a model, or null if they need to be built
+static const MeshStreamsView* CachedStreams(const MeshCache& cache, MeshStreamsView& streams)
+{
+    if(cache.IsOpen() == false)
+        return nullptr;
+
+    streams = cache.Streams();
+    return &streams;
+}
+
 ShadowsApp::ShadowsApp() :  App(L"Shadows", MAKEINTRESOURCEW(IDI_ICON1)),
                                 camera(WindowWidthF / WindowHeightF, XM_PIDIV4 * 0.75f, NearClip, FarClip),
-                                cameraForShadows(WindowWidthF / WindowHeightF, XM_PIDIV4 * 0.75f, NearClip, FarClip)
+                                cameraForShadows(WindowWidthF / WindowHeightF, XM_PIDIV4 * 0.75f, NearClip, FarClip),
+                                numPropInstances(0),
+                                displayedScene(Scene::PowerPlant),
+                                backgroundLoading(false),
+                                benchmarkOnStartup(false),
+                                compressVertices(true),
+                                tangentBenchmarkOnStartup(false)
 {
     deviceManager.SetMinFeatureLevel(D3D_FEATURE_LEVEL_11_0);
 }
@@ -98,36 +205,138 @@ void ShadowsApp::Initialize()
     camera.SetPosition(Float3(40.0f, 5.0f, 5.0f));
     camera.SetYRotation(-XM_PIDIV2);
 
-    // Load the meshes
+    if(tangentBenchmarkOnStartup)
+        RunTangentFrameBenchmark();
+
+    TextureCache::GlobalCache.SetBudget(TextureCacheBudget);
+
+    // Start loading the meshes in the background, with the character and the current scene
+    // first so that they're ready as soon as possible
+    loadJobs.Start();
+    loadTimer = Timer();
+    backgroundLoading = true;
+
+    wstring characterPath(L"..\\Content\\Models\\Soldier\\Soldier.sdkmesh");
+    LoadModelAsync(characterPath, characterMesh, characterCache, characterLoad);
+
+    displayedScene = AppSettings::CurrentScene;
     for(uint32 i = 0; i < uint32(Scene::NumValues); ++i)
     {
+        const uint32 sceneIdx = (uint32(displayedScene) + i) % uint32(Scene::NumValues);
+        if(sceneIdx == uint32(Scene::Stress))
+        {
+            LoadStressSceneAsync(models[sceneIdx], modelCaches[sceneIdx], sceneLoads[sceneIdx]);
+            continue;
+        }
+
         wstring path(L"..\\Content\\Models\\");
-        path += MeshFileNames[i];
-        models[i].CreateFromSDKMeshFile(device, path.c_str());
+        path += MeshFileNames[sceneIdx];
+        LoadModelAsync(path, models[sceneIdx], modelCaches[sceneIdx], sceneLoads[sceneIdx]);
     }
 
     // models[0].SaveAsOBJ(L"..\\Content\\Models\\Powerplant\\Powerplant.obj");
 
-    wstring characterPath(L"..\\Content\\Models\\Soldier\\Soldier.sdkmesh");
-    characterMesh.CreateFromSDKMeshFile(device, characterPath.c_str());
-
     meshRenderer.Initialize(device, deviceManager.ImmediateContext());
 
+    skybox.Initialize(device);
+
+    // Init the post processor
+    postProcessor.Initialize(device);
+
+    // Everything else can wait for the other scenes
+    loadJobs.WaitUntil([this]() { return characterLoad.Ready && sceneLoads[uint64(displayedScene)].Ready; });
+
+    loadTimer.Update();
+    std::string report = MakeString("Current scene loaded in %.2fms\n", loadTimer.ElapsedMillisecondsD());
+    PrintReport(report);
+
     ID3D11DeviceContext* context = deviceManager.ImmediateContext();
 
-    Float4x4 meshWorld = Float4x4::ScaleMatrix(MeshScales[(int)AppSettings::CurrentScene]);
-    meshRenderer.SetSceneMesh(context, &models[(int)AppSettings::CurrentScene], meshWorld);
+    Float4x4 meshWorld = Float4x4::ScaleMatrix(MeshScales[uint64(displayedScene)]);
+    MeshStreamsView sceneStreams;
+    meshRenderer.SetSceneMesh(context, &models[uint64(displayedScene)], meshWorld,
+                              CachedStreams(modelCaches[uint64(displayedScene)], sceneStreams));
 
     Float4x4 characterWorld = Float4x4::ScaleMatrix(CharacterScale);
     Float4x4 characterOrientation = Quaternion::ToFloat4x4(AppSettings::CharacterOrientation);
     characterWorld = characterWorld * characterOrientation;
     characterWorld.SetTranslation(CharacterPos);
-    meshRenderer.SetCharacterMesh(context, &characterMesh, characterWorld);
+    MeshStreamsView characterStreams;
+    meshRenderer.SetCharacterMesh(context, &characterMesh, characterWorld,
+                                  CachedStreams(characterCache, characterStreams));
 
-    skybox.Initialize(device);
+    propMesh.GenerateBoxScene(device);
+    UpdatePropInstances();
 
-    // Init the post processor
-    postProcessor.Initialize(device);
+    if(benchmarkOnStartup)
+        StartBenchmark();
+}
+
+// Adds the jobs for loading a model. A worker loads the geometry with loadData, which for a cache
+// miss also covers building the optimized streams, bounding spheres, and levels of detail. Then
+// each material's textures get read and decoded on the workers, and once they're all done a
+// device job creates the buffers and textures.
+void ShadowsApp::LoadAsync(std::function<void()> loadData, const wstring& textureDirectory, Model& model,
+                           ModelLoad& load)
+{
+    ID3D11Device* device = deviceManager.Device();
+    JobGraph& jobs = loadJobs;
+    const wstring directory = textureDirectory;
+    load.Ready = false;
+
+    jobs.AddJob([=, &jobs, &model, &load]()
+    {
+        loadData();
+
+        // The textures only get decoded here, since creating them needs the immediate context
+        // for generating mips
+        const uint64 numMaterials = model.Materials().size();
+        load.Textures.resize(numMaterials);
+
+        std::vector<JobGraph::JobID> textureJobs;
+        for(uint64 i = 0; i < numMaterials; ++i)
+        {
+            MeshMaterialTextures* textures = &load.Textures[i];
+            textureJobs.push_back(jobs.AddJob([=, &model]()
+            {
+                model.DecodeMaterialTextures(device, i, directory, *textures);
+            }));
+        }
+
+        jobs.AddDeviceJob([=, &model, &load]()
+        {
+            model.CreateBuffers(device);
+            for(uint64 i = 0; i < numMaterials; ++i)
+                model.CreateMaterialTextures(device, i, load.Textures[i]);
+
+            std::vector<MeshMaterialTextures>().swap(load.Textures);
+            load.Ready = true;
+        }, textureJobs.data(), uint32(textureJobs.size()));
+    });
+}
+
+// Loads a model from its .sdkmesh file, or from the mesh cache next to it
+void ShadowsApp::LoadModelAsync(const wstring& path, Model& model, MeshCache& cache, ModelLoad& load)
+{
+    const bool compress = compressVertices;
+    LoadAsync([=, &model, &cache]() { LoadModelData(path, model, cache, compress); },
+              GetDirectoryFromFilePath(path.c_str()), model, load);
+}
+
+// Generates the stress scene with the current settings, or loads it from its cache
+void ShadowsApp::LoadStressSceneAsync(Model& model, MeshCache& cache, ModelLoad& load)
+{
+    const bool compress = compressVertices;
+    const StressSceneDesc desc = stressScene;
+    LoadAsync([=, &model, &cache]() { LoadStressSceneData(desc, model, cache, compress); },
+              StressSceneTextureDirectory, model, load);
+}
+
+// Blocks until a scene has finished loading, for things that need it right away
+void ShadowsApp::WaitForScene(Scene scene)
+{
+    const ModelLoad& load = sceneLoads[uint64(scene)];
+    loadJobs.WaitUntil([&]() { return load.Ready; });
 }
 
 // Creates all required render targets
@@ -147,6 +356,7 @@ void ShadowsApp::CreateRenderTargets()
         resolveTarget = colorTarget;
 
     meshRenderer.CreateReductionTargets(width, height);
+    meshRenderer.CreateShadowMask(width, height);
 }
 
 void ShadowsApp::Update(const Timer& timer)
@@ -205,11 +415,52 @@ void ShadowsApp::Update(const Timer& timer)
     if(kbState.RisingEdge(KeyboardState::V))
         deviceManager.SetVSYNCEnabled(!deviceManager.VSYNCEnabled());
 
-    if(AppSettings::CurrentScene.Changed())
+    // Print the moment shadow map memory/precision report
+    if(kbState.RisingEdge(KeyboardState::M))
     {
-        float scale = MeshScales[AppSettings::CurrentScene];
-        meshRenderer.SetSceneMesh(deviceManager.ImmediateContext(), &models[AppSettings::CurrentScene],
-                             XMMatrixScaling(scale, scale, scale));
+        std::string report = MomentQuantizationReport(AppSettings::ShadowMapResolution(), AppSettings::EnableShadowMips);
+        PrintReport(report);
+    }
+
+    // Compare all shadow techniques against a ray traced reference
+    if(kbState.RisingEdge(KeyboardState::G))
+        PrintShadowQualityReport();
+
+    // Run through all combinations of the shadow settings, which overrides the camera
+    if(kbState.RisingEdge(KeyboardState::B))
+        StartBenchmark();
+
+    if(benchmark.Running())
+    {
+        benchmark.Update(camera, timer);
+        if(benchmark.Running() == false && benchmarkOnStartup)
+            Exit();
+    }
+
+    // Create the resources for models that finished loading in the background
+    if(backgroundLoading)
+    {
+        loadJobs.RunDeviceJobs();
+        if(loadJobs.Idle())
+        {
+            backgroundLoading = false;
+            loadTimer.Update();
+            std::string report = MakeString("All scenes loaded in %.2fms\n", loadTimer.ElapsedMillisecondsD());
+            report += TextureCache::GlobalCache.Report();
+            PrintReport(report);
+        }
+    }
+
+    // Switching to a scene that's still loading keeps showing the old one until it's ready
+    const Scene currentScene = AppSettings::CurrentScene;
+    if(currentScene != displayedScene && sceneLoads[uint64(currentScene)].Ready)
+    {
+        displayedScene = currentScene;
+        float scale = MeshScales[uint64(displayedScene)];
+        MeshStreamsView streams;
+        meshRenderer.SetSceneMesh(deviceManager.ImmediateContext(), &models[uint64(displayedScene)],
+                                  XMMatrixScaling(scale, scale, scale),
+                                  CachedStreams(modelCaches[uint64(displayedScene)], streams));
     }
 
     if (AppSettings::FreezeCascades == false)
@@ -231,9 +482,102 @@ void ShadowsApp::Update(const Timer& timer)
 
     AppSettings::Update();
 
+    if(uint32(AppSettings::NumPropInstances.Value()) != numPropInstances)
+        UpdatePropInstances();
+
     meshRenderer.Update();
 }
 
+// Scatters copies of the prop around the origin with random rotations and scales. The seed is
+// always the same, so changing the count only adds or removes instances at the end.
+void ShadowsApp::UpdatePropInstances()
+{
+    numPropInstances = uint32(AppSettings::NumPropInstances.Value());
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> positionDist(-PropAreaSize * 0.5f, PropAreaSize * 0.5f);
+    std::uniform_real_distribution<float> angleDist(0.0f, XM_2PI);
+    std::uniform_real_distribution<float> scaleDist(PropMinScale, PropMaxScale);
+
+    std::vector<Float4x4> worlds(numPropInstances);
+    for(uint32 i = 0; i < numPropInstances; ++i)
+    {
+        const float scale = scaleDist(rng);
+        const float angle = angleDist(rng);
+        const float x = positionDist(rng);
+        const float z = positionDist(rng);
+
+        Float4x4 rotation = XMMatrixRotationY(angle);
+        worlds[i] = Float4x4::ScaleMatrix(scale) * rotation;
+        worlds[i].SetTranslation(Float3(x, 0.0f, z));
+    }
+
+    meshRenderer.SetInstancedMesh(deviceManager.ImmediateContext(), &propMesh, worlds.data(), numPropInstances);
+}
+
+// Adds the scene mesh and the character to a BVH, using the same transforms that are used for rendering
+void ShadowsApp::AddSceneToBVH(Scene scene, BVH& bvh)
+{
+    WaitForScene(scene);
+
+    Float4x4 meshWorld = Float4x4::ScaleMatrix(MeshScales[uint64(scene)]);
+
+    Float4x4 characterWorld = Float4x4::ScaleMatrix(CharacterScale);
+    Float4x4 characterOrientation = Quaternion::ToFloat4x4(AppSettings::CharacterOrientation);
+    characterWorld = characterWorld * characterOrientation;
+    characterWorld.SetTranslation(CharacterPos);
+
+    bvh.AddModel(models[uint64(scene)], meshWorld);
+    bvh.AddModel(characterMesh, characterWorld);
+}
+
+// Builds a BVH for the current scene, and prints the error of each shadow technique
+// compared to ray traced visibility, along with the error of the shadow mask upsample and
+// temporal accumulation
+void ShadowsApp::PrintShadowQualityReport()
+{
+    BVH bvh;
+    AddSceneToBVH(AppSettings::CurrentScene, bvh);
+    bvh.Build();
+
+    std::string report = ShadowQualityReport(bvh, AppSettings::LightDirection, 65536);
+    report += ShadowMaskReport(bvh, camera, AppSettings::LightDirection, ShadowMaskReportWidth,
+                               uint32(ShadowMaskReportWidth / camera.AspectRatio()),
+                               AppSettings::TemporalHistoryFrames);
+    PrintReport(report);
+}
+
+// Starts the benchmark, which writes ShadowBenchmark.csv and ShadowBenchmark.json
+void ShadowsApp::StartBenchmark()
+{
+    // The benchmark switches scenes every few frames, so they all need to be loaded
+    loadJobs.WaitForAll();
+
+    benchmark.Start(L"ShadowBenchmark", [this](Scene scene, BVH& bvh) { AddSceneToBVH(scene, bvh); });
+}
+
+// Loads every mesh straight from its .sdkmesh file (skipping the mesh cache, which has compressed
+// vertices) and compares the serial and parallel tangent frame generation on it
+void ShadowsApp::RunTangentFrameBenchmark()
+{
+    const uint32 NumIterations = 5;
+
+    std::vector<wstring> paths;
+    for(uint32 i = 0; i < ArraySize_(MeshFileNames); ++i)
+        paths.push_back(wstring(L"..\\Content\\Models\\") + MeshFileNames[i]);
+    paths.push_back(L"..\\Content\\Models\\Soldier\\Soldier.sdkmesh");
+
+    for(uint64 i = 0; i < paths.size(); ++i)
+    {
+        Model model;
+        model.CreateFromSDKMeshFile(deviceManager.Device(), paths[i].c_str());
+
+        std::string report = WStringToAnsi(paths[i].c_str()) + "\n";
+        report += model.BenchmarkTangentFrames(NumIterations);
+        PrintReport(report);
+    }
+}
+
 void ShadowsApp::Render(const Timer& timer)
 {
     ID3D11DeviceContextPtr context = deviceManager.ImmediateContext();
@@ -317,7 +661,7 @@ void ShadowsApp::RenderMainPass()
     context->ClearRenderTargetView(colorTarget.RTView, clearColor);
     context->ClearDepthStencilView(ds, D3D11_CLEAR_DEPTH|D3D11_CLEAR_STENCIL, 1.0f, 0);
 
-    Float4x4 meshWorld = Float4x4::ScaleMatrix(MeshScales[AppSettings::CurrentScene]);
+    Float4x4 meshWorld = Float4x4::ScaleMatrix(MeshScales[uint64(displayedScene)]);
     Float4x4 characterWorld = Float4x4::ScaleMatrix(CharacterScale);
     Float4x4 characterOrientation = Quaternion::ToFloat4x4(AppSettings::CharacterOrientation);
     characterWorld = characterWorld * characterOrientation;
@@ -339,6 +683,9 @@ void ShadowsApp::RenderMainPass()
     else
         meshRenderer.RenderShadowMap(context, cameraForShadows, meshWorld, characterWorld);
 
+    if(AppSettings::UseShadowMask())
+        meshRenderer.RenderShadowMask(context, depthBuffer.SRView, camera);
+
     renderTargets[0] = colorTarget.RTView;
     context->OMSetRenderTargets(1, renderTargets, ds);
 
@@ -369,11 +716,60 @@ void ShadowsApp::RenderHUD()
     vsyncText += deviceManager.VSYNCEnabled() ? L"Enabled" : L"Disabled";
     spriteRenderer.RenderText(font, vsyncText.c_str(), transform, XMFLOAT4(1, 1, 0, 1));
 
+    if(benchmark.Running())
+    {
+        transform._42 += 25.0f;
+        wstring benchmarkText(L"Benchmark (B): ");
+        benchmarkText += ToString(uint32(benchmark.Progress() * 100.0f)) + L"%";
+        spriteRenderer.RenderText(font, benchmarkText.c_str(), transform, XMFLOAT4(1, 1, 0, 1));
+    }
+
     spriteRenderer.End();
 }
 
+// Returns the text after "name=" on the command line, or null if it's not there
+static const char* CommandLineValue(const char* cmdLine, const char* name)
+{
+    const char* arg = std::strstr(cmdLine, name);
+    return arg != nullptr ? arg + std::strlen(name) : nullptr;
+}
+
+// Reads the settings for the stress scene, with -stressparts=N, -stresstriangles=N,
+// -stressoccluders=F, and -stressdistribution=uniform|clustered|city
+static StressSceneDesc ParseStressScene(const char* cmdLine)
+{
+    StressSceneDesc desc;
+
+    const char* value = CommandLineValue(cmdLine, "-stressparts=");
+    if(value != nullptr)
+        desc.NumParts = Clamp<uint32>(uint32(std::atoi(value)), 1, MaxStressSceneParts);
+
+    value = CommandLineValue(cmdLine, "-stresstriangles=");
+    if(value != nullptr)
+        desc.TrianglesPerPart = std::max<uint32>(uint32(std::atoi(value)), 12);
+
+    value = CommandLineValue(cmdLine, "-stressoccluders=");
+    if(value != nullptr)
+        desc.OccluderShare = Saturate(float(std::atof(value)));
+
+    value = CommandLineValue(cmdLine, "-stressdistribution=");
+    if(value != nullptr && std::strncmp(value, "clustered", 9) == 0)
+        desc.PartDistribution = StressSceneDesc::Clustered;
+    else if(value != nullptr && std::strncmp(value, "city", 4) == 0)
+        desc.PartDistribution = StressSceneDesc::CityGrid;
+
+    return desc;
+}
+
 int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nShowCmd)
 {
     ShadowsApp app;
+    if(std::strstr(lpCmdLine, "-benchmark") != nullptr)
+        app.RunBenchmarkOnStartup();
+    if(std::strstr(lpCmdLine, "-fullvertices") != nullptr)
+        app.UseFullPrecisionVertices();
+    if(std::strstr(lpCmdLine, "-tangentbenchmark") != nullptr)
+        app.RunTangentBenchmarkOnStartup();
+    app.SetStressScene(ParseStressScene(lpCmdLine));
     app.Run();
 }
\ No newline at end of file
@@ -22,9 +22,12 @@
 #include "SampleFramework11/GraphicsTypes.h"
 #include "SampleFramework11/Slider.h"
 #include "SampleFramework11/SH.h"
+#include "SampleFramework11/JobGraph.h"
+#include "SampleFramework11/Timer.h"
 
 #include "PostProcessor.h"
 #include "MeshRenderer.h"
+#include "ShadowBenchmark.h"
 
 using namespace SampleFramework11;
 
@@ -43,10 +46,41 @@ protected:
     RenderTarget2D colorTarget;
     RenderTarget2D resolveTarget;
 
-    // Model
+    // Model, with the caches declared first so that they outlive the models that point into them
+    MeshCache modelCaches[uint64(Scene::NumValues)];
+    MeshCache characterCache;
     Model models[uint64(Scene::NumValues)];
     Model characterMesh;
+    Model propMesh;
     MeshRenderer meshRenderer;
+    uint32 numPropInstances;
+
+    // Textures that have been decoded for a model that's still loading, and whether its
+    // resources have been created. Only touched by the jobs that load the model until it's ready.
+    struct ModelLoad
+    {
+        std::vector<MeshMaterialTextures> Textures;
+        bool Ready;
+
+        ModelLoad() : Ready(false)
+        {
+        }
+    };
+
+    ModelLoad sceneLoads[uint64(Scene::NumValues)];
+    ModelLoad characterLoad;
+    Scene displayedScene;
+    Timer loadTimer;
+    bool backgroundLoading;
+
+    ShadowBenchmark benchmark;
+    bool benchmarkOnStartup;
+    bool compressVertices;
+    bool tangentBenchmarkOnStartup;
+    StressSceneDesc stressScene;
+
+    // Declared last, so that the workers get stopped before anything they're loading into is destroyed
+    JobGraph loadJobs;
 
     virtual void Initialize() override;
     virtual void Render(const Timer& timer) override;
@@ -56,11 +90,36 @@ protected:
 
     void CreateRenderTargets();
 
+    void LoadAsync(std::function<void()> loadData, const std::wstring& textureDirectory, Model& model,
+                   ModelLoad& load);
+    void LoadModelAsync(const std::wstring& path, Model& model, MeshCache& cache, ModelLoad& load);
+    void LoadStressSceneAsync(Model& model, MeshCache& cache, ModelLoad& load);
+    void WaitForScene(Scene scene);
+
     void RenderMainPass();
     void RenderHUD();
 
+    void UpdatePropInstances();
+
+    void AddSceneToBVH(Scene scene, BVH& bvh);
+    void PrintShadowQualityReport();
+    void StartBenchmark();
+    void RunTangentFrameBenchmark();
+
 public:
 
     ShadowsApp();
+
+    // Runs the benchmark as soon as everything is loaded, and exits when it's done
+    void RunBenchmarkOnStartup() { benchmarkOnStartup = true; }
+
+    // Loads the meshes with the source file's vertex format instead of the compressed one
+    void UseFullPrecisionVertices() { compressVertices = false; }
+
+    // Times the serial and parallel tangent frame generation on every mesh before loading
+    void RunTangentBenchmarkOnStartup() { tangentBenchmarkOnStartup = true; }
+
+    // Sets what gets generated for the stress scene
+    void SetStressScene(const StressSceneDesc& desc) { stressScene = desc; }
 };
 
@@ -38,6 +38,23 @@ static const uint NumCascades = 4;
 
 static const float MaxKernelSize = 9.0f;
 
+// Upper limit on the PCSS blocker search and penumbra widths, in texels
+static const float MaxPCSSKernelSize = 32.0f;
+static const uint NumPCSSBlockerSamples = 16;
+
+// Bilateral upsampling of the shadow mask: texels whose depth differs from the pixel's by more
+// than this fraction of the pixel's depth get no weight, and if the total weight ends up below
+// the minimum the texel that's closest in depth is used instead
+static const float ShadowMaskDepthThreshold = 0.05f;
+static const float ShadowMaskMinWeight = 0.001f;
+
+// Temporal accumulation of the shadow mask: history gets thrown away if its depth is further
+// than this fraction of the depth that the pixel had from the previous frame's camera
+static const float ShadowHistoryDepthThreshold = 0.02f;
+
+// Fractional part of the golden ratio, used for rotating the sample pattern every frame
+static const float GoldenRatioFrac = 0.618033989f;
+
 // Structures
 struct DrawCall
 {
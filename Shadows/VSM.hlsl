@@ -8,6 +8,11 @@
 //
 //=================================================================================================
 
+//=================================================================================================
+// Includes
+//=================================================================================================
+#include "MomentEncoding.h"
+
 //=================================================================================================
 // Constants
 //=================================================================================================
@@ -15,14 +20,16 @@
 #define ShadowModeGridPCF_ 1
 #define ShadowModeRandomDiscPCF_ 2
 #define ShadowModeOptimizedPCF_ 3
-#define ShadowModeVSM_ 4
-#define ShadowModeEVSM2_ 5
-#define ShadowModeEVSM4_ 6
-#define ShadowModeMSMHamburger_ 7
-#define ShadowModeMSMHausdorff_ 8
+#define ShadowModePCSS_ 4
+#define ShadowModeVSM_ 5
+#define ShadowModeEVSM2_ 6
+#define ShadowModeEVSM4_ 7
+#define ShadowModeMSMHamburger_ 8
+#define ShadowModeMSMHausdorff_ 9
+#define ShadowModeESM_ 10
 
 #ifndef ShadowMode_
-    #define ShadowMode_ 4
+    #define ShadowMode_ 5
 #endif
 
 #if ShadowMode_ == ShadowModeEVSM2_ || ShadowMode_ == ShadowModeEVSM4_
@@ -31,12 +38,20 @@
     #define UseEVSM_ 0
 #endif
 
+#if ShadowMode_ == ShadowModeESM_
+    #define UseESM_ 1
+#else
+    #define UseESM_ 0
+#endif
+
 static const uint SMFormat16Bit = 0;
 static const uint SMFormat32Bit = 1;
+static const uint SMFormat16BitOptimized = 2;
+static const uint SMFormat16BitRaw = 3;
 
 float2 GetEVSMExponents(in float positiveExponent, in float negativeExponent, in uint vsmFormat)
 {
-    const float maxExponent = vsmFormat == SMFormat16Bit ? 5.54f : 42.0f;
+    const float maxExponent = vsmFormat == SMFormat32Bit ? 42.0f : 5.54f;
 
     float2 lightSpaceExponents = float2(positiveExponent, negativeExponent);
 
@@ -44,6 +59,13 @@ float2 GetEVSMExponents(in float positiveExponent, in float negativeExponent, in
     return min(lightSpaceExponents, maxExponent);
 }
 
+// ESM only stores the warped depth and not its square, so it can use twice the range of EVSM
+float GetESMExponent(in float positiveExponent, in uint vsmFormat)
+{
+    const float maxExponent = vsmFormat == SMFormat32Bit ? 84.0f : 11.08f;
+    return min(positiveExponent, maxExponent);
+}
+
 // Applies exponential warp to shadow map depth, input depth should be in [0, 1]
 float2 WarpDepth(float depth, float2 exponents)
 {
@@ -85,6 +85,8 @@ float4 ConvertToVSM(in VSOutput input) : SV_Target0
 
     #if UseEVSM_
         float2 exponents = GetEVSMExponents(PositiveExponent, NegativeExponent, SMFormat);
+    #elif UseESM_
+        float2 exponents = float2(GetESMExponent(PositiveExponent, SMFormat), 0.0f);
     #endif
 
     float4 average = float4(0.0f, 0.0f, 0.0f, 0.0f);
@@ -101,24 +103,28 @@ float4 ConvertToVSM(in VSOutput input) : SV_Target0
         #endif
 
         #if UseMSM_
+            // Both 16-bit UNORM formats use the optimized basis, only the raw one doesn't
             float4 msmDepth = 0.0f;
-            if(SMFormat == SMFormat_SM16Bit)
+            if(SMFormat == SMFormat_SM16Bit || SMFormat == SMFormat_SM16BitOptimized)
                 msmDepth = GetOptimizedMoments(depth);
             else
-                msmDepth = float4(depth, depth * depth, depth * depth * depth, depth * depth * depth * depth);
+                msmDepth = GetMSMMoments(depth);
             average += sampleWeight * msmDepth;
-        #else
-            #if UseEVSM_
-                float2 vsmDepth = WarpDepth(depth, exponents);
-            #else
-                float2 vsmDepth = depth;
-            #endif
-
+        #elif UseEVSM_
+            float2 vsmDepth = WarpDepth(depth, exponents);
             average += sampleWeight * float4(vsmDepth.xy, vsmDepth.xy * vsmDepth.xy);
+        #elif UseESM_
+            float esmDepth = WarpDepth(depth, exponents).x;
+            average += sampleWeight * esmDepth;
+        #else
+            float2 vsmMoments = float2(depth, depth * depth);
+            if(SMFormat == SMFormat_SM16BitOptimized)
+                vsmMoments = GetOptimizedVSMMoments(depth);
+            average += sampleWeight * vsmMoments.xxyy;
         #endif
     }
 
-    #if ShadowMode_ == ShadowModeEVSM4_ || UseMSM_
+    #if ShadowMode_ == ShadowModeEVSM4_ || UseMSM_ || UseESM_
         return average;
     #else
         return average.xzxz;
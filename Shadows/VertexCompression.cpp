@@ -0,0 +1,521 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include <immintrin.h>
+
+#include "VertexCompression.h"
+#include "PositionQuantization.h"
+#include "MomentQuantization.h"
+
+#include "SampleFramework11/Utility.h"
+
+static const float SNorm16Scale = 32767.0f;
+
+// Smallest |w| that a QTangent can have, so that w never quantizes to 0 and loses its sign
+static const float QTangentMinW = 1.0f / 32767.0f;
+
+// Finds the index of the vertex element with the given semantic
+static uint32 VertexElementIndex(const Mesh& mesh, const char* semanticName, uint32 semanticIndex)
+{
+    for(uint32 elemIdx = 0; elemIdx < mesh.NumInputElements(); ++elemIdx)
+    {
+        const D3D11_INPUT_ELEMENT_DESC& elem = mesh.InputElements()[elemIdx];
+        if(strcmp(semanticName, elem.SemanticName) == 0 && elem.SemanticIndex == semanticIndex)
+            return elemIdx;
+    }
+
+    return uint32(-1);
+}
+
+VertexFormat GetVertexFormat(const Mesh& mesh)
+{
+    if(VertexElementIndex(mesh, "QTANGENT", 0) != uint32(-1))
+        return VertexFormat::QTangent;
+
+    const uint32 nmlIdx = VertexElementIndex(mesh, "NORMAL", 0);
+    if(nmlIdx != uint32(-1) && mesh.InputElements()[nmlIdx].Format == DXGI_FORMAT_R16G16_SNORM)
+        return VertexFormat::Octahedral;
+
+    return VertexFormat::Float;
+}
+
+// Copies the sign of a onto the magnitude of b
+static __m128 CopySign(__m128 a, __m128 b)
+{
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    return _mm_or_ps(_mm_and_ps(a, signMask), _mm_andnot_ps(signMask, b));
+}
+
+static __m128 Abs(__m128 v)
+{
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+}
+
+static __m128 Select(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static void Normalize(__m128& x, __m128& y, __m128& z)
+{
+    const __m128 lenSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+    const __m128 invLen = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_max_ps(lenSq, _mm_set1_ps(1e-20f))));
+    x = _mm_mul_ps(x, invLen);
+    y = _mm_mul_ps(y, invLen);
+    z = _mm_mul_ps(z, invLen);
+}
+
+static void Cross(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz,
+                  __m128& x, __m128& y, __m128& z)
+{
+    x = _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by));
+    y = _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz));
+    z = _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx));
+}
+
+// Loads 4 Float3's into SoA form. Past the end of the array the last value gets repeated, so
+// that the tail doesn't need a separate scalar path.
+static void LoadFloat3x4(const Float3* v, uint64 count, __m128& x, __m128& y, __m128& z)
+{
+    const Float3& v0 = v[0];
+    const Float3& v1 = v[std::min<uint64>(1, count - 1)];
+    const Float3& v2 = v[std::min<uint64>(2, count - 1)];
+    const Float3& v3 = v[std::min<uint64>(3, count - 1)];
+    x = _mm_setr_ps(v0.x, v1.x, v2.x, v3.x);
+    y = _mm_setr_ps(v0.y, v1.y, v2.y, v3.y);
+    z = _mm_setr_ps(v0.z, v1.z, v2.z, v3.z);
+}
+
+static void StoreFloat3x4(__m128 x, __m128 y, __m128 z, uint64 count, Float3* v)
+{
+    Float4Align float xs[4];
+    Float4Align float ys[4];
+    Float4Align float zs[4];
+    _mm_store_ps(xs, x);
+    _mm_store_ps(ys, y);
+    _mm_store_ps(zs, z);
+    for(uint64 i = 0; i < std::min<uint64>(count, 4); ++i)
+        v[i] = Float3(xs[i], ys[i], zs[i]);
+}
+
+// Converts to SNORM with round-to-nearest, and packs to 16-bit with saturation
+static __m128i FloatToSNorm16(__m128 a, __m128 b)
+{
+    const __m128 scale = _mm_set1_ps(SNorm16Scale);
+    const __m128i ia = _mm_cvtps_epi32(_mm_mul_ps(a, scale));
+    const __m128i ib = _mm_cvtps_epi32(_mm_mul_ps(b, scale));
+    return _mm_packs_epi32(ia, ib);
+}
+
+// Sign extends 16-bit SNORM values to float, clamping -32768 to -1 the same way that D3D does
+static void SNorm16ToFloat(__m128i v, __m128& lo, __m128& hi)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scale = _mm_set1_ps(1.0f / SNorm16Scale);
+    const __m128 minusOne = _mm_set1_ps(-1.0f);
+    lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(zero, v), 16));
+    hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(zero, v), 16));
+    lo = _mm_max_ps(_mm_mul_ps(lo, scale), minusOne);
+    hi = _mm_max_ps(_mm_mul_ps(hi, scale), minusOne);
+}
+
+void EncodeOctahedral(const Float3* normals, uint64 count, int16* encoded)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    for(uint64 i = 0; i < count; i += 4)
+    {
+        __m128 x, y, z;
+        LoadFloat3x4(normals + i, count - i, x, y, z);
+
+        // Project onto the octahedron, and fold the lower hemisphere over the diagonals
+        const __m128 invL1 = _mm_div_ps(one, _mm_max_ps(_mm_add_ps(_mm_add_ps(Abs(x), Abs(y)), Abs(z)),
+                                                        _mm_set1_ps(1e-20f)));
+        __m128 px = _mm_mul_ps(x, invL1);
+        __m128 py = _mm_mul_ps(y, invL1);
+
+        const __m128 foldedX = CopySign(px, _mm_sub_ps(one, Abs(py)));
+        const __m128 foldedY = CopySign(py, _mm_sub_ps(one, Abs(px)));
+        const __m128 lower = _mm_cmplt_ps(z, zero);
+        px = _mm_max_ps(_mm_min_ps(Select(lower, foldedX, px), one), _mm_sub_ps(zero, one));
+        py = _mm_max_ps(_mm_min_ps(Select(lower, foldedY, py), one), _mm_sub_ps(zero, one));
+
+        // Interleave to x0 y0 x1 y1 x2 y2 x3 y3
+        const __m128i packed = FloatToSNorm16(_mm_unpacklo_ps(px, py), _mm_unpackhi_ps(px, py));
+        if(i + 4 <= count)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(encoded + i * 2), packed);
+        }
+        else
+        {
+            Float4Align int16 tail[8];
+            _mm_store_si128(reinterpret_cast<__m128i*>(tail), packed);
+            memcpy(encoded + i * 2, tail, (count - i) * 2 * sizeof(int16));
+        }
+    }
+}
+
+void DecodeOctahedral(const int16* encoded, uint64 count, Float3* normals)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    for(uint64 i = 0; i < count; i += 4)
+    {
+        __m128i v;
+        if(i + 4 <= count)
+        {
+            v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(encoded + i * 2));
+        }
+        else
+        {
+            Float4Align int16 tail[8] = { };
+            memcpy(tail, encoded + i * 2, (count - i) * 2 * sizeof(int16));
+            v = _mm_load_si128(reinterpret_cast<const __m128i*>(tail));
+        }
+
+        __m128 lo, hi;
+        SNorm16ToFloat(v, lo, hi);
+        __m128 x = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 y = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 z = _mm_sub_ps(_mm_sub_ps(one, Abs(x)), Abs(y));
+
+        // Unfold the lower hemisphere
+        const __m128 t = _mm_max_ps(_mm_sub_ps(zero, z), zero);
+        x = _mm_sub_ps(x, CopySign(x, t));
+        y = _mm_sub_ps(y, CopySign(y, t));
+
+        Normalize(x, y, z);
+        StoreFloat3x4(x, y, z, count - i, normals + i);
+    }
+}
+
+void EncodeQTangents(const Float3* normals, const Float3* tangents, const Float3* bitangents,
+                     uint64 count, int16* encoded)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    for(uint64 i = 0; i < count; i += 4)
+    {
+        __m128 nx, ny, nz, tx, ty, tz, bx, by, bz;
+        LoadFloat3x4(normals + i, count - i, nx, ny, nz);
+        LoadFloat3x4(tangents + i, count - i, tx, ty, tz);
+        LoadFloat3x4(bitangents + i, count - i, bx, by, bz);
+
+        // Gram-Schmidt, so that the frame is a rotation
+        Normalize(nx, ny, nz);
+        const __m128 nDotT = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, tx), _mm_mul_ps(ny, ty)), _mm_mul_ps(nz, tz));
+        tx = _mm_sub_ps(tx, _mm_mul_ps(nx, nDotT));
+        ty = _mm_sub_ps(ty, _mm_mul_ps(ny, nDotT));
+        tz = _mm_sub_ps(tz, _mm_mul_ps(nz, nDotT));
+        Normalize(tx, ty, tz);
+
+        __m128 cx, cy, cz;
+        Cross(nx, ny, nz, tx, ty, tz, cx, cy, cz);
+        const __m128 handedness = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, bx), _mm_mul_ps(cy, by)), _mm_mul_ps(cz, bz));
+
+        // Branchless conversion of the matrix with columns T, N x T, and N to a quaternion
+        const __m128 r00 = tx;
+        const __m128 r11 = cy;
+        const __m128 r22 = nz;
+        __m128 qw = _mm_add_ps(_mm_add_ps(one, r00), _mm_add_ps(r11, r22));
+        __m128 qx = _mm_sub_ps(_mm_sub_ps(_mm_add_ps(one, r00), r11), r22);
+        __m128 qy = _mm_sub_ps(_mm_add_ps(_mm_sub_ps(one, r00), r11), r22);
+        __m128 qz = _mm_add_ps(_mm_sub_ps(_mm_sub_ps(one, r00), r11), r22);
+        qw = _mm_mul_ps(_mm_sqrt_ps(_mm_max_ps(qw, zero)), half);
+        qx = CopySign(_mm_sub_ps(cz, ny), _mm_mul_ps(_mm_sqrt_ps(_mm_max_ps(qx, zero)), half));
+        qy = CopySign(_mm_sub_ps(nx, tz), _mm_mul_ps(_mm_sqrt_ps(_mm_max_ps(qy, zero)), half));
+        qz = CopySign(_mm_sub_ps(ty, cx), _mm_mul_ps(_mm_sqrt_ps(_mm_max_ps(qz, zero)), half));
+
+        const __m128 qLenSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy)),
+                                         _mm_add_ps(_mm_mul_ps(qz, qz), _mm_mul_ps(qw, qw)));
+        const __m128 invQLen = _mm_div_ps(one, _mm_sqrt_ps(qLenSq));
+        qx = _mm_mul_ps(qx, invQLen);
+        qy = _mm_mul_ps(qy, invQLen);
+        qz = _mm_mul_ps(qz, invQLen);
+        qw = _mm_max_ps(_mm_mul_ps(qw, invQLen), _mm_set1_ps(QTangentMinW));
+
+        // q and -q are the same rotation, so the sign of w is free to store the handedness
+        const __m128 flip = _mm_and_ps(_mm_cmplt_ps(handedness, zero), _mm_set1_ps(-0.0f));
+        qx = _mm_xor_ps(qx, flip);
+        qy = _mm_xor_ps(qy, flip);
+        qz = _mm_xor_ps(qz, flip);
+        qw = _mm_xor_ps(qw, flip);
+
+        _MM_TRANSPOSE4_PS(qx, qy, qz, qw);
+        const __m128i packed01 = FloatToSNorm16(qx, qy);
+        const __m128i packed23 = FloatToSNorm16(qz, qw);
+        if(i + 4 <= count)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(encoded + i * 4), packed01);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(encoded + i * 4 + 8), packed23);
+        }
+        else
+        {
+            Float4Align int16 tail[16];
+            _mm_store_si128(reinterpret_cast<__m128i*>(tail), packed01);
+            _mm_store_si128(reinterpret_cast<__m128i*>(tail + 8), packed23);
+            memcpy(encoded + i * 4, tail, (count - i) * 4 * sizeof(int16));
+        }
+    }
+}
+
+void DecodeQTangents(const int16* encoded, uint64 count, Float3* normals, Float3* tangents,
+                     Float3* bitangents)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+
+    for(uint64 i = 0; i < count; i += 4)
+    {
+        __m128i v01, v23;
+        if(i + 4 <= count)
+        {
+            v01 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(encoded + i * 4));
+            v23 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(encoded + i * 4 + 8));
+        }
+        else
+        {
+            Float4Align int16 tail[16] = { };
+            memcpy(tail, encoded + i * 4, (count - i) * 4 * sizeof(int16));
+            v01 = _mm_load_si128(reinterpret_cast<const __m128i*>(tail));
+            v23 = _mm_load_si128(reinterpret_cast<const __m128i*>(tail + 8));
+        }
+
+        __m128 qx, qy, qz, qw;
+        SNorm16ToFloat(v01, qx, qy);
+        SNorm16ToFloat(v23, qz, qw);
+        _MM_TRANSPOSE4_PS(qx, qy, qz, qw);
+
+        const __m128 qLenSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy)),
+                                         _mm_add_ps(_mm_mul_ps(qz, qz), _mm_mul_ps(qw, qw)));
+        const __m128 invQLen = _mm_div_ps(one, _mm_sqrt_ps(_mm_max_ps(qLenSq, _mm_set1_ps(1e-20f))));
+        qx = _mm_mul_ps(qx, invQLen);
+        qy = _mm_mul_ps(qy, invQLen);
+        qz = _mm_mul_ps(qz, invQLen);
+        qw = _mm_mul_ps(qw, invQLen);
+
+        const __m128 xx = _mm_mul_ps(qx, qx);
+        const __m128 yy = _mm_mul_ps(qy, qy);
+        const __m128 zz = _mm_mul_ps(qz, qz);
+        const __m128 xy = _mm_mul_ps(qx, qy);
+        const __m128 xz = _mm_mul_ps(qx, qz);
+        const __m128 yz = _mm_mul_ps(qy, qz);
+        const __m128 xw = _mm_mul_ps(qx, qw);
+        const __m128 yw = _mm_mul_ps(qy, qw);
+        const __m128 zw = _mm_mul_ps(qz, qw);
+
+        const __m128 nx = _mm_mul_ps(two, _mm_add_ps(xz, yw));
+        const __m128 ny = _mm_mul_ps(two, _mm_sub_ps(yz, xw));
+        const __m128 nz = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)));
+        const __m128 tx = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)));
+        const __m128 ty = _mm_mul_ps(two, _mm_add_ps(xy, zw));
+        const __m128 tz = _mm_mul_ps(two, _mm_sub_ps(xz, yw));
+
+        __m128 bx, by, bz;
+        Cross(nx, ny, nz, tx, ty, tz, bx, by, bz);
+        const __m128 flip = _mm_and_ps(_mm_cmplt_ps(qw, zero), _mm_set1_ps(-0.0f));
+        bx = _mm_xor_ps(bx, flip);
+        by = _mm_xor_ps(by, flip);
+        bz = _mm_xor_ps(bz, flip);
+
+        StoreFloat3x4(nx, ny, nz, count - i, normals + i);
+        if(tangents != nullptr)
+            StoreFloat3x4(tx, ty, tz, count - i, tangents + i);
+        if(bitangents != nullptr)
+            StoreFloat3x4(bx, by, bz, count - i, bitangents + i);
+    }
+}
+
+// Reads one element of every vertex, with a float format
+template<typename T> static void ReadElement(const Mesh& mesh, uint32 elemIdx, std::vector<T>& values)
+{
+    values.resize(mesh.NumVertices());
+    const uint8* vtx = mesh.Vertices() + mesh.InputElements()[elemIdx].AlignedByteOffset;
+    for(uint32 i = 0; i < mesh.NumVertices(); ++i)
+        memcpy(&values[i], vtx + uint64(i) * mesh.VertexStride(), sizeof(T));
+}
+
+void DecodePositions(const Mesh& mesh, std::vector<Float3>& positions)
+{
+    const uint32 posIdx = VertexElementIndex(mesh, "POSITION", 0);
+    Assert_(posIdx != uint32(-1));
+
+    const D3D11_INPUT_ELEMENT_DESC& posElem = mesh.InputElements()[posIdx];
+    if(posElem.Format == DXGI_FORMAT_R32G32B32_FLOAT)
+    {
+        ReadElement(mesh, posIdx, positions);
+        return;
+    }
+
+    Assert_(posElem.Format == DXGI_FORMAT_R16G16B16A16_UNORM);
+
+    const uint32 numVertices = mesh.NumVertices();
+    std::vector<uint16> quantized(uint64(numVertices) * 4);
+    const uint8* vtx = mesh.Vertices() + posElem.AlignedByteOffset;
+    for(uint32 i = 0; i < numVertices; ++i)
+        memcpy(&quantized[i * 4], vtx + uint64(i) * mesh.VertexStride(), QuantizedPositionStride);
+
+    std::vector<float> normalized(quantized.size());
+    UNorm16ToFloat(quantized.data(), normalized.data(), quantized.size());
+
+    positions.resize(numVertices);
+    for(uint32 i = 0; i < numVertices; ++i)
+    {
+        const Float3 n(normalized[i * 4 + 0], normalized[i * 4 + 1], normalized[i * 4 + 2]);
+        positions[i] = n * mesh.PositionScale() + mesh.PositionBias();
+    }
+}
+
+// Angle between two unit vectors, in degrees
+static float AngleBetween(const Float3& a, const Float3& b)
+{
+    return std::acos(Clamp(Float3::Dot(a, b), -1.0f, 1.0f)) * (180.0f / XM_PI);
+}
+
+std::string CompressModelVertices(ID3D11Device* device, Model& model)
+{
+    std::string report = "Vertex compression\n";
+    report += MakeString("%-24s %-10s %9s %7s %7s %10s %10s %10s\n", "Mesh", "Format", "Vertices", "Before",
+                         "After", "Pos Error", "Nml Error", "UV Error");
+
+    uint64 totalBefore = 0;
+    uint64 totalAfter = 0;
+
+    for(Mesh& mesh : model.Meshes())
+    {
+        if(GetVertexFormat(mesh) != VertexFormat::Float)
+            continue;
+
+        const uint32 posIdx = VertexElementIndex(mesh, "POSITION", 0);
+        const uint32 nmlIdx = VertexElementIndex(mesh, "NORMAL", 0);
+        const uint32 uvIdx = VertexElementIndex(mesh, "TEXCOORD", 0);
+        const uint32 tanIdx = VertexElementIndex(mesh, "TANGENT", 0);
+        const uint32 bitanIdx = VertexElementIndex(mesh, "BITANGENT", 0);
+        if(posIdx == uint32(-1) || nmlIdx == uint32(-1) || uvIdx == uint32(-1))
+            continue;
+
+        const uint32 numVertices = mesh.NumVertices();
+        std::vector<Float3> positions;
+        std::vector<Float3> normals;
+        std::vector<Float2> uvs;
+        ReadElement(mesh, posIdx, positions);
+        ReadElement(mesh, nmlIdx, normals);
+        ReadElement(mesh, uvIdx, uvs);
+
+        for(Float3& normal : normals)
+            normal = Float3::Length(normal) > 0.0f ? Float3::Normalize(normal) : Float3(0.0f, 0.0f, 1.0f);
+
+        // Meshes with a tangent frame keep the whole thing, since the bitangent sign can't be
+        // recovered from just the normal
+        const VertexFormat format = tanIdx != uint32(-1) ? VertexFormat::QTangent : VertexFormat::Octahedral;
+        const uint32 normalSize = format == VertexFormat::QTangent ? sizeof(int16) * 4 : sizeof(int16) * 2;
+        const uint32 stride = QuantizedPositionStride + normalSize + sizeof(uint16) * 2;
+
+        std::vector<uint16> quantizedPositions(uint64(numVertices) * 4);
+        const PositionQuantization quantization = QuantizePositions(positions.data(), numVertices,
+                                                                    quantizedPositions.data());
+
+        std::vector<int16> encodedNormals(uint64(numVertices) * normalSize / sizeof(int16));
+        std::vector<Float3> decodedNormals(numVertices);
+        if(format == VertexFormat::QTangent)
+        {
+            std::vector<Float3> tangents;
+            std::vector<Float3> bitangents;
+            ReadElement(mesh, tanIdx, tangents);
+            if(bitanIdx != uint32(-1))
+            {
+                ReadElement(mesh, bitanIdx, bitangents);
+            }
+            else
+            {
+                bitangents.resize(numVertices);
+                for(uint32 i = 0; i < numVertices; ++i)
+                    bitangents[i] = Float3::Cross(normals[i], tangents[i]);
+            }
+
+            // Degenerate tangents still need to be perpendicular to the normal
+            for(uint32 i = 0; i < numVertices; ++i)
+            {
+                const Float3 t = tangents[i] - normals[i] * Float3::Dot(normals[i], tangents[i]);
+                if(Float3::Length(t) < 1e-6f)
+                    tangents[i] = Float3::Perpendicular(normals[i]);
+            }
+
+            EncodeQTangents(normals.data(), tangents.data(), bitangents.data(), numVertices, encodedNormals.data());
+            DecodeQTangents(encodedNormals.data(), numVertices, decodedNormals.data(), nullptr, nullptr);
+        }
+        else
+        {
+            EncodeOctahedral(normals.data(), numVertices, encodedNormals.data());
+            DecodeOctahedral(encodedNormals.data(), numVertices, decodedNormals.data());
+        }
+
+        std::vector<uint16> halfUVs(uint64(numVertices) * 2);
+        std::vector<Float2> decodedUVs(numVertices);
+        FloatToHalf(reinterpret_cast<const float*>(uvs.data()), halfUVs.data(), halfUVs.size());
+        HalfToFloat(halfUVs.data(), reinterpret_cast<float*>(decodedUVs.data()), halfUVs.size());
+
+        float maxNormalError = 0.0f;
+        float maxUVError = 0.0f;
+        for(uint32 i = 0; i < numVertices; ++i)
+        {
+            maxNormalError = std::max(maxNormalError, AngleBetween(normals[i], decodedNormals[i]));
+            maxUVError = std::max(maxUVError, std::max(std::abs(uvs[i].x - decodedUVs[i].x),
+                                                       std::abs(uvs[i].y - decodedUVs[i].y)));
+        }
+
+        // Interleave the streams
+        std::vector<uint8> vertices(uint64(numVertices) * stride);
+        for(uint32 i = 0; i < numVertices; ++i)
+        {
+            uint8* vtx = &vertices[uint64(i) * stride];
+            memcpy(vtx, &quantizedPositions[i * 4], QuantizedPositionStride);
+            memcpy(vtx + QuantizedPositionStride, &encodedNormals[uint64(i) * normalSize / sizeof(int16)], normalSize);
+            memcpy(vtx + QuantizedPositionStride + normalSize, &halfUVs[i * 2], sizeof(uint16) * 2);
+        }
+
+        D3D11_INPUT_ELEMENT_DESC elements[3] = { };
+        elements[0].SemanticName = "POSITION";
+        elements[0].Format = DXGI_FORMAT_R16G16B16A16_UNORM;
+        elements[0].AlignedByteOffset = 0;
+        elements[1].SemanticName = format == VertexFormat::QTangent ? "QTANGENT" : "NORMAL";
+        elements[1].Format = format == VertexFormat::QTangent ? DXGI_FORMAT_R16G16B16A16_SNORM : DXGI_FORMAT_R16G16_SNORM;
+        elements[1].AlignedByteOffset = QuantizedPositionStride;
+        elements[2].SemanticName = "TEXCOORD";
+        elements[2].Format = DXGI_FORMAT_R16G16_FLOAT;
+        elements[2].AlignedByteOffset = QuantizedPositionStride + normalSize;
+        for(D3D11_INPUT_ELEMENT_DESC& element : elements)
+            element.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+        const uint32 strideBefore = mesh.VertexStride();
+        mesh.SetVertexFormat(device, vertices.data(), stride, elements, ArraySize_(elements));
+        mesh.SetPositionDequantization(quantization.Scale, quantization.Bias);
+
+        totalBefore += uint64(numVertices) * strideBefore;
+        totalAfter += uint64(numVertices) * stride;
+
+        report += MakeString("%-24s %-10s %9u %5u B %5u B %10.6f %8.4f deg %10.6f\n", mesh.Name().c_str(),
+                             format == VertexFormat::QTangent ? "QTangent" : "Octahedral", numVertices,
+                             strideBefore, stride, quantization.MaxError, maxNormalError, maxUVError);
+    }
+
+    if(totalBefore > 0)
+        report += MakeString("Total: %.2f MB -> %.2f MB (%.1f%% smaller)\n", totalBefore / (1024.0 * 1024.0),
+                             totalAfter / (1024.0 * 1024.0), 100.0 * (1.0 - double(totalAfter) / totalBefore));
+
+    return report;
+}
@@ -0,0 +1,53 @@
+//=================================================================================================
+//
+//	Shadows Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+#include "SampleFramework11/Math.h"
+#include "SampleFramework11/Model.h"
+
+using namespace SampleFramework11;
+
+// Compact vertex layouts for the main pass. Positions are stored as 16-bit UNORM relative to the
+// bounds of the mesh (the scale and bias are stored in the Mesh and applied in the vertex
+// shader), and texture coordinates as halfs. Meshes with a tangent frame store it as a
+// quaternion with the handedness in the sign of w (a "QTangent"), and meshes without one store
+// an octahedral-encoded normal. These need to match the VertexFormat_ values in Mesh.hlsl.
+enum class VertexFormat
+{
+    Float = 0,          // Whatever the source file had
+    Octahedral = 1,     // UNORM16x4 position, SNORM16x2 normal, half2 texcoord (16 bytes)
+    QTangent = 2,       // UNORM16x4 position, SNORM16x4 tangent frame, half2 texcoord (20 bytes)
+
+    NumValues
+};
+
+// Works out the format from the mesh's input elements
+VertexFormat GetVertexFormat(const Mesh& mesh);
+
+// Octahedral normal encoding, 4 normals at a time with SSE2. Each normal takes 2 SNORM values.
+void EncodeOctahedral(const Float3* normals, uint64 count, int16* encoded);
+void DecodeOctahedral(const int16* encoded, uint64 count, Float3* normals);
+
+// Tangent frame encoding, 4 frames at a time with SSE2. The tangent gets orthogonalized against
+// the normal, and only the sign of the bitangent is kept. Each frame takes 4 SNORM values.
+void EncodeQTangents(const Float3* normals, const Float3* tangents, const Float3* bitangents,
+                     uint64 count, int16* encoded);
+void DecodeQTangents(const int16* encoded, uint64 count, Float3* normals, Float3* tangents,
+                     Float3* bitangents);
+
+// Reads the object space positions of a mesh, in any of the vertex formats
+void DecodePositions(const Mesh& mesh, std::vector<Float3>& positions);
+
+// Converts every mesh in the model to one of the compressed formats, and returns a report with
+// the memory savings and the error of each attribute. Elements that aren't used for rendering
+// (such as blend weights) get dropped.
+std::string CompressModelVertices(ID3D11Device* device, Model& model);